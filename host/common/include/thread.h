@@ -60,10 +60,55 @@
         assert(status == 0 && "Mutex unlock failure");\
     } while (0)
 
+#   define MUTEX_DESTROY(m) do { \
+        int status = pthread_mutex_destroy(m); \
+        assert(status == 0 && "Mutex destroy failure");\
+    } while (0)
+
 #else
 #   define MUTEX_INIT(m) pthread_mutex_init(m, NULL)
 #   define MUTEX_LOCK(m) pthread_mutex_lock(m)
 #   define MUTEX_UNLOCK(m) pthread_mutex_unlock(m)
+#   define MUTEX_DESTROY(m) pthread_mutex_destroy(m)
+#endif
+
+/* Atomic accessors for values that are handed off between threads without
+ * holding a lock. Loads have acquire semantics and stores have release
+ * semantics. The _SC variants are sequentially consistent, and are required
+ * where a store must not be reordered with a subsequent load of another
+ * location (e.g., a "set flag, then re-check" handshake).
+ *
+ * These are only intended for use with naturally aligned, int-sized values.
+ */
+#if defined(_MSC_VER)
+#   include <windows.h>
+#   define ATOMIC_LOAD(p) \
+        InterlockedCompareExchange((volatile LONG *)(p), 0, 0)
+#   define ATOMIC_STORE(p, v) \
+        InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#   define ATOMIC_LOAD_SC(p)      ATOMIC_LOAD(p)
+#   define ATOMIC_STORE_SC(p, v)  ATOMIC_STORE(p, v)
+#else
+#   define ATOMIC_LOAD(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#   define ATOMIC_STORE(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#   define ATOMIC_LOAD_SC(p)      __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#   define ATOMIC_STORE_SC(p, v)  __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#endif
+
+/* Accessors for 64-bit statistics counters. These impose no ordering on
+ * other memory accesses; they only ensure that concurrent updates are not
+ * lost and that readers never observe a torn value. */
+#if defined(_MSC_VER)
+#   define COUNTER_ADD(p, v) \
+        InterlockedExchangeAdd64((volatile LONG64 *)(p), (LONG64)(v))
+#   define COUNTER_LOAD(p) \
+        ((uint64_t) InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0))
+#   define COUNTER_STORE(p, v) \
+        InterlockedExchange64((volatile LONG64 *)(p), (LONG64)(v))
+#else
+#   define COUNTER_ADD(p, v)      __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#   define COUNTER_LOAD(p)        __atomic_load_n(p, __ATOMIC_RELAXED)
+#   define COUNTER_STORE(p, v)    __atomic_store_n(p, v, __ATOMIC_RELAXED)
 #endif
 
 #endif
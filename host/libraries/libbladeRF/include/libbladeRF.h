@@ -199,6 +199,8 @@ int CALL_CONV bladerf_open_with_devinfo(struct bladerf **device,
  *   - libusb:  libusb (See libusb changelog notes for required version, given
  *   your OS and controller)
  *   - cypress: Cypress CyUSB/CyAPI backend (Windows only)
+ *   - dummy:   Simulated device, for development purposes. This is only
+ *              available when libbladeRF is built with ENABLE_BACKEND_DUMMY.
  *
  * If no arguments are provided after the backend, the first encountered
  * device on the specified backend will be opened. Note that a backend is
@@ -1155,6 +1157,204 @@ int CALL_CONV bladerf_xb200_get_path(struct bladerf *dev,
 
 /** @} (End of FN_CTRL) */
 
+/**
+ * @defgroup FN_QUICK_TUNE Quick retune
+ *
+ * Tuning via bladerf_set_frequency() includes a search for the LMS6002D's
+ * VCO capacitor (VCOCAP) setting, which requires a number of round trips to
+ * the device. Applications that repeatedly hop between a known set of
+ * frequencies may instead capture the results of this search once, in a
+ * "quick tune" profile, and apply them directly later.
+ *
+ * Quick tune parameters are specific to the device and module they were
+ * captured on. They do not include XB-200 path or filterbank selections, or
+ * the DC offset corrections from a loaded DC calibration table.
+ *
+ * @{
+ */
+
+/** Quick tune flag: The high band (LNA2 or PA2) is selected */
+#define BLADERF_QUICK_TUNE_FLAG_HIGH_BAND   (1 << 0)
+
+/**
+ * Tuning parameters for a single frequency
+ */
+struct bladerf_quick_tune {
+    unsigned int frequency; /**< Frequency, in Hz, the parameters yield */
+    bladerf_module module;  /**< Module these parameters apply to */
+    uint8_t freqsel;        /**< VCO and VCO division ratio selection */
+    uint8_t vcocap;         /**< VCO capacitor setting */
+    uint16_t nint;          /**< Integer portion of the PLL divider */
+    uint32_t nfrac;         /**< Fractional portion of the PLL divider */
+    uint8_t flags;          /**< BLADERF_QUICK_TUNE_FLAG_* bits */
+};
+
+/**
+ * Capture the quick tune parameters for the module's current frequency
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module to query
+ * @param[out]  quick_tune  Populated with the current tuning parameters
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_quick_tune(struct bladerf *dev,
+                                     bladerf_module module,
+                                     struct bladerf_quick_tune *quick_tune);
+
+/**
+ * Build a quick tune profile by tuning to each of the provided frequencies
+ * and capturing the resulting parameters. The module is returned to its
+ * original frequency afterwards.
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module to build the profile for
+ * @param[in]   frequencies Frequencies to include in the profile
+ * @param[out]  profile     Populated with `count` entries, in the order of
+ *                          `frequencies`
+ * @param[in]   count       Number of frequencies
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_build_quick_tune_profile(
+                                        struct bladerf *dev,
+                                        bladerf_module module,
+                                        const unsigned int *frequencies,
+                                        struct bladerf_quick_tune *profile,
+                                        unsigned int count);
+
+/**
+ * Apply quick tune parameters, as captured by bladerf_get_quick_tune() or
+ * bladerf_build_quick_tune_profile(), to the module they were captured for.
+ *
+ * The PLL and band selection are written without a VCOCAP search. If the VCO
+ * is found not to be locked afterwards (e.g., due to temperature drift since
+ * the parameters were captured), a search is performed as a fallback.
+ *
+ * @param       dev         Device handle
+ * @param       quick_tune  Parameters to apply
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_quick_tune(struct bladerf *dev,
+                                     const struct bladerf_quick_tune *quick_tune);
+
+/**
+ * Write a quick tune profile to a file, in a plain-text format
+ *
+ * @param       filename    File to write
+ * @param       profile     Profile entries
+ * @param       count       Number of entries in `profile`
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_save_quick_tune_profile(
+                                    const char *filename,
+                                    const struct bladerf_quick_tune *profile,
+                                    unsigned int count);
+
+/**
+ * Read a quick tune profile previously written by
+ * bladerf_save_quick_tune_profile()
+ *
+ * @param[in]   filename    File to read
+ * @param[out]  profile     Upon success, updated to point to a heap-allocated
+ *                          array of profile entries. This must be freed with
+ *                          bladerf_free_quick_tune_profile().
+ * @param[out]  count       Upon success, updated with the number of entries
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_load_quick_tune_profile(
+                                    const char *filename,
+                                    struct bladerf_quick_tune **profile,
+                                    unsigned int *count);
+
+/**
+ * Free a profile returned by bladerf_load_quick_tune_profile()
+ *
+ * @param       profile     Profile to free
+ */
+API_EXPORT
+void CALL_CONV bladerf_free_quick_tune_profile(
+                                    struct bladerf_quick_tune *profile);
+
+/**
+ * A retune to be performed when a module's sample counter reaches a
+ * specified timestamp. See bladerf_schedule_retunes().
+ */
+struct bladerf_retune {
+    /** Timestamp at which the retune should take effect */
+    uint64_t timestamp;
+
+    /** Frequency to tune to. Ignored if `quick_tune` is non-NULL. */
+    unsigned int frequency;
+
+    /**
+     * Pre-computed tuning parameters for the module being retuned, or NULL.
+     * These are applied as a single register burst, and are therefore
+     * strongly recommended for precisely timed hops.
+     */
+    const struct bladerf_quick_tune *quick_tune;
+
+    /**
+     * Populated with the module's timestamp, as read back from the device
+     * immediately after the retune was applied. Samples with timestamps at
+     * or beyond this value were acquired or transmitted at the new
+     * frequency.
+     */
+    uint64_t applied;
+};
+
+/**
+ * Perform a sequence of retunes, each aligned to the specified module's
+ * sample counter.
+ *
+ * The device does not support queuing retunes, so each retune is released
+ * by the host once it observes that the counter has reached the associated
+ * timestamp. The host sleeps until shortly before each timestamp, based upon
+ * the current sample rate, and then polls the counter. As such, retunes take
+ * effect slightly after their requested timestamps, with the latency
+ * dominated by USB round trips. The `applied` field of each entry reports
+ * when the retune actually completed, such that dwell boundaries may be
+ * trimmed in a stream using one of the _META formats.
+ *
+ * Entries whose timestamp has already passed are applied immediately.
+ *
+ * This call blocks until all retunes have been applied. The device's control
+ * lock is only held while polling the counter and applying retunes, so other
+ * control calls may be made from other threads in the meantime.
+ *
+ * @pre Timestamps must be enabled by configuring the module's stream for
+ *      one of the _META formats, and the module must be enabled such that
+ *      its sample counter is running.
+ *
+ * @param       dev         Device handle
+ * @param       module      Module to retune
+ * @param       retunes     Retunes to perform, in order of non-decreasing
+ *                          timestamps. Each entry's `applied` field is updated
+ *                          upon return.
+ * @param       count       Number of entries in `retunes`
+ * @param       timeout_ms  Maximum time to wait for the sample counter to
+ *                          advance before failing with BLADERF_ERR_TIMEOUT
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure. On failure,
+ *         entries preceding the failed one have been applied.
+ */
+API_EXPORT
+int CALL_CONV bladerf_schedule_retunes(struct bladerf *dev,
+                                       bladerf_module module,
+                                       struct bladerf_retune *retunes,
+                                       unsigned int count,
+                                       unsigned int timeout_ms);
+
+/** @} (End of FN_QUICK_TUNE) */
+
 /**
  * @defgroup FMT_META   Sample Formats and Metadata
  *
@@ -1211,6 +1411,48 @@ typedef enum {
      * their sample data.
      */
     BLADERF_FORMAT_SC16_Q11_META,
+
+    /**
+     * This format is the same as the ::BLADERF_FORMAT_SC16_Q11 format, except
+     * each value is a right-aligned int16_t in the host's byte order. On
+     * little-endian hosts, the two formats are identical.
+     *
+     * This format is only supported by the synchronous interface, which
+     * performs any required byte swapping while copying samples.
+     */
+    BLADERF_FORMAT_SC16_Q11_HOST,
+
+    /**
+     * The ::BLADERF_FORMAT_SC16_Q11_HOST format, with metadata handled by the
+     * synchronous interface as it is for ::BLADERF_FORMAT_SC16_Q11_META.
+     */
+    BLADERF_FORMAT_SC16_Q11_HOST_META,
+
+    /**
+     * Complex 32-bit floating point. Samples consist of interleaved IQ value
+     * pairs of `float` values in the range [-1.0, 1.0). Received values are
+     * scaled from the SC16 Q11 samples by 1/2048. Transmitted values are
+     * scaled by 2048, rounded to the nearest integer and clamped to
+     * [-2048, 2047]. The conversion of NaN values is unspecified.
+     *
+     * When using this format the minimum required buffer size, in bytes, is:
+     * <pre>
+     *   buffer_size_min = [ 2 * num_samples * sizeof(float) ]
+     * </pre>
+     *
+     * This format is only supported by the synchronous interface, which
+     * converts samples while copying them to/from its internal buffers.
+     * Therefore, the conversion does not add a pass over the sample data. See
+     * bladerf_sc16q11_to_cf32() and bladerf_cf32_to_sc16q11() for use with
+     * the asynchronous interface.
+     */
+    BLADERF_FORMAT_CF32,
+
+    /**
+     * The ::BLADERF_FORMAT_CF32 format, with metadata handled by the
+     * synchronous interface as it is for ::BLADERF_FORMAT_SC16_Q11_META.
+     */
+    BLADERF_FORMAT_CF32_META,
 } bladerf_format;
 
 /*
@@ -1350,13 +1592,58 @@ struct bladerf_metadata {
      */
     unsigned int actual_count;
 
+    /**
+     * This output parameter is updated by bladerf_sync_rx() to reflect the
+     * number of samples lost in the discontinuity reported via the
+     * ::BLADERF_META_STATUS_OVERRUN flag, and is 0 when that flag is not set.
+     *
+     * If `actual_count` is less than the requested count, the discontinuity
+     * immediately follows the returned samples. Otherwise, it immediately
+     * precedes them.
+     *
+     * This parameter is not currently used by bladerf_sync_tx().
+     */
+    uint64_t dropped;
+
     /**
      * Reserved for future use. This is not used by any functions.
      * It is recommended that users zero out this field.
      */
-    uint8_t reserved[32];
+    uint8_t reserved[24];
 };
 
+/**
+ * Convert SC16 Q11 samples to the ::BLADERF_FORMAT_CF32 format
+ *
+ * This uses the same SIMD-accelerated routines as the synchronous interface,
+ * and is intended for use with samples received via the asynchronous
+ * interface.
+ *
+ * @param[out]  dest        Destination. Must be able to hold
+ *                          `2 * num_samples` floats.
+ * @param[in]   src         Little-endian SC16 Q11 samples
+ * @param[in]   num_samples Number of (complex) samples to convert
+ */
+API_EXPORT
+void CALL_CONV bladerf_sc16q11_to_cf32(float *dest, const int16_t *src,
+                                       unsigned int num_samples);
+
+/**
+ * Convert ::BLADERF_FORMAT_CF32 samples to the SC16 Q11 format
+ *
+ * This uses the same SIMD-accelerated routines as the synchronous interface,
+ * and is intended for use with samples transmitted via the asynchronous
+ * interface.
+ *
+ * @param[out]  dest        Destination for little-endian SC16 Q11 samples.
+ *                          Must be able to hold `2 * num_samples` int16_t's.
+ * @param[in]   src         Samples to convert
+ * @param[in]   num_samples Number of (complex) samples to convert
+ */
+API_EXPORT
+void CALL_CONV bladerf_cf32_to_sc16q11(int16_t *dest, const float *src,
+                                       unsigned int num_samples);
+
 
 /** @} (End of FMT_META) */
 
@@ -1496,7 +1783,10 @@ typedef void *(*bladerf_stream_cb)(struct bladerf *dev,
  * @param[in]   num_buffers     Number of buffers to allocate and return. This
  *                              value must >= the `num_transfers` parameter.
  *
- * @param[in]   format          Sample data format
+ * @param[in]   format          Sample data format. Only the
+ *                              ::BLADERF_FORMAT_SC16_Q11 and
+ *                              ::BLADERF_FORMAT_SC16_Q11_META formats are
+ *                              supported by the asynchronous interface.
  *
  * @param[in]   samples_per_buffer  Size of allocated buffers, in units of
  *                                  samples Note that the physical size of the
@@ -1714,7 +2004,9 @@ int CALL_CONV bladerf_get_stream_timeout(struct bladerf *dev,
  *
  * @param   module          Module to use with synchronous interface
  *
- * @param   format          Format to use in synchronous data transfers
+ * @param   format          Format to use in synchronous data transfers.
+ *                          Samples are converted to/from host-side formats
+ *                          (e.g., ::BLADERF_FORMAT_CF32) as they are copied.
  *
  * @param   num_buffers     The number of buffers to use in the underlying
  *                          data stream. This must be greater than the
@@ -1809,7 +2101,11 @@ int CALL_CONV bladerf_sync_tx(struct bladerf *dev,
  * @param[out]  metadata    Sample metadata. This must be provided when using
  *                          the ::BLADERF_FORMAT_SC16_Q11_META format, but may
  *                          be NULL when the interface is configured for
- *                          the ::BLADERF_FORMAT_SC16_Q11 format.
+ *                          the ::BLADERF_FORMAT_SC16_Q11 format. For the
+ *                          latter, only the `status`, `actual_count`, and
+ *                          `dropped` fields are written. Samples lost to an
+ *                          overrun are reported, but do not cut the call
+ *                          short, as they are in the former format.
  *
  * @param[in]   timeout_ms  Timeout (milliseconds) for this call to complete.
  *                          Zero implies "infinite."
@@ -1821,6 +2117,8 @@ int CALL_CONV bladerf_sync_tx(struct bladerf *dev,
  *      receive samples. Failing to do this may result in timeouts and other
  *      errors.
  *
+ * @see bladerf_get_rx_overrun_stats() for cumulative overrun information.
+ *
  *
  * @return 0 on success,
  *         BLADERF_ERR_UNSUPPORTED if libbladeRF is not built with support
@@ -1833,9 +2131,504 @@ int CALL_CONV bladerf_sync_rx(struct bladerf *dev,
                               struct bladerf_metadata *metadata,
                               unsigned int timeout_ms);
 
+/**
+ * Receive IQ samples without copying them.
+ *
+ * Rather than copying samples into a caller-provided array, as
+ * bladerf_sync_rx() does, this function lends the caller a pointer directly
+ * into the synchronous interface's next available RX buffer. The lent samples
+ * remain valid, and the underlying buffer will not be reused, until they are
+ * handed back via bladerf_sync_rx_release().
+ *
+ * Only one set of samples may be lent at a time. Calls to bladerf_sync_rx()
+ * and bladerf_sync_rx_acquire() will fail with ::BLADERF_ERR_INVAL until the
+ * lent samples have been released.
+ *
+ * When using the ::BLADERF_FORMAT_SC16_Q11_META format, at most one message's
+ * worth of samples is lent at a time, as the metadata headers are interleaved
+ * with the sample data. The metadata's `timestamp` field is updated with the
+ * timestamp of the first lent sample. Sample discontinuities may be detected
+ * by comparing this against the timestamp expected from previously received
+ * samples. The ::BLADERF_META_FLAG_RX_NOW flag is implied.
+ *
+ * @param[in]   dev         Device handle
+ *
+ * @param[out]  samples     Updated to point to the lent samples
+ *
+ * @param[out]  num_samples Updated with the number of samples available at
+ *                          `samples`. This is always > 0 on success.
+ *
+ * @param[out]  metadata    Sample metadata. This must be provided when using
+ *                          the ::BLADERF_FORMAT_SC16_Q11_META format, but may
+ *                          be NULL when the interface is configured for
+ *                          the ::BLADERF_FORMAT_SC16_Q11 format.
+ *
+ * @param[in]   timeout_ms  Timeout (milliseconds) for a buffer to become
+ *                          available. Zero implies "infinite."
+ *
+ * @pre A bladerf_sync_config() call has been to configure the device for
+ *      synchronous data transfer.
+ *
+ * @note Lent samples become invalid when the interface is reconfigured via
+ *       bladerf_sync_config(), or when the module is disabled.
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_UNSUPPORTED if libbladeRF is not built with support
+ *         for this functionality, or if the configured format requires
+ *         samples to be converted (e.g., ::BLADERF_FORMAT_CF32),
+ *         or a value from \ref RETCODES list on failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_rx_acquire(struct bladerf *dev,
+                                      void **samples,
+                                      unsigned int *num_samples,
+                                      struct bladerf_metadata *metadata,
+                                      unsigned int timeout_ms);
+
+/**
+ * Hand back samples lent by bladerf_sync_rx_acquire().
+ *
+ * @param[in]   dev         Device handle
+ *
+ * @param[in]   samples     Pointer provided by bladerf_sync_rx_acquire()
+ *
+ * @param[in]   num_samples Number of samples that have been consumed. This
+ *                          may be less than the number of samples lent,
+ *                          in which case the remaining samples will be lent
+ *                          out again by the next bladerf_sync_rx_acquire()
+ *                          call, or returned by the next bladerf_sync_rx()
+ *                          call.
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_INVAL if `samples` were not lent or `num_samples`
+ *         exceeds the number of samples lent,
+ *         or a value from \ref RETCODES list on other failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_rx_release(struct bladerf *dev,
+                                      void *samples,
+                                      unsigned int num_samples);
+
+/**
+ * Obtain space for IQ samples to transmit, without copying them.
+ *
+ * Rather than copying samples from a caller-provided array, as
+ * bladerf_sync_tx() does, this function lends the caller a pointer directly
+ * into the synchronous interface's current TX buffer. The caller writes
+ * samples to this location and then commits them via
+ * bladerf_sync_tx_release().
+ *
+ * Only one set of samples may be lent at a time. Calls to bladerf_sync_tx()
+ * and bladerf_sync_tx_acquire() will fail with ::BLADERF_ERR_INVAL until the
+ * lent samples have been released.
+ *
+ * When using the ::BLADERF_FORMAT_SC16_Q11_META format, at most one message's
+ * worth of samples is lent at a time, as the metadata headers are interleaved
+ * with the sample data.
+ *
+ * @param[in]   dev         Device handle
+ *
+ * @param[out]  samples     Updated to point to the lent sample space
+ *
+ * @param[out]  num_samples Updated with the number of samples that may be
+ *                          written at `samples`. This is always > 0 on
+ *                          success.
+ *
+ * @param[in]   timeout_ms  Timeout (milliseconds) for a buffer to become
+ *                          available. Zero implies "infinite."
+ *
+ * @pre A bladerf_sync_config() call has been to configure the device for
+ *      synchronous data transfer.
+ *
+ * @note Lent samples become invalid when the interface is reconfigured via
+ *       bladerf_sync_config(), or when the module is disabled.
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_UNSUPPORTED if libbladeRF is not built with support
+ *         for this functionality, or if the configured format requires
+ *         samples to be converted (e.g., ::BLADERF_FORMAT_CF32),
+ *         or a value from \ref RETCODES list on failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_tx_acquire(struct bladerf *dev,
+                                      void **samples,
+                                      unsigned int *num_samples,
+                                      unsigned int timeout_ms);
+
+/**
+ * Commit samples written to space lent by bladerf_sync_tx_acquire().
+ *
+ * The metadata is interpreted exactly as it is by bladerf_sync_tx(), so bursts
+ * may be started and ended here. The lent space is handed back regardless of
+ * whether this call succeeds.
+ *
+ * @param[in]   dev         Device handle
+ *
+ * @param[in]   samples     Pointer provided by bladerf_sync_tx_acquire()
+ *
+ * @param[in]   num_samples Number of samples written. This may be less than
+ *                          the number of samples lent.
+ *
+ * @param[in]   metadata    Sample metadata. This must be provided when using
+ *                          the ::BLADERF_FORMAT_SC16_Q11_META format, but may
+ *                          be NULL when the interface is configured for
+ *                          the ::BLADERF_FORMAT_SC16_Q11 format.
+ *
+ * @param[in]   timeout_ms  Timeout (milliseconds) for this call to complete.
+ *                          This is only relevant when the samples fill a
+ *                          buffer, or when ::BLADERF_META_FLAG_TX_BURST_END
+ *                          is used, as buffers are then submitted.
+ *                          Zero implies "infinite."
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_INVAL if `samples` were not lent or `num_samples`
+ *         exceeds the number of samples lent,
+ *         or a value from \ref RETCODES list on other failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_tx_release(struct bladerf *dev,
+                                      void *samples,
+                                      unsigned int num_samples,
+                                      struct bladerf_metadata *metadata,
+                                      unsigned int timeout_ms);
+
+/**
+ * Cumulative RX overrun statistics for the synchronous interface
+ *
+ * When the host does not keep up with the incoming samples, the synchronous
+ * interface discards the contents of the stream's in-flight transfers in
+ * order to recover. These statistics account for each sample lost in this
+ * manner, as it is encountered by bladerf_sync_rx().
+ *
+ * Sample counts and indices exclude metadata headers when using the
+ * ::BLADERF_FORMAT_SC16_Q11_META format.
+ */
+struct bladerf_rx_overrun_stats {
+    uint64_t events;            /**< Number of overruns */
+    uint64_t dropped_buffers;   /**< Total number of buffers discarded */
+    uint64_t dropped_samples;   /**< Total number of samples discarded */
+
+    /**
+     * Index of the first sample lost in the most recent overrun, relative
+     * to the first sample received since the stream was (re)started. All
+     * samples before this index, less those lost in earlier overruns, have
+     * been returned by bladerf_sync_rx().
+     */
+    uint64_t last_gap_index;
+};
+
+/**
+ * Retrieve cumulative RX overrun statistics for the synchronous interface.
+ *
+ * These are reset by bladerf_sync_config().
+ *
+ * @param[in]   dev         Device handle
+ * @param[out]  stats       Overrun statistics
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_INVAL if the RX module has not been configured via
+ *         bladerf_sync_config(),
+ *         or a value from \ref RETCODES list on other failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_rx_overrun_stats(struct bladerf *dev,
+                                    struct bladerf_rx_overrun_stats *stats);
+
+/**
+ * Pause the synchronous interface's stream and disable the specified module.
+ *
+ * Unlike disabling the module via bladerf_enable_module(), this retains the
+ * configuration provided to bladerf_sync_config(), along with the associated
+ * buffers, transfers, and worker thread. This allows duty-cycled
+ * applications to stop and restart streaming quickly.
+ *
+ * Any samples that have not yet been read via bladerf_sync_rx(), or that have
+ * not yet been transmitted, are discarded. Samples lent via
+ * bladerf_sync_rx_acquire() or bladerf_sync_tx_acquire() must be released
+ * before calling this function.
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module to pause
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_INVAL if the module has not been configured via
+ *         bladerf_sync_config(),
+ *         or a value from \ref RETCODES list on other failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_pause(struct bladerf *dev, bladerf_module module);
+
+/**
+ * Re-enable a module paused via bladerf_sync_pause().
+ *
+ * The stream itself is restarted by the next bladerf_sync_rx() or
+ * bladerf_sync_tx() call, as it is following bladerf_sync_config().
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module to resume
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_INVAL if the module has not been configured via
+ *         bladerf_sync_config(),
+ *         or a value from \ref RETCODES list on other failures.
+ */
+API_EXPORT
+int CALL_CONV bladerf_sync_resume(struct bladerf *dev, bladerf_module module);
 
 /** @} (End of FN_DATA_SYNC) */
 
+/**
+ * @defgroup FN_STREAM_STATS    Stream statistics
+ *
+ * These functions provide a snapshot of counters that are maintained while a
+ * stream is running on a module, whether it was started via the
+ * \ref FN_DATA_ASYNC or \ref FN_DATA_SYNC interface. They are intended for
+ * monitoring the health of a stream, such that degradation can be detected
+ * before samples are lost.
+ *
+ * The counters are updated with lightweight atomic operations from the
+ * stream's context, and may be read from any thread at any time. The values
+ * in a snapshot are not guaranteed to be mutually consistent with each other.
+ *
+ * These functions are thread-safe.
+ *
+ * @{
+ */
+
+/**
+ * Stream statistics. All counts are relative to when the stream on the
+ * associated module was last started.
+ */
+struct bladerf_stream_stats {
+    uint64_t transfers_submitted;   /**< Transfers submitted to the device */
+    uint64_t transfers_completed;   /**< Transfers completed successfully */
+    uint64_t short_transfers;       /**< Completed transfers that contained
+                                     *   fewer bytes than requested */
+
+    /**
+     * RX: Number of times the synchronous interface had no free buffer
+     * available for received samples, and had to discard them.
+     * See bladerf_get_rx_overrun_stats() for the amount of data lost.
+     *
+     * TX: Always 0.
+     */
+    uint64_t overruns;
+
+    /**
+     * TX: Number of times a transfer completed while no other transfers were
+     * in flight. This means the device may have been starved of samples
+     * unless the stream was intentionally allowed to drain, such as at the
+     * end of a burst.
+     *
+     * RX: Always 0.
+     */
+    uint64_t underruns;
+
+    unsigned int in_flight;         /**< Transfers currently in flight */
+    unsigned int in_flight_max;     /**< Most transfers ever in flight */
+
+    /**
+     * RX only: The most buffers ever awaiting bladerf_sync_rx(). A value
+     * approaching the `num_buffers` supplied to bladerf_sync_config()
+     * indicates that the caller is at risk of falling behind.
+     */
+    unsigned int full_max;
+
+    /**
+     * TX only: The most buffers ever awaiting samples from bladerf_sync_tx().
+     * A value approaching the `num_buffers` supplied to bladerf_sync_config()
+     * indicates that the caller is at risk of falling behind.
+     */
+    unsigned int empty_max;
+
+    /**
+     * Number of buffer latency measurements. These are only taken by the
+     * \ref FN_DATA_SYNC interface.
+     *
+     * RX: Time from the stream callback handing a filled buffer off until
+     *     bladerf_sync_rx() begins consuming it.
+     *
+     * TX: Time from bladerf_sync_tx() submitting a buffer until the transfer
+     *     of its contents completes.
+     */
+    uint64_t latency_count;
+
+    /**
+     * Latency percentiles, in microseconds. These are estimated from a
+     * histogram with power-of-two bucket widths, so are accurate to within
+     * a factor of 2. They are 0 if latency_count is 0.
+     */
+    unsigned int latency_p50_us;
+    unsigned int latency_p90_us;    /**< 90th percentile latency (us) */
+    unsigned int latency_p99_us;    /**< 99th percentile latency (us) */
+    unsigned int latency_max_us;    /**< Largest latency observed (us) */
+};
+
+/**
+ * Retrieve a snapshot of a module's stream statistics
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module to query
+ * @param[out]  stats       Stream statistics. This is zeroed if no stream has
+ *                          been started on the module.
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL on an invalid module or NULL
+ *         `stats`
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_stream_stats(struct bladerf *dev,
+                                       bladerf_module module,
+                                       struct bladerf_stream_stats *stats);
+
+/** @} (End of FN_STREAM_STATS) */
+
+/**
+ * @defgroup FN_CTRL_STATS    Control transaction statistics
+ *
+ * Most control operations (e.g., tuning, gain, and sample rate changes) are
+ * carried out via packets exchanged with the FPGA's control processor, each
+ * of which requires a USB round trip. These functions count those round
+ * trips, allowing the cost of control operations to be measured.
+ *
+ * These functions are thread-safe.
+ *
+ * @{
+ */
+
+/**
+ * Control transaction statistics. Counts are relative to when the device
+ * was opened, or bladerf_reset_ctrl_stats() was last called.
+ */
+struct bladerf_ctrl_stats {
+    /** Total number of round trips to the FPGA's control processor */
+    uint64_t transactions;
+
+    uint64_t lms_transactions;      /**< LMS6002D register transactions */
+    uint64_t si5338_transactions;   /**< Si5338 register transactions */
+
+    /**
+     * FPGA register transactions, e.g., GPIO, IQ correction, timestamp,
+     * VCTCXO trim DAC, and expansion board accesses
+     */
+    uint64_t gpio_transactions;
+
+    /**
+     * Total number of register accesses. A single transaction may carry
+     * several register accesses.
+     */
+    uint64_t accesses;
+};
+
+/**
+ * Retrieve a snapshot of the device's control transaction statistics
+ *
+ * @param[in]   dev         Device handle
+ * @param[out]  stats       Control transaction statistics
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL on a NULL `stats`
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_ctrl_stats(struct bladerf *dev,
+                                     struct bladerf_ctrl_stats *stats);
+
+/**
+ * Reset the device's control transaction statistics
+ *
+ * @param[in]   dev         Device handle
+ */
+API_EXPORT
+void CALL_CONV bladerf_reset_ctrl_stats(struct bladerf *dev);
+
+/** @} (End of FN_CTRL_STATS) */
+
+/**
+ * @defgroup FN_STREAM_THREADS    Stream thread scheduling
+ *
+ * The library creates threads to service streams: a worker thread for each
+ * module configured via bladerf_sync_config(), and a thread that handles
+ * USB events (and thereby executes stream callbacks) for both modules.
+ *
+ * By default, these threads use the operating system's default scheduling
+ * policy and may run on any CPU. Under heavy system load, preemption or
+ * migration of these threads can result in overruns and underruns. The
+ * functions in this group allow real-time scheduling, CPU affinity, and
+ * locking of stream buffers into memory to be requested.
+ *
+ * These functions are thread-safe.
+ *
+ * @{
+ */
+
+/**
+ * Scheduling configuration for library-owned stream threads
+ */
+struct bladerf_thread_config {
+    /**
+     * SCHED_FIFO real-time priority. 0 selects the default, non-real-time
+     * policy.
+     *
+     * This generally requires elevated privileges, such as CAP_SYS_NICE or
+     * an appropriate RLIMIT_RTPRIO on Linux. This is not supported on
+     * Windows.
+     */
+    int priority;
+
+    /**
+     * CPUs the threads may run on, where bit `n` corresponds to CPU `n`.
+     * 0 allows the threads to run on any CPU available to the process.
+     *
+     * This is only supported on Linux.
+     */
+    uint64_t cpu_mask;
+
+    /**
+     * Lock stream buffers into physical memory (i.e., via mlock()), such
+     * that accessing them never incurs a page fault. This applies to streams
+     * initialized after this option is set, including those created by
+     * bladerf_sync_config(), whose initialization will fail if the buffers
+     * cannot be locked.
+     *
+     * This is subject to RLIMIT_MEMLOCK on Linux and OSX.
+     */
+    bool lock_memory;
+};
+
+/**
+ * Set the scheduling configuration for library-owned stream threads
+ *
+ * Worker threads are configured when created by bladerf_sync_config(), so
+ * this should be called prior to bladerf_sync_config(). The USB event
+ * thread applies updated configurations the next time a stream is started.
+ *
+ * Failures to apply a priority or CPU affinity to a thread, such as due to
+ * insufficient privileges, are logged as warnings.
+ *
+ * @param       dev         Device handle
+ * @param[in]   config      Thread configuration
+ *
+ * @return 0 on success,
+ *         BLADERF_ERR_RANGE if the priority is not valid for SCHED_FIFO,
+ *         BLADERF_ERR_UNSUPPORTED if an option is not supported on this
+ *         platform, or BLADERF_ERR_INVAL for a NULL `config`
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_thread_config(struct bladerf *dev,
+                                    const struct bladerf_thread_config *config);
+
+/**
+ * Get the scheduling configuration for library-owned stream threads
+ *
+ * @param       dev         Device handle
+ * @param[out]  config      Thread configuration
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL for a NULL `config`
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_thread_config(struct bladerf *dev,
+                                        struct bladerf_thread_config *config);
+
+/** @} (End of FN_STREAM_THREADS) */
+
 /**
  * @defgroup FN_INFO    Device info
  *
@@ -1982,6 +2775,15 @@ int CALL_CONV bladerf_flash_firmware(struct bladerf *dev,
  * Load device's FPGA. Note that this FPGA configuration will be reset
  * at the next power cycle.
  *
+ * The SHA-256 digest of the last bitstream loaded by libbladeRF is recorded
+ * for each device serial number. If the FPGA is still configured with the
+ * same bitstream, the load and the subsequent device reinitialization are
+ * skipped. Use bladerf_load_fpga_force() to load the bitstream regardless.
+ *
+ * These records are kept in the user's bladeRF configuration directory, or
+ * in the directory named by the BLADERF_FPGA_CACHE_DIR environment variable,
+ * if it is set.
+ *
  * @param   dev         Device handle
  * @param   fpga        Full path to FPGA bitstream
  *
@@ -1990,6 +2792,50 @@ int CALL_CONV bladerf_flash_firmware(struct bladerf *dev,
 API_EXPORT
 int CALL_CONV bladerf_load_fpga(struct bladerf *dev, const char *fpga);
 
+/**
+ * Load device's FPGA, even if it is already configured with the specified
+ * bitstream. See bladerf_load_fpga().
+ *
+ * @param   dev         Device handle
+ * @param   fpga        Full path to FPGA bitstream
+ *
+ * @return 0 upon successfully, or a value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_load_fpga_force(struct bladerf *dev, const char *fpga);
+
+/**
+ * FPGA load progress callback
+ *
+ * This is called from within bladerf_load_fpga() and
+ * bladerf_load_fpga_force() as portions of the bitstream are sent to the
+ * device. It must not call any libbladeRF functions that access the device.
+ *
+ * @param   dev         Device handle
+ * @param   done        Number of bitstream bytes sent to the device
+ * @param   total       Total number of bitstream bytes
+ * @param   user_data   User data provided to
+ *                      bladerf_set_fpga_load_progress_cb()
+ */
+typedef void (*bladerf_fpga_load_progress_cb)(struct bladerf *dev,
+                                              size_t done, size_t total,
+                                              void *user_data);
+
+/**
+ * Set the callback used to report the progress of FPGA loads
+ *
+ * @param   dev         Device handle
+ * @param   cb          Progress callback, or NULL to disable progress reports
+ * @param   user_data   Data to pass to the callback
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_fpga_load_progress_cb(
+                                            struct bladerf *dev,
+                                            bladerf_fpga_load_progress_cb cb,
+                                            void *user_data);
+
 /**
  * Write the provided FPGA image to the bladeRF's SPI flash and enable FPGA
  * loading from SPI flash at power on (also referred to within this project as
@@ -2600,6 +3446,65 @@ API_EXPORT
 int CALL_CONV bladerf_get_timestamp(struct bladerf *dev, bladerf_module mod,
                                     uint64_t *value);
 
+/**
+ * Get the current time of the host clock that the library correlates sample
+ * counters with. This is CLOCK_MONOTONIC on Linux, and CLOCK_REALTIME on
+ * other platforms.
+ *
+ * @return Host time, in nanoseconds
+ */
+API_EXPORT
+uint64_t CALL_CONV bladerf_get_host_time(void);
+
+/**
+ * Estimate the current value of a module's timestamp counter, without
+ * communicating with the device.
+ *
+ * The library maintains a linear model of each module's counter, as a
+ * function of host time (see bladerf_get_host_time()). It is updated with the
+ * arrival of each RX buffer when streaming with
+ * ::BLADERF_FORMAT_SC16_Q11_META, and with each bladerf_get_timestamp() call.
+ * When the model has not been updated within the past second, this function
+ * performs a bladerf_get_timestamp() readback to refresh it.
+ *
+ * Estimates are made in terms of the counters' rates when metadata is in use
+ * (i.e., one count per sample), and are accurate to within the latency of
+ * the least-delayed observation that the model retains.
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   mod         Module whose counter to estimate
+ * @param[out]  timestamp   Estimated counter value
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_timestamp_estimate(struct bladerf *dev,
+                                             bladerf_module mod,
+                                             uint64_t *timestamp);
+
+/**
+ * Estimate the host time at which a module's timestamp counter reaches the
+ * specified value. For the TX module, this is the time at which the sample
+ * with that timestamp will be transmitted.
+ *
+ * See bladerf_get_timestamp_estimate() for a description of how estimates
+ * are made.
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   mod         Module whose counter to estimate
+ * @param[in]   timestamp   Counter value
+ * @param[out]  host_ns     Estimated host time, in nanoseconds, as returned
+ *                          by bladerf_get_host_time(). This may be in the
+ *                          past.
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_get_host_time_estimate(struct bladerf *dev,
+                                             bladerf_module mod,
+                                             uint64_t timestamp,
+                                             uint64_t *host_ns);
+
 /**
  * Write value to VCTCXO DAC
  *
@@ -2808,6 +3713,48 @@ API_EXPORT
 int CALL_CONV bladerf_write_flash(struct bladerf *dev, const uint8_t *buf,
                                   uint32_t page, uint32_t count);
 
+/**
+ * Flash operations reported to a bladerf_flash_progress_cb
+ */
+typedef enum {
+    BLADERF_FLASH_OP_ERASE, /**< Erasing erase blocks */
+    BLADERF_FLASH_OP_READ,  /**< Reading pages */
+    BLADERF_FLASH_OP_WRITE  /**< Writing pages */
+} bladerf_flash_op;
+
+/**
+ * Flash progress callback
+ *
+ * This is called from within flash operations, including those performed by
+ * bladerf_flash_firmware() and bladerf_flash_fpga(), as each erase block
+ * or page completes. It must not call any libbladeRF functions that access
+ * the device.
+ *
+ * @param   dev         Device handle
+ * @param   op          Operation in progress
+ * @param   done        Number of erase blocks or pages completed
+ * @param   total       Total number of erase blocks or pages in the operation
+ * @param   user_data   User data provided to bladerf_set_flash_progress_cb()
+ */
+typedef void (*bladerf_flash_progress_cb)(struct bladerf *dev,
+                                          bladerf_flash_op op,
+                                          uint32_t done, uint32_t total,
+                                          void *user_data);
+
+/**
+ * Set the callback used to report the progress of flash operations
+ *
+ * @param   dev         Device handle
+ * @param   cb          Progress callback, or NULL to disable progress reports
+ * @param   user_data   Data to pass to the callback
+ *
+ * @return 0 on success, value from \ref RETCODES list on failure
+ */
+API_EXPORT
+int CALL_CONV bladerf_set_flash_progress_cb(struct bladerf *dev,
+                                            bladerf_flash_progress_cb cb,
+                                            void *user_data);
+
 /** @} (End of FN_FLASH) */
 
 
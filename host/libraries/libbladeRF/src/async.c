@@ -20,6 +20,7 @@
  */
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "async.h"
 #include "log.h"
@@ -68,6 +69,11 @@ int async_init_stream(struct bladerf_stream **stream,
         return BLADERF_ERR_UNEXPECTED;
     }
 
+    if (pthread_cond_init(&lstream->stream_stopped, NULL) != 0) {
+        free(lstream);
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
     lstream->dev = dev;
     lstream->error_code = 0;
     lstream->state = STREAM_IDLE;
@@ -77,6 +83,8 @@ int async_init_stream(struct bladerf_stream **stream,
     lstream->cb = callback;
     lstream->user_data = user_data;
     lstream->buffers = NULL;
+    lstream->thread_config = dev->thread_config;
+    memset(&lstream->arena, 0, sizeof(lstream->arena));
 
     switch(format) {
         case BLADERF_FORMAT_SC16_Q11:
@@ -84,6 +92,18 @@ int async_init_stream(struct bladerf_stream **stream,
             buffer_size_bytes = sc16q11_to_bytes(samples_per_buffer);
             break;
 
+        /* Stream buffers are handed directly to the caller, so there is no
+         * copy into which a conversion could be folded. Callers may use
+         * bladerf_sc16q11_to_cf32() and bladerf_cf32_to_sc16q11() instead. */
+        case BLADERF_FORMAT_SC16_Q11_HOST:
+        case BLADERF_FORMAT_SC16_Q11_HOST_META:
+        case BLADERF_FORMAT_CF32:
+        case BLADERF_FORMAT_CF32_META:
+            log_debug("Format %d is only supported by the sync interface\n",
+                      format);
+            status = BLADERF_ERR_UNSUPPORTED;
+            break;
+
         default:
             status = BLADERF_ERR_INVAL;
             break;
@@ -91,29 +111,30 @@ int async_init_stream(struct bladerf_stream **stream,
 
     if (!status) {
         lstream->buffers = calloc(num_buffers, sizeof(lstream->buffers[0]));
-        if (lstream->buffers) {
-            for (i = 0; i < num_buffers && !status; i++) {
-                lstream->buffers[i] = calloc(1, buffer_size_bytes);
-                if (!lstream->buffers[i]) {
-                    status = BLADERF_ERR_MEM;
-                }
-            }
-        } else {
+        if (!lstream->buffers) {
             status = BLADERF_ERR_MEM;
         }
     }
 
-    /* Clean up everything we've allocated if we hit any errors */
-    if (status) {
-
-        if (lstream->buffers) {
-            for (i = 0; i < num_buffers; i++) {
-                free(lstream->buffers[i]);
-            }
+    /* All buffers are carved out of a single contiguous allocation.
+     * Buffer sizes are multiples of 1024 samples, so each buffer remains
+     * page-aligned when the arena is. */
+    if (!status) {
+        status = stream_arena_alloc(lstream, &lstream->arena,
+                                    num_buffers * buffer_size_bytes,
+                                    lstream->thread_config.lock_memory);
+    }
 
-            free(lstream->buffers);
+    if (!status) {
+        for (i = 0; i < num_buffers; i++) {
+            lstream->buffers[i] =
+                (uint8_t *) lstream->arena.mem + i * buffer_size_bytes;
         }
+    }
 
+    /* Clean up everything we've allocated if we hit any errors */
+    if (status) {
+        free(lstream->buffers);
         free(lstream);
     } else {
         /* Perform any backend-specific stream initialization */
@@ -142,12 +163,19 @@ int async_run_stream(struct bladerf_stream *stream, bladerf_module module)
 
     MUTEX_LOCK(&stream->lock);
     stream->module = module;
+    stream_stats_reset(async_stream_stats(stream));
+    time_model_reset(&dev->time_model[module]);
     stream->state = STREAM_RUNNING;
     pthread_cond_signal(&stream->stream_started);
     MUTEX_UNLOCK(&stream->lock);
 
     status = dev->fn->stream(stream, module);
 
+    /* Wake anyone waiting for the stream to finish */
+    MUTEX_LOCK(&stream->lock);
+    pthread_cond_broadcast(&stream->stream_stopped);
+    MUTEX_UNLOCK(&stream->lock);
+
     /* Backend return value takes precedence over stream error status */
     return status == 0 ? stream->error_code : status;
 }
@@ -194,7 +222,9 @@ int async_submit_stream_buffer(struct bladerf_stream *stream,
         }
     }
 
-    status = stream->dev->fn->submit_stream_buffer(stream, buffer, timeout_ms);
+    MUTEX_UNLOCK(&stream->lock);
+
+    return stream->dev->fn->submit_stream_buffer(stream, buffer, timeout_ms);
 
 error:
     MUTEX_UNLOCK(&stream->lock);
@@ -203,25 +233,23 @@ error:
 
 void async_deinit_stream(struct bladerf_stream *stream)
 {
-    size_t i;
-
     if (!stream) {
         log_debug("%s called with NULL stream\n", __FUNCTION__);
         return;
     }
 
-    while(stream->state != STREAM_DONE && stream->state != STREAM_IDLE) {
-        log_verbose( "Stream not done...\n" );
-        usleep(1000000);
+    MUTEX_LOCK(&stream->lock);
+    while (stream->state != STREAM_DONE && stream->state != STREAM_IDLE) {
+        log_verbose("Waiting for stream to finish...\n");
+        pthread_cond_wait(&stream->stream_stopped, &stream->lock);
     }
+    MUTEX_UNLOCK(&stream->lock);
 
     /* Free up the backend data */
     stream->dev->fn->deinit_stream(stream);
 
     /* Free up the buffers */
-    for (i = 0; i < stream->num_buffers; i++) {
-        free(stream->buffers[i]);
-    }
+    stream_arena_free(stream, &stream->arena);
 
     /* Free up the pointer to the buffers */
     free(stream->buffers);
@@ -24,6 +24,7 @@
 #include <pthread.h>
 #include "libbladeRF.h"
 #include "bladerf_priv.h"
+#include "stream_arena.h"
 
 typedef enum {
     STREAM_IDLE,            /* Idle and initialized */
@@ -46,7 +47,14 @@ struct bladerf_stream {
     void *user_data;
     size_t samples_per_buffer;
     size_t num_buffers;
+
+    /* buffers[i] is located at arena.mem + i * async_stream_buf_bytes() */
     void **buffers;
+    struct stream_arena arena;
+
+    /* Copy of the device's thread configuration at the time the stream was
+     * initialized, for use by backends and the sync worker */
+    struct bladerf_thread_config thread_config;
 
     MUTEX lock;
 
@@ -55,6 +63,8 @@ struct bladerf_stream {
     bladerf_stream_state state;
     pthread_cond_t can_submit_buffer;
     pthread_cond_t stream_started;
+    pthread_cond_t stream_stopped;  /* Signaled when async_run_stream()'s
+                                     * backend call has returned */
     void *backend_data;
 };
 
@@ -63,6 +73,68 @@ static inline size_t async_stream_buf_bytes(struct bladerf_stream *s) {
     return samples_to_bytes(s->format, s->samples_per_buffer);
 }
 
+/* Get the statistics for the module a stream is running on */
+static inline struct stream_stats * async_stream_stats(
+                                            struct bladerf_stream *s) {
+    return &s->dev->stream_stats[s->module];
+}
+
+/* Backends call the following while holding stream->lock, and while the
+ * stream is running. `in_flight` is the number of transfers in flight after
+ * the operation being reported. */
+
+/* Report that a transfer has been submitted */
+static inline void async_stats_submitted(struct bladerf_stream *s,
+                                         size_t in_flight)
+{
+    struct stream_stats *stats = async_stream_stats(s);
+
+    COUNTER_ADD(&stats->transfers_submitted, 1);
+    ATOMIC_STORE(&stats->in_flight, (unsigned int) in_flight);
+    stream_stats_update_max(&stats->in_flight_max, (unsigned int) in_flight);
+}
+
+/* Report that a transfer has completed successfully */
+static inline void async_stats_completed(struct bladerf_stream *s,
+                                         size_t requested_bytes,
+                                         size_t actual_bytes)
+{
+    struct stream_stats *stats = async_stream_stats(s);
+
+    COUNTER_ADD(&stats->transfers_completed, 1);
+
+    if (actual_bytes < requested_bytes) {
+        COUNTER_ADD(&stats->short_transfers, 1);
+    }
+}
+
+/* Report the number of transfers in flight after a completed transfer's
+ * callback has been executed, and any new transfer has been submitted */
+static inline void async_stats_in_flight(struct bladerf_stream *s,
+                                         size_t in_flight)
+{
+    struct stream_stats *stats = async_stream_stats(s);
+
+    ATOMIC_STORE(&stats->in_flight, (unsigned int) in_flight);
+
+    if (in_flight == 0 && s->module == BLADERF_MODULE_TX &&
+        s->state == STREAM_RUNNING) {
+        COUNTER_ADD(&stats->underruns, 1);
+    }
+}
+
+/* Report the host time at which an RX transfer completed, so that its
+ * metadata may be used to correlate host time with the sample counter */
+static inline void async_rx_arrival(struct bladerf_stream *s, const void *buf,
+                                    size_t len, uint64_t host_ns)
+{
+    if (s->module == BLADERF_MODULE_RX &&
+        s->format == BLADERF_FORMAT_SC16_Q11_META) {
+        time_model_add_rx_buffer(&s->dev->time_model[BLADERF_MODULE_RX],
+                                 host_ns, buf, len, s->dev->msg_size);
+    }
+}
+
 int async_init_stream(struct bladerf_stream **stream,
                       struct bladerf *dev,
                       bladerf_stream_cb callback,
@@ -77,7 +149,9 @@ int async_init_stream(struct bladerf_stream **stream,
 int async_run_stream(struct bladerf_stream *stream, bladerf_module module);
 
 
-/* This function WILL acquire stream->lock before calling backend code */
+/* This function WILL acquire stream->lock while waiting for the stream to
+ * start. It is released before calling backend code, which is responsible
+ * for acquiring it as needed. */
 int async_submit_stream_buffer(struct bladerf_stream *stream,
                                void *buffer,
                                unsigned int timeout_ms);
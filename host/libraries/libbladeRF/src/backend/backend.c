@@ -120,6 +120,9 @@ const char * backend2str(bladerf_backend backend)
         case BLADERF_BACKEND_CYPRESS:
             return BACKEND_STR_CYPRESS;
 
+        case BLADERF_BACKEND_DUMMY:
+            return BACKEND_STR_DUMMY;
+
         default:
             return BACKEND_STR_ANY;
     }
@@ -135,6 +138,8 @@ int str2backend(const char *str, bladerf_backend *backend)
         *backend = BLADERF_BACKEND_LINUX;
     } else if (!strcasecmp(BACKEND_STR_CYPRESS, str)) {
         *backend = BLADERF_BACKEND_CYPRESS;
+    } else if (!strcasecmp(BACKEND_STR_DUMMY, str)) {
+        *backend = BLADERF_BACKEND_DUMMY;
     } else if (!strcasecmp(BACKEND_STR_ANY, str)) {
         *backend = BLADERF_BACKEND_ANY;
     } else {
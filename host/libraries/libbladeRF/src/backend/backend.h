@@ -31,6 +31,15 @@
 #define BACKEND_STR_LIBUSB "libusb"
 #define BACKEND_STR_LINUX  "linux"
 #define BACKEND_STR_CYPRESS "cypress"
+#define BACKEND_STR_DUMMY  "dummy"
+
+/**
+ * Register address/data pair, used by batched register accessors
+ */
+struct backend_reg {
+    uint8_t addr;
+    uint8_t data;
+};
 
 /**
  * Backend-specific function table
@@ -105,6 +114,13 @@ struct backend_fns {
     int (*lms_write)(struct bladerf *dev, uint8_t addr, uint8_t data);
     int (*lms_read)(struct bladerf *dev, uint8_t addr, uint8_t *data);
 
+    /* Batched LMS6002D accessors. The accesses are performed in the order
+     * provided, using as few transactions with the device as possible. */
+    int (*lms_write_batch)(struct bladerf *dev,
+                           const struct backend_reg *regs, size_t n);
+    int (*lms_read_batch)(struct bladerf *dev,
+                          struct backend_reg *regs, size_t n);
+
     /* VCTCXO accessor */
     int (*dac_write)(struct bladerf *dev, uint16_t value);
 
@@ -120,9 +136,18 @@ struct backend_fns {
 
     int (*init_stream)(struct bladerf_stream *stream, size_t num_transfers);
     int (*stream)(struct bladerf_stream *stream, bladerf_module module);
+
+    /* Called without stream->lock held */
     int (*submit_stream_buffer)(struct bladerf_stream *stream, void *buffer,
                                 unsigned int timeout_ms);
     void (*deinit_stream)(struct bladerf_stream *stream);
+
+    /* Optional. Allocate memory for stream buffers that the backend can
+     * transfer to/from without an intermediate copy, or return NULL to have
+     * the caller fall back to a host allocation. */
+    void * (*alloc_stream_mem)(struct bladerf_stream *stream, size_t len);
+    void (*free_stream_mem)(struct bladerf_stream *stream, void *mem,
+                            size_t len);
 };
 
 /**
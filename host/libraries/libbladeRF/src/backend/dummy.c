@@ -1,7 +1,39 @@
 /*
- * Dummy backend to allow libbladeRF to build when no other backends are
- * enabled. This is intended for development purposes only, and should
- * generally should not be enabled for libbladeRF releases.
+ * Dummy backend, which provides a simulated (software-only) device. This is
+ * intended for development purposes only, and should generally not be
+ * enabled for libbladeRF releases.
+ *
+ * The simulated device models the NIOS II firmware's handling of LMS6002D,
+ * Si5338 and GPIO accesses, keeps an in-memory SPI flash, and implements
+ * sample streaming. Peripheral accesses are packed into the same UART packets
+ * the USB backend sends, so control transaction counts reported by
+ * bladerf_get_ctrl_stats() match those of a physical device. The LMS6002D's
+ * VTUNE comparators report lock only for VCOCAP values near one derived from
+ * the programmed PLL frequency, so the VCOCAP search in tuning is exercised.
+ *
+ * RX buffers are filled with a configurable waveform (or samples looped back
+ * from TX) and valid metadata headers with monotonically increasing
+ * timestamps. TX buffers are consumed and, optionally, looped back into RX.
+ * This allows the sync, async, and metadata code to be exercised and
+ * benchmarked without a physical board.
+ *
+ * A dummy device is only opened when explicitly requested via the "dummy"
+ * backend (e.g., a device identifier string of "dummy"). The following
+ * environment variables configure the simulated device when it is opened:
+ *
+ *  BLADERF_DUMMY_SAMPLE_RATE   Rate, in samples per second, at which each
+ *                              stream's transfers are completed. If unset or
+ *                              0, streams are free-running.
+ *
+ *  BLADERF_DUMMY_WAVEFORM      RX waveform: "zero", "ramp" (default), or
+ *                              "tone" (a complex exponential at fs/8)
+ *
+ *  BLADERF_DUMMY_CTRL_LATENCY_US
+ *                              Latency, in microseconds, of each control
+ *                              transaction. Defaults to 0.
+ *
+ * TX samples are looped back to RX while firmware loopback is enabled via
+ * bladerf_set_loopback(dev, BLADERF_LB_FIRMWARE).
  *
  * This file is part of the bladeRF project:
  *   http://www.github.com/nuand/bladeRF
@@ -22,64 +54,377 @@
  * License along with this library; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "rel_assert.h"
 #include "bladerf_priv.h"
-#include "backend.h"
+#include "backend/backend.h"
+#include "backend/dummy.h"
+#include "async.h"
+#include "metadata.h"
+#include "flash_fields.h"
+#include "fpga.h"
+#include "conversions.h"
+#include "log.h"
+
+#define DUMMY_SERIAL            "0123456789abcdef0123456789abcdef"
+#define DUMMY_FW_VERSION        "1.8.0"
+#define DUMMY_FPGA_VERSION      "0.1.1"
+
+#define DUMMY_TRANSFER_TIMEOUT_MS   1000
+
+/* Capacity of the TX -> RX loopback FIFO, in samples */
+#define DUMMY_LOOPBACK_SAMPLES  (1024 * 1024)
+
+#define DUMMY_LMS_NUM_REGS      128
+#define DUMMY_SI5338_NUM_REGS   256
+/* Maximum number of accesses in a NIOS UART packet, and the packet size */
+#define DUMMY_NIOS_MAX_CMDS     7
+#define DUMMY_NIOS_PKT_SIZE     16
+
+/* LMS6002D PLL register bases. VCOCAP is at base + 9, and VTUNE at base + 10 */
+#define LMS_TX_PLL_BASE         0x10
+#define LMS_RX_PLL_BASE         0x20
+
+/* LMS6002D read-only chip revision register, and the value it reports */
+#define LMS_CHIP_REV_ADDR       0x04
+#define DUMMY_LMS_CHIP_REV      0x22
+
+/* LMS6002D PLL reference clock frequency */
+#define DUMMY_LMS_REF_HZ        38400000ull
+
+/* Half-width of the range of VCOCAP values within which the simulated VTUNE
+ * comparators report that the PLL is locked */
+#define DUMMY_VCOCAP_LOCK_WIDTH 8
+
+typedef enum {
+    DUMMY_WAVEFORM_ZERO,
+    DUMMY_WAVEFORM_RAMP,
+    DUMMY_WAVEFORM_TONE,
+} dummy_waveform;
+
+/* TX -> RX loopback FIFO of interleaved I/Q samples */
+struct dummy_loopback {
+    bool enabled;
+    int16_t *samples;
+    size_t head;            /* Index of the oldest sample */
+    size_t count;           /* Number of samples in the FIFO */
+};
+
+struct bladerf_dummy {
+    /* Simulated peripherals. These are protected by the device's control
+     * lock, as they are only accessed via control operations. */
+    uint8_t lms_regs[DUMMY_LMS_NUM_REGS];
+    uint8_t si5338_regs[DUMMY_SI5338_NUM_REGS];
+    uint32_t config_gpio;
+    uint32_t xb_gpio;
+    uint32_t xb_gpio_dir;
+    uint32_t xb_spi;
+    uint16_t dac;
+    uint32_t iq_corr[NUM_MODULES];  /* Phase in [31:16], gain in [15:0] */
+    uint32_t gpio_collect;          /* Bytes of a multi-byte GPIO write */
+    bool fpga_configured;
+    char otp[OTP_BUFFER_SIZE];
+    uint8_t *flash;
+
+    /* Streaming configuration, set when the device is opened */
+    unsigned int sample_rate;
+    dummy_waveform waveform;
+    unsigned int ctrl_latency_us;
+
+    /* Items below are shared between the stream and control threads */
+    MUTEX lock;
+    uint64_t timestamp[NUM_MODULES];
+    struct dummy_loopback loopback;
+};
+
+struct dummy_stream_data {
+    void **transfers;           /* Buffers of in-flight transfers,
+                                 * in the order they were submitted */
+    size_t num_transfers;
+    size_t num_avail;
+    size_t i;                   /* Index of the oldest in-flight transfer */
+
+    pthread_cond_t submitted;   /* Signaled upon transfer submission, or
+                                 * a request to shut down the stream */
+
+    uint32_t phase;             /* Current position in the RX waveform */
+
+    /* Used to pace transfers at the configured sample rate */
+    struct timespec start;
+    uint64_t samples_done;
+};
+
+static inline struct bladerf_dummy *dummy_backend(struct bladerf *dev)
+{
+    return (struct bladerf_dummy *) dev->backend;
+}
+
+static const int16_t tone_i[8] = {
+    2047,  1448,     0, -1448, -2047, -1448,     0,  1448
+};
+
+static const int16_t tone_q[8] = {
+       0,  1448,  2047,  1448,     0, -1448, -2047, -1448
+};
+
+/*******************************************************************************
+ * Device probe, open and close
+ ******************************************************************************/
 
 static bool dummy_matches(bladerf_backend backend)
 {
-    return false;
+    return backend == BLADERF_BACKEND_DUMMY;
 }
 
-static int dummy_is_fpga_configured(struct bladerf *dev)
+static void dummy_init_devinfo(struct bladerf_devinfo *info)
 {
-    return 0;
+    info->backend = BLADERF_BACKEND_DUMMY;
+    strncpy(info->serial, DUMMY_SERIAL, BLADERF_SERIAL_LENGTH - 1);
+    info->serial[BLADERF_SERIAL_LENGTH - 1] = '\0';
+    info->usb_bus = 0;
+    info->usb_addr = 0;
+    info->instance = 0;
 }
 
-int dummy_enable_module(struct bladerf *dev, bladerf_module m, bool enable)
+static int dummy_probe(struct bladerf_devinfo_list *info_list)
 {
-    return 0;
+    struct bladerf_devinfo info;
+
+    dummy_init_devinfo(&info);
+    return bladerf_devinfo_list_add(info_list, &info);
 }
 
-static int dummy_open(struct bladerf **device, struct bladerf_devinfo *info)
+static int populate_flash(struct bladerf_dummy *dummy)
 {
-    return BLADERF_ERR_NODEV;
+    int status;
+    int idx = 0;
+    char *cal;
+
+    dummy->flash = malloc(BLADERF_FLASH_TOTAL_SIZE);
+    if (dummy->flash == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    memset(dummy->flash, 0xff, BLADERF_FLASH_TOTAL_SIZE);
+
+    cal = (char *) &dummy->flash[BLADERF_FLASH_ADDR_CAL];
+    status = encode_field(cal, CAL_BUFFER_SIZE, &idx, "B", "40");
+    if (status == 0) {
+        status = encode_field(cal, CAL_BUFFER_SIZE, &idx, "DAC", "0x8000");
+    }
+
+    if (status == 0) {
+        memset(dummy->otp, 0xff, OTP_BUFFER_SIZE);
+        idx = 0;
+        status = encode_field(dummy->otp, OTP_BUFFER_SIZE, &idx,
+                              "S", DUMMY_SERIAL);
+    }
+
+    return status;
 }
 
-static int dummy_close(struct bladerf *dev)
+static void load_config(struct bladerf_dummy *dummy)
 {
-    return 0;
+    const char *env;
+    bool ok;
+
+    dummy->sample_rate = 0;
+    dummy->waveform = DUMMY_WAVEFORM_RAMP;
+    dummy->ctrl_latency_us = 0;
+
+    env = getenv("BLADERF_DUMMY_SAMPLE_RATE");
+    if (env != NULL) {
+        dummy->sample_rate = str2uint(env, 0, UINT_MAX, &ok);
+        if (!ok) {
+            log_warning("Invalid BLADERF_DUMMY_SAMPLE_RATE: %s\n", env);
+            dummy->sample_rate = 0;
+        }
+    }
+
+    env = getenv("BLADERF_DUMMY_WAVEFORM");
+    if (env != NULL) {
+        if (!strcasecmp(env, "zero")) {
+            dummy->waveform = DUMMY_WAVEFORM_ZERO;
+        } else if (!strcasecmp(env, "tone")) {
+            dummy->waveform = DUMMY_WAVEFORM_TONE;
+        } else if (!strcasecmp(env, "ramp")) {
+            dummy->waveform = DUMMY_WAVEFORM_RAMP;
+        } else {
+            log_warning("Invalid BLADERF_DUMMY_WAVEFORM: %s\n", env);
+        }
+    }
+
+    env = getenv("BLADERF_DUMMY_CTRL_LATENCY_US");
+    if (env != NULL) {
+        dummy->ctrl_latency_us = str2uint(env, 0, UINT_MAX, &ok);
+        if (!ok) {
+            log_warning("Invalid BLADERF_DUMMY_CTRL_LATENCY_US: %s\n", env);
+            dummy->ctrl_latency_us = 0;
+        }
+    }
+
+    if (dummy->sample_rate == 0) {
+        log_debug("Dummy device streams are free-running\n");
+    } else {
+        log_debug("Dummy device streams are paced at %u samples/s\n",
+                  dummy->sample_rate);
+    }
 }
 
-static int dummy_load_fpga(struct bladerf *dev, uint8_t *image, size_t image_size)
+static void dummy_close(struct bladerf *dev)
 {
-    return 0;
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+
+    if (dummy != NULL) {
+        free(dummy->loopback.samples);
+        free(dummy->flash);
+        MUTEX_DESTROY(&dummy->lock);
+        free(dummy);
+        dev->backend = NULL;
+    }
 }
 
-static int dummy_erase_flash(struct bladerf *dev, uint32_t addr, uint32_t len)
+static int dummy_open(struct bladerf *dev, struct bladerf_devinfo *info)
 {
-    return 0;
+    int status;
+    struct bladerf_dummy *dummy;
+    struct bladerf_devinfo dummy_info;
+
+    /* Only open a simulated device when one is explicitly requested */
+    dummy_init_devinfo(&dummy_info);
+    if (info->backend != BLADERF_BACKEND_DUMMY ||
+        !bladerf_instance_matches(info, &dummy_info) ||
+        !bladerf_serial_matches(info, &dummy_info)) {
+        return BLADERF_ERR_NODEV;
+    }
+
+    dummy = calloc(1, sizeof(*dummy));
+    if (dummy == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    dev->fn = &backend_fns_dummy;
+    dev->backend = dummy;
+
+    MUTEX_INIT(&dummy->lock);
 
+    dummy->lms_regs[LMS_CHIP_REV_ADDR] = DUMMY_LMS_CHIP_REV;
+
+    dummy->loopback.samples =
+        malloc(2 * DUMMY_LOOPBACK_SAMPLES * sizeof(dummy->loopback.samples[0]));
+
+    if (dummy->loopback.samples == NULL) {
+        status = BLADERF_ERR_MEM;
+        goto error;
+    }
+
+    status = populate_flash(dummy);
+    if (status != 0) {
+        goto error;
+    }
+
+    load_config(dummy);
+    dummy->fpga_configured = true;
+
+    memcpy(&dev->ident, &dummy_info, sizeof(dev->ident));
+
+    dev->transfer_timeout[BLADERF_MODULE_TX] = DUMMY_TRANSFER_TIMEOUT_MS;
+    dev->transfer_timeout[BLADERF_MODULE_RX] = DUMMY_TRANSFER_TIMEOUT_MS;
+
+    strncpy((char *) dev->fw_version.describe, DUMMY_FW_VERSION,
+            BLADERF_VERSION_STR_MAX);
+    status = str2version(dev->fw_version.describe, &dev->fw_version);
+    if (status != 0) {
+        goto error;
+    }
+
+    strncpy((char *) dev->fpga_version.describe, DUMMY_FPGA_VERSION,
+            BLADERF_VERSION_STR_MAX);
+    status = str2version(dev->fpga_version.describe, &dev->fpga_version);
+
+error:
+    if (status != 0) {
+        dummy_close(dev);
+        dev->fn = NULL;
+    }
+
+    return status;
 }
 
-static int dummy_get_cal(struct bladerf *dev, char *cal) {
+/*******************************************************************************
+ * FPGA and flash
+ ******************************************************************************/
+
+static int dummy_load_fpga(struct bladerf *dev, uint8_t *image,
+                           size_t image_size)
+{
+    fpga_load_progress(dev, image_size, image_size);
+    dummy_backend(dev)->fpga_configured = true;
     return 0;
 }
 
-static int dummy_read_flash(struct bladerf *dev, uint32_t addr,
-                           uint8_t *buf, uint32_t len)
+static int dummy_is_fpga_configured(struct bladerf *dev)
+{
+    return dummy_backend(dev)->fpga_configured ? 1 : 0;
+}
+
+static int dummy_erase_flash_blocks(struct bladerf *dev,
+                                    uint32_t eb, uint16_t count)
 {
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    uint16_t i;
+
+    for (i = 0; i < count; i++) {
+        memset(&dummy->flash[(eb + i) * BLADERF_FLASH_EB_SIZE], 0xff,
+               BLADERF_FLASH_EB_SIZE);
+
+        flash_progress(dev, BLADERF_FLASH_OP_ERASE, i + 1, count);
+    }
+
     return 0;
 }
 
-static int dummy_write_flash(struct bladerf *dev, uint32_t addr,
-                        uint8_t *buf, uint32_t len)
+static int dummy_read_flash_pages(struct bladerf *dev, uint8_t *buf,
+                                  uint32_t page, uint32_t count)
 {
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(&buf[i * BLADERF_FLASH_PAGE_SIZE],
+               &dummy->flash[(page + i) * BLADERF_FLASH_PAGE_SIZE],
+               BLADERF_FLASH_PAGE_SIZE);
+
+        flash_progress(dev, BLADERF_FLASH_OP_READ, i + 1, count);
+    }
+
     return 0;
 }
 
-static int dummy_flash_firmware(struct bladerf *dev,
-                               uint8_t *image, size_t image_size)
+static int dummy_write_flash_pages(struct bladerf *dev, const uint8_t *buf,
+                                   uint32_t page, uint32_t count)
 {
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    uint8_t *dest = &dummy->flash[page * BLADERF_FLASH_PAGE_SIZE];
+    uint32_t i;
+    size_t j;
+
+    for (i = 0; i < count; i++) {
+        /* As with NOR flash, programming can only clear bits */
+        for (j = 0; j < BLADERF_FLASH_PAGE_SIZE; j++) {
+            *dest++ &= *buf++;
+        }
+
+        flash_progress(dev, BLADERF_FLASH_OP_WRITE, i + 1, count);
+    }
+
     return 0;
 }
 
@@ -88,95 +433,1201 @@ static int dummy_device_reset(struct bladerf *dev)
     return 0;
 }
 
-static int dummy_jump_to_bootloader(struct bladerf *dev)
+static int dummy_get_cal(struct bladerf *dev, char *cal)
 {
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    memcpy(cal, &dummy->flash[BLADERF_FLASH_ADDR_CAL], CAL_BUFFER_SIZE);
     return 0;
 }
 
 static int dummy_get_otp(struct bladerf *dev, char *otp)
 {
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    memcpy(otp, dummy->otp, OTP_BUFFER_SIZE);
     return 0;
 }
 
 static int dummy_get_device_speed(struct bladerf *dev,
-                                 bladerf_dev_speed *device_speed)
+                                  bladerf_dev_speed *device_speed)
 {
+    *device_speed = BLADERF_DEVICE_SPEED_SUPER;
     return 0;
 }
 
-static int dummy_config_gpio_write(struct bladerf *dev, uint32_t val)
+/*******************************************************************************
+ * Peripherals
+ *
+ * Peripheral accesses are encoded into the same 16-byte UART packets that the
+ * USB backend exchanges with the FPGA's NIOS II control processor, and are
+ * executed by a model of that processor's firmware (lms_spi_controller.c).
+ * Each packet is counted as a control transaction, and incurs the configured
+ * transaction latency.
+ ******************************************************************************/
+
+/* Devices within the NIOS firmware's GPIO address space */
+typedef enum {
+    GDEV_UNKNOWN,
+    GDEV_GPIO,
+    GDEV_IQ_CORR_RX_GAIN,
+    GDEV_IQ_CORR_RX_PHASE,
+    GDEV_IQ_CORR_TX_GAIN,
+    GDEV_IQ_CORR_TX_PHASE,
+    GDEV_FPGA_VERSION,
+    GDEV_TIME_TAMER,
+    GDEV_VCTCXO,
+    GDEV_XB_LO,
+    GDEV_EXPANSION,
+    GDEV_EXPANSION_DIR,
+} dummy_gdev;
+
+static const struct {
+    dummy_gdev gdev;
+    uint8_t start;
+    uint8_t len;
+} gdev_lut[] = {
+    { GDEV_GPIO,                 0,  4 },
+    { GDEV_IQ_CORR_RX_GAIN,      4,  2 },
+    { GDEV_IQ_CORR_RX_PHASE,     6,  2 },
+    { GDEV_IQ_CORR_TX_GAIN,      8,  2 },
+    { GDEV_IQ_CORR_TX_PHASE,    10,  2 },
+    { GDEV_FPGA_VERSION,        12,  4 },
+    { GDEV_TIME_TAMER,          16, 16 },
+    { GDEV_VCTCXO,              34,  2 },
+    { GDEV_XB_LO,               36,  4 },
+    { GDEV_EXPANSION,           40,  4 },
+    { GDEV_EXPANSION_DIR,       44,  4 },
+};
+
+/* Simulated VCO tuning. Each of the LMS6002D's four VCOs (selected via
+ * FREQSEL[5:3] = 4..7) covers the following range of frequencies. Additional
+ * tuning capacitance (i.e., larger VCOCAP values) lowers a VCO's frequency,
+ * so the VCOCAP values for which VTUNE is in range decrease as the programmed
+ * frequency increases across a VCO's range. */
+static const struct {
+    uint64_t min;
+    uint64_t max;
+} vco_range[] = {
+    { 3720000000ull, 4570000000ull },
+    { 4570000000ull, 5390000000ull },
+    { 5390000000ull, 6480000000ull },
+    { 6480000000ull, 7440000000ull },
+};
+
+/* Compute the VTUNE comparator bits for the PLL at the specified register
+ * base: 0x2 if VCOCAP is too low, 0x1 if it is too high */
+static uint8_t vtune_bits(struct bladerf_dummy *dummy, uint8_t base)
 {
+    const uint8_t *regs = &dummy->lms_regs[base];
+    const uint32_t nint = ((uint32_t) regs[0] << 1) | (regs[1] >> 7);
+    const uint32_t nfrac = ((uint32_t) (regs[1] & 0x7f) << 16) |
+                           ((uint32_t) regs[2] << 8) | regs[3];
+    const unsigned int vco = regs[5] >> 5;
+    const int vcocap = regs[9] & 0x3f;
+    int center;
+
+    if (vco >= 4 && vco < 4 + ARRAY_SIZE(vco_range)) {
+        const uint64_t min = vco_range[vco - 4].min;
+        const uint64_t max = vco_range[vco - 4].max;
+        uint64_t f = (DUMMY_LMS_REF_HZ * (((uint64_t) nint << 23) + nfrac))
+                        >> 23;
+
+        f = f < min ? min : (f > max ? max : f);
+
+        center = DUMMY_VCOCAP_LOCK_WIDTH +
+                 (int) ((63 - 2 * DUMMY_VCOCAP_LOCK_WIDTH) * (max - f) /
+                        (max - min));
+    } else {
+        /* PLL not yet configured */
+        center = 32;
+    }
+
+    if (vcocap < center - DUMMY_VCOCAP_LOCK_WIDTH) {
+        return 0x2 << 6;
+    } else if (vcocap > center + DUMMY_VCOCAP_LOCK_WIDTH) {
+        return 0x1 << 6;
+    } else {
+        return 0;
+    }
+}
+
+static void nios_lms_access(struct bladerf_dummy *dummy, bool write,
+                            struct uart_cmd *cmd)
+{
+    const uint8_t addr = cmd->addr & 0x7f;
+
+    if (write) {
+        if (addr != LMS_CHIP_REV_ADDR) {
+            dummy->lms_regs[addr] = cmd->data;
+        }
+        cmd->data = 0;
+    } else if (addr == LMS_TX_PLL_BASE + 10 || addr == LMS_RX_PLL_BASE + 10) {
+        cmd->data = (dummy->lms_regs[addr] & 0x3f) |
+                    vtune_bits(dummy, addr - 10);
+    } else {
+        cmd->data = dummy->lms_regs[addr];
+    }
+}
+
+static void nios_si5338_access(struct bladerf_dummy *dummy, bool write,
+                               struct uart_cmd *cmd)
+{
+    if (write) {
+        dummy->si5338_regs[cmd->addr] = cmd->data;
+        cmd->data = 0;
+    } else {
+        cmd->data = dummy->si5338_regs[cmd->addr];
+    }
+}
+
+/* Update half of an IQ correction register, which holds the phase correction
+ * in its upper 16 bits, and the gain correction in its lower 16 bits */
+static inline void split_write(uint32_t *reg, uint32_t value,
+                               unsigned int shift)
+{
+    *reg &= 0xffff << (16 - shift);
+    *reg |= value << shift;
+}
+
+static void nios_gpio_access(struct bladerf *dev, bool write,
+                             struct uart_cmd *cmd)
+{
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    dummy_gdev gdev = GDEV_UNKNOWN;
+    unsigned int offset = 0;
+    bool last_byte = false;
+    uint32_t value;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(gdev_lut); i++) {
+        if (cmd->addr >= gdev_lut[i].start &&
+            cmd->addr < gdev_lut[i].start + gdev_lut[i].len) {
+            gdev = gdev_lut[i].gdev;
+            offset = cmd->addr - gdev_lut[i].start;
+            last_byte = offset == (unsigned int) gdev_lut[i].len - 1;
+            break;
+        }
+    }
+
+    if (!write) {
+        switch (gdev) {
+            case GDEV_GPIO:
+                cmd->data = dummy->config_gpio >> (offset * 8);
+                break;
+
+            case GDEV_IQ_CORR_RX_GAIN:
+                cmd->data = dummy->iq_corr[BLADERF_MODULE_RX] >> (offset * 8);
+                break;
+
+            case GDEV_IQ_CORR_RX_PHASE:
+                cmd->data = dummy->iq_corr[BLADERF_MODULE_RX] >>
+                                ((offset + 2) * 8);
+                break;
+
+            case GDEV_IQ_CORR_TX_GAIN:
+                cmd->data = dummy->iq_corr[BLADERF_MODULE_TX] >> (offset * 8);
+                break;
+
+            case GDEV_IQ_CORR_TX_PHASE:
+                cmd->data = dummy->iq_corr[BLADERF_MODULE_TX] >>
+                                ((offset + 2) * 8);
+                break;
+
+            case GDEV_FPGA_VERSION:
+                value = dev->fpga_version.major |
+                        (dev->fpga_version.minor << 8) |
+                        (dev->fpga_version.patch << 16);
+                cmd->data = value >> (offset * 8);
+                break;
+
+            case GDEV_TIME_TAMER:
+                MUTEX_LOCK(&dummy->lock);
+                cmd->data = dummy->timestamp[offset / 8] >> ((offset % 8) * 8);
+                MUTEX_UNLOCK(&dummy->lock);
+                break;
+
+            case GDEV_EXPANSION:
+                cmd->data = dummy->xb_gpio >> (offset * 8);
+                break;
+
+            case GDEV_EXPANSION_DIR:
+                cmd->data = dummy->xb_gpio_dir >> (offset * 8);
+                break;
+
+            default:
+                /* The firmware leaves the data untouched */
+                break;
+        }
+
+        return;
+    }
+
+    /* The timer registers latch upon any write */
+    if (gdev == GDEV_TIME_TAMER || gdev == GDEV_UNKNOWN) {
+        return;
+    }
+
+    /* Multi-byte registers are written once their last byte is received */
+    dummy->gpio_collect &= ~(0xffu << (8 * offset));
+    dummy->gpio_collect |= (uint32_t) cmd->data << (8 * offset);
+    cmd->data = 0;
+
+    if (!last_byte) {
+        return;
+    }
+
+    value = dummy->gpio_collect;
+    dummy->gpio_collect = 0;
+
+    switch (gdev) {
+        case GDEV_GPIO:
+            dummy->config_gpio = value;
+            break;
+
+        case GDEV_IQ_CORR_RX_GAIN:
+            split_write(&dummy->iq_corr[BLADERF_MODULE_RX], value, 0);
+            break;
+
+        case GDEV_IQ_CORR_RX_PHASE:
+            split_write(&dummy->iq_corr[BLADERF_MODULE_RX], value, 16);
+            break;
+
+        case GDEV_IQ_CORR_TX_GAIN:
+            split_write(&dummy->iq_corr[BLADERF_MODULE_TX], value, 0);
+            break;
+
+        case GDEV_IQ_CORR_TX_PHASE:
+            split_write(&dummy->iq_corr[BLADERF_MODULE_TX], value, 16);
+            break;
+
+        case GDEV_VCTCXO:
+            dummy->dac = (uint16_t) value;
+            break;
+
+        case GDEV_XB_LO:
+            dummy->xb_spi = value;
+            break;
+
+        case GDEV_EXPANSION:
+            dummy->xb_gpio = value;
+            break;
+
+        case GDEV_EXPANSION_DIR:
+            dummy->xb_gpio_dir = value;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Execute a request packet, producing a response packet, as the NIOS firmware
+ * does */
+static int nios_process_pkt(struct bladerf *dev, const uint8_t *req,
+                            uint8_t *resp)
+{
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    struct uart_cmd cmds[DUMMY_NIOS_MAX_CMDS];
+    uint8_t mode = req[1];
+    bool is_read, is_write;
+    size_t i, cnt;
+
+    if (req[0] != UART_PKT_MAGIC) {
+        log_debug("%s: Invalid packet magic: 0x%02x\n", __FUNCTION__, req[0]);
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    if ((mode & UART_PKT_MODE_CNT_MASK) > DUMMY_NIOS_MAX_CMDS) {
+        mode = (mode & ~UART_PKT_MODE_CNT_MASK) | DUMMY_NIOS_MAX_CMDS;
+    }
+
+    cnt = mode & UART_PKT_MODE_CNT_MASK;
+    is_read = (mode & UART_PKT_MODE_DIR_MASK) == UART_PKT_MODE_DIR_READ;
+    is_write = (mode & UART_PKT_MODE_DIR_MASK) == UART_PKT_MODE_DIR_WRITE;
+
+    for (i = 0; i < cnt; i++) {
+        cmds[i].addr = req[i * 2 + 2];
+        cmds[i].data = req[i * 2 + 3];
+
+        if (!is_read && !is_write) {
+            cmds[i].addr = 0;
+            cmds[i].data = 0;
+            continue;
+        }
+
+        switch (mode & UART_PKT_MODE_DEV_MASK) {
+            case UART_PKT_DEV_LMS:
+                nios_lms_access(dummy, is_write, &cmds[i]);
+                break;
+
+            case UART_PKT_DEV_SI5338:
+                nios_si5338_access(dummy, is_write, &cmds[i]);
+                break;
+
+            case UART_PKT_DEV_GPIO:
+                nios_gpio_access(dev, is_write, &cmds[i]);
+                break;
+
+            default:
+                /* Not handled by the firmware */
+                break;
+        }
+    }
+
+    memset(resp, 0xff, DUMMY_NIOS_PKT_SIZE);
+    resp[0] = UART_PKT_MAGIC;
+    resp[1] = mode;
+
+    for (i = 0; i < cnt; i++) {
+        resp[i * 2 + 2] = cmds[i].addr;
+        resp[i * 2 + 3] = cmds[i].data;
+    }
+
     return 0;
 }
 
+/* Perform the specified accesses, packing up to DUMMY_NIOS_MAX_CMDS of them
+ * into each transaction, as the USB backend does */
+static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
+                             bool write, struct uart_cmd *cmd, size_t len)
+{
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+    uint8_t req[DUMMY_NIOS_PKT_SIZE], resp[DUMMY_NIOS_PKT_SIZE];
+    int status = 0;
+    size_t i, j, n;
+
+    for (i = 0; i < len && status == 0; i += n) {
+        n = len - i;
+        if (n > DUMMY_NIOS_MAX_CMDS) {
+            n = DUMMY_NIOS_MAX_CMDS;
+        }
+
+        memset(req, 0, sizeof(req));
+        req[0] = UART_PKT_MAGIC;
+        req[1] = (write ? UART_PKT_MODE_DIR_WRITE : UART_PKT_MODE_DIR_READ) |
+                 peripheral | (uint8_t) n;
+
+        for (j = 0; j < n; j++) {
+            req[j * 2 + 2] = cmd[i + j].addr;
+            req[j * 2 + 3] = cmd[i + j].data;
+        }
+
+        ctrl_stats_transaction(&dev->ctrl_stats, peripheral, n);
+
+        if (dummy->ctrl_latency_us != 0) {
+            usleep(dummy->ctrl_latency_us);
+        }
+
+        status = nios_process_pkt(dev, req, resp);
+
+        if (status == 0 && !write) {
+            for (j = 0; j < n; j++) {
+                cmd[i + j].data = resp[j * 2 + 3];
+            }
+        }
+    }
+
+    return status;
+}
+
+static int gpio_read(struct bladerf *dev, uint8_t addr, uint32_t *data)
+{
+    int status;
+    size_t i;
+    struct uart_cmd cmds[sizeof(*data)];
+
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        cmds[i].addr = (uint8_t) (addr + i);
+        cmds[i].data = 0xff;
+    }
+
+    status = access_peripheral(dev, UART_PKT_DEV_GPIO, false,
+                               cmds, ARRAY_SIZE(cmds));
+
+    if (status == 0) {
+        *data = 0;
+        for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+            *data |= (uint32_t) cmds[i].data << (i * 8);
+        }
+    }
+
+    return status;
+}
+
+static int gpio_write(struct bladerf *dev, uint8_t addr, uint32_t data)
+{
+    size_t i;
+    struct uart_cmd cmds[sizeof(data)];
+
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        cmds[i].addr = (uint8_t) (addr + i);
+        cmds[i].data = (data >> (i * 8)) & 0xff;
+    }
+
+    return access_peripheral(dev, UART_PKT_DEV_GPIO, true,
+                             cmds, ARRAY_SIZE(cmds));
+}
+
+static int dummy_config_gpio_write(struct bladerf *dev, uint32_t val)
+{
+    return gpio_write(dev, UART_PKT_DEV_GPIO_ADDR, val);
+}
+
 static int dummy_config_gpio_read(struct bladerf *dev, uint32_t *val)
 {
-    return 0;
+    return gpio_read(dev, UART_PKT_DEV_GPIO_ADDR, val);
 }
 
-static int dummy_si5338_write(struct bladerf *dev, uint8_t addr, uint8_t data)
+static int dummy_expansion_gpio_write(struct bladerf *dev, uint32_t val)
 {
-    return 0;
+    return gpio_write(dev, 40, val);
 }
 
-static int dummy_si5338_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
+static int dummy_expansion_gpio_read(struct bladerf *dev, uint32_t *val)
 {
-    return 0;
+    return gpio_read(dev, 40, val);
+}
+
+static int dummy_expansion_gpio_dir_write(struct bladerf *dev, uint32_t val)
+{
+    return gpio_write(dev, 44, val);
+}
+
+static int dummy_expansion_gpio_dir_read(struct bladerf *dev, uint32_t *val)
+{
+    return gpio_read(dev, 44, val);
 }
 
 static int dummy_lms_write(struct bladerf *dev, uint8_t addr, uint8_t data)
 {
-    return 0;
+    struct uart_cmd cmd;
+
+    cmd.addr = addr;
+    cmd.data = data;
+
+    return access_peripheral(dev, UART_PKT_DEV_LMS, true, &cmd, 1);
 }
 
 static int dummy_lms_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
 {
-    return 0;
+    int status;
+    struct uart_cmd cmd;
+
+    cmd.addr = addr;
+    cmd.data = 0xff;
+
+    status = access_peripheral(dev, UART_PKT_DEV_LMS, false, &cmd, 1);
+    if (status == 0) {
+        *data = cmd.data;
+    }
+
+    return status;
+}
+
+static int dummy_lms_write_batch(struct bladerf *dev,
+                                 const struct backend_reg *regs, size_t n)
+{
+    int status = 0;
+    size_t i, j, count;
+    struct uart_cmd cmds[DUMMY_NIOS_MAX_CMDS];
+
+    for (i = 0; i < n && status == 0; i += count) {
+        count = n - i;
+        if (count > DUMMY_NIOS_MAX_CMDS) {
+            count = DUMMY_NIOS_MAX_CMDS;
+        }
+
+        for (j = 0; j < count; j++) {
+            cmds[j].addr = regs[i + j].addr;
+            cmds[j].data = regs[i + j].data;
+        }
+
+        status = access_peripheral(dev, UART_PKT_DEV_LMS, true, cmds, count);
+    }
+
+    return status;
+}
+
+static int dummy_lms_read_batch(struct bladerf *dev,
+                                struct backend_reg *regs, size_t n)
+{
+    int status = 0;
+    size_t i, j, count;
+    struct uart_cmd cmds[DUMMY_NIOS_MAX_CMDS];
+
+    for (i = 0; i < n && status == 0; i += count) {
+        count = n - i;
+        if (count > DUMMY_NIOS_MAX_CMDS) {
+            count = DUMMY_NIOS_MAX_CMDS;
+        }
+
+        for (j = 0; j < count; j++) {
+            cmds[j].addr = regs[i + j].addr;
+            cmds[j].data = 0xff;
+        }
+
+        status = access_peripheral(dev, UART_PKT_DEV_LMS, false, cmds, count);
+
+        for (j = 0; j < count && status == 0; j++) {
+            regs[i + j].data = cmds[j].data;
+        }
+    }
+
+    return status;
+}
+
+/* Correction values are stored in the same registers, and with the same
+ * scaling, as they are on the device */
+static int dummy_set_correction(struct bladerf *dev, bladerf_module module,
+                                bladerf_correction corr, int16_t value)
+{
+    const bool rx = module == BLADERF_MODULE_RX;
+    struct uart_cmd cmds[2];
+    uint8_t addr, tmp;
+    int status;
+
+    switch (corr) {
+        case BLADERF_CORR_FPGA_PHASE:
+        case BLADERF_CORR_FPGA_GAIN:
+            if (corr == BLADERF_CORR_FPGA_GAIN) {
+                addr = rx ? UART_PKT_DEV_RX_GAIN_ADDR :
+                            UART_PKT_DEV_TX_GAIN_ADDR;
+
+                /* A gain correction of 0 corresponds to unity gain */
+                value += (int16_t) 4096;
+            } else {
+                addr = rx ? UART_PKT_DEV_RX_PHASE_ADDR :
+                            UART_PKT_DEV_TX_PHASE_ADDR;
+            }
+
+            cmds[0].addr = addr;
+            cmds[0].data = value & 0xff;
+            cmds[1].addr = addr + 1;
+            cmds[1].data = (value >> 8) & 0xff;
+
+            return access_peripheral(dev, UART_PKT_DEV_GPIO, true, cmds, 2);
+
+        case BLADERF_CORR_LMS_DCOFF_I:
+        case BLADERF_CORR_LMS_DCOFF_Q:
+            if (corr == BLADERF_CORR_LMS_DCOFF_I) {
+                addr = rx ? 0x71 : 0x42;
+            } else {
+                addr = rx ? 0x72 : 0x43;
+            }
+
+            status = dummy_lms_read(dev, addr, &tmp);
+            if (status != 0) {
+                return status;
+            }
+
+            if (rx) {
+                /* 6 bits of magnitude plus a sign bit, preserving bit 7 */
+                value >>= 5;
+                if (value < 0) {
+                    value = ((value <= -64) ? 0x3f : (-value & 0x3f)) |
+                            (1 << 6);
+                } else {
+                    value = (value >= 64) ? 0x3f : (value & 0x3f);
+                }
+
+                tmp = (tmp & (1 << 7)) | (uint8_t) value;
+            } else {
+                /* 0x00 = -16, 0x80 = 0, 0xff = 15.9375 */
+                value >>= 4;
+                if (value >= 0) {
+                    tmp = (1 << 7) | ((value >= 128) ? 0x7f : (value & 0x7f));
+                } else {
+                    tmp = (value <= -128) ? 0x00 : (value & 0x7f);
+                }
+            }
+
+            return dummy_lms_write(dev, addr, tmp);
+
+        default:
+            return BLADERF_ERR_INVAL;
+    }
+}
+
+static int dummy_get_correction(struct bladerf *dev, bladerf_module module,
+                                bladerf_correction corr, int16_t *value)
+{
+    const bool rx = module == BLADERF_MODULE_RX;
+    struct uart_cmd cmds[2];
+    uint8_t addr, tmp;
+    int status;
+
+    switch (corr) {
+        case BLADERF_CORR_FPGA_PHASE:
+        case BLADERF_CORR_FPGA_GAIN:
+            if (corr == BLADERF_CORR_FPGA_GAIN) {
+                addr = rx ? UART_PKT_DEV_RX_GAIN_ADDR :
+                            UART_PKT_DEV_TX_GAIN_ADDR;
+            } else {
+                addr = rx ? UART_PKT_DEV_RX_PHASE_ADDR :
+                            UART_PKT_DEV_TX_PHASE_ADDR;
+            }
+
+            cmds[0].addr = addr;
+            cmds[0].data = 0xff;
+            cmds[1].addr = addr + 1;
+            cmds[1].data = 0xff;
+
+            status = access_peripheral(dev, UART_PKT_DEV_GPIO, false, cmds, 2);
+            if (status == 0) {
+                *value = cmds[0].data | (cmds[1].data << 8);
+                if (corr == BLADERF_CORR_FPGA_GAIN) {
+                    *value -= 4096;
+                }
+            }
+
+            return status;
+
+        case BLADERF_CORR_LMS_DCOFF_I:
+        case BLADERF_CORR_LMS_DCOFF_Q:
+            if (corr == BLADERF_CORR_LMS_DCOFF_I) {
+                addr = rx ? 0x71 : 0x42;
+            } else {
+                addr = rx ? 0x72 : 0x43;
+            }
+
+            status = dummy_lms_read(dev, addr, &tmp);
+            if (status == 0) {
+                if (rx) {
+                    tmp &= 0x7f;
+                    *value = (tmp & (1 << 6)) ? -(int16_t) (tmp & 0x3f) :
+                                                 (int16_t) (tmp & 0x3f);
+                    *value <<= 5;
+                } else {
+                    *value = (int16_t) tmp << 4;
+                }
+            }
+
+            return status;
+
+        default:
+            return BLADERF_ERR_INVAL;
+    }
+}
+
+static int dummy_get_timestamp(struct bladerf *dev, bladerf_module module,
+                               uint64_t *value)
+{
+    int status;
+    size_t i;
+    struct uart_cmd cmds[sizeof(*value)];
+
+    /* As with the USB backend, all 8 bytes are read in a batched access,
+     * which is split across two transactions */
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        cmds[i].addr = (uint8_t) ((module == BLADERF_MODULE_RX ? 16 : 24) + i);
+        cmds[i].data = 0xff;
+    }
+
+    status = access_peripheral(dev, UART_PKT_DEV_GPIO, false,
+                               cmds, ARRAY_SIZE(cmds));
+
+    if (status == 0) {
+        *value = 0;
+        for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+            *value |= (uint64_t) cmds[i].data << (i * 8);
+        }
+    }
+
+    return status;
+}
+
+static int dummy_si5338_write(struct bladerf *dev, uint8_t addr, uint8_t data)
+{
+    struct uart_cmd cmd;
+
+    cmd.addr = addr;
+    cmd.data = data;
+
+    return access_peripheral(dev, UART_PKT_DEV_SI5338, true, &cmd, 1);
+}
+
+static int dummy_si5338_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
+{
+    int status;
+    struct uart_cmd cmd;
+
+    cmd.addr = addr;
+    cmd.data = 0xff;
+
+    status = access_peripheral(dev, UART_PKT_DEV_SI5338, false, &cmd, 1);
+    if (status == 0) {
+        *data = cmd.data;
+    }
+
+    return status;
 }
 
 static int dummy_dac_write(struct bladerf *dev, uint16_t value)
 {
+    struct uart_cmd cmds[2];
+
+    cmds[0].addr = 34;
+    cmds[0].data = value & 0xff;
+    cmds[1].addr = 35;
+    cmds[1].data = (value >> 8) & 0xff;
+
+    return access_peripheral(dev, UART_PKT_DEV_GPIO, true, cmds, 2);
+}
+
+static int dummy_xb_spi(struct bladerf *dev, uint32_t value)
+{
+    return gpio_write(dev, 36, value);
+}
+
+static int dummy_set_firmware_loopback(struct bladerf *dev, bool enable)
+{
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+
+    MUTEX_LOCK(&dummy->lock);
+    dummy->loopback.enabled = enable;
+    dummy->loopback.head = 0;
+    dummy->loopback.count = 0;
+    MUTEX_UNLOCK(&dummy->lock);
+
     return 0;
 }
 
-int dummy_set_correction(struct bladerf *dev, bladerf_module module,
-                          bladerf_correction corr, int16_t value)
+static int dummy_get_firmware_loopback(struct bladerf *dev, bool *is_enabled)
 {
+    struct bladerf_dummy *dummy = dummy_backend(dev);
+
+    MUTEX_LOCK(&dummy->lock);
+    *is_enabled = dummy->loopback.enabled;
+    MUTEX_UNLOCK(&dummy->lock);
+
     return 0;
 }
 
-int dummy_get_correction(struct bladerf *dev, bladerf_module module,
-                          bladerf_correction corr, int16_t *value)
+static int dummy_enable_module(struct bladerf *dev, bladerf_module m,
+                               bool enable)
 {
     return 0;
 }
 
-static int dummy_stream_init(struct bladerf_stream *stream)
+/*******************************************************************************
+ * Sample stream
+ ******************************************************************************/
+
+/* Assumes dummy->lock is held */
+static void loopback_write(struct dummy_loopback *lb,
+                           const uint8_t *samples, size_t n)
+{
+    size_t i, idx;
+
+    if (n > DUMMY_LOOPBACK_SAMPLES - lb->count) {
+        log_debug("Loopback FIFO full - dropping %u samples\n",
+                  (unsigned int) (n - (DUMMY_LOOPBACK_SAMPLES - lb->count)));
+        n = DUMMY_LOOPBACK_SAMPLES - lb->count;
+    }
+
+    idx = (lb->head + lb->count) % DUMMY_LOOPBACK_SAMPLES;
+    for (i = 0; i < n; i++) {
+        memcpy(&lb->samples[2 * idx], &samples[4 * i], 4);
+        idx = (idx + 1) % DUMMY_LOOPBACK_SAMPLES;
+    }
+
+    lb->count += n;
+}
+
+/* Assumes dummy->lock is held. Any shortfall is filled with zeros. */
+static void loopback_read(struct dummy_loopback *lb, uint8_t *samples, size_t n)
+{
+    size_t i;
+    const size_t to_read = n < lb->count ? n : lb->count;
+
+    for (i = 0; i < to_read; i++) {
+        memcpy(&samples[4 * i], &lb->samples[2 * lb->head], 4);
+        lb->head = (lb->head + 1) % DUMMY_LOOPBACK_SAMPLES;
+    }
+
+    lb->count -= to_read;
+    memset(&samples[4 * to_read], 0, 4 * (n - to_read));
+}
+
+static void generate_samples(struct bladerf_dummy *dummy,
+                             struct dummy_stream_data *data,
+                             uint8_t *samples, size_t n)
+{
+    size_t i;
+    int16_t iq[2];
+
+    switch (dummy->waveform) {
+        case DUMMY_WAVEFORM_RAMP:
+            for (i = 0; i < n; i++, data->phase++) {
+                iq[0] = (int16_t) ((data->phase & 0xfff) - 2048);
+                iq[1] = -iq[0] - 1;
+                iq[0] = HOST_TO_LE16(iq[0]);
+                iq[1] = HOST_TO_LE16(iq[1]);
+                memcpy(&samples[4 * i], iq, sizeof(iq));
+            }
+            break;
+
+        case DUMMY_WAVEFORM_TONE:
+            for (i = 0; i < n; i++, data->phase++) {
+                iq[0] = HOST_TO_LE16(tone_i[data->phase & 7]);
+                iq[1] = HOST_TO_LE16(tone_q[data->phase & 7]);
+                memcpy(&samples[4 * i], iq, sizeof(iq));
+            }
+            break;
+
+        default:
+            memset(samples, 0, 4 * n);
+    }
+}
+
+/* Fill an RX buffer with samples, and metadata if applicable */
+static void rx_fill(struct bladerf_stream *stream, uint8_t *buf)
+{
+    struct bladerf_dummy *dummy = dummy_backend(stream->dev);
+    struct dummy_stream_data *data = stream->backend_data;
+    const size_t msg_size = stream->dev->msg_size;
+    const size_t buf_size = async_stream_buf_bytes(stream);
+    size_t n, off;
+    uint64_t timestamp;
+    bool loopback;
+
+    MUTEX_LOCK(&dummy->lock);
+    timestamp = dummy->timestamp[BLADERF_MODULE_RX];
+    loopback = dummy->loopback.enabled;
+
+    if (loopback) {
+        if (stream->format == BLADERF_FORMAT_SC16_Q11_META) {
+            n = bytes_to_sc16q11(msg_size - METADATA_HEADER_SIZE);
+            for (off = 0; off < buf_size; off += msg_size) {
+                loopback_read(&dummy->loopback,
+                              &buf[off + METADATA_HEADER_SIZE], n);
+            }
+        } else {
+            loopback_read(&dummy->loopback, buf, stream->samples_per_buffer);
+        }
+    }
+    MUTEX_UNLOCK(&dummy->lock);
+
+    if (stream->format == BLADERF_FORMAT_SC16_Q11_META) {
+        n = bytes_to_sc16q11(msg_size - METADATA_HEADER_SIZE);
+
+        for (off = 0; off < buf_size; off += msg_size) {
+            metadata_set(&buf[off], timestamp, 0);
+
+            if (!loopback) {
+                generate_samples(dummy, data,
+                                 &buf[off + METADATA_HEADER_SIZE], n);
+            }
+
+            timestamp += n;
+        }
+    } else {
+        if (!loopback) {
+            generate_samples(dummy, data, buf, stream->samples_per_buffer);
+        }
+
+        timestamp += stream->samples_per_buffer;
+    }
+
+    MUTEX_LOCK(&dummy->lock);
+    dummy->timestamp[BLADERF_MODULE_RX] = timestamp;
+    MUTEX_UNLOCK(&dummy->lock);
+}
+
+/* Consume a TX buffer, looping it back to RX if applicable */
+static void tx_consume(struct bladerf_stream *stream, const uint8_t *buf)
+{
+    struct bladerf_dummy *dummy = dummy_backend(stream->dev);
+    const size_t msg_size = stream->dev->msg_size;
+    const size_t buf_size = async_stream_buf_bytes(stream);
+    size_t n, off;
+    uint64_t msg_timestamp;
+    uint64_t *timestamp;
+
+    MUTEX_LOCK(&dummy->lock);
+    timestamp = &dummy->timestamp[BLADERF_MODULE_TX];
+
+    if (stream->format == BLADERF_FORMAT_SC16_Q11_META) {
+        n = bytes_to_sc16q11(msg_size - METADATA_HEADER_SIZE);
+
+        for (off = 0; off < buf_size; off += msg_size) {
+            /* A timestamp of 0 indicates the samples are to be sent "now".
+             * Otherwise, the device would idle until the specified time. */
+            msg_timestamp = metadata_get_timestamp(&buf[off]);
+            if (msg_timestamp > *timestamp) {
+                *timestamp = msg_timestamp;
+            }
+
+            if (dummy->loopback.enabled) {
+                loopback_write(&dummy->loopback,
+                               &buf[off + METADATA_HEADER_SIZE], n);
+            }
+
+            *timestamp += n;
+        }
+    } else {
+        if (dummy->loopback.enabled) {
+            loopback_write(&dummy->loopback, buf, stream->samples_per_buffer);
+        }
+
+        *timestamp += stream->samples_per_buffer;
+    }
+
+    MUTEX_UNLOCK(&dummy->lock);
+}
+
+static int dummy_init_stream(struct bladerf_stream *stream,
+                             size_t num_transfers)
 {
+    struct dummy_stream_data *data;
+
+    data = calloc(1, sizeof(*data));
+    if (data == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    data->transfers = calloc(num_transfers, sizeof(data->transfers[0]));
+    if (data->transfers == NULL) {
+        free(data);
+        return BLADERF_ERR_MEM;
+    }
+
+    if (pthread_cond_init(&data->submitted, NULL) != 0) {
+        free(data->transfers);
+        free(data);
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    data->num_transfers = num_transfers;
+    data->num_avail = num_transfers;
+
+    stream->backend_data = data;
     return 0;
 }
 
+/* Assumes stream->lock is held. Precondition: A transfer is available. */
+static void submit_transfer(struct bladerf_stream *stream, void *buffer)
+{
+    struct dummy_stream_data *data = stream->backend_data;
+    const size_t in_flight = data->num_transfers - data->num_avail;
+
+    assert(data->num_avail != 0);
+
+    data->transfers[(data->i + in_flight) % data->num_transfers] = buffer;
+    data->num_avail--;
+
+    async_stats_submitted(stream, in_flight + 1);
+
+    pthread_cond_signal(&data->submitted);
+}
+
+/* Assumes stream->lock is held. Completes the oldest in-flight transfer and
+ * hands its buffer to the stream callback. */
+static void complete_transfer(struct bladerf_stream *stream)
+{
+    struct dummy_stream_data *data = stream->backend_data;
+    struct bladerf_metadata metadata;
+    void *buffer, *next_buffer;
+
+    buffer = data->transfers[data->i];
+    data->transfers[data->i] = NULL;
+    data->i = (data->i + 1) % data->num_transfers;
+    data->num_avail++;
+    data->samples_done += stream->samples_per_buffer;
+
+    pthread_cond_signal(&stream->can_submit_buffer);
+
+    if (stream->state == STREAM_RUNNING) {
+        async_stats_completed(stream, async_stream_buf_bytes(stream),
+                              async_stream_buf_bytes(stream));
+
+        async_rx_arrival(stream, buffer, async_stream_buf_bytes(stream),
+                         time_model_now_ns());
+
+        memset(&metadata, 0, sizeof(metadata));
+
+        next_buffer = stream->cb(stream->dev, stream, &metadata, buffer,
+                                 stream->samples_per_buffer,
+                                 stream->user_data);
+
+        if (next_buffer == BLADERF_STREAM_SHUTDOWN) {
+            stream->state = STREAM_SHUTTING_DOWN;
+        } else if (next_buffer != BLADERF_STREAM_NO_DATA) {
+            submit_transfer(stream, next_buffer);
+        }
+
+        async_stats_in_flight(stream, data->num_transfers - data->num_avail);
+    }
+}
+
+/* Compute the absolute time at which the next transfer completes */
+static void next_deadline(struct dummy_stream_data *data,
+                          unsigned int sample_rate, struct timespec *t)
+{
+    const uint64_t nsec_per_sec = 1000 * 1000 * 1000;
+    const uint64_t samples = data->samples_done + 1;
+    const uint64_t nsec = (samples % sample_rate) * nsec_per_sec / sample_rate;
+
+    t->tv_sec = data->start.tv_sec + (time_t) (samples / sample_rate);
+    t->tv_nsec = data->start.tv_nsec + (long) nsec;
+
+    if (t->tv_nsec >= (long) nsec_per_sec) {
+        t->tv_sec += t->tv_nsec / nsec_per_sec;
+        t->tv_nsec %= nsec_per_sec;
+    }
+}
+
 static int dummy_stream(struct bladerf_stream *stream, bladerf_module module)
 {
+    size_t i;
+    int status;
+    void *buffer;
+    struct bladerf_metadata metadata;
+    struct bladerf_dummy *dummy = dummy_backend(stream->dev);
+    struct dummy_stream_data *data = stream->backend_data;
+    struct timespec deadline;
+
+    memset(&metadata, 0, sizeof(metadata));
+
+    MUTEX_LOCK(&stream->lock);
+
+    /* Set up the initial set of transfers, as the USB backends do */
+    for (i = 0; i < data->num_transfers; i++) {
+        if (module == BLADERF_MODULE_TX) {
+            buffer = stream->cb(stream->dev, stream, &metadata, NULL,
+                                stream->samples_per_buffer, stream->user_data);
+
+            if (buffer == BLADERF_STREAM_SHUTDOWN) {
+                stream->state = STREAM_SHUTTING_DOWN;
+                break;
+            }
+        } else {
+            buffer = stream->buffers[i];
+        }
+
+        if (buffer != BLADERF_STREAM_NO_DATA) {
+            submit_transfer(stream, buffer);
+        }
+    }
+
+    clock_gettime(CLOCK_REALTIME, &data->start);
+    data->samples_done = 0;
+
+    while (stream->state == STREAM_RUNNING) {
+        if (data->num_avail == data->num_transfers) {
+            /* Nothing to do until a transfer is submitted */
+            pthread_cond_wait(&data->submitted, &stream->lock);
+            continue;
+        }
+
+        if (dummy->sample_rate != 0) {
+            next_deadline(data, dummy->sample_rate, &deadline);
+            status = pthread_cond_timedwait(&data->submitted, &stream->lock,
+                                            &deadline);
+
+            /* Re-evaluate the stream state if we were woken up early */
+            if (status == 0) {
+                continue;
+            }
+        }
+
+        /* The buffer belongs to the in-flight transfer, so it may be accessed
+         * without holding the stream lock. Only this thread completes
+         * transfers, so it won't be removed from the queue in the meantime. */
+        buffer = data->transfers[data->i];
+        MUTEX_UNLOCK(&stream->lock);
+
+        if (module == BLADERF_MODULE_RX) {
+            rx_fill(stream, buffer);
+        } else {
+            tx_consume(stream, buffer);
+        }
+
+        MUTEX_LOCK(&stream->lock);
+        complete_transfer(stream);
+    }
+
+    /* Any transfers still in flight are considered to be cancelled */
+    data->num_avail = data->num_transfers;
+    stream->state = STREAM_DONE;
+    pthread_cond_broadcast(&stream->can_submit_buffer);
+
+    MUTEX_UNLOCK(&stream->lock);
     return 0;
 }
 
+/* Assumes stream->lock is held */
+static int submit_stream_buffer(struct bladerf_stream *stream, void *buffer,
+                                unsigned int timeout_ms)
+{
+    int status = 0;
+    struct dummy_stream_data *data = stream->backend_data;
+    struct timespec timeout_abs;
+
+    if (buffer == BLADERF_STREAM_SHUTDOWN) {
+        if (data->num_avail == data->num_transfers) {
+            stream->state = STREAM_DONE;
+        } else {
+            stream->state = STREAM_SHUTTING_DOWN;
+        }
+
+        pthread_cond_signal(&data->submitted);
+        return 0;
+    }
+
+    if (timeout_ms != 0) {
+        status = populate_abs_timeout(&timeout_abs, timeout_ms);
+        if (status != 0) {
+            return BLADERF_ERR_UNEXPECTED;
+        }
+
+        while (data->num_avail == 0 && status == 0 &&
+               stream->state == STREAM_RUNNING) {
+            status = pthread_cond_timedwait(&stream->can_submit_buffer,
+                                            &stream->lock, &timeout_abs);
+        }
+    } else {
+        while (data->num_avail == 0 && status == 0 &&
+               stream->state == STREAM_RUNNING) {
+            status = pthread_cond_wait(&stream->can_submit_buffer,
+                                       &stream->lock);
+        }
+    }
+
+    if (status == ETIMEDOUT) {
+        log_debug("%s: Timed out waiting for a transfer to become availble.\n",
+                  __FUNCTION__);
+        return BLADERF_ERR_TIMEOUT;
+    } else if (status != 0 || stream->state != STREAM_RUNNING) {
+        return BLADERF_ERR_UNEXPECTED;
+    } else {
+        submit_transfer(stream, buffer);
+        return 0;
+    }
+}
+
 static int dummy_submit_stream_buffer(struct bladerf_stream *stream,
                                       void *buffer,
                                       unsigned int timeout_ms)
 {
-    return 0;
-}
+    int status;
 
-void dummy_deinit_stream(struct bladerf_stream *stream)
-{
-    return;
+    MUTEX_LOCK(&stream->lock);
+    status = submit_stream_buffer(stream, buffer, timeout_ms);
+    MUTEX_UNLOCK(&stream->lock);
+
+    return status;
 }
 
-/* We never "find" dummy devices */
-int dummy_probe(struct bladerf_devinfo_list *info_list)
+static void dummy_deinit_stream(struct bladerf_stream *stream)
 {
-    return 0;
+    struct dummy_stream_data *data = stream->backend_data;
+
+    if (data != NULL) {
+        pthread_cond_destroy(&data->submitted);
+        free(data->transfers);
+        free(data);
+        stream->backend_data = NULL;
+    }
 }
 
 const struct backend_fns backend_fns_dummy = {
@@ -190,13 +1641,12 @@ const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.load_fpga, dummy_load_fpga),
     FIELD_INIT(.is_fpga_configured, dummy_is_fpga_configured),
 
-    FIELD_INIT(.flash_firmware, dummy_flash_firmware),
+    FIELD_INIT(.erase_flash_blocks, dummy_erase_flash_blocks),
+    FIELD_INIT(.read_flash_pages, dummy_read_flash_pages),
+    FIELD_INIT(.write_flash_pages, dummy_write_flash_pages),
 
-    FIELD_INIT(.erase_flash, dummy_erase_flash),
-    FIELD_INIT(.read_flash, dummy_read_flash),
-    FIELD_INIT(.write_flash, dummy_write_flash),
     FIELD_INIT(.device_reset, dummy_device_reset),
-    FIELD_INIT(.jump_to_bootloader, dummy_jump_to_bootloader),
+    FIELD_INIT(.jump_to_bootloader, NULL),
 
     FIELD_INIT(.get_cal, dummy_get_cal),
     FIELD_INIT(.get_otp, dummy_get_otp),
@@ -205,20 +1655,34 @@ const struct backend_fns backend_fns_dummy = {
     FIELD_INIT(.config_gpio_write, dummy_config_gpio_write),
     FIELD_INIT(.config_gpio_read, dummy_config_gpio_read),
 
+    FIELD_INIT(.expansion_gpio_write, dummy_expansion_gpio_write),
+    FIELD_INIT(.expansion_gpio_read, dummy_expansion_gpio_read),
+    FIELD_INIT(.expansion_gpio_dir_write, dummy_expansion_gpio_dir_write),
+    FIELD_INIT(.expansion_gpio_dir_read, dummy_expansion_gpio_dir_read),
+
     FIELD_INIT(.set_correction, dummy_set_correction),
     FIELD_INIT(.get_correction, dummy_get_correction),
 
+    FIELD_INIT(.get_timestamp, dummy_get_timestamp),
+
     FIELD_INIT(.si5338_write, dummy_si5338_write),
     FIELD_INIT(.si5338_read, dummy_si5338_read),
 
     FIELD_INIT(.lms_write, dummy_lms_write),
     FIELD_INIT(.lms_read, dummy_lms_read),
+    FIELD_INIT(.lms_write_batch, dummy_lms_write_batch),
+    FIELD_INIT(.lms_read_batch, dummy_lms_read_batch),
 
     FIELD_INIT(.dac_write, dummy_dac_write),
 
+    FIELD_INIT(.xb_spi, dummy_xb_spi),
+
+    FIELD_INIT(.set_firmware_loopback, dummy_set_firmware_loopback),
+    FIELD_INIT(.get_firmware_loopback, dummy_get_firmware_loopback),
+
     FIELD_INIT(.enable_module, dummy_enable_module),
 
-    FIELD_INIT(.init_stream, dummy_stream_init),
+    FIELD_INIT(.init_stream, dummy_init_stream),
     FIELD_INIT(.stream, dummy_stream),
     FIELD_INIT(.submit_stream_buffer, dummy_submit_stream_buffer),
     FIELD_INIT(.deinit_stream, dummy_deinit_stream),
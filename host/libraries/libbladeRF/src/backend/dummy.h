@@ -18,11 +18,11 @@
  * License along with this library; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
-#if defined(ENABLE_BACKEND_DUMMY) 
+#ifndef BACKEND_DUMMY_H__
 #define BACKEND_DUMMY_H__
 
-#include "bladerf_priv.h"
+#include "backend/backend.h"
 
-extern const struct bladerf_fn bladerf_dummy_fn;
+extern const struct backend_fns backend_fns_dummy;
 
 #endif
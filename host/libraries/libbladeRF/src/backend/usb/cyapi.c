@@ -508,6 +508,8 @@ static int submit_transfer(struct bladerf_stream *stream, void *buffer)
 
         data->avail_i = next_idx(data, data->avail_i);
         data->num_avail--;
+
+        async_stats_submitted(stream, data->num_transfers - data->num_avail);
     } else {
         status = BLADERF_ERR_UNEXPECTED;
         log_debug("Failed to submit buffer %p in transfer slot %u.\n",
@@ -617,6 +619,9 @@ static int cyapi_stream(void *driver, struct bladerf_stream *stream,
                                            xfer->handle);
 
         if (success) {
+            async_stats_completed(stream, async_stream_buf_bytes(stream),
+                                  (size_t) len);
+
             next_buffer = stream->cb(stream->dev, stream, &meta,
                                      data->transfers[i].buffer,
                                      bytes_to_samples(stream->format, len),
@@ -641,6 +646,11 @@ static int cyapi_stream(void *driver, struct bladerf_stream *stream,
             done = (status != 0);
         }
 
+        if (!done) {
+            async_stats_in_flight(stream,
+                                  data->num_transfers - data->num_avail);
+        }
+
         data->inflight_i = next_idx(data, data->inflight_i);
         MUTEX_UNLOCK(&stream->lock);
     }
@@ -677,9 +687,9 @@ out:
 
     return 0;
 }
-/* The top-level code will have aquired the stream->lock for us */
-int cyapi_submit_stream_buffer(void *driver, struct bladerf_stream *stream,
-                              void *buffer, unsigned int timeout_ms)
+/* Assumes stream->lock is held */
+static int submit_stream_buffer(struct bladerf_stream *stream, void *buffer,
+                                unsigned int timeout_ms)
 {
     int status = 0;
     struct timespec timeout_abs;
@@ -722,6 +732,18 @@ int cyapi_submit_stream_buffer(void *driver, struct bladerf_stream *stream,
     }
 }
 
+int cyapi_submit_stream_buffer(void *driver, struct bladerf_stream *stream,
+                              void *buffer, unsigned int timeout_ms)
+{
+    int status;
+
+    MUTEX_LOCK(&stream->lock);
+    status = submit_stream_buffer(stream, buffer, timeout_ms);
+    MUTEX_UNLOCK(&stream->lock);
+
+    return status;
+}
+
 extern "C" {
     static const struct usb_fns cypress_fns = {
         FIELD_INIT(.probe, cyapi_probe),
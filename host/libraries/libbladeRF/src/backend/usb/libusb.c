@@ -27,6 +27,7 @@
 #include "backend/backend.h"
 #include "backend/usb/usb.h"
 #include "async.h"
+#include "thread_config.h"
 #include "log.h"
 
 #ifndef LIBUSB_HANDLE_EVENTS_TIMEOUT_NSEC
@@ -37,6 +38,24 @@ struct bladerf_lusb {
     libusb_device           *dev;
     libusb_device_handle    *handle;
     libusb_context          *context;
+
+    /* A single thread handles libusb events on behalf of both the RX and TX
+     * streams. It is started along with the first stream, and stopped when
+     * the device is closed. */
+    pthread_t               event_thread;
+    bool                    event_thread_started;
+
+    MUTEX                   event_lock;     /* Protects the following items */
+    pthread_cond_t          event_cond;     /* Signaled upon changes below */
+    struct bladerf_stream   *streams[2];    /* Streams being serviced, indexed
+                                             * by module */
+    unsigned int            active_streams; /* # of streams being serviced */
+    bool                    event_thread_stop;
+
+    /* Scheduling configuration for the event thread. This is (re)applied by
+     * the thread when thread_config_changed is set. */
+    struct bladerf_thread_config thread_config;
+    bool                    thread_config_changed;
 };
 
 typedef enum {
@@ -46,12 +65,29 @@ typedef enum {
     TRANSFER_CANCEL_PENDING
 } transfer_status;
 
+/* Per-transfer state. This is the libusb transfer's user_data, such that a
+ * completed transfer's bookkeeping can be located without a search. */
+struct lusb_transfer {
+    struct libusb_transfer *handle;
+    struct bladerf_stream *stream;      /* Stream this transfer belongs to */
+    size_t idx;                         /* Index into transfers[] */
+    transfer_status status;             /* Accessed with stream->lock held */
+    bool launching;                     /* Between prepare_transfer() and the
+                                         * end of launch_transfer(). Accessed
+                                         * with stream->lock held. */
+};
+
+/* All items are accessed with the associated stream->lock held */
 struct lusb_stream_data {
     size_t num_transfers;               /* Total # of allocated transfers */
     size_t num_avail;                   /* # of currently available transfers */
-    size_t i;                           /* Index to next transfer */
-    struct libusb_transfer **transfers; /* Array of transfer metadata */
-    transfer_status *transfer_status;   /* Status of each transfer */
+    struct lusb_transfer *transfers;    /* Array of transfer metadata */
+    struct lusb_transfer **avail;       /* Stack of the num_avail available
+                                         * transfers */
+    struct lusb_transfer **pending;     /* Transfers awaiting submission
+                                         * when the stream is started */
+    pthread_cond_t done;                /* Signaled upon entering
+                                         * STREAM_DONE */
 };
 
 static inline struct bladerf_lusb * lusb_backend(struct bladerf *dev)
@@ -389,6 +425,16 @@ static int lusb_open(void **driver,
                     continue;
                 }
 
+                lusb->event_thread_started = false;
+                lusb->streams[BLADERF_MODULE_RX] = NULL;
+                lusb->streams[BLADERF_MODULE_TX] = NULL;
+                lusb->active_streams = 0;
+                lusb->event_thread_stop = false;
+                lusb->thread_config_changed = false;
+                memset(&lusb->thread_config, 0, sizeof(lusb->thread_config));
+                MUTEX_INIT(&lusb->event_lock);
+                pthread_cond_init(&lusb->event_cond, NULL);
+
                 memcpy(info_out, &thisinfo, sizeof(struct bladerf_devinfo));
                 *driver = lusb;
                 break;
@@ -458,6 +504,18 @@ static void lusb_close(void *driver)
     int status;
     struct bladerf_lusb *lusb = (struct bladerf_lusb *) driver;
 
+    if (lusb->event_thread_started) {
+        MUTEX_LOCK(&lusb->event_lock);
+        lusb->event_thread_stop = true;
+        pthread_cond_signal(&lusb->event_cond);
+        MUTEX_UNLOCK(&lusb->event_lock);
+
+        pthread_join(lusb->event_thread, NULL);
+    }
+
+    pthread_cond_destroy(&lusb->event_cond);
+    MUTEX_DESTROY(&lusb->event_lock);
+
     status = libusb_release_interface(lusb->handle, 0);
     if (status < 0) {
         log_error("Failed to release interface: %s\n",
@@ -597,6 +655,247 @@ static int lusb_bulk_transfer(void *driver, uint8_t endpoint, void *buffer,
     return status;
 }
 
+/* State shared by the transfers of a chunked bulk transfer. The transfers
+ * may complete on the event thread of an active stream, so the items below
+ * `lock` are only accessed with it held. */
+struct bulk_chunks {
+    uint8_t *buffer;
+    uint32_t len;
+    uint32_t chunk_len;
+
+    MUTEX lock;
+    uint32_t submitted;         /* Bytes submitted thus far */
+    uint32_t done;              /* Bytes transferred thus far */
+    unsigned int in_flight;     /* Transfers currently in flight */
+    int status;                 /* First error encountered */
+    int completed;              /* Set once no transfers remain in flight,
+                                 * and none will be submitted */
+};
+
+/* Record an error, and flag completion if nothing remains in flight.
+ * Assumes c->lock is held. */
+static void chunks_update(struct bulk_chunks *c, int status)
+{
+    if (c->status == 0) {
+        c->status = status;
+    }
+
+    if (c->in_flight == 0 && (c->status != 0 || c->submitted == c->len)) {
+        c->completed = 1;
+    }
+}
+
+/* Claim the next chunk for the provided transfer. Returns false if there is
+ * nothing to submit, due to an earlier error or all of the data having been
+ * submitted. The claimed chunk is counted as in flight, so the transfer does
+ * not complete before the chunk has been passed to launch_chunk().
+ *
+ * Assumes c->lock is held. */
+static bool claim_chunk(struct bulk_chunks *c, struct libusb_transfer *xfer)
+{
+    uint32_t n;
+
+    if (c->status != 0 || c->submitted == c->len) {
+        return false;
+    }
+
+    n = u32_min(c->chunk_len, c->len - c->submitted);
+    xfer->buffer = c->buffer + c->submitted;
+    xfer->length = (int) n;
+
+    c->submitted += n;
+    c->in_flight++;
+
+    return true;
+}
+
+/* Submit a chunk claimed via claim_chunk().
+ *
+ * As with stream transfers, this must be called without c->lock held, as
+ * libusb may execute bulk_chunk_cb() while holding its own locks. */
+static void launch_chunk(struct bulk_chunks *c, struct libusb_transfer *xfer)
+{
+    int status = libusb_submit_transfer(xfer);
+
+    if (status != 0) {
+        MUTEX_LOCK(&c->lock);
+        c->in_flight--;
+        chunks_update(c, error_conv(status));
+        MUTEX_UNLOCK(&c->lock);
+    }
+}
+
+/* Retrieve the progress of a chunked transfer, returning true when it has
+ * completed */
+static bool chunks_poll(struct bulk_chunks *c, uint32_t *done, int *status)
+{
+    bool completed;
+
+    MUTEX_LOCK(&c->lock);
+    *done = c->done;
+    *status = c->status;
+    completed = c->completed != 0;
+    MUTEX_UNLOCK(&c->lock);
+
+    return completed;
+}
+
+static void LIBUSB_CALL bulk_chunk_cb(struct libusb_transfer *xfer)
+{
+    struct bulk_chunks *c = (struct bulk_chunks *) xfer->user_data;
+    int status;
+    bool resubmit;
+
+    switch (xfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+            if (xfer->actual_length != xfer->length) {
+                log_debug("Short bulk transfer: requested=%d, "
+                          "transferred=%d\n",
+                          xfer->length, xfer->actual_length);
+                status = BLADERF_ERR_IO;
+            } else {
+                status = 0;
+            }
+            break;
+
+        case LIBUSB_TRANSFER_TIMED_OUT:
+            status = BLADERF_ERR_TIMEOUT;
+            break;
+
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            status = BLADERF_ERR_NODEV;
+            break;
+
+        default:
+            status = BLADERF_ERR_IO;
+            break;
+    }
+
+    MUTEX_LOCK(&c->lock);
+
+    c->in_flight--;
+
+    if (status == 0) {
+        c->done += (uint32_t) xfer->actual_length;
+    }
+
+    chunks_update(c, status);
+    resubmit = claim_chunk(c, xfer);
+
+    MUTEX_UNLOCK(&c->lock);
+
+    /* c may no longer be valid once the transfer has completed, so it is
+     * only accessed if a chunk was claimed above */
+    if (resubmit) {
+        launch_chunk(c, xfer);
+    }
+}
+
+static int lusb_bulk_transfer_chunked(void *driver, uint8_t endpoint,
+                                      void *buffer, uint32_t buffer_len,
+                                      uint32_t chunk_len,
+                                      unsigned int num_xfers,
+                                      uint32_t timeout_ms,
+                                      void (*progress)(void *arg,
+                                                       uint32_t done),
+                                      void *progress_arg)
+{
+    int status;
+    unsigned int i;
+    uint32_t done;
+    uint32_t reported = 0;
+    bool claimed;
+    bool completed;
+    struct libusb_transfer **xfers;
+    struct bladerf_lusb *lusb = (struct bladerf_lusb *) driver;
+    struct timeval tv = { 0, LIBUSB_HANDLE_EVENTS_TIMEOUT_NSEC };
+    struct bulk_chunks c;
+
+    c.buffer = (uint8_t *) buffer;
+    c.len = buffer_len;
+    c.chunk_len = chunk_len;
+    c.submitted = 0;
+    c.done = 0;
+    c.in_flight = 0;
+    c.status = 0;
+    c.completed = 0;
+
+    xfers = (struct libusb_transfer **) calloc(num_xfers, sizeof(xfers[0]));
+    if (xfers == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    MUTEX_INIT(&c.lock);
+
+    for (i = 0; i < num_xfers; i++) {
+        xfers[i] = libusb_alloc_transfer(0);
+        if (xfers[i] == NULL) {
+            MUTEX_LOCK(&c.lock);
+            chunks_update(&c, BLADERF_ERR_MEM);
+            MUTEX_UNLOCK(&c.lock);
+            break;
+        }
+
+        libusb_fill_bulk_transfer(xfers[i], lusb->handle, endpoint, NULL, 0,
+                                  bulk_chunk_cb, &c, timeout_ms);
+
+        MUTEX_LOCK(&c.lock);
+        claimed = claim_chunk(&c, xfers[i]);
+        MUTEX_UNLOCK(&c.lock);
+
+        if (!claimed) {
+            break;
+        }
+
+        launch_chunk(&c, xfers[i]);
+    }
+
+    /* Account for the case where nothing was submitted */
+    MUTEX_LOCK(&c.lock);
+    chunks_update(&c, 0);
+    MUTEX_UNLOCK(&c.lock);
+
+    completed = chunks_poll(&c, &done, &status);
+
+    while (!completed) {
+        if (status != 0) {
+            /* Transfers already completed will just report NOT_FOUND */
+            for (i = 0; i < num_xfers && xfers[i] != NULL; i++) {
+                libusb_cancel_transfer(xfers[i]);
+            }
+        }
+
+        /* This returns as soon as the chunks complete, including when
+         * another thread is handling events on their behalf, as is the case
+         * while a stream is running. */
+        status = libusb_handle_events_timeout_completed(lusb->context, &tv,
+                                                        &c.completed);
+        if (status < 0 && status != LIBUSB_ERROR_INTERRUPTED) {
+            log_debug("Unexpected value from events processing: %d: %s\n",
+                      status, libusb_error_name(status));
+
+            MUTEX_LOCK(&c.lock);
+            chunks_update(&c, error_conv(status));
+            MUTEX_UNLOCK(&c.lock);
+        }
+
+        completed = chunks_poll(&c, &done, &status);
+
+        if (progress != NULL && done != reported) {
+            reported = done;
+            progress(progress_arg, reported);
+        }
+    }
+
+    for (i = 0; i < num_xfers; i++) {
+        libusb_free_transfer(xfers[i]);
+    }
+
+    MUTEX_DESTROY(&c.lock);
+    free(xfers);
+    return status;
+}
+
 static int lusb_get_string_descriptor(void *driver, uint8_t index,
                                       void *buffer, uint32_t buffer_len)
 {
@@ -616,11 +915,11 @@ static int lusb_get_string_descriptor(void *driver, uint8_t index,
     return status;
 }
 
-/* At the risk of being a little inefficient, just keep attempting to cancel
- * everything. If a transfer's no longer active, we'll just get a NOT_FOUND
- * error -- no big deal.  Just accepting that alleviates the need to track
- * the status of each transfer...
- */
+/* Attempt to cancel every transfer in flight. A transfer may have completed,
+ * or may not have been handed to libusb yet (see launch_transfer()), in which
+ * case we'll just get a NOT_FOUND error -- no big deal.
+ *
+ * Assumes stream->lock is held. */
 static inline void cancel_all_transfers(struct bladerf_stream *stream)
 {
     size_t i;
@@ -628,59 +927,195 @@ static inline void cancel_all_transfers(struct bladerf_stream *stream)
     struct lusb_stream_data *stream_data = stream->backend_data;
 
     for (i = 0; i < stream_data->num_transfers; i++) {
-        if (stream_data->transfer_status[i] == TRANSFER_IN_FLIGHT) {
+        struct lusb_transfer *xfer = &stream_data->transfers[i];
 
-            status = libusb_cancel_transfer(stream_data->transfers[i]);
+        if (xfer->status == TRANSFER_IN_FLIGHT) {
+            status = libusb_cancel_transfer(xfer->handle);
             if (status < 0 && status != LIBUSB_ERROR_NOT_FOUND) {
-                log_error("Error canceling transfer (%d): %s\r\n",
-                        status, libusb_error_name(status));
+                log_error("Error canceling transfer %u (%d): %s\r\n",
+                          (unsigned int) xfer->idx, status,
+                          libusb_error_name(status));
             } else {
-                stream_data->transfer_status[i] = TRANSFER_CANCEL_PENDING;
+                xfer->status = TRANSFER_CANCEL_PENDING;
             }
         }
     }
 }
 
-static inline size_t transfer_idx(struct lusb_stream_data *stream_data,
-                                  struct libusb_transfer *transfer)
+/* Return a transfer to the pool of available transfers.
+ *
+ * A transfer that completes before launch_transfer() is finished with it is
+ * instead returned to the pool by launch_transfer(), so that it cannot be
+ * reused in the meantime.
+ *
+ * Assumes stream->lock is held. */
+static inline void release_transfer(struct lusb_stream_data *stream_data,
+                                    struct lusb_transfer *xfer)
 {
-    size_t i;
-    for (i = 0; i < stream_data->num_transfers; i++) {
-        if (stream_data->transfers[i] == transfer) {
-            return i;
+    assert(xfer->status == TRANSFER_IN_FLIGHT ||
+           xfer->status == TRANSFER_CANCEL_PENDING);
+
+    xfer->status = TRANSFER_AVAIL;
+
+    if (!xfer->launching) {
+        assert(stream_data->num_avail < stream_data->num_transfers);
+        stream_data->avail[stream_data->num_avail++] = xfer;
+    }
+}
+
+/* Mark the stream as done, waking lusb_stream().
+ * Assumes stream->lock is held. */
+static inline void stream_done(struct bladerf_stream *stream)
+{
+    struct lusb_stream_data *stream_data = stream->backend_data;
+
+    stream->state = STREAM_DONE;
+    pthread_cond_signal(&stream_data->done);
+}
+
+/* If the stream is shutting down, either finish up or (re)attempt to cancel
+ * anything still in flight. Assumes stream->lock is held. */
+static inline void check_shutdown(struct bladerf_stream *stream)
+{
+    struct lusb_stream_data *stream_data = stream->backend_data;
+
+    if (stream->state == STREAM_SHUTTING_DOWN) {
+        /* We know we're done when all of our transfers have returned to their
+         * "available" states */
+        if (stream_data->num_avail == stream_data->num_transfers) {
+            stream_done(stream);
+        } else {
+            cancel_all_transfers(stream);
         }
     }
+}
+
+static void LIBUSB_CALL lusb_stream_cb(struct libusb_transfer *transfer);
+
+/* Claim an available transfer for the provided buffer and mark it in flight.
+ * The caller must hand the transfer to launch_transfer() once it has
+ * released stream->lock.
+ *
+ * Assumes stream->lock is held. Precondition: A transfer is available. */
+static struct lusb_transfer * prepare_transfer(struct bladerf_stream *stream,
+                                               void *buffer)
+{
+    struct bladerf_lusb *lusb = lusb_backend(stream->dev);
+    struct lusb_stream_data *stream_data = stream->backend_data;
+    struct lusb_transfer *xfer;
+    const size_t bytes_per_buffer = async_stream_buf_bytes(stream);
+    const unsigned char ep =
+        stream->module == BLADERF_MODULE_TX ? SAMPLE_EP_OUT : SAMPLE_EP_IN;
+
+    assert(stream_data->num_avail != 0);
+    xfer = stream_data->avail[--stream_data->num_avail];
+    assert(xfer->status == TRANSFER_AVAIL);
+
+    assert(bytes_per_buffer <= INT_MAX);
+    libusb_fill_bulk_transfer(xfer->handle,
+                              lusb->handle,
+                              ep,
+                              buffer,
+                              (int)bytes_per_buffer,
+                              lusb_stream_cb,
+                              xfer,
+                              stream->dev->transfer_timeout[stream->module]);
 
-    return UINT_MAX;
+    xfer->status = TRANSFER_IN_FLIGHT;
+    xfer->launching = true;
+
+    async_stats_submitted(stream, stream_data->num_transfers -
+                                  stream_data->num_avail);
+
+    return xfer;
 }
 
-static int submit_transfer(struct bladerf_stream *stream, void *buffer);
+/* Submit a transfer claimed via prepare_transfer().
+ *
+ * This must be called without stream->lock held. libusb may execute our
+ * callback, which acquires stream->lock, while holding its own internal
+ * locks, so submitting with stream->lock held is prone to deadlock.
+ *
+ * The transfer's bookkeeping has already been updated, so it is safe for the
+ * transfer's callback to execute before this function returns. The transfer
+ * is not returned to the pool of available transfers until this function
+ * has finished with it, which also holds off the completion of a stream
+ * shutdown.
+ *
+ * If `fatal` is true, a failure to submit the transfer shuts down the
+ * stream. This is the case for transfers submitted on the stream's behalf,
+ * as opposed to a buffer submitted by the API user. */
+static int launch_transfer(struct bladerf_stream *stream,
+                           struct lusb_transfer *xfer, bool fatal)
+{
+    int status;
+    struct lusb_stream_data *stream_data = stream->backend_data;
+
+    status = libusb_submit_transfer(xfer->handle);
+
+    MUTEX_LOCK(&stream->lock);
+
+    xfer->launching = false;
+
+    if (status == 0) {
+        if (xfer->status == TRANSFER_AVAIL) {
+            /* The transfer has already completed */
+            assert(stream_data->num_avail < stream_data->num_transfers);
+            stream_data->avail[stream_data->num_avail++] = xfer;
+            pthread_cond_signal(&stream->can_submit_buffer);
+        } else if (stream->state != STREAM_RUNNING) {
+            /* If the stream began shutting down before this transfer reached
+             * libusb, the attempt to cancel it will have come up empty */
+            status = libusb_cancel_transfer(xfer->handle);
+            if (status < 0 && status != LIBUSB_ERROR_NOT_FOUND) {
+                log_error("Error canceling transfer %u (%d): %s\r\n",
+                          (unsigned int) xfer->idx, status,
+                          libusb_error_name(status));
+            } else {
+                xfer->status = TRANSFER_CANCEL_PENDING;
+            }
+
+            status = 0;
+        }
+    } else {
+        log_error("Failed to submit transfer %u: %s\n",
+                  (unsigned int) xfer->idx, libusb_error_name(status));
+
+        release_transfer(stream_data, xfer);
+        pthread_cond_signal(&stream->can_submit_buffer);
+
+        /* If this fails, we probably have a serious problem...so just shut
+         * the stream down. */
+        if (fatal && stream->state == STREAM_RUNNING) {
+            stream->error_code = error_conv(status);
+            stream->state = STREAM_SHUTTING_DOWN;
+        }
+    }
+
+    check_shutdown(stream);
+
+    MUTEX_UNLOCK(&stream->lock);
+
+    return error_conv(status);
+}
 
 static void LIBUSB_CALL lusb_stream_cb(struct libusb_transfer *transfer)
 {
-    struct bladerf_stream *stream = transfer->user_data;
+    struct lusb_transfer *xfer = transfer->user_data;
+    struct bladerf_stream *stream = xfer->stream;
+    struct lusb_transfer *next_xfer = NULL;
     void *next_buffer = NULL;
     struct bladerf_metadata metadata;
     struct lusb_stream_data *stream_data = stream->backend_data;
-    size_t transfer_i;
+    const uint64_t arrival_ns = time_model_now_ns();
 
     /* Currently unused - zero out for out own debugging sanity... */
     memset(&metadata, 0, sizeof(metadata));
 
     MUTEX_LOCK(&stream->lock);
 
-    transfer_i = transfer_idx(stream_data, transfer);
-    assert(stream_data->transfer_status[transfer_i] == TRANSFER_IN_FLIGHT ||
-           stream_data->transfer_status[transfer_i] == TRANSFER_CANCEL_PENDING);
-
-    if (transfer_i >= stream_data->num_transfers) {
-        log_error("Unable to find transfer");
-        stream->state = STREAM_SHUTTING_DOWN;
-    } else {
-        stream_data->transfer_status[transfer_i] = TRANSFER_AVAIL;
-        stream_data->num_avail++;
-        pthread_cond_signal(&stream->can_submit_buffer);
-    }
+    release_transfer(stream_data, xfer);
+    pthread_cond_signal(&stream->can_submit_buffer);
 
     /* Check to see if the transfer has been cancelled or errored */
     if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
@@ -728,6 +1163,12 @@ static void LIBUSB_CALL lusb_stream_cb(struct libusb_transfer *transfer)
 
     if (stream->state == STREAM_RUNNING) {
 
+        async_stats_completed(stream, transfer->length,
+                              transfer->actual_length);
+
+        async_rx_arrival(stream, transfer->buffer,
+                         transfer->actual_length, arrival_ns);
+
         /* Sanity check for debugging purposes */
         if (transfer->length != transfer->actual_length) {
             log_warning( "Received short transfer\n" );
@@ -745,98 +1186,24 @@ static void LIBUSB_CALL lusb_stream_cb(struct libusb_transfer *transfer)
         if (next_buffer == BLADERF_STREAM_SHUTDOWN) {
             stream->state = STREAM_SHUTTING_DOWN;
         } else if (next_buffer != BLADERF_STREAM_NO_DATA) {
-            int status = submit_transfer(stream, next_buffer);
-            if (status != 0) {
-                /* If this fails, we probably have a serious problem...so just
-                 * shut it down. */
-                stream->state = STREAM_SHUTTING_DOWN;
-            }
+            next_xfer = prepare_transfer(stream, next_buffer);
         }
-    }
 
+        async_stats_in_flight(stream, stream_data->num_transfers -
+                                      stream_data->num_avail);
+    }
 
     /* Check to see if all the transfers have been cancelled,
      * and if so, clean up the stream */
-    if (stream->state == STREAM_SHUTTING_DOWN) {
-
-        /* We know we're done when all of our transfers have returned to their
-         * "available" states */
-        if (stream_data->num_avail == stream_data->num_transfers) {
-            stream->state = STREAM_DONE;
-        } else {
-            cancel_all_transfers(stream);
-        }
-    }
+    check_shutdown(stream);
 
     MUTEX_UNLOCK(&stream->lock);
-}
 
-/* Precondition: A transfer is available. */
-static int submit_transfer(struct bladerf_stream *stream, void *buffer)
-{
-    int status;
-    struct bladerf_lusb *lusb = lusb_backend(stream->dev);
-    struct lusb_stream_data *stream_data = stream->backend_data;
-    struct libusb_transfer *transfer;
-    const size_t bytes_per_buffer = async_stream_buf_bytes(stream);
-    size_t prev_idx;
-    const unsigned char ep =
-        stream->module == BLADERF_MODULE_TX ? SAMPLE_EP_OUT : SAMPLE_EP_IN;
-
-    assert(stream_data->transfer_status[stream_data->i] == TRANSFER_AVAIL);
-    transfer = stream_data->transfers[stream_data->i];
-
-    assert(bytes_per_buffer <= INT_MAX);
-    libusb_fill_bulk_transfer(transfer,
-                              lusb->handle,
-                              ep,
-                              buffer,
-                              (int)bytes_per_buffer,
-                              lusb_stream_cb,
-                              stream,
-                              stream->dev->transfer_timeout[stream->module]);
-
-    prev_idx = stream_data->i;
-    stream_data->transfer_status[stream_data->i] = TRANSFER_IN_FLIGHT;
-    stream_data->i = (stream_data->i + 1) % stream_data->num_transfers;
-    assert(stream_data->num_avail != 0);
-    stream_data->num_avail--;
-
-    /* FIXME We have an inherent issue here with lock ordering between
-     *       stream->lock and libusb's underlying event lock, so we
-     *       have to drop the stream->lock as a workaround.
-     *
-     *       This implies that a callback can potentially execute,
-     *       including a callback for this transfer. Therefore, the transfer
-     *       has been setup and its metadata logged.
-     *
-     *       Ultimately, we need to review our async scheme and associated
-     *       lock schemes.
-     */
-    MUTEX_UNLOCK(&stream->lock);
-    status = libusb_submit_transfer(transfer);
-    MUTEX_LOCK(&stream->lock);
-
-    if (status != 0) {
-        log_error("Failed to submit transfer in %s: %s\n",
-                  __FUNCTION__, libusb_error_name(status));
-
-        /* We need to undo the metadata we updated prior to dropping
-         * the lock and attempting to submit the transfer */
-        assert(stream_data->transfer_status[prev_idx] == TRANSFER_IN_FLIGHT);
-        stream_data->transfer_status[prev_idx] = TRANSFER_AVAIL;
-        stream_data->num_avail++;
-        if (stream_data->i == 0) {
-            stream_data->i = stream_data->num_transfers - 1;
-        } else {
-            stream_data->i--;
-        }
+    if (next_xfer != NULL) {
+        launch_transfer(stream, next_xfer, true);
     }
-
-    return error_conv(status);
 }
 
-
 static int lusb_init_stream(void *driver, struct bladerf_stream *stream,
                             size_t num_transfers)
 {
@@ -852,60 +1219,57 @@ static int lusb_init_stream(void *driver, struct bladerf_stream *stream,
 
     /* Backend stream information */
     stream->backend_data = stream_data;
-    stream_data->transfers = NULL;
-    stream_data->transfer_status = NULL;
     stream_data->num_transfers = num_transfers;
     stream_data->num_avail = 0;
-    stream_data->i = 0;
-
-    stream_data->transfers =
-        malloc(num_transfers * sizeof(struct libusb_transfer *));
 
-    if (stream_data->transfers == NULL) {
-        log_error("Failed to allocate libusb tranfers\n");
-        status = BLADERF_ERR_MEM;
-        goto error;
+    if (pthread_cond_init(&stream_data->done, NULL) != 0) {
+        free(stream_data);
+        stream->backend_data = NULL;
+        return BLADERF_ERR_UNEXPECTED;
     }
 
-    stream_data->transfer_status =
-        calloc(num_transfers, sizeof(transfer_status));
+    stream_data->transfers = calloc(num_transfers, sizeof(struct lusb_transfer));
+    stream_data->avail = calloc(num_transfers, sizeof(struct lusb_transfer *));
+    stream_data->pending = calloc(num_transfers, sizeof(struct lusb_transfer *));
 
-    if (stream_data->transfer_status == NULL) {
-        log_error("Failed to allocated libusb transfer status array\n");
+    if (stream_data->transfers == NULL || stream_data->avail == NULL ||
+        stream_data->pending == NULL) {
+        log_error("Failed to allocate libusb tranfers\n");
         status = BLADERF_ERR_MEM;
         goto error;
     }
 
     /* Create the libusb transfers */
     for (i = 0; i < stream_data->num_transfers; i++) {
-        stream_data->transfers[i] = libusb_alloc_transfer(0);
-
-        /* Upon error, start tearing down anything we've started allocating
-         * and report that the stream is in a bad state */
-        if (stream_data->transfers[i] == NULL) {
-
-            /* Note: <= 0 not appropriate as we're dealing
-             *       with an unsigned index */
-            while (i > 0) {
-                if (--i) {
-                    libusb_free_transfer(stream_data->transfers[i]);
-                    stream_data->transfers[i] = NULL;
-                    stream_data->transfer_status[i] = TRANSFER_UNINITIALIZED;
-                    stream_data->num_avail--;
-                }
-            }
+        struct lusb_transfer *xfer = &stream_data->transfers[i];
 
+        xfer->handle = libusb_alloc_transfer(0);
+        if (xfer->handle == NULL) {
             status = BLADERF_ERR_MEM;
-            break;
-        } else {
-            stream_data->transfer_status[i] = TRANSFER_AVAIL;
-            stream_data->num_avail++;
+            goto error;
         }
+
+        xfer->stream = stream;
+        xfer->idx = i;
+        xfer->status = TRANSFER_AVAIL;
+        xfer->launching = false;
+        stream_data->avail[stream_data->num_avail++] = xfer;
     }
 
 error:
     if (status != 0) {
-        free(stream_data->transfer_status);
+        /* Tear down anything we've started allocating */
+        if (stream_data->transfers != NULL) {
+            for (i = 0; i < stream_data->num_transfers; i++) {
+                if (stream_data->transfers[i].handle != NULL) {
+                    libusb_free_transfer(stream_data->transfers[i].handle);
+                }
+            }
+        }
+
+        pthread_cond_destroy(&stream_data->done);
+        free(stream_data->pending);
+        free(stream_data->avail);
         free(stream_data->transfers);
         free(stream_data);
         stream->backend_data = NULL;
@@ -914,21 +1278,148 @@ error:
     return status;
 }
 
+/* Shut down a stream due to an error that is not specific to one of its
+ * transfers, such that the error is reported by lusb_stream() */
+static void fail_stream(struct bladerf_stream *stream, int error)
+{
+    MUTEX_LOCK(&stream->lock);
+
+    if (stream->state == STREAM_RUNNING) {
+        stream->error_code = error;
+        stream->state = STREAM_SHUTTING_DOWN;
+    }
+
+    check_shutdown(stream);
+
+    MUTEX_UNLOCK(&stream->lock);
+}
+
+/* Handle libusb events, and thereby execute stream callbacks, while any
+ * streams are active on the device */
+static void * lusb_event_thread(void *arg)
+{
+    int status;
+    size_t i;
+    struct bladerf_lusb *lusb = (struct bladerf_lusb *) arg;
+    const size_t num_streams = sizeof(lusb->streams) / sizeof(lusb->streams[0]);
+    struct timeval tv = { 0, LIBUSB_HANDLE_EVENTS_TIMEOUT_NSEC };
+
+    MUTEX_LOCK(&lusb->event_lock);
+
+    while (!lusb->event_thread_stop) {
+        if (lusb->thread_config_changed) {
+            struct bladerf_thread_config config = lusb->thread_config;
+            lusb->thread_config_changed = false;
+
+            MUTEX_UNLOCK(&lusb->event_lock);
+            thread_config_apply(&config, "USB event");
+            MUTEX_LOCK(&lusb->event_lock);
+        } else if (lusb->active_streams == 0) {
+            pthread_cond_wait(&lusb->event_cond, &lusb->event_lock);
+        } else {
+            MUTEX_UNLOCK(&lusb->event_lock);
+
+            status = libusb_handle_events_timeout(lusb->context, &tv);
+
+            MUTEX_LOCK(&lusb->event_lock);
+
+            if (status < 0 && status != LIBUSB_ERROR_INTERRUPTED) {
+                log_warning("unexpected value from events processing: "
+                            "%d: %s\n", status, libusb_error_name(status));
+
+                /* Streams are not detached until they are done, so they
+                 * remain valid while event_lock is held */
+                for (i = 0; i < num_streams; i++) {
+                    if (lusb->streams[i] != NULL) {
+                        fail_stream(lusb->streams[i], error_conv(status));
+                    }
+                }
+            }
+        }
+    }
+
+    MUTEX_UNLOCK(&lusb->event_lock);
+    return NULL;
+}
+
+/* Register a stream with the event thread, starting it if needed. The
+ * thread adopts the stream's scheduling configuration. */
+static int event_thread_attach(struct bladerf_lusb *lusb,
+                               struct bladerf_stream *stream)
+{
+    int status = 0;
+    const struct bladerf_thread_config *config = &stream->thread_config;
+
+    MUTEX_LOCK(&lusb->event_lock);
+
+    if (!lusb->event_thread_started ||
+        config->priority != lusb->thread_config.priority ||
+        config->cpu_mask != lusb->thread_config.cpu_mask) {
+        lusb->thread_config = *config;
+        lusb->thread_config_changed = true;
+    }
+
+    if (!lusb->event_thread_started) {
+        status = pthread_create(&lusb->event_thread, NULL,
+                                lusb_event_thread, lusb);
+
+        if (status == 0) {
+            lusb->event_thread_started = true;
+        } else {
+            log_error("Failed to start libusb event thread: %d\n", status);
+            status = BLADERF_ERR_UNEXPECTED;
+        }
+    }
+
+    if (status == 0) {
+        assert(lusb->streams[stream->module] == NULL);
+        lusb->streams[stream->module] = stream;
+        lusb->active_streams++;
+        pthread_cond_signal(&lusb->event_cond);
+    }
+
+    MUTEX_UNLOCK(&lusb->event_lock);
+    return status;
+}
+
+/* Unregister a stream, once all of its transfers have completed */
+static void event_thread_detach(struct bladerf_lusb *lusb,
+                                struct bladerf_stream *stream)
+{
+    MUTEX_LOCK(&lusb->event_lock);
+    assert(lusb->active_streams != 0);
+    assert(lusb->streams[stream->module] == stream);
+    lusb->streams[stream->module] = NULL;
+    lusb->active_streams--;
+    MUTEX_UNLOCK(&lusb->event_lock);
+}
+
+/* Transfers are serviced by the device's event thread, which is shared with
+ * the stream on the other module. This just submits the initial transfers
+ * and waits for the stream to complete. */
 static int lusb_stream(void *driver, struct bladerf_stream *stream,
                        bladerf_module module)
 {
     size_t i;
-    int status = 0;
+    size_t num_pending = 0;
+    int status;
     void *buffer;
     struct bladerf_metadata metadata;
     struct bladerf *dev = stream->dev;
     struct bladerf_lusb *lusb = (struct bladerf_lusb *) driver;
     struct lusb_stream_data *stream_data = stream->backend_data;
-    struct timeval tv = { 0, LIBUSB_HANDLE_EVENTS_TIMEOUT_NSEC };
 
     /* Currently unused, so zero it out for a sanity check when debugging */
     memset(&metadata, 0, sizeof(metadata));
 
+    status = event_thread_attach(lusb, stream);
+    if (status != 0) {
+        MUTEX_LOCK(&stream->lock);
+        stream_done(stream);
+        MUTEX_UNLOCK(&stream->lock);
+        return status;
+    }
+
     MUTEX_LOCK(&stream->lock);
 
     /* Set up initial set of buffers */
@@ -949,7 +1440,7 @@ static int lusb_stream(void *driver, struct bladerf_stream *stream,
                 } else {
                     /* No transfers have been shipped out yet so we can
                      * simply enter our "done" state */
-                    stream->state = STREAM_DONE;
+                    stream_done(stream);
                 }
 
                 /* In either of the above we don't want to attempt to
@@ -961,56 +1452,62 @@ static int lusb_stream(void *driver, struct bladerf_stream *stream,
         }
 
         if (buffer != BLADERF_STREAM_NO_DATA) {
-            status = submit_transfer(stream, buffer);
-
-            /* If we failed to submit any transfers, cancel everything in
-             * flight.  We'll leave the stream in the running state so we can
-             * have libusb fire off callbacks with the cancelled status*/
-            if (status < 0) {
-                stream->error_code = status;
-                cancel_all_transfers(stream);
-            }
+            stream_data->pending[num_pending++] =
+                prepare_transfer(stream, buffer);
         }
     }
     MUTEX_UNLOCK(&stream->lock);
 
-    /* This loop is required so libusb can do callbacks and whatnot */
-    while (stream->state != STREAM_DONE) {
-        status = libusb_handle_events_timeout(lusb->context, &tv);
+    /* If we fail to submit any transfers, everything in flight will be
+     * cancelled, and libusb will fire off callbacks with the cancelled
+     * status. Any remaining transfers are cancelled as they're submitted. */
+    for (i = 0; i < num_pending; i++) {
+        launch_transfer(stream, stream_data->pending[i], true);
+    }
 
-        if (status < 0 && status != LIBUSB_ERROR_INTERRUPTED) {
-            log_warning("unexpected value from events processing: "
-                        "%d: %s\n", status, libusb_error_name(status));
-            status = error_conv(status);
-        }
+    MUTEX_LOCK(&stream->lock);
+    while (stream->state != STREAM_DONE) {
+        pthread_cond_wait(&stream_data->done, &stream->lock);
     }
+    MUTEX_UNLOCK(&stream->lock);
 
-    return status;
+    event_thread_detach(lusb, stream);
+
+    /* Errors are reported via stream->error_code */
+    return 0;
 }
-/* The top-level code will have aquired the stream->lock for us */
+
+/* Unlike the other stream functions, this is called without stream->lock
+ * held, such that the transfer can be submitted after releasing it. */
 int lusb_submit_stream_buffer(void *driver, struct bladerf_stream *stream,
                               void *buffer, unsigned int timeout_ms)
 {
     int status = 0;
     struct lusb_stream_data *stream_data = stream->backend_data;
+    struct lusb_transfer *xfer = NULL;
     struct timespec timeout_abs;
 
+    if (buffer != BLADERF_STREAM_SHUTDOWN && timeout_ms != 0) {
+        status = populate_abs_timeout(&timeout_abs, timeout_ms);
+        if (status != 0) {
+            return BLADERF_ERR_UNEXPECTED;
+        }
+    }
+
+    MUTEX_LOCK(&stream->lock);
+
     if (buffer == BLADERF_STREAM_SHUTDOWN) {
         if (stream_data->num_avail == stream_data->num_transfers) {
-            stream->state = STREAM_DONE;
+            stream_done(stream);
         } else {
             stream->state = STREAM_SHUTTING_DOWN;
         }
 
+        MUTEX_UNLOCK(&stream->lock);
         return 0;
     }
 
     if (timeout_ms != 0) {
-        status = populate_abs_timeout(&timeout_abs, timeout_ms);
-        if (status != 0) {
-            return BLADERF_ERR_UNEXPECTED;
-        }
-
         while (stream_data->num_avail == 0 && status == 0) {
             status = pthread_cond_timedwait(&stream->can_submit_buffer,
                     &stream->lock,
@@ -1026,12 +1523,20 @@ int lusb_submit_stream_buffer(void *driver, struct bladerf_stream *stream,
     if (status == ETIMEDOUT) {
         log_debug("%s: Timed out waiting for a transfer to become availble.\n",
                   __FUNCTION__);
-        return BLADERF_ERR_TIMEOUT;
+        status = BLADERF_ERR_TIMEOUT;
     } else if (status != 0) {
-        return BLADERF_ERR_UNEXPECTED;
+        status = BLADERF_ERR_UNEXPECTED;
     } else {
-        return submit_transfer(stream, buffer);
+        xfer = prepare_transfer(stream, buffer);
     }
+
+    MUTEX_UNLOCK(&stream->lock);
+
+    if (xfer != NULL) {
+        status = launch_transfer(stream, xfer, false);
+    }
+
+    return status;
 }
 
 static int lusb_deinit_stream(void *driver, struct bladerf_stream *stream)
@@ -1040,19 +1545,53 @@ static int lusb_deinit_stream(void *driver, struct bladerf_stream *stream)
     struct lusb_stream_data *stream_data = stream->backend_data;
 
     for (i = 0; i < stream_data->num_transfers; i++) {
-        libusb_free_transfer(stream_data->transfers[i]);
-        stream_data->transfers[i] = NULL;
-        stream_data->transfer_status[i] = TRANSFER_UNINITIALIZED;
+        libusb_free_transfer(stream_data->transfers[i].handle);
+        stream_data->transfers[i].handle = NULL;
+        stream_data->transfers[i].status = TRANSFER_UNINITIALIZED;
     }
 
+    pthread_cond_destroy(&stream_data->done);
+    free(stream_data->pending);
+    free(stream_data->avail);
     free(stream_data->transfers);
-    free(stream_data->transfer_status);
     free(stream->backend_data);
 
     stream->backend_data = NULL;
     return 0;
 }
 
+/* libusb_dev_mem_alloc() was introduced in libusb 1.0.21. It provides memory
+ * mapped via usbfs, which the kernel can transfer to/from directly rather
+ * than copying through a bounce buffer. */
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+#   define HAVE_LIBUSB_DEV_MEM
+#endif
+
+static void * lusb_alloc_stream_mem(void *driver, size_t len)
+{
+#ifdef HAVE_LIBUSB_DEV_MEM
+    struct bladerf_lusb *lusb = (struct bladerf_lusb *) driver;
+    void *mem = libusb_dev_mem_alloc(lusb->handle, len);
+
+    if (mem == NULL) {
+        log_verbose("libusb_dev_mem_alloc() unavailable; "
+                    "using host memory for stream buffers.\n");
+    }
+
+    return mem;
+#else
+    return NULL;
+#endif
+}
+
+static void lusb_free_stream_mem(void *driver, void *mem, size_t len)
+{
+#ifdef HAVE_LIBUSB_DEV_MEM
+    struct bladerf_lusb *lusb = (struct bladerf_lusb *) driver;
+    libusb_dev_mem_free(lusb->handle, (unsigned char *) mem, len);
+#endif
+}
+
 static const struct usb_fns libusb_fns = {
     FIELD_INIT(.probe, lusb_probe),
     FIELD_INIT(.open, lusb_open),
@@ -1065,7 +1604,10 @@ static const struct usb_fns libusb_fns = {
     FIELD_INIT(.init_stream, lusb_init_stream),
     FIELD_INIT(.stream, lusb_stream),
     FIELD_INIT(.submit_stream_buffer, lusb_submit_stream_buffer),
-    FIELD_INIT(.deinit_stream, lusb_deinit_stream)
+    FIELD_INIT(.deinit_stream, lusb_deinit_stream),
+    FIELD_INIT(.alloc_stream_mem, lusb_alloc_stream_mem),
+    FIELD_INIT(.free_stream_mem, lusb_free_stream_mem),
+    FIELD_INIT(.bulk_transfer_chunked, lusb_bulk_transfer_chunked)
 };
 
 const struct usb_driver usb_driver_libusb = {
@@ -32,6 +32,7 @@
 #include "bladeRF.h"    /* Firmware interface */
 #include "log.h"
 #include "version_compat.h"
+#include "fpga.h"
 
 typedef enum {
     CORR_INVALID,
@@ -53,9 +54,13 @@ static inline struct bladerf_usb *usb_backend(struct bladerf *dev, void **driver
 }
 
 
-static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
-                             usb_direction dir, struct uart_cmd *cmd,
-                             size_t len)
+/* Maximum number of addr/data pairs that fit into a single 16-byte NIOS
+ * peripheral access packet, following the 2-byte header */
+#define PERIPHERAL_MAX_CMDS     7
+
+static int access_peripheral_pkt(struct bladerf *dev, uint8_t peripheral,
+                                 usb_direction dir, struct uart_cmd *cmd,
+                                 size_t len)
 {
     void *driver;
     struct bladerf_usb *usb = usb_backend(dev, &driver);
@@ -66,6 +71,7 @@ static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
     const uint8_t pkt_mode_dir = (dir == USB_DIR_HOST_TO_DEVICE) ?
                         UART_PKT_MODE_DIR_WRITE : UART_PKT_MODE_DIR_READ;
 
+    assert(len <= PERIPHERAL_MAX_CMDS);
     assert(len <= ((sizeof(buf) - 2) / 2));
 
     /* Populate the buffer for transfer */
@@ -77,6 +83,8 @@ static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
         buf[i * 2 + 3] = cmd[i].data;
     }
 
+    ctrl_stats_transaction(&dev->ctrl_stats, peripheral, len);
+
     /* Send the command */
     status = usb->fn->bulk_transfer(driver, PERIPHERAL_EP_OUT,
                                      buf, sizeof(buf),
@@ -93,7 +101,7 @@ static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
                                     buf, sizeof(buf),
                                     PERIPHERAL_TIMEOUT_MS);
 
-    if (dir == UART_PKT_MODE_DIR_READ && status == 0) {
+    if (dir == USB_DIR_DEVICE_TO_HOST && status == 0) {
         for (i = 0; i < len; i++) {
             cmd[i].data = buf[i * 2 + 3];
         }
@@ -102,27 +110,50 @@ static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
     return status;
 }
 
+/* Perform the specified accesses, packing up to PERIPHERAL_MAX_CMDS of them
+ * into each round trip with the device */
+static int access_peripheral(struct bladerf *dev, uint8_t peripheral,
+                             usb_direction dir, struct uart_cmd *cmd,
+                             size_t len)
+{
+    int status = 0;
+    size_t i, n;
+
+    for (i = 0; i < len && status == 0; i += n) {
+        n = len - i;
+        if (n > PERIPHERAL_MAX_CMDS) {
+            n = PERIPHERAL_MAX_CMDS;
+        }
+
+        status = access_peripheral_pkt(dev, peripheral, dir, &cmd[i], n);
+    }
+
+    return status;
+}
+
 static inline int gpio_read(struct bladerf *dev, uint8_t addr, uint32_t *data)
 {
     int status;
     size_t i;
-    struct uart_cmd cmd;
+    struct uart_cmd cmds[sizeof(*data)];
 
-    *data = 0;
+    assert((addr + ARRAY_SIZE(cmds) - 1) <= UINT8_MAX);
 
-    for (i = 0; i < sizeof(*data); i++) {
-        assert((addr + i) <= UINT8_MAX);
-        cmd.addr = (uint8_t)(addr + i);
-        cmd.data = 0xff;
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        cmds[i].addr = (uint8_t)(addr + i);
+        cmds[i].data = 0xff;
+    }
 
-        status = access_peripheral(dev, UART_PKT_DEV_GPIO,
-                                   USB_DIR_DEVICE_TO_HOST, &cmd, 1);
+    status = access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_DEVICE_TO_HOST,
+                               cmds, ARRAY_SIZE(cmds));
 
-        if (status < 0) {
-            return status;
-        }
+    if (status < 0) {
+        return status;
+    }
 
-        *data |= (cmd.data << (i * 8));
+    *data = 0;
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        *data |= ((uint32_t) cmds[i].data << (i * 8));
     }
 
     return 0;
@@ -130,63 +161,44 @@ static inline int gpio_read(struct bladerf *dev, uint8_t addr, uint32_t *data)
 
 static inline int gpio_write(struct bladerf *dev, uint8_t addr, uint32_t data)
 {
-    int status;
     size_t i;
-    struct uart_cmd cmd;
-
-    for (i = 0; i < sizeof(data); i++) {
-        assert((addr + i) <= UINT8_MAX);
-        cmd.addr = (uint8_t)(addr + i);
-        cmd.data = (data >> (i * 8)) & 0xff;
+    struct uart_cmd cmds[sizeof(data)];
 
-        status = access_peripheral(dev, UART_PKT_DEV_GPIO,
-                                   USB_DIR_HOST_TO_DEVICE, &cmd, 1);
+    assert((addr + ARRAY_SIZE(cmds) - 1) <= UINT8_MAX);
 
-        if (status < 0) {
-            return status;
-        }
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        cmds[i].addr = (uint8_t)(addr + i);
+        cmds[i].data = (data >> (i * 8)) & 0xff;
     }
 
-    return 0;
+    return access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_HOST_TO_DEVICE,
+                             cmds, ARRAY_SIZE(cmds));
 }
 
 static int load_fpga_version(struct bladerf *dev)
 {
     int i, status;
-    struct uart_cmd cmd;
+    struct uart_cmd cmds[4];
 
     for (i = 0; i < 4; i++) {
-        cmd.addr = UART_PKT_DEV_FGPA_VERSION_ID + i;
-        cmd.data = 0xff;
-
-        status = access_peripheral(dev, UART_PKT_DEV_GPIO,
-                                   USB_DIR_DEVICE_TO_HOST, &cmd, 1);
+        cmds[i].addr = UART_PKT_DEV_FGPA_VERSION_ID + i;
+        cmds[i].data = 0xff;
+    }
 
-        if (status != 0) {
-            memset(&dev->fpga_version, 0, sizeof(dev->fpga_version));
-            log_debug("Failed to read FPGA version[%d]: %s\n", i,
-                        bladerf_strerror(status));
-            return status;
-        }
+    status = access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_DEVICE_TO_HOST,
+                               cmds, ARRAY_SIZE(cmds));
 
-        switch (i) {
-            case 0:
-                dev->fpga_version.major = cmd.data;
-                break;
-            case 1:
-                dev->fpga_version.minor = cmd.data;
-                break;
-            case 2:
-                dev->fpga_version.patch = cmd.data;
-                break;
-            case 3:
-                dev->fpga_version.patch |= (cmd.data << 8);
-                break;
-            default:
-                assert(!"Bug");
-        }
+    if (status != 0) {
+        memset(&dev->fpga_version, 0, sizeof(dev->fpga_version));
+        log_debug("Failed to read FPGA version: %s\n",
+                  bladerf_strerror(status));
+        return status;
     }
 
+    dev->fpga_version.major = cmds[0].data;
+    dev->fpga_version.minor = cmds[1].data;
+    dev->fpga_version.patch = cmds[2].data | (cmds[3].data << 8);
+
     snprintf((char*)dev->fpga_version.describe, BLADERF_VERSION_STR_MAX,
              "%d.%d.%d", dev->fpga_version.major, dev->fpga_version.minor,
              dev->fpga_version.patch);
@@ -509,14 +521,79 @@ static int begin_fpga_programming(struct bladerf *dev)
     }
 }
 
-static int usb_load_fpga(struct bladerf *dev, uint8_t *image, size_t image_size)
+struct fpga_load_state {
+    struct bladerf *dev;
+    uint32_t image_size;
+};
+
+static void fpga_load_chunk_done(void *arg, uint32_t done)
+{
+    struct fpga_load_state *state = (struct fpga_load_state *) arg;
+    fpga_load_progress(state->dev, done, state->image_size);
+}
+
+/* Send the bitstream down in chunks, reporting progress along the way */
+static int send_fpga_bitstream(struct bladerf *dev, uint8_t *image,
+                               uint32_t image_size)
 {
     void *driver;
     struct bladerf_usb *usb = usb_backend(dev, &driver);
+    uint32_t sent, n;
+    int status = 0;
+    struct fpga_load_state state;
+
+    if (usb->fn->bulk_transfer_chunked != NULL) {
+        state.dev = dev;
+        state.image_size = image_size;
+
+        return usb->fn->bulk_transfer_chunked(driver, PERIPHERAL_EP_OUT,
+                                              image, image_size,
+                                              FPGA_LOAD_CHUNK_SIZE,
+                                              FPGA_LOAD_XFERS,
+                                              CTRL_TIMEOUT_MS,
+                                              fpga_load_chunk_done, &state);
+    }
+
+    for (sent = 0; sent < image_size && status == 0; sent += n) {
+        n = u32_min(FPGA_LOAD_CHUNK_SIZE, image_size - sent);
+
+        status = usb->fn->bulk_transfer(driver, PERIPHERAL_EP_OUT,
+                                        image + sent, n, CTRL_TIMEOUT_MS);
+        if (status == 0) {
+            fpga_load_progress(dev, sent + n, image_size);
+        }
+    }
+
+    return status;
+}
+
+/* Poll the FPGA's configuration status, starting with short intervals that
+ * back off towards FPGA_CONF_POLL_MAX_US. */
+static int wait_for_fpga_configured(struct bladerf *dev)
+{
+    int status;
+    unsigned int interval_us = FPGA_CONF_POLL_MIN_US;
+    const uint64_t deadline =
+        time_model_now_ns() + (uint64_t) FPGA_CONF_TIMEOUT_MS * 1000000;
+
+    while (true) {
+        status = usb_is_fpga_configured(dev);
+        if (status != 0) {
+            return status;
+        } else if (time_model_now_ns() >= deadline) {
+            return BLADERF_ERR_TIMEOUT;
+        }
+
+        usleep(interval_us);
+        interval_us = uint_min(2 * interval_us, FPGA_CONF_POLL_MAX_US);
+    }
+}
 
-    unsigned int wait_count;
-    const unsigned int timeout_ms = (2 * CTRL_TIMEOUT_MS);
+static int usb_load_fpga(struct bladerf *dev, uint8_t *image, size_t image_size)
+{
     int status;
+    const uint64_t t_start = time_model_now_ns();
+    uint64_t t_sent;
 
     /* Switch to the FPGA configuration interface */
     status = change_setting(dev, USB_IF_CONFIG);
@@ -536,38 +613,30 @@ static int usb_load_fpga(struct bladerf *dev, uint8_t *image, size_t image_size)
 
     /* Send the file down */
     assert(image_size <= UINT32_MAX);
-    status = usb->fn->bulk_transfer(driver, PERIPHERAL_EP_OUT, image,
-                                    (uint32_t)image_size, timeout_ms);
+    status = send_fpga_bitstream(dev, image, (uint32_t) image_size);
     if (status < 0) {
         log_debug("Failed to write FPGA bitstream to FPGA: %s\n",
                   bladerf_strerror(status));
         return status;
     }
 
-    /* Poll FPGA status to determine if programming was a success */
-    wait_count = 10;
-    status = 0;
-
-    while (wait_count > 0 && status == 0) {
-        status = usb_is_fpga_configured(dev);
-        if (status == 1) {
-            break;
-        }
+    t_sent = time_model_now_ns();
 
-        usleep(200000);
-        wait_count--;
-    }
-
-    /* Failed to determine if FPGA is loaded */
-    if (status < 0) {
+    /* Poll FPGA status to determine if programming was a success */
+    status = wait_for_fpga_configured(dev);
+    if (status == BLADERF_ERR_TIMEOUT) {
+        log_debug("Timeout while waiting for FPGA configuration status\n");
+        return status;
+    } else if (status < 0) {
         log_debug("Failed to determine if FPGA is loaded: %s\n",
                   bladerf_strerror(status));
         return status;
-    } else if (wait_count == 0 && status != 0) {
-        log_debug("Timeout while waiting for FPGA configuration status\n");
-        return BLADERF_ERR_TIMEOUT;
     }
 
+    log_verbose("FPGA bitstream sent in %u ms, configured %u ms later\n",
+                (unsigned int) ((t_sent - t_start) / 1000000),
+                (unsigned int) ((time_model_now_ns() - t_sent) / 1000000));
+
     return rflink_and_fpga_version_load(dev);
 }
 
@@ -607,6 +676,7 @@ static int usb_erase_flash_blocks(struct bladerf *dev,
         status = perform_erase(dev, eb + i);
         if (status == 0) {
             log_info("Erased block %u%c", eb + i, (i+1) == count ? '\n':'\r' );
+            flash_progress(dev, BLADERF_FLASH_OP_ERASE, i + 1, count);
         } else {
             log_debug("Failed to erase block %u: %s\n",
                     eb + i, bladerf_strerror(status));
@@ -621,6 +691,25 @@ error:
     return status != 0 ? status : restore_status;
 }
 
+/* Size of the control transfers used to access the firmware's page buffer.
+ *
+ * At high speed, pages are moved in 64-byte transfers, matching the EP0 max
+ * packet size. Larger data stages have not been validated against the
+ * firmware at high speed. */
+static inline uint16_t flash_xfer_size(struct bladerf *dev)
+{
+    switch (dev->usb_speed) {
+        case BLADERF_DEVICE_SPEED_SUPER:
+            return BLADERF_FLASH_PAGE_SIZE;
+
+        case BLADERF_DEVICE_SPEED_HIGH:
+            return 64;
+
+        default:
+            return 0;
+    }
+}
+
 static inline int read_page(struct bladerf *dev, uint8_t read_operation,
                             uint16_t page, uint8_t *buf)
 {
@@ -628,15 +717,11 @@ static inline int read_page(struct bladerf *dev, uint8_t read_operation,
     struct bladerf_usb *usb = usb_backend(dev, &driver);
     int status;
     int32_t op_status;
-    uint16_t read_size;
     uint16_t offset;
     uint8_t request;
+    const uint16_t read_size = flash_xfer_size(dev);
 
-    if (dev->usb_speed == BLADERF_DEVICE_SPEED_SUPER) {
-        read_size = BLADERF_FLASH_PAGE_SIZE;
-    } else if (dev->usb_speed == BLADERF_DEVICE_SPEED_HIGH) {
-        read_size = 64;
-    } else {
+    if (read_size == 0) {
         log_debug("Encountered unknown USB speed in %s\n", __FUNCTION__);
         return BLADERF_ERR_UNEXPECTED;
     }
@@ -689,7 +774,7 @@ static inline int read_page(struct bladerf *dev, uint8_t read_operation,
 static int usb_read_flash_pages(struct bladerf *dev, uint8_t *buf,
                                 uint32_t page_u32, uint32_t count_u32)
 {
-    int status;
+    int status, restore_status;
     size_t n_read;
     uint16_t i;
 
@@ -718,13 +803,14 @@ static int usb_read_flash_pages(struct bladerf *dev, uint8_t *buf,
         }
 
         n_read += BLADERF_FLASH_PAGE_SIZE;
+        flash_progress(dev, BLADERF_FLASH_OP_READ, i + 1, count);
     }
 
     log_info("Done reading %u pages\n", count);
 
 error:
-    status = restore_post_flash_setting(dev);
-    return status;
+    restore_status = restore_post_flash_setting(dev);
+    return status != 0 ? status : restore_status;
 }
 
 static int write_page(struct bladerf *dev, uint16_t page, const uint8_t *buf)
@@ -732,15 +818,11 @@ static int write_page(struct bladerf *dev, uint16_t page, const uint8_t *buf)
     int status;
     int32_t commit_status;
     uint16_t offset;
-    uint16_t write_size;
     void *driver;
     struct bladerf_usb *usb = usb_backend(dev, &driver);
+    const uint16_t write_size = flash_xfer_size(dev);
 
-    if (dev->usb_speed == BLADERF_DEVICE_SPEED_SUPER) {
-        write_size = BLADERF_FLASH_PAGE_SIZE;
-    } else if (dev->usb_speed == BLADERF_DEVICE_SPEED_HIGH) {
-        write_size = 64;
-    } else {
+    if (write_size == 0) {
         assert(!"BUG - unexpected device speed");
         return BLADERF_ERR_UNEXPECTED;
     }
@@ -820,6 +902,7 @@ static int usb_write_flash_pages(struct bladerf *dev, const uint8_t *buf,
         }
 
         n_written += BLADERF_FLASH_PAGE_SIZE;
+        flash_progress(dev, BLADERF_FLASH_OP_WRITE, i + 1, count);
     }
     log_info("Done writing %u pages\n", count );
 
@@ -974,8 +1057,7 @@ static int set_fpga_correction(struct bladerf *dev,
                                uint8_t addr, int16_t value)
 {
     int i;
-    int status;
-    struct uart_cmd cmd;
+    struct uart_cmd cmds[2];
 
     /* If this is a gain correction add in the 1.0 value so 0 correction yields
      * an unscaled gain */
@@ -983,15 +1065,13 @@ static int set_fpga_correction(struct bladerf *dev,
         value += (int16_t)4096;
     }
 
-    for (i = status = 0; status == 0 && i < 2; i++) {
-        cmd.addr = i + addr;
-
-        cmd.data = (value >> (i * 8)) & 0xff;
-        status = access_peripheral(dev, UART_PKT_DEV_GPIO,
-                                   USB_DIR_HOST_TO_DEVICE, &cmd, 1);
+    for (i = 0; i < 2; i++) {
+        cmds[i].addr = i + addr;
+        cmds[i].data = (value >> (i * 8)) & 0xff;
     }
 
-    return status;
+    return access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_HOST_TO_DEVICE,
+                             cmds, ARRAY_SIZE(cmds));
 }
 
 static int usb_lms_write(struct bladerf *dev, uint8_t addr, uint8_t data)
@@ -1029,6 +1109,66 @@ static int usb_lms_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
     return status;
 }
 
+static int usb_lms_write_batch(struct bladerf *dev,
+                               const struct backend_reg *regs, size_t n)
+{
+    int status = 0;
+    size_t i, j, count;
+    struct uart_cmd cmds[PERIPHERAL_MAX_CMDS];
+
+    for (i = 0; i < n && status == 0; i += count) {
+        count = n - i;
+        if (count > PERIPHERAL_MAX_CMDS) {
+            count = PERIPHERAL_MAX_CMDS;
+        }
+
+        for (j = 0; j < count; j++) {
+            cmds[j].addr = regs[i + j].addr;
+            cmds[j].data = regs[i + j].data;
+            log_verbose("%s: 0x%2.2x 0x%2.2x\n", __FUNCTION__,
+                        cmds[j].addr, cmds[j].data);
+        }
+
+        status = access_peripheral_pkt(dev, UART_PKT_DEV_LMS,
+                                       USB_DIR_HOST_TO_DEVICE, cmds, count);
+    }
+
+    return status;
+}
+
+static int usb_lms_read_batch(struct bladerf *dev,
+                              struct backend_reg *regs, size_t n)
+{
+    int status = 0;
+    size_t i, j, count;
+    struct uart_cmd cmds[PERIPHERAL_MAX_CMDS];
+
+    for (i = 0; i < n && status == 0; i += count) {
+        count = n - i;
+        if (count > PERIPHERAL_MAX_CMDS) {
+            count = PERIPHERAL_MAX_CMDS;
+        }
+
+        for (j = 0; j < count; j++) {
+            cmds[j].addr = regs[i + j].addr;
+            cmds[j].data = 0xff;
+        }
+
+        status = access_peripheral_pkt(dev, UART_PKT_DEV_LMS,
+                                       USB_DIR_DEVICE_TO_HOST, cmds, count);
+
+        if (status == 0) {
+            for (j = 0; j < count; j++) {
+                regs[i + j].data = cmds[j].data;
+                log_verbose("%s: 0x%2.2x 0x%2.2x\n", __FUNCTION__,
+                            cmds[j].addr, cmds[j].data);
+            }
+        }
+    }
+
+    return status;
+}
+
 static int set_lms_correction(struct bladerf *dev, bladerf_module module,
                               uint8_t addr, int16_t value)
 {
@@ -1113,18 +1253,18 @@ static int get_fpga_correction(struct bladerf *dev, bladerf_correction corr,
 {
     int i;
     int status;
-    struct uart_cmd cmd;
-
-    *value = 0;
-    for (i = status = 0; status == 0 && i < 2; i++) {
-        cmd.addr = i + addr;
-        cmd.data = 0xff;
-        status = access_peripheral(dev, UART_PKT_DEV_GPIO,
-                                   USB_DIR_DEVICE_TO_HOST, &cmd, 1);
+    struct uart_cmd cmds[2];
 
-        *value |= (cmd.data << (i * 8));
+    for (i = 0; i < 2; i++) {
+        cmds[i].addr = i + addr;
+        cmds[i].data = 0xff;
     }
 
+    status = access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_DEVICE_TO_HOST,
+                               cmds, ARRAY_SIZE(cmds));
+
+    *value = cmds[0].data | (cmds[1].data << 8);
+
     /* Gain corrections have an offset that needs to be accounted for */
     if (corr == BLADERF_CORR_FPGA_GAIN) {
         *value -= 4096;
@@ -1190,42 +1330,27 @@ static int usb_get_correction(struct bladerf *dev, bladerf_module module,
 int usb_get_timestamp(struct bladerf *dev, bladerf_module mod, uint64_t *value)
 {
     int status = 0;
-    struct uart_cmd cmds[4];
-    uint8_t timestamp_bytes[8];
+    struct uart_cmd cmds[sizeof(*value)];
+    uint8_t timestamp_bytes[sizeof(*value)];
     size_t i;
 
-    /* Offset 16 is the time tamer according to the Nios firmware */
-    cmds[0].addr = (mod == BLADERF_MODULE_RX ? 16 : 24);
-    cmds[1].addr = (mod == BLADERF_MODULE_RX ? 17 : 25);
-    cmds[2].addr = (mod == BLADERF_MODULE_RX ? 18 : 26);
-    cmds[3].addr = (mod == BLADERF_MODULE_RX ? 19 : 27);
-    cmds[0].data = cmds[1].data = cmds[2].data = cmds[3].data = 0xff;
+    /* Offset 16 is the time tamer according to the Nios firmware.
+     *
+     * All 8 bytes are read via a single batched access, which is split into
+     * two round trips as a packet holds at most PERIPHERAL_MAX_CMDS. */
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        cmds[i].addr = (uint8_t) ((mod == BLADERF_MODULE_RX ? 16 : 24) + i);
+        cmds[i].data = 0xff;
+    }
 
     status = access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_DEVICE_TO_HOST,
                                cmds, ARRAY_SIZE(cmds));
     if (status != 0) {
         return status;
-    } else {
-        for (i = 0; i < 4; i++) {
-            timestamp_bytes[i] = cmds[i].data;
-        }
     }
 
-    cmds[0].addr = (mod == BLADERF_MODULE_RX ? 20 : 28);
-    cmds[1].addr = (mod == BLADERF_MODULE_RX ? 21 : 29);
-    cmds[2].addr = (mod == BLADERF_MODULE_RX ? 22 : 30);
-    cmds[3].addr = (mod == BLADERF_MODULE_RX ? 23 : 31);
-    cmds[0].data = cmds[1].data = cmds[2].data = cmds[3].data = 0xff;
-
-    status = access_peripheral(dev, UART_PKT_DEV_GPIO, USB_DIR_DEVICE_TO_HOST,
-                               cmds, ARRAY_SIZE(cmds));
-
-    if (status) {
-        return status;
-    } else {
-        for (i = 0; i < 4; i++) {
-            timestamp_bytes[i + 4] = cmds[i].data;
-        }
+    for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+        timestamp_bytes[i] = cmds[i].data;
     }
 
     memcpy(value, timestamp_bytes, sizeof(*value));
@@ -1269,8 +1394,7 @@ static int usb_si5338_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
 
 static int usb_dac_write(struct bladerf *dev, uint16_t value)
 {
-    int status;
-    struct uart_cmd cmd;
+    struct uart_cmd cmds[2];
     int base;
 
     /* FPGA v0.0.4 introduced a change to the location of the DAC registers */
@@ -1278,21 +1402,13 @@ static int usb_dac_write(struct bladerf *dev, uint16_t value)
 
     base = legacy_location ? 0 : 34;
 
-    cmd.addr = base;
-    cmd.data = value & 0xff;
-    status = access_peripheral(dev, legacy_location ? UART_PKT_DEV_VCTCXO : UART_PKT_DEV_GPIO,
-                               USB_DIR_HOST_TO_DEVICE, &cmd, 1);
-
-    if (status < 0) {
-        return status;
-    }
-
-    cmd.addr = base + 1;
-    cmd.data = (value >> 8) & 0xff;
-    status = access_peripheral(dev, legacy_location ? UART_PKT_DEV_VCTCXO : UART_PKT_DEV_GPIO,
-                               USB_DIR_HOST_TO_DEVICE, &cmd, 1);
+    cmds[0].addr = base;
+    cmds[0].data = value & 0xff;
+    cmds[1].addr = base + 1;
+    cmds[1].data = (value >> 8) & 0xff;
 
-    return status;
+    return access_peripheral(dev, legacy_location ? UART_PKT_DEV_VCTCXO : UART_PKT_DEV_GPIO,
+                             USB_DIR_HOST_TO_DEVICE, cmds, ARRAY_SIZE(cmds));
 }
 
 static int usb_xb_spi(struct bladerf *dev, uint32_t value)
@@ -1399,6 +1515,26 @@ static void usb_deinit_stream(struct bladerf_stream *stream)
     usb->fn->deinit_stream(driver, stream);
 }
 
+static void * usb_alloc_stream_mem(struct bladerf_stream *stream, size_t len)
+{
+    void *driver;
+    struct bladerf_usb *usb = usb_backend(stream->dev, &driver);
+
+    if (usb->fn->alloc_stream_mem == NULL) {
+        return NULL;
+    }
+
+    return usb->fn->alloc_stream_mem(driver, len);
+}
+
+static void usb_free_stream_mem(struct bladerf_stream *stream,
+                                void *mem, size_t len)
+{
+    void *driver;
+    struct bladerf_usb *usb = usb_backend(stream->dev, &driver);
+    usb->fn->free_stream_mem(driver, mem, len);
+}
+
 const struct backend_fns backend_fns_usb = {
     FIELD_INIT(.matches, usb_matches),
 
@@ -1439,6 +1575,8 @@ const struct backend_fns backend_fns_usb = {
 
     FIELD_INIT(.lms_write, usb_lms_write),
     FIELD_INIT(.lms_read, usb_lms_read),
+    FIELD_INIT(.lms_write_batch, usb_lms_write_batch),
+    FIELD_INIT(.lms_read_batch, usb_lms_read_batch),
 
     FIELD_INIT(.dac_write, usb_dac_write),
 
@@ -1452,5 +1590,8 @@ const struct backend_fns backend_fns_usb = {
     FIELD_INIT(.init_stream, usb_init_stream),
     FIELD_INIT(.stream, usb_stream),
     FIELD_INIT(.submit_stream_buffer, usb_submit_stream_buffer),
-    FIELD_INIT(.deinit_stream, usb_deinit_stream)
+    FIELD_INIT(.deinit_stream, usb_deinit_stream),
+
+    FIELD_INIT(.alloc_stream_mem, usb_alloc_stream_mem),
+    FIELD_INIT(.free_stream_mem, usb_free_stream_mem),
 };
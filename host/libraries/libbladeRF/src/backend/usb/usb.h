@@ -54,6 +54,31 @@
 #   define BULK_TIMEOUT_MS  1000
 #endif
 
+/* FPGA bitstreams are sent in chunks of this many bytes, with up to
+ * FPGA_LOAD_XFERS chunks in flight when the driver supports it */
+#ifndef FPGA_LOAD_CHUNK_SIZE
+#   define FPGA_LOAD_CHUNK_SIZE (64 * 1024)
+#endif
+
+#ifndef FPGA_LOAD_XFERS
+#   define FPGA_LOAD_XFERS 4
+#endif
+
+/* Following a bitstream upload, the FPGA's configuration status is polled
+ * at intervals that double from FPGA_CONF_POLL_MIN_US up to
+ * FPGA_CONF_POLL_MAX_US, for up to FPGA_CONF_TIMEOUT_MS */
+#ifndef FPGA_CONF_POLL_MIN_US
+#   define FPGA_CONF_POLL_MIN_US 500
+#endif
+
+#ifndef FPGA_CONF_POLL_MAX_US
+#   define FPGA_CONF_POLL_MAX_US 20000
+#endif
+
+#ifndef FPGA_CONF_TIMEOUT_MS
+#   define FPGA_CONF_TIMEOUT_MS 2000
+#endif
+
 /* Size of a host<->FPGA message in BYTES */
 #define USB_MSG_SIZE_SS    2048
 #define USB_MSG_SIZE_HS    1024
@@ -120,10 +145,26 @@ struct usb_fns {
     int (*stream)(void *driver, struct bladerf_stream *stream,
                   bladerf_module module);
 
+    /* Called without stream->lock held */
     int (*submit_stream_buffer)(void *driver, struct bladerf_stream *stream,
                                 void *buffer, unsigned int timeout_ms);
 
     int (*deinit_stream)(void *driver, struct bladerf_stream *stream);
+
+    /* Optional. See the backend_fns items of the same name. */
+    void * (*alloc_stream_mem)(void *driver, size_t len);
+    void (*free_stream_mem)(void *driver, void *mem, size_t len);
+
+    /* Optional. Perform a bulk transfer as a series of `chunk_len`-byte
+     * transfers, keeping up to `num_xfers` of them in flight. `timeout_ms`
+     * applies to each chunk. If non-NULL, `progress` is called with the
+     * total number of bytes transferred as chunks complete. */
+    int (*bulk_transfer_chunked)(void *driver, uint8_t endpoint,
+                                 void *buffer, uint32_t buffer_len,
+                                 uint32_t chunk_len, unsigned int num_xfers,
+                                 uint32_t timeout_ms,
+                                 void (*progress)(void *arg, uint32_t done),
+                                 void *progress_arg);
 };
 
 struct usb_driver {
@@ -28,6 +28,9 @@
 #include "bladerf_priv.h"   /* Implementation-specific items ("private") */
 #include "async.h"
 #include "sync.h"
+#include "thread_config.h"
+#include "sample_conv.h"
+#include "retune.h"
 #include "tuning.h"
 #include "gain.h"
 #include "lms.h"
@@ -101,6 +104,11 @@ int bladerf_open_with_devinfo(struct bladerf **opened_device,
     MUTEX_INIT(&dev->sync_lock[BLADERF_MODULE_RX]);
     MUTEX_INIT(&dev->sync_lock[BLADERF_MODULE_TX]);
 
+    thread_config_init();
+
+    time_model_init(&dev->time_model[BLADERF_MODULE_RX]);
+    time_model_init(&dev->time_model[BLADERF_MODULE_TX]);
+
     dev->fpga_version.describe = calloc(1, BLADERF_VERSION_STR_MAX + 1);
     if (dev->fpga_version.describe == NULL) {
         free(dev);
@@ -193,6 +201,8 @@ int bladerf_open_with_devinfo(struct bladerf **opened_device,
     dev->module_format[BLADERF_MODULE_RX] = -1;
     dev->module_format[BLADERF_MODULE_TX] = -1;
 
+    lms_shadow_init(dev);
+
     /* Load any available calibration tables so that the LMS DC register
      * configurations may be loaded in init_device */
     status = config_load_dc_cals(dev);
@@ -688,6 +698,73 @@ int bladerf_get_frequency(struct bladerf *dev,
     return status;
 }
 
+int bladerf_get_quick_tune(struct bladerf *dev, bladerf_module module,
+                           struct bladerf_quick_tune *quick_tune)
+{
+    int status;
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    status = tuning_get_quick_tune(dev, module, quick_tune);
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+int bladerf_build_quick_tune_profile(struct bladerf *dev,
+                                     bladerf_module module,
+                                     const unsigned int *frequencies,
+                                     struct bladerf_quick_tune *profile,
+                                     unsigned int count)
+{
+    int status, restore_status;
+    unsigned int i;
+    unsigned int orig_freq;
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    status = tuning_get_freq(dev, module, &orig_freq);
+
+    for (i = 0; i < count && status == 0; i++) {
+        status = tuning_set_freq(dev, module, frequencies[i]);
+        if (status == 0) {
+            status = tuning_get_quick_tune(dev, module, &profile[i]);
+        }
+    }
+
+    /* Restore the original frequency via the same path used above, so that
+     * any XB-200 filter/path and DC calibration changes are undone as well */
+    if (i > 0) {
+        restore_status = tuning_set_freq(dev, module, orig_freq);
+        if (status == 0) {
+            status = restore_status;
+        }
+    }
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+int bladerf_set_quick_tune(struct bladerf *dev,
+                           const struct bladerf_quick_tune *quick_tune)
+{
+    int status;
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    status = tuning_set_quick_tune(dev, quick_tune);
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+int bladerf_schedule_retunes(struct bladerf *dev, bladerf_module module,
+                             struct bladerf_retune *retunes,
+                             unsigned int count, unsigned int timeout_ms)
+{
+    /* The control lock is acquired as needed, as this may block for a
+     * significant amount of time */
+    return retune_schedule(dev, module, retunes, count, timeout_ms);
+}
+
 int bladerf_set_stream_timeout(struct bladerf *dev, bladerf_module module,
                                unsigned int timeout) {
 
@@ -774,6 +851,216 @@ int bladerf_sync_rx(struct bladerf *dev,
     return status;
 }
 
+int bladerf_sync_rx_acquire(struct bladerf *dev,
+                            void **samples, unsigned int *num_samples,
+                            struct bladerf_metadata *metadata,
+                            unsigned int timeout_ms)
+{
+    int status;
+
+    MUTEX_LOCK(&dev->sync_lock[BLADERF_MODULE_RX]);
+    status = sync_rx_acquire(dev, samples, num_samples, metadata, timeout_ms);
+    MUTEX_UNLOCK(&dev->sync_lock[BLADERF_MODULE_RX]);
+
+    return status;
+}
+
+int bladerf_sync_rx_release(struct bladerf *dev,
+                            void *samples, unsigned int num_samples)
+{
+    int status;
+
+    MUTEX_LOCK(&dev->sync_lock[BLADERF_MODULE_RX]);
+    status = sync_rx_release(dev, samples, num_samples);
+    MUTEX_UNLOCK(&dev->sync_lock[BLADERF_MODULE_RX]);
+
+    return status;
+}
+
+int bladerf_sync_tx_acquire(struct bladerf *dev,
+                            void **samples, unsigned int *num_samples,
+                            unsigned int timeout_ms)
+{
+    int status;
+
+    MUTEX_LOCK(&dev->sync_lock[BLADERF_MODULE_TX]);
+    status = sync_tx_acquire(dev, samples, num_samples, timeout_ms);
+    MUTEX_UNLOCK(&dev->sync_lock[BLADERF_MODULE_TX]);
+
+    return status;
+}
+
+int bladerf_sync_tx_release(struct bladerf *dev,
+                            void *samples, unsigned int num_samples,
+                            struct bladerf_metadata *metadata,
+                            unsigned int timeout_ms)
+{
+    int status;
+
+    MUTEX_LOCK(&dev->sync_lock[BLADERF_MODULE_TX]);
+    status = sync_tx_release(dev, samples, num_samples, metadata, timeout_ms);
+    MUTEX_UNLOCK(&dev->sync_lock[BLADERF_MODULE_TX]);
+
+    return status;
+}
+
+int bladerf_get_rx_overrun_stats(struct bladerf *dev,
+                                 struct bladerf_rx_overrun_stats *stats)
+{
+    int status;
+
+    if (stats == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dev->sync_lock[BLADERF_MODULE_RX]);
+    status = sync_get_rx_overrun_stats(dev, stats);
+    MUTEX_UNLOCK(&dev->sync_lock[BLADERF_MODULE_RX]);
+
+    return status;
+}
+
+int bladerf_sync_pause(struct bladerf *dev, bladerf_module module)
+{
+    int status;
+
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    log_debug("Pause Module: %s\n", module2str(module));
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+    MUTEX_LOCK(&dev->sync_lock[module]);
+
+    status = sync_pause(dev, module);
+
+    MUTEX_UNLOCK(&dev->sync_lock[module]);
+
+    if (status == 0) {
+        lms_enable_rffe(dev, module, false);
+        status = dev->fn->enable_module(dev, module, false);
+    }
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+int bladerf_sync_resume(struct bladerf *dev, bladerf_module module)
+{
+    int status;
+
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    log_debug("Resume Module: %s\n", module2str(module));
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    if (dev->sync[module] == NULL) {
+        log_debug("%s: %s sync interface is not configured\n",
+                  __FUNCTION__, module2str(module));
+        status = BLADERF_ERR_INVAL;
+    } else {
+        lms_enable_rffe(dev, module, true);
+        status = dev->fn->enable_module(dev, module, true);
+    }
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+int bladerf_get_stream_stats(struct bladerf *dev, bladerf_module module,
+                             struct bladerf_stream_stats *stats)
+{
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        log_debug("%s: Invalid module: %d\n", __FUNCTION__, module);
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (stats == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    /* No locking is required, as the counters are accessed atomically */
+    stream_stats_get(&dev->stream_stats[module], stats);
+    return 0;
+}
+
+int bladerf_get_ctrl_stats(struct bladerf *dev,
+                           struct bladerf_ctrl_stats *stats)
+{
+    if (stats == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    ctrl_stats_get(&dev->ctrl_stats, stats);
+    return 0;
+}
+
+void bladerf_reset_ctrl_stats(struct bladerf *dev)
+{
+    ctrl_stats_reset(&dev->ctrl_stats);
+}
+
+int bladerf_set_thread_config(struct bladerf *dev,
+                              const struct bladerf_thread_config *config)
+{
+    int status;
+
+    if (config == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    status = thread_config_check(config);
+    if (status != 0) {
+        return status;
+    }
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+    dev->thread_config = *config;
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    return 0;
+}
+
+int bladerf_get_thread_config(struct bladerf *dev,
+                              struct bladerf_thread_config *config)
+{
+    if (config == NULL) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+    *config = dev->thread_config;
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    return 0;
+}
+
+void bladerf_sc16q11_to_cf32(float *dest, const int16_t *src,
+                             unsigned int num_samples)
+{
+    struct sample_conv conv;
+
+    /* CF32 conversions are always available */
+    if (sample_conv_init(BLADERF_FORMAT_CF32, &conv) == 0) {
+        conv.to_host(dest, src, num_samples);
+    }
+}
+
+void bladerf_cf32_to_sc16q11(int16_t *dest, const float *src,
+                             unsigned int num_samples)
+{
+    struct sample_conv conv;
+
+    /* CF32 conversions are always available */
+    if (sample_conv_init(BLADERF_FORMAT_CF32, &conv) == 0) {
+        conv.to_wire(dest, src, num_samples);
+    }
+}
+
 int bladerf_init_stream(struct bladerf_stream **stream,
                         struct bladerf *dev,
                         bladerf_stream_cb callback,
@@ -939,6 +1226,18 @@ int bladerf_write_flash(struct bladerf *dev, const uint8_t *buf,
     return status;
 }
 
+int bladerf_set_flash_progress_cb(struct bladerf *dev,
+                                  bladerf_flash_progress_cb cb,
+                                  void *user_data)
+{
+    MUTEX_LOCK(&dev->ctrl_lock);
+    dev->flash_progress_cb = cb;
+    dev->flash_progress_data = user_data;
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    return 0;
+}
+
 int bladerf_device_reset(struct bladerf *dev)
 {
     int status;
@@ -1016,13 +1315,36 @@ int bladerf_load_fpga(struct bladerf *dev, const char *fpga_file)
     int status;
     MUTEX_LOCK(&dev->ctrl_lock);
 
-    status = fpga_load_from_file(dev, fpga_file);
+    status = fpga_load_from_file(dev, fpga_file, false);
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+int bladerf_load_fpga_force(struct bladerf *dev, const char *fpga_file)
+{
+    int status;
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    status = fpga_load_from_file(dev, fpga_file, true);
 
     MUTEX_UNLOCK(&dev->ctrl_lock);
     return status;
 }
 
 
+int bladerf_set_fpga_load_progress_cb(struct bladerf *dev,
+                                      bladerf_fpga_load_progress_cb cb,
+                                      void *user_data)
+{
+    MUTEX_LOCK(&dev->ctrl_lock);
+    dev->fpga_load_progress_cb = cb;
+    dev->fpga_load_progress_data = user_data;
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    return 0;
+}
+
 int bladerf_flash_fpga(struct bladerf *dev, const char *fpga_file)
 {
     int status;
@@ -1203,7 +1525,7 @@ int bladerf_lms_read(struct bladerf *dev, uint8_t address, uint8_t *val)
     int status;
     MUTEX_LOCK(&dev->ctrl_lock);
 
-    status = dev->fn->lms_read(dev,address,val);
+    status = LMS_READ(dev, address, val);
 
     MUTEX_UNLOCK(&dev->ctrl_lock);
     return status;
@@ -1214,7 +1536,7 @@ int bladerf_lms_write(struct bladerf *dev, uint8_t address, uint8_t val)
     int status;
     MUTEX_LOCK(&dev->ctrl_lock);
 
-    status = dev->fn->lms_write(dev,address,val);
+    status = LMS_WRITE(dev, address, val);
 
     MUTEX_UNLOCK(&dev->ctrl_lock);
     return status;
@@ -1436,12 +1758,85 @@ int bladerf_get_timestamp(struct bladerf *dev, bladerf_module module, uint64_t *
     int status;
     MUTEX_LOCK(&dev->ctrl_lock);
 
-    status = dev->fn->get_timestamp(dev,module,value);
+    status = read_timestamp(dev, module, value);
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+    return status;
+}
+
+uint64_t bladerf_get_host_time(void)
+{
+    return time_model_now_ns();
+}
+
+/* Ensure a module's time model is able to provide a current estimate */
+static int refresh_time_model(struct bladerf *dev, bladerf_module module)
+{
+    int status = 0;
+    struct bladerf_rational_rate rate;
+    uint64_t timestamp;
+
+    if (!time_model_needs_refresh(&dev->time_model[module],
+                                  time_model_now_ns())) {
+        return 0;
+    }
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    /* The nominal sample rate is only unknown if it has not been set since
+     * the device was opened */
+    if (dev->time_model[module].nominal_rate == 0) {
+        status = si5338_get_rational_sample_rate(dev, module, &rate);
+        if (status == 0 && rate.den != 0) {
+            time_model_set_rate(&dev->time_model[module],
+                                rate.integer + (double) rate.num / rate.den);
+        }
+    }
+
+    if (status == 0) {
+        status = read_timestamp(dev, module, &timestamp);
+    }
 
     MUTEX_UNLOCK(&dev->ctrl_lock);
     return status;
 }
 
+int bladerf_get_timestamp_estimate(struct bladerf *dev, bladerf_module module,
+                                   uint64_t *timestamp)
+{
+    int status;
+
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    status = refresh_time_model(dev, module);
+    if (status == 0) {
+        status = time_model_timestamp(&dev->time_model[module],
+                                      time_model_now_ns(), timestamp);
+    }
+
+    return status;
+}
+
+int bladerf_get_host_time_estimate(struct bladerf *dev, bladerf_module module,
+                                   uint64_t timestamp, uint64_t *host_ns)
+{
+    int status;
+
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    status = refresh_time_model(dev, module);
+    if (status == 0) {
+        status = time_model_host_time(&dev->time_model[module],
+                                      timestamp, host_ns);
+    }
+
+    return status;
+}
+
 /*------------------------------------------------------------------------------
  * VCTCXO DAC register write
  *----------------------------------------------------------------------------*/
@@ -131,6 +131,24 @@ static inline int apply_lms_dc_cals(struct bladerf *dev)
     return status;
 }
 
+/* LMS6002D register values applied when initializing a device */
+static const struct backend_reg lms_init_regs[] = {
+    /* Set the internal LMS register to enable RX and TX */
+    { 0x05, 0x3e },
+
+    /* LMS FAQ: Improve TX spurious emission performance */
+    { 0x47, 0x40 },
+
+    /* LMS FAQ: Improve ADC performance */
+    { 0x59, 0x29 },
+
+    /* LMS FAQ: Common mode voltage for ADC */
+    { 0x64, 0x36 },
+
+    /* LMS FAQ: Higher LNA Gain */
+    { 0x79, 0x37 },
+};
+
 int init_device(struct bladerf *dev)
 {
     int status;
@@ -151,7 +169,16 @@ int init_device(struct bladerf *dev)
         if (status != 0) {
             return status;
         }
+    }
+
+    /* The LMS6002D may have been reset, or configured by someone else since
+     * we last saw it, so (re)load the host-side copy of its registers */
+    status = lms_shadow_load(dev);
+    if (status != 0) {
+        return status;
+    }
 
+    if ((val & 0x7f) == 0) {
         /* Disable the front ends */
         status = lms_enable_rffe(dev, BLADERF_MODULE_TX, false);
         if (status != 0) {
@@ -163,32 +190,7 @@ int init_device(struct bladerf *dev)
             return status;
         }
 
-        /* Set the internal LMS register to enable RX and TX */
-        status = LMS_WRITE(dev, 0x05, 0x3e);
-        if (status != 0) {
-            return status;
-        }
-
-        /* LMS FAQ: Improve TX spurious emission performance */
-        status = LMS_WRITE(dev, 0x47, 0x40);
-        if (status != 0) {
-            return status;
-        }
-
-        /* LMS FAQ: Improve ADC performance */
-        status = LMS_WRITE(dev, 0x59, 0x29);
-        if (status != 0) {
-            return status;
-        }
-
-        /* LMS FAQ: Common mode voltage for ADC */
-        status = LMS_WRITE(dev, 0x64, 0x36);
-        if (status != 0) {
-            return status;
-        }
-
-        /* LMS FAQ: Higher LNA Gain */
-        status = LMS_WRITE(dev, 0x79, 0x37);
+        status = LMS_WRITE_BATCH(dev, lms_init_regs, ARRAY_SIZE(lms_init_regs));
         if (status != 0) {
             return status;
         }
@@ -251,6 +253,21 @@ int populate_abs_timeout(struct timespec *t, unsigned int timeout_ms)
     }
 }
 
+int read_timestamp(struct bladerf *dev, bladerf_module module,
+                   uint64_t *timestamp)
+{
+    int status;
+
+    status = dev->fn->get_timestamp(dev, module, timestamp);
+    if (status == 0) {
+        /* The counter had at least this value upon completion */
+        time_model_add(&dev->time_model[module], time_model_now_ns(),
+                       *timestamp);
+    }
+
+    return status;
+}
+
 int config_gpio_write(struct bladerf *dev, uint32_t val)
 {
     /* If we're connected at HS, we need to use smaller DMA transfers */
@@ -272,10 +289,14 @@ static inline int requires_timestamps(bladerf_format format, bool *required)
 
     switch (format) {
         case BLADERF_FORMAT_SC16_Q11_META:
+        case BLADERF_FORMAT_SC16_Q11_HOST_META:
+        case BLADERF_FORMAT_CF32_META:
             *required = true;
             break;
 
         case BLADERF_FORMAT_SC16_Q11:
+        case BLADERF_FORMAT_SC16_Q11_HOST:
+        case BLADERF_FORMAT_CF32:
             *required = false;
             break;
 
@@ -293,7 +314,7 @@ int perform_format_config(struct bladerf *dev, bladerf_module module,
     bool use_timestamps;
     bladerf_module other;
     bool other_using_timestamps;
-    uint32_t gpio_val;
+    uint32_t gpio_val, prev_gpio_val;
 
     status = requires_timestamps(format, &use_timestamps);
     if (status != 0) {
@@ -333,6 +354,8 @@ int perform_format_config(struct bladerf *dev, bladerf_module module,
         return status;
     }
 
+    prev_gpio_val = gpio_val;
+
     if (use_timestamps) {
         gpio_val |= (BLADERF_GPIO_TIMESTAMP | BLADERF_GPIO_TIMESTAMP_DIV2);
     } else {
@@ -343,6 +366,12 @@ int perform_format_config(struct bladerf *dev, bladerf_module module,
 
     if (status == 0) {
         dev->module_format[module] = format;
+
+        /* The sample counters' rates change with the timestamp mode */
+        if ((gpio_val ^ prev_gpio_val) & BLADERF_GPIO_TIMESTAMP_DIV2) {
+            time_model_reset(&dev->time_model[BLADERF_MODULE_RX]);
+            time_model_reset(&dev->time_model[BLADERF_MODULE_TX]);
+        }
     }
 
     return status;
@@ -47,6 +47,9 @@
 #include "devinfo.h"
 #include "flash.h"
 #include "backend/backend.h"
+#include "stream_stats.h"
+#include "ctrl_stats.h"
+#include "time_model.h"
 #include "rel_assert.h"
 
 /* 1 TX, 1 RX */
@@ -78,6 +81,18 @@ struct bladerf;
 #define BLADERF_HAS_RX_DC_CAL(dev)   (BLADERF_HAS_CAL_(dev, dc_rx))
 #define BLADERF_HAS_TX_DC_CAL(dev)   (BLADERF_HAS_CAL_(dev, dc_tx))
 
+/* Number of LMS6002D registers (7-bit addresses) */
+#define LMS_NUM_REGS 128
+
+/* Host-side copy of the LMS6002D register file, maintained by lms.c */
+struct lms_shadow {
+    uint8_t regs[LMS_NUM_REGS];
+    bool valid[LMS_NUM_REGS];
+
+    bool enabled;   /* Serve reads of non-volatile registers from `regs` */
+    bool verify;    /* Read from the device anyway, and report mismatches */
+};
+
 struct calibrations {
     struct dc_cal_tbl *dc_rx;
     struct dc_cal_tbl *dc_tx;
@@ -130,6 +145,30 @@ struct bladerf {
 
     /* Format currently being used with a module, or -1 if module is not used */
     bladerf_format module_format[NUM_MODULES];
+
+    /* LMS6002D register cache. Accessed with the control lock held. */
+    struct lms_shadow lms_shadow;
+
+    /* Statistics for the stream running on each module */
+    struct stream_stats stream_stats[NUM_MODULES];
+
+    /* Control transaction counters */
+    struct ctrl_stats ctrl_stats;
+
+    /* Host time to sample counter correlation for each module */
+    struct time_model time_model[NUM_MODULES];
+
+    /* Scheduling of library-owned stream threads. Accessed with the control
+     * lock held. */
+    struct bladerf_thread_config thread_config;
+
+    /* Flash progress reporting. Accessed with the control lock held. */
+    bladerf_flash_progress_cb flash_progress_cb;
+    void *flash_progress_data;
+
+    /* FPGA load progress reporting. Accessed with the control lock held. */
+    bladerf_fpga_load_progress_cb fpga_load_progress_cb;
+    void *fpga_load_progress_data;
 };
 
 /*
@@ -196,6 +235,19 @@ int init_device(struct bladerf *dev);
  */
 int populate_abs_timeout(struct timespec *t_abs, unsigned int timeout_ms);
 
+/**
+ * Read a module's sample counter, and record the readback in the module's
+ * time model. The caller must hold the control lock.
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module whose counter to read
+ * @param[out]  timestamp   Counter value
+ *
+ * @return 0 on success, BLADERF_ERR_* on failure
+ */
+int read_timestamp(struct bladerf *dev, bladerf_module module,
+                   uint64_t *timestamp);
+
 /**
  * Load a calibration table and apply its settings
  *
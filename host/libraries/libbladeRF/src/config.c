@@ -78,7 +78,7 @@ int config_load_fpga(struct bladerf *dev)
 
     if (filename != NULL) {
         log_debug("Loading FPGA from: %s\n", filename);
-        status = fpga_load_from_file(dev, filename);
+        status = fpga_load_from_file(dev, filename, false);
     }
 
     free(filename);
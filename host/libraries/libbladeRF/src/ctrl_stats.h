@@ -0,0 +1,84 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_CTRL_STATS_H_
+#define BLADERF_CTRL_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "libbladeRF.h"
+#include "bladeRF.h"
+#include "thread.h"
+
+/* Control transaction counters, stored in struct bladerf. These are only
+ * accessed via the COUNTER_* accessors, as some control operations (e.g.,
+ * timestamp reads) are not performed under the device's control lock. */
+struct ctrl_stats {
+    uint64_t transactions;
+    uint64_t lms_transactions;
+    uint64_t si5338_transactions;
+    uint64_t gpio_transactions;
+    uint64_t accesses;
+};
+
+/* Backends call this for each peripheral access packet exchanged with the
+ * device's control processor. `peripheral` is a UART_PKT_DEV_* value, and
+ * `n` is the number of register accesses carried by the packet. */
+static inline void ctrl_stats_transaction(struct ctrl_stats *s,
+                                          uint8_t peripheral, size_t n)
+{
+    COUNTER_ADD(&s->transactions, 1);
+    COUNTER_ADD(&s->accesses, (uint64_t) n);
+
+    switch (peripheral) {
+        case UART_PKT_DEV_LMS:
+            COUNTER_ADD(&s->lms_transactions, 1);
+            break;
+
+        case UART_PKT_DEV_SI5338:
+            COUNTER_ADD(&s->si5338_transactions, 1);
+            break;
+
+        default:
+            COUNTER_ADD(&s->gpio_transactions, 1);
+            break;
+    }
+}
+
+static inline void ctrl_stats_get(struct ctrl_stats *s,
+                                  struct bladerf_ctrl_stats *out)
+{
+    out->transactions = COUNTER_LOAD(&s->transactions);
+    out->lms_transactions = COUNTER_LOAD(&s->lms_transactions);
+    out->si5338_transactions = COUNTER_LOAD(&s->si5338_transactions);
+    out->gpio_transactions = COUNTER_LOAD(&s->gpio_transactions);
+    out->accesses = COUNTER_LOAD(&s->accesses);
+}
+
+static inline void ctrl_stats_reset(struct ctrl_stats *s)
+{
+    COUNTER_STORE(&s->transactions, 0);
+    COUNTER_STORE(&s->lms_transactions, 0);
+    COUNTER_STORE(&s->si5338_transactions, 0);
+    COUNTER_STORE(&s->gpio_transactions, 0);
+    COUNTER_STORE(&s->accesses, 0);
+}
+
+#endif
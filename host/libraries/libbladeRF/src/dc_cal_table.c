@@ -57,6 +57,8 @@
 #   include <stdio.h>
 #   define SHORT_SEARCH 4
 #   define WARN(str) fprintf(stderr, str)
+#   define log_debug(...)
+#   define log_verbose(...)
 #else
 #   include "log.h"
 #   define SHORT_SEARCH 10
@@ -119,7 +121,8 @@ static unsigned int find_entry(const struct dc_cal_tbl *tbl,
 }
 
 
-unsigned int dc_cal_tbl_lookup(const struct dc_cal_tbl *tbl, unsigned int freq)
+static unsigned int search_entries(const struct dc_cal_tbl *tbl,
+                                   unsigned int curr_idx, unsigned int freq)
 {
     unsigned int ret = 0;
     bool limit = false; /* Hit a limit before finding a match */
@@ -128,18 +131,67 @@ unsigned int dc_cal_tbl_lookup(const struct dc_cal_tbl *tbl, unsigned int freq)
      * when the frequecy change */
     if (tbl->n_entries > SHORT_SEARCH) {
         const unsigned int min_idx =
-            (unsigned int) i64_max(0, tbl->curr_idx - (int64_t)SHORT_SEARCH / 2);
+            (unsigned int) i64_max(0, curr_idx - (int64_t)SHORT_SEARCH / 2);
 
         const unsigned int max_idx =
-            (unsigned int) i64_min(tbl->n_entries - 1, tbl->curr_idx + SHORT_SEARCH / 2);
+            (unsigned int) i64_min(tbl->n_entries - 1, curr_idx + SHORT_SEARCH / 2);
 
-        ret = find_entry(tbl, tbl->curr_idx, min_idx, max_idx, freq, &limit);
+        ret = find_entry(tbl, curr_idx, min_idx, max_idx, freq, &limit);
         if (!limit) {
             return ret;
         }
     }
 
-    return find_entry(tbl, tbl->curr_idx, 0, tbl->n_entries - 1, freq, &limit);
+    return find_entry(tbl, curr_idx, 0, tbl->n_entries - 1, freq, &limit);
+}
+
+unsigned int dc_cal_tbl_lookup(const struct dc_cal_tbl *tbl, unsigned int freq)
+{
+    unsigned int ret;
+
+    if (tbl->f_inc != 0) {
+        if (freq <= tbl->f_low) {
+            return 0;
+        }
+
+        ret = (freq - tbl->f_low) / tbl->f_inc;
+        return ret < tbl->n_entries ? ret : tbl->n_entries - 1;
+    }
+
+    ret = search_entries(tbl, ATOMIC_LOAD(&tbl->curr_idx), freq);
+
+    /* The table is otherwise read-only, so the search hint is the only
+     * state updated via this const pointer */
+    ATOMIC_STORE((unsigned int *) &tbl->curr_idx, ret);
+
+    return ret;
+}
+
+/* Determine if a table's entries lie on a uniform f_low + k * f_inc grid,
+ * and if so, fill in f_low and f_inc to allow them to be indexed directly */
+static void detect_uniform_grid(struct dc_cal_tbl *tbl)
+{
+    uint32_t i;
+    uint64_t f_inc;
+
+    tbl->f_low = 0;
+    tbl->f_inc = 0;
+
+    if (tbl->n_entries < 2 ||
+        tbl->entries[1].freq <= tbl->entries[0].freq) {
+        return;
+    }
+
+    f_inc = tbl->entries[1].freq - tbl->entries[0].freq;
+
+    for (i = 2; i < tbl->n_entries; i++) {
+        if (tbl->entries[i].freq != tbl->entries[0].freq + i * f_inc) {
+            return;
+        }
+    }
+
+    tbl->f_low = tbl->entries[0].freq;
+    tbl->f_inc = (unsigned int) f_inc;
 }
 
 struct dc_cal_tbl * dc_cal_tbl_load(uint8_t *buf, size_t buf_len)
@@ -214,6 +266,13 @@ struct dc_cal_tbl * dc_cal_tbl_load(uint8_t *buf, size_t buf_len)
         ret->entries[i].dc_q = LE32_TO_HOST(ret->entries[i].dc_q);
     }
 
+    detect_uniform_grid(ret);
+
+    if (ret->f_inc != 0) {
+        log_verbose("DC cal table entries are indexed directly, "
+                    "with f_low=%u, f_inc=%u\n", ret->f_low, ret->f_inc);
+    }
+
     return ret;
 }
 
@@ -283,18 +342,35 @@ void dc_cal_tbl_free(struct dc_cal_tbl **tbl)
 
 #define ENTRY(f) { f, 0, 0 }
 
-#define TBL(entries, curr_idx) { \
-    entries != NULL ? sizeof(entries) / sizeof(entries[0]) : 0, \
-    curr_idx, entries \
+#define TBL(tbl_entries, idx, low, inc) { \
+    .n_entries = tbl_entries != NULL ? \
+                    sizeof(tbl_entries) / sizeof(tbl_entries[0]) : 0, \
+    .curr_idx = idx, .entries = tbl_entries, \
+    .f_low = low, .f_inc = inc \
 }
 
 #define TEST_CASE(exp_idx, entries, default_idx, freq) { \
-    TBL(entries, default_idx), \
+    TBL(entries, default_idx, 0, 0), \
     freq, \
     exp_idx, \
     exp_idx > -2,  \
 }
 
+/* Table entries on a uniform grid, indexed directly */
+#define TEST_CASE_UNIFORM(exp_idx, entries, f_low, f_inc, freq) { \
+    TBL(entries, 0, f_low, f_inc), \
+    freq, \
+    exp_idx, \
+    true,  \
+}
+
+/* Grid detection, where an exp_inc of 0 denotes a non-uniform table */
+#define GRID_TEST_CASE(entries, exp_low, exp_inc) { \
+    TBL(entries, 0, 0, 0), \
+    exp_low, \
+    exp_inc, \
+}
+
 
 struct dc_cal_entry unsorted_entries[] = {
     ENTRY(300e6), ENTRY(400e6), ENTRY(320e6),
@@ -307,6 +383,13 @@ struct dc_cal_entry three_entries[] = {
     ENTRY(300e6), ENTRY(1.5e9), ENTRY(2.4e9)
 };
 
+struct dc_cal_entry two_entries[] = { ENTRY(300e6), ENTRY(2.4e9) };
+
+struct dc_cal_entry off_grid_entries[] = {
+    ENTRY(300e6), ENTRY(400e6), ENTRY(500e6), ENTRY(650e6), ENTRY(700e6),
+    ENTRY(800e6),
+};
+
 struct dc_cal_entry entries[] = {
     ENTRY(300e6), ENTRY(400e6), ENTRY(500e6), ENTRY(600e6), ENTRY(700e6),
     ENTRY(800e6), ENTRY(900e6), ENTRY(1.0e9), ENTRY(1.1e9), ENTRY(1.2e9),
@@ -422,6 +505,32 @@ struct test {
     TEST_CASE(30, entries, 20, 3.35e9),
     TEST_CASE(30, entries, 30, 3.35e9),
     TEST_CASE(30, entries, 35, 3.35e9),
+
+    /* Uniform grid, limits */
+    TEST_CASE_UNIFORM(0, entries, 300e6, 100e6, 0),
+    TEST_CASE_UNIFORM(0, entries, 300e6, 100e6, 350e6),
+    TEST_CASE_UNIFORM(35, entries, 300e6, 100e6, 3.8e9),
+    TEST_CASE_UNIFORM(35, entries, 300e6, 100e6, 4e9),
+
+    /* Uniform grid, exact and approximate matches */
+    TEST_CASE_UNIFORM(4, entries, 300e6, 100e6, 700e6),
+    TEST_CASE_UNIFORM(4, entries, 300e6, 100e6, 701e6),
+    TEST_CASE_UNIFORM(12, entries, 300e6, 100e6, 1.5e9),
+    TEST_CASE_UNIFORM(12, entries, 300e6, 100e6, 1.59e9),
+    TEST_CASE_UNIFORM(30, entries, 300e6, 100e6, 3.35e9),
+};
+
+struct grid_test {
+    struct dc_cal_tbl tbl;
+    unsigned int expected_f_low;
+    unsigned int expected_f_inc;
+} grid_tests[] = {
+    GRID_TEST_CASE(entries, 300e6, 100e6),
+    GRID_TEST_CASE(two_entries, 300e6, 2.1e9),
+    GRID_TEST_CASE(off_grid_entries, 0, 0),
+    GRID_TEST_CASE(three_entries, 0, 0),
+    GRID_TEST_CASE(single_entry, 0, 0),
+    GRID_TEST_CASE(unsorted_entries, 0, 0),
 };
 
 static inline void print_entry(const struct dc_cal_tbl *t,
@@ -453,6 +562,25 @@ int main(void)
         }
     }
 
+    for (i = 0; i < sizeof(grid_tests) / sizeof(grid_tests[0]); i++) {
+        struct dc_cal_tbl *tbl = &grid_tests[i].tbl;
+
+        detect_uniform_grid(tbl);
+
+        if (tbl->f_low != grid_tests[i].expected_f_low ||
+            tbl->f_inc != grid_tests[i].expected_f_inc) {
+            fprintf(stderr, "Grid test case %u: failed.\n", i);
+            fprintf(stderr, "  Got: f_low=%u Hz, f_inc=%u Hz\n",
+                    tbl->f_low, tbl->f_inc);
+            fprintf(stderr, "  Expected: f_low=%u Hz, f_inc=%u Hz\n",
+                    grid_tests[i].expected_f_low,
+                    grid_tests[i].expected_f_inc);
+            num_failures++;
+        } else {
+            printf("Grid test case %u: passed.\n", i);
+        }
+    }
+
     return num_failures;
 }
 #endif
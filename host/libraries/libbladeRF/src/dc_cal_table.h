@@ -37,8 +37,18 @@ struct dc_cal_tbl {
     uint32_t n_entries;
     struct bladerf_lms_dc_cals reg_vals;
 
+    /* Index of the most recent match, used as the starting point when
+     * searching tables that are not on a uniform grid. Lookups are performed
+     * on const tables, so this is only accessed via ATOMIC_LOAD/STORE. */
     unsigned int curr_idx;
+
     struct dc_cal_entry *entries;  /* Sorted (increasing) by freq */
+
+    /* When entries[i].freq == f_low + i * f_inc for all entries, as is the
+     * case for tables generated by the CLI, entries are indexed directly.
+     * Otherwise, f_inc is 0 and the table is searched. */
+    unsigned int f_low;
+    unsigned int f_inc;
 };
 
 extern struct dc_cal_tbl rx_cal_test;
@@ -149,6 +149,7 @@ out:
 
 #if BLADERF_OS_LINUX || BLADERF_OS_OSX
 #define ACCESS_FILE_EXISTS F_OK
+#define MKDIR(path) mkdir(path, 0755)
 
 static const struct search_path_entries search_paths[] = {
     { true,  "/.config/Nuand/bladeRF/" },
@@ -171,7 +172,9 @@ static inline size_t get_install_dir(char *buf, size_t max_len){
 
 #elif BLADERF_OS_WINDOWS
 #define ACCESS_FILE_EXISTS 0
+#define MKDIR(path) _mkdir(path)
 #include <shlobj.h>
+#include <direct.h>
 
 static const struct search_path_entries search_paths[] = {
     { true,  "/Nuand/bladeRF/" },
@@ -342,3 +345,46 @@ int file_find_and_read(const char *filename, uint8_t **buf, size_t *size)
         return BLADERF_ERR_NO_FILE;
     }
 }
+
+char *file_config_path(const char *filename)
+{
+    size_t i, home_len;
+    char *full_path = (char*) calloc(1, PATH_MAX_LEN + 1);
+
+    if (full_path == NULL) {
+        return NULL;
+    }
+
+    /* The first search path is the per-user config directory */
+    assert(search_paths[0].prepend_home);
+
+    home_len = get_home_dir(full_path, PATH_MAX_LEN - 1);
+    if (home_len == 0) {
+        log_debug("Failed to determine home directory\n");
+        goto error;
+    }
+
+    strncat(full_path, search_paths[0].path, PATH_MAX_LEN - home_len);
+
+    /* Create each directory following the home directory, as needed */
+    for (i = home_len + 1; full_path[i] != '\0'; i++) {
+        if (full_path[i] == '/') {
+            full_path[i] = '\0';
+
+            if (MKDIR(full_path) != 0 && errno != EEXIST) {
+                log_debug("Failed to create %s: %s\n",
+                          full_path, strerror(errno));
+                goto error;
+            }
+
+            full_path[i] = '/';
+        }
+    }
+
+    strncat(full_path, filename, PATH_MAX_LEN - strlen(full_path));
+    return full_path;
+
+error:
+    free(full_path);
+    return NULL;
+}
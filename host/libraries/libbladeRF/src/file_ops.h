@@ -105,4 +105,15 @@ char *file_find(const char *filename);
  */
 int file_find_and_read(const char *filename, uint8_t **buf, size_t *size);
 
+/**
+ * Get the full path of a file in the per-user bladeRF config directory,
+ * creating the directory if it does not yet exist.
+ *
+ * @param   filename    Name of the file
+ *
+ * @return Full path on success, which must be freed by the caller, or NULL
+ *         on failure
+ */
+char *file_config_path(const char *filename);
+
 #endif
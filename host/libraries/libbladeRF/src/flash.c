@@ -23,6 +23,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 
 #include "libbladeRF.h"
 #include "bladerf_priv.h"
@@ -65,6 +67,14 @@ static inline int check_page_access(uint32_t page, uint32_t count)
     }
 }
 
+void flash_progress(struct bladerf *dev, bladerf_flash_op op,
+                    uint32_t done, uint32_t total)
+{
+    if (dev->flash_progress_cb != NULL) {
+        dev->flash_progress_cb(dev, op, done, total, dev->flash_progress_data);
+    }
+}
+
 int flash_erase(struct bladerf *dev, uint32_t erase_block, uint32_t count)
 {
     int status = check_eb_access(erase_block, count);
@@ -101,13 +111,13 @@ int flash_write(struct bladerf *dev, const uint8_t *buf,
 }
 
 static inline int verify_flash(struct bladerf *dev, uint8_t *readback_buf,
-                               uint8_t *image, uint32_t page, uint32_t count)
+                               const uint8_t *image, uint32_t page, uint32_t count)
 {
     int status = 0;
     size_t i;
     const size_t len = count * BLADERF_FLASH_PAGE_SIZE;
 
-    log_info("Verifying %u pages, starting at page %u\n", count, page);
+    log_verbose("Verifying %u pages, starting at page %u\n", count, page);
     status = flash_read(dev, readback_buf, page, count);
 
     if (status < 0) {
@@ -128,72 +138,140 @@ static inline int verify_flash(struct bladerf *dev, uint8_t *readback_buf,
     return status;
 }
 
-int flash_write_fx3_fw(struct bladerf *dev, uint8_t **image, size_t len)
+static inline bool page_is_erased(const uint8_t *page)
+{
+    size_t i;
+
+    for (i = 0; i < BLADERF_FLASH_PAGE_SIZE; i++) {
+        if (page[i] != 0xff) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Program `count` erase blocks of flash, starting at `erase_block`, such
+ * that they contain `image`, which must be count * BLADERF_FLASH_EB_SIZE bytes.
+ *
+ * Each erase block is read and compared against the image first. Only the
+ * erase blocks that differ are erased, have their non-blank pages rewritten,
+ * and are read back for verification. */
+static int flash_program_region(struct bladerf *dev, const uint8_t *image,
+                                uint32_t erase_block, uint32_t count)
 {
     int status;
+    uint32_t i, p, run;
+    uint32_t num_updated = 0;
     uint8_t *readback_buf;
-    uint8_t *padded_image;
-    uint32_t padded_image_len;
+    const uint32_t pages_per_eb = BLADERF_FLASH_TO_PAGES(BLADERF_FLASH_EB_SIZE);
 
-    /* Pad firwmare data out to a page size */
-    const uint32_t page_size = BLADERF_FLASH_PAGE_SIZE;
-    const uint32_t padding_len =
-        (len % page_size == 0) ? 0 : page_size - (len % page_size);
-
-    if (len >= (UINT32_MAX - padding_len)) {
-        return BLADERF_ERR_INVAL;
+    status = check_eb_access(erase_block, count);
+    if (status != 0) {
+        return status;
     }
 
-    padded_image_len = (uint32_t) len + padding_len;
-
-    readback_buf = (uint8_t*) malloc(padded_image_len);
+    readback_buf = (uint8_t *) malloc(BLADERF_FLASH_EB_SIZE);
     if (readback_buf == NULL) {
         return BLADERF_ERR_MEM;
     }
 
-    padded_image = (uint8_t *) realloc(*image, padded_image_len);
-    if (padded_image == NULL) {
-        status = BLADERF_ERR_MEM;
-        goto error;
-    }
+    for (i = 0; i < count; i++) {
+        const uint8_t *block = image + (size_t) i * BLADERF_FLASH_EB_SIZE;
+        const uint32_t page = (erase_block + i) * pages_per_eb;
 
-    *image = padded_image;
+        status = flash_read(dev, readback_buf, page, pages_per_eb);
+        if (status != 0) {
+            log_debug("Failed to read erase block %u: %s\n",
+                      erase_block + i, bladerf_strerror(status));
+            goto out;
+        }
 
-    /* Clear the padded region */
-    memset(padded_image + len, 0xFF, padded_image_len - len);
+        if (memcmp(readback_buf, block, BLADERF_FLASH_EB_SIZE) == 0) {
+            continue;
+        }
 
-    /* Erase the entire firmware region */
-    status = flash_erase(dev, BLADERF_FLASH_EB_FIRMWARE,
-                         BLADERF_FLASH_EB_LEN_FIRMWARE);
+        log_verbose("Updating erase block %u\n", erase_block + i);
+        num_updated++;
 
-    if (status != 0) {
-        log_debug("Failed to erase firmware region: %s\n",
-                  bladerf_strerror(status));
-        goto error;
+        status = flash_erase(dev, erase_block + i, 1);
+        if (status != 0) {
+            log_debug("Failed to erase block %u: %s\n",
+                      erase_block + i, bladerf_strerror(status));
+            goto out;
+        }
+
+        /* Write contiguous runs of non-blank pages. Blank pages are already
+         * in the desired state following the erase. */
+        for (p = 0; p < pages_per_eb; p += run) {
+            const uint8_t *data = block + p * BLADERF_FLASH_PAGE_SIZE;
+
+            if (page_is_erased(data)) {
+                run = 1;
+                continue;
+            }
+
+            for (run = 1; (p + run) < pages_per_eb; run++) {
+                if (page_is_erased(data + run * BLADERF_FLASH_PAGE_SIZE)) {
+                    break;
+                }
+            }
+
+            status = flash_write(dev, data, page + p, run);
+            if (status != 0) {
+                log_debug("Failed to write %u pages at page %u: %s\n",
+                          run, page + p, bladerf_strerror(status));
+                goto out;
+            }
+        }
+
+        /* Read back and double-check what we just wrote */
+        status = verify_flash(dev, readback_buf, block, page, pages_per_eb);
+        if (status != 0) {
+            log_debug("Flash verification failed: %s\n",
+                      bladerf_strerror(status));
+            goto out;
+        }
     }
 
-    /* Convert the image length to pages */
-    padded_image_len /= BLADERF_FLASH_PAGE_SIZE;
+    log_info("Updated %u of %u erase blocks, starting at block %u\n",
+             num_updated, count, erase_block);
 
-    /* Write the firmware image to flash */
-    status = flash_write(dev, padded_image,
-                         BLADERF_FLASH_PAGE_FIRMWARE, padded_image_len);
+out:
+    free(readback_buf);
+    return status;
+}
 
-    if (status < 0) {
-        log_debug("Failed to write firmware: %s\n", bladerf_strerror(status));
-        goto error;
+int flash_write_fx3_fw(struct bladerf *dev, uint8_t **image, size_t len)
+{
+    int status;
+    uint8_t *region;
+    const size_t region_len =
+        BLADERF_FLASH_EB_LEN_FIRMWARE * BLADERF_FLASH_EB_SIZE;
+
+    if (len > region_len) {
+        log_debug("Firmware image (%llu bytes) exceeds the firmware region.\n",
+                  (unsigned long long) len);
+        return BLADERF_ERR_INVAL;
     }
 
-    /* Read back and double-check what we just wrote */
-    status = verify_flash(dev, readback_buf, padded_image,
-                          BLADERF_FLASH_PAGE_FIRMWARE, padded_image_len);
+    /* The remainder of the firmware region is left erased */
+    region = (uint8_t *) malloc(region_len);
+    if (region == NULL) {
+        return BLADERF_ERR_MEM;
+    }
+
+    memset(region, 0xff, region_len);
+    memcpy(region, *image, len);
+
+    status = flash_program_region(dev, region, BLADERF_FLASH_EB_FIRMWARE,
+                                  BLADERF_FLASH_EB_LEN_FIRMWARE);
 
     if (status != 0) {
-        log_debug("Flash verification failed: %s\n", bladerf_strerror(status));
+        log_debug("Failed to write firmware: %s\n", bladerf_strerror(status));
     }
 
-error:
-    free(readback_buf);
+    free(region);
     return status;
 }
 
@@ -217,89 +295,38 @@ int flash_write_fpga_bitstream(struct bladerf *dev,
                                uint8_t **bitstream, size_t len)
 {
     int status;
-    uint8_t *readback_buf;
-    uint8_t *padded_bitstream;
-    uint8_t metadata[BLADERF_FLASH_PAGE_SIZE];
-    uint32_t padded_bitstream_len;
-
-    /* Pad data to be page-aligned */
-    const uint32_t page_size = BLADERF_FLASH_PAGE_SIZE;
-    const uint32_t padding_len =
-        (len % page_size == 0) ? 0 : page_size - (len % page_size);
-
-    if (len >= (UINT32_MAX - padding_len)) {
+    uint8_t *region;
+    const size_t region_len =
+        BLADERF_FLASH_EB_LEN_FPGA * BLADERF_FLASH_EB_SIZE;
+
+    /* The metadata page precedes the bitstream */
+    if (len > (region_len - BLADERF_FLASH_PAGE_SIZE)) {
+        log_debug("Bitstream (%llu bytes) exceeds the FPGA region.\n",
+                  (unsigned long long) len);
         return BLADERF_ERR_INVAL;
     }
 
-    padded_bitstream_len = (uint32_t) len + padding_len;
-
-    /* Fill in metadata with the *actual* FPGA bitstream length */
-    fill_fpga_metadata_page(metadata, len);
-
-    readback_buf = (uint8_t*) malloc(padded_bitstream_len);
-    if (readback_buf == NULL) {
+    /* The remainder of the FPGA region is left erased */
+    region = (uint8_t *) malloc(region_len);
+    if (region == NULL) {
         return BLADERF_ERR_MEM;
     }
 
-    padded_bitstream = (uint8_t*) realloc(*bitstream, padded_bitstream_len);
-    if (padded_bitstream == NULL) {
-        status = BLADERF_ERR_MEM;
-        goto error;
-    }
-
-    *bitstream = padded_bitstream;
+    memset(region, 0xff, region_len);
 
-    /* Clear the padded region */
-    memset(padded_bitstream + len, 0xFF, padded_bitstream_len - len);
-
-    /* Erase FPGA metadata and bitstream region */
-    status = flash_erase(dev, BLADERF_FLASH_EB_FPGA, BLADERF_FLASH_EB_LEN_FPGA);
-    if (status != 0) {
-        log_debug("Failed to erase FPGA meta & bitstream regions: %s\n",
-                  bladerf_strerror(status));
-        goto error;
-    }
-
-    /* Write the metadata page */
-    status = flash_write(dev, metadata, BLADERF_FLASH_PAGE_FPGA, 1);
-    if (status != 0) {
-        log_debug("Failed to write FPGA metadata page: %s\n",
-                  bladerf_strerror(status));
-        goto error;
-    }
-
-    /* Convert the padded bitstream length to pages */
-    padded_bitstream_len /= BLADERF_FLASH_PAGE_SIZE;
-
-    /* Write the padded bitstream */
-    status = flash_write(dev, padded_bitstream, BLADERF_FLASH_PAGE_FPGA + 1,
-                         padded_bitstream_len);
-    if (status != 0) {
-        log_debug("Failed to write bitstream: %s\n",
-                  bladerf_strerror(status));
-        goto error;
-    }
-
-    /* Read back and verify metadata */
-    status = verify_flash(dev, readback_buf, metadata,
-                          BLADERF_FLASH_PAGE_FPGA, 1);
-    if (status != 0) {
-        log_debug("Failed to verify metadata: %s\n", bladerf_strerror(status));
-        goto error;
-    }
+    /* Fill in metadata with the *actual* FPGA bitstream length */
+    fill_fpga_metadata_page(region, len);
+    memcpy(region + BLADERF_FLASH_PAGE_SIZE, *bitstream, len);
 
-    /* Read back and verify the bitstream data */
-    status = verify_flash(dev, readback_buf, padded_bitstream,
-                          BLADERF_FLASH_PAGE_FPGA + 1, padded_bitstream_len);
+    status = flash_program_region(dev, region, BLADERF_FLASH_EB_FPGA,
+                                  BLADERF_FLASH_EB_LEN_FPGA);
 
     if (status != 0) {
-        log_debug("Failed to verify bitstream data: %s\n",
+        log_debug("Failed to write FPGA metadata & bitstream: %s\n",
                   bladerf_strerror(status));
-        goto error;
     }
 
-error:
-    free(readback_buf);
+    free(region);
     return status;
 }
 
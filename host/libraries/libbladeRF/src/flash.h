@@ -85,6 +85,18 @@ uint32_t flash_pages_to_bytes(uint16_t page);
  */
 uint32_t flash_eb_to_bytes(unsigned int eb);
 
+/**
+ * Report the progress of a flash operation to the device's flash progress
+ * callback, if one is set. Backends call this with the control lock held.
+ *
+ * @param   dev     Device handle
+ * @param   op      Operation in progress
+ * @param   done    Number of erase blocks or pages completed
+ * @param   total   Total number of erase blocks or pages in the operation
+ */
+void flash_progress(struct bladerf *dev, bladerf_flash_op op,
+                    uint32_t done, uint32_t total);
+
 /**
  * Erase regions of SPI flash
  *
@@ -133,9 +145,11 @@ int flash_write(struct bladerf *dev, const uint8_t *buf,
  *
  * This function does no validation of the data (i.e., that it's valid FW).
  *
+ * Only the erase blocks whose contents differ from the image are erased,
+ * rewritten, and verified.
+ *
  * @param   dev             bladeRF handle
- * @param   image           Firmware image data. Buffer will be
- *                          realloc'd as needed to pad the image data.
+ * @param   image           Firmware image data
  * @param   len             Length of firmware to write, in bytes
  *
  * @return 0 on success, BLADERF_ERR_* value on failure
@@ -146,9 +160,11 @@ int flash_write_fx3_fw(struct bladerf *dev, uint8_t **image, size_t len);
  * Write the provided FPGA bitstream to flash and enable autoloading via
  * writing the associated metadata.
  *
+ * Only the erase blocks whose contents differ from the metadata and bitstream
+ * are erased, rewritten, and verified.
+ *
  * @param   dev             bladeRF handle
- * @param   bitstream       FPGA bitstream data. Buffer will be realloc'd as
- *                          needed to pad the image data.
+ * @param   bitstream       FPGA bitstream data
  * @param   len             Length of the bitstream data
  *
  * @return 0 on success, BLADERF_ERR_* value on failure
@@ -24,6 +24,7 @@
 #include "file_ops.h"
 #include "log.h"
 #include "flash.h"
+#include "fpga_cache.h"
 
 int fpga_check_version(struct bladerf *dev)
 {
@@ -70,6 +71,14 @@ int fpga_check_version(struct bladerf *dev)
     return status;
 }
 
+void fpga_load_progress(struct bladerf *dev, size_t done, size_t total)
+{
+    if (dev->fpga_load_progress_cb != NULL) {
+        dev->fpga_load_progress_cb(dev, done, total,
+                                   dev->fpga_load_progress_data);
+    }
+}
+
 static inline bool valid_fpga_size(size_t len)
 {
     if (len < (1 * 1024 * 1024)) {
@@ -81,10 +90,12 @@ static inline bool valid_fpga_size(size_t len)
     }
 }
 
-int fpga_load_from_file(struct bladerf *dev, const char *fpga_file)
+int fpga_load_from_file(struct bladerf *dev, const char *fpga_file,
+                        bool force)
 {
     uint8_t *buf = NULL;
     size_t  buf_size;
+    uint8_t digest[SHA256_DIGEST_SIZE];
     int status;
 
     /* TODO sanity check FPGA:
@@ -94,30 +105,44 @@ int fpga_load_from_file(struct bladerf *dev, const char *fpga_file)
      */
     status = file_read_buffer(fpga_file, &buf, &buf_size);
     if (status != 0) {
-        goto error;
+        goto out;
     }
 
     if (!valid_fpga_size(buf_size)) {
         status = BLADERF_ERR_INVAL;
-        goto error;
+        goto out;
     }
 
+    fpga_cache_digest(buf, buf_size, digest);
+
+    if (!force && fpga_cache_is_loaded(dev, digest)) {
+        log_info("FPGA is already configured with %s. Skipping load.\n",
+                 fpga_file);
+        goto out;
+    }
+
+    /* Forget the previous bitstream before the FPGA is reconfigured, in case
+     * the load fails part way through */
+    fpga_cache_update(dev, NULL);
+
     status = dev->fn->load_fpga(dev, buf, buf_size);
     if (status != 0) {
-        goto error;
+        goto out;
     }
 
     status = fpga_check_version(dev);
     if (status != 0) {
-        goto error;
+        goto out;
     }
 
     status = init_device(dev);
     if (status != 0) {
-        goto error;
+        goto out;
     }
 
-error:
+    fpga_cache_update(dev, digest);
+
+out:
     free(buf);
     return status;
 }
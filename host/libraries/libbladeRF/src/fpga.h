@@ -40,18 +40,33 @@
  */
 int fpga_check_version(struct bladerf *dev);
 
+/**
+ * Report the progress of an FPGA load to the device's FPGA load progress
+ * callback, if one is set. Backends call this with the control lock held.
+ *
+ * @param   dev     Device handle
+ * @param   done    Number of bitstream bytes sent to the device
+ * @param   total   Total number of bitstream bytes
+ */
+void fpga_load_progress(struct bladerf *dev, size_t done, size_t total);
+
 /**
  * Load an FPGA bitstream from the specified RBF
  *
+ * Unless `force` is set, the load is skipped if the FPGA is known to already
+ * be configured with the same bitstream. (See fpga_cache.h.)
+ *
  * @param   dev         Device handle
  * @param   fpga_file   Path to an RBF file
+ * @param   force       Load the bitstream even if it is already configured
  *
  * @return 0 on success,
  *         BLADERF_ERR_TIMEOUT generally occurs when attempting to load
  *              the wrong size FPGA image.
  *         BLADERF_ERR_* values on other failures
  */
-int fpga_load_from_file(struct bladerf *dev, const char *fpga_file);
+int fpga_load_from_file(struct bladerf *dev, const char *fpga_file,
+                        bool force);
 
 /**
  * Write an FPGA bitstream to the device's SPI flash. This will cause the
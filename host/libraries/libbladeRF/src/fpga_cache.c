@@ -0,0 +1,161 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "fpga_cache.h"
+#include "fpga.h"
+#include "file_ops.h"
+#include "log.h"
+
+#define CACHE_SUFFIX "_fpga.cache"
+
+/* Overrides the directory in which records are kept */
+#define CACHE_DIR_ENV "BLADERF_FPGA_CACHE_DIR"
+
+/* Hex string representation of a digest, with NUL terminator */
+#define DIGEST_STR_LEN (2 * SHA256_DIGEST_SIZE + 1)
+
+static char *cache_path(struct bladerf *dev)
+{
+    char filename[BLADERF_SERIAL_LENGTH + sizeof(CACHE_SUFFIX)];
+    const char *dir = getenv(CACHE_DIR_ENV);
+    char *path;
+    size_t len;
+
+    if (dev->ident.serial[0] == '\0') {
+        return NULL;
+    }
+
+    snprintf(filename, sizeof(filename), "%s" CACHE_SUFFIX, dev->ident.serial);
+
+    if (dir == NULL || dir[0] == '\0') {
+        return file_config_path(filename);
+    }
+
+    len = strlen(dir) + 1 + strlen(filename) + 1;
+    path = (char *) malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/%s", dir, filename);
+    }
+
+    return path;
+}
+
+static void digest_to_str(const uint8_t digest[SHA256_DIGEST_SIZE],
+                          char str[DIGEST_STR_LEN])
+{
+    size_t i;
+
+    for (i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        sprintf(&str[2 * i], "%02x", digest[i]);
+    }
+}
+
+void fpga_cache_digest(const uint8_t *image, size_t len,
+                       uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    SHA256_CTX ctx;
+
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, image, len);
+    SHA256_Final(digest, &ctx);
+}
+
+bool fpga_cache_is_loaded(struct bladerf *dev,
+                          const uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    FILE *f;
+    char *path;
+    char expected[DIGEST_STR_LEN];
+    char recorded[DIGEST_STR_LEN];
+    unsigned int major, minor, patch, bus, addr;
+    int n;
+
+    if (FPGA_IS_CONFIGURED(dev) != 1) {
+        return false;
+    }
+
+    path = cache_path(dev);
+    if (path == NULL) {
+        return false;
+    }
+
+    f = fopen(path, "r");
+    free(path);
+
+    if (f == NULL) {
+        return false;
+    }
+
+    n = fscanf(f, "%64s %u.%u.%u %u %u",
+               recorded, &major, &minor, &patch, &bus, &addr);
+    fclose(f);
+
+    if (n != 6) {
+        log_debug("Ignoring malformed FPGA cache record\n");
+        return false;
+    }
+
+    digest_to_str(digest, expected);
+
+    return strcmp(expected, recorded) == 0 &&
+           major == dev->fpga_version.major &&
+           minor == dev->fpga_version.minor &&
+           patch == dev->fpga_version.patch &&
+           bus == dev->ident.usb_bus &&
+           addr == dev->ident.usb_addr;
+}
+
+void fpga_cache_update(struct bladerf *dev,
+                       const uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    FILE *f;
+    char *path;
+    char str[DIGEST_STR_LEN];
+
+    path = cache_path(dev);
+    if (path == NULL) {
+        return;
+    }
+
+    if (digest == NULL) {
+        if (remove(path) != 0 && errno != ENOENT) {
+            log_debug("Failed to remove %s: %s\n", path, strerror(errno));
+        }
+    } else {
+        f = fopen(path, "w");
+        if (f != NULL) {
+            digest_to_str(digest, str);
+            fprintf(f, "%s %u.%u.%u %u %u\n", str,
+                    dev->fpga_version.major, dev->fpga_version.minor,
+                    dev->fpga_version.patch,
+                    dev->ident.usb_bus, dev->ident.usb_addr);
+            fclose(f);
+        } else {
+            log_debug("Failed to open %s: %s\n", path, strerror(errno));
+        }
+    }
+
+    free(path);
+}
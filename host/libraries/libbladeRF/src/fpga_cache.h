@@ -0,0 +1,76 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_FPGA_CACHE_H_
+#define BLADERF_FPGA_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bladerf_priv.h"
+#include "sha256.h"
+
+/*
+ * The FPGA configuration persists across processes, so the SHA-256 digest of
+ * the last bitstream the library loaded is recorded per serial number in the
+ * user's bladeRF config directory, along with the FPGA version it reported and
+ * the USB bus and address the device was attached at. A power cycle or
+ * re-enumeration changes the USB address, which invalidates the record.
+ *
+ * If the BLADERF_FPGA_CACHE_DIR environment variable is set, records are kept
+ * in the (existing) directory it names instead.
+ */
+
+/**
+ * Compute the fingerprint of an FPGA bitstream
+ *
+ * @param[in]   image       Bitstream data
+ * @param[in]   len         Length of `image`, in bytes
+ * @param[out]  digest      SHA-256 digest of the bitstream
+ */
+void fpga_cache_digest(const uint8_t *image, size_t len,
+                       uint8_t digest[SHA256_DIGEST_SIZE]);
+
+/**
+ * Test whether the device's FPGA is known to be configured with the bitstream
+ * having the specified fingerprint.
+ *
+ * @param   dev         Device handle
+ * @param   digest      Bitstream fingerprint
+ *
+ * @return true if the bitstream is known to be loaded, false otherwise
+ */
+bool fpga_cache_is_loaded(struct bladerf *dev,
+                          const uint8_t digest[SHA256_DIGEST_SIZE]);
+
+/**
+ * Record the fingerprint of the bitstream that was just loaded, or remove the
+ * record prior to (re)configuring the FPGA. Failures are logged, but
+ * otherwise ignored, as they only result in subsequent loads not being
+ * skipped.
+ *
+ * @param   dev         Device handle
+ * @param   digest      Fingerprint of the loaded bitstream, or NULL to remove
+ *                      the record
+ */
+void fpga_cache_update(struct bladerf *dev,
+                       const uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#endif
@@ -39,6 +39,8 @@
  *  http://www.limemicro.com/download/FAQ_v1.0r10.pdf
  *
  */
+#include <stdlib.h>
+#include <string.h>
 #include <libbladeRF.h>
 #include "lms.h"
 #include "bladerf_priv.h"
@@ -222,6 +224,212 @@ static const uint8_t lms_reg_dumpset[] = {
 #define LOOPBBEN_ENVPK  (3 << 2)
 #define LOOBBBEN_MASK   (3 << 2)
 
+/* Registers that the LMS6002D (or something other than lms.c) may modify,
+ * and which are therefore never served from the shadow:
+ *  - The DC calibration blocks' result, status, count and control registers.
+ *    These are at 0x00 (LPF tuning), 0x30 (TX LPF), 0x50 (RX LPF),
+ *    and 0x60 (RX VGA2).
+ *  - The TX and RX PLLs' VTUNE comparators.
+ *  - The TX and RX DC offset corrections, which backends write directly
+ *    in their set_correction() implementations. */
+static inline bool lms_reg_is_volatile(uint8_t addr)
+{
+    const uint8_t block = addr & 0xf0;
+
+    if (addr >= LMS_NUM_REGS) {
+        return true;
+    }
+
+    if ((addr & 0x0f) <= 0x03 &&
+        (block == 0x00 || block == 0x30 || block == 0x50 || block == 0x60)) {
+        return true;
+    }
+
+    switch (addr) {
+        case 0x1a:
+        case 0x2a:
+        case 0x42:
+        case 0x43:
+        case 0x71:
+        case 0x72:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static inline void shadow_invalidate(struct lms_shadow *s)
+{
+    memset(s->valid, 0, sizeof(s->valid));
+}
+
+/* Record a register's value. If `readback` is true, the value was read
+ * from the device and is checked against the cached value in verify mode. */
+static inline void shadow_fill(struct lms_shadow *s, uint8_t addr, uint8_t val,
+                               bool readback)
+{
+    if (!s->enabled || lms_reg_is_volatile(addr)) {
+        return;
+    }
+
+    if (readback && s->verify && s->valid[addr] && s->regs[addr] != val) {
+        log_warning("LMS shadow mismatch @ 0x%02x: cached=0x%02x, "
+                    "device=0x%02x\n", addr, s->regs[addr], val);
+    }
+
+    s->regs[addr] = val;
+    s->valid[addr] = true;
+}
+
+/* Record a value written to the device */
+static inline void shadow_store(struct lms_shadow *s, uint8_t addr,
+                                uint8_t val, bool success)
+{
+    if (addr >= LMS_NUM_REGS) {
+        return;
+    }
+
+    /* Clearing SRESET resets the entire register file to its defaults */
+    if (addr == 0x05 && (!success || (val & (1 << 5)) == 0)) {
+        shadow_invalidate(s);
+    } else if (!success) {
+        /* The device's value is unknown if the write may have failed */
+        s->valid[addr] = false;
+    } else {
+        shadow_fill(s, addr, val, false);
+    }
+}
+
+static inline bool shadow_hit(const struct lms_shadow *s, uint8_t addr)
+{
+    return s->enabled && !s->verify &&
+           !lms_reg_is_volatile(addr) && s->valid[addr];
+}
+
+void lms_shadow_init(struct bladerf *dev)
+{
+    struct lms_shadow *s = &dev->lms_shadow;
+    const char *env = getenv("BLADERF_LMS_SHADOW");
+
+    shadow_invalidate(s);
+    s->enabled = true;
+    s->verify = false;
+
+    if (env != NULL) {
+        if (!strcasecmp(env, "off")) {
+            s->enabled = false;
+        } else if (!strcasecmp(env, "verify")) {
+            s->verify = true;
+        } else {
+            log_warning("Ignoring invalid BLADERF_LMS_SHADOW value: %s\n", env);
+        }
+
+        log_debug("LMS register shadow: %s\n", env);
+    }
+}
+
+int lms_shadow_load(struct bladerf *dev)
+{
+    struct lms_shadow *s = &dev->lms_shadow;
+    struct backend_reg regs[LMS_NUM_REGS];
+    size_t i;
+    int status;
+
+    shadow_invalidate(s);
+
+    if (!s->enabled) {
+        return 0;
+    }
+
+    for (i = 0; i < LMS_NUM_REGS; i++) {
+        regs[i].addr = (uint8_t) i;
+    }
+
+    status = dev->fn->lms_read_batch(dev, regs, LMS_NUM_REGS);
+    if (status != 0) {
+        log_debug("Failed to load LMS register shadow: %s\n",
+                  bladerf_strerror(status));
+        return status;
+    }
+
+    for (i = 0; i < LMS_NUM_REGS; i++) {
+        shadow_fill(s, regs[i].addr, regs[i].data, true);
+    }
+
+    return 0;
+}
+
+int lms_read(struct bladerf *dev, uint8_t addr, uint8_t *data)
+{
+    struct lms_shadow *s = &dev->lms_shadow;
+    int status;
+
+    if (shadow_hit(s, addr)) {
+        *data = s->regs[addr];
+        return 0;
+    }
+
+    status = dev->fn->lms_read(dev, addr, data);
+    if (status == 0) {
+        shadow_fill(s, addr, *data, true);
+    }
+
+    return status;
+}
+
+int lms_write(struct bladerf *dev, uint8_t addr, uint8_t data)
+{
+    int status = dev->fn->lms_write(dev, addr, data);
+    shadow_store(&dev->lms_shadow, addr, data, status == 0);
+    return status;
+}
+
+int lms_read_batch(struct bladerf *dev, struct backend_reg *regs, size_t n)
+{
+    struct lms_shadow *s = &dev->lms_shadow;
+    size_t i;
+    int status;
+
+    for (i = 0; i < n; i++) {
+        if (!shadow_hit(s, regs[i].addr)) {
+            break;
+        }
+    }
+
+    if (i == n) {
+        for (i = 0; i < n; i++) {
+            regs[i].data = s->regs[regs[i].addr];
+        }
+        return 0;
+    }
+
+    /* Reading all of the registers costs no more than reading only the
+     * misses, so long as they fit in the same number of transactions */
+    status = dev->fn->lms_read_batch(dev, regs, n);
+    if (status == 0) {
+        for (i = 0; i < n; i++) {
+            shadow_fill(s, regs[i].addr, regs[i].data, true);
+        }
+    }
+
+    return status;
+}
+
+int lms_write_batch(struct bladerf *dev,
+                    const struct backend_reg *regs, size_t n)
+{
+    size_t i;
+    int status = dev->fn->lms_write_batch(dev, regs, n);
+
+    for (i = 0; i < n; i++) {
+        shadow_store(&dev->lms_shadow, regs[i].addr, regs[i].data,
+                     status == 0);
+    }
+
+    return status;
+}
+
 static inline int lms_set(struct bladerf *dev, uint8_t addr, uint8_t mask)
 {
     int status;
@@ -266,24 +474,13 @@ static inline int is_loopback_enabled(struct bladerf *dev)
     return loopback != BLADERF_LB_NONE;
 }
 
-static int write_pll_config(struct bladerf *dev, bladerf_module module,
-                                     uint32_t frequency, uint8_t freqsel)
+/* Update the provided PLL configuration register value (0x15 or 0x25) for
+ * the specified band and freqsel value */
+static int update_pll_config(struct bladerf *dev, bool low_band,
+                             uint8_t freqsel, uint8_t *regval)
 {
     int status;
-    uint8_t regval;
     uint8_t selout;
-    uint8_t addr;
-
-    if (module == BLADERF_MODULE_TX) {
-        addr = 0x15;
-    } else {
-        addr = 0x25;
-    }
-
-    status = LMS_READ(dev, addr, &regval);
-    if (status != 0) {
-        return status;
-    }
 
     status = is_loopback_enabled(dev);
     if (status < 0) {
@@ -292,14 +489,14 @@ static int write_pll_config(struct bladerf *dev, bladerf_module module,
 
     if (status == 0) {
         /* Loopback not enabled - update the PLL output buffer. */
-        selout = (frequency < BLADERF_BAND_HIGH ? 1 : 2);
-        regval = (freqsel << 2) | selout;
+        selout = (low_band ? 1 : 2);
+        *regval = (freqsel << 2) | selout;
     } else {
         /* Loopback is enabled - don't touch PLL output buffer. */
-        regval = (regval & ~0xfc) | (freqsel << 2);
+        *regval = (*regval & ~0xfc) | (freqsel << 2);
     }
 
-    return LMS_WRITE(dev, addr, regval);
+    return 0;
 }
 
 
@@ -1522,6 +1719,7 @@ int lms_get_frequency(struct bladerf *dev, bladerf_module mod,
 #define VCO_HIGH 0x02
 #define VCO_NORM 0x00
 #define VCO_LOW 0x01
+/* `data` is the current value of the VCOCAP register, base + 9 */
 static inline int tune_vcocap(struct bladerf *dev, uint8_t base, uint8_t data)
 {
     int start_i = -1, stop_i = -1;
@@ -1531,11 +1729,6 @@ static inline int tune_vcocap(struct bladerf *dev, uint8_t base, uint8_t data)
     uint8_t vtune;
     int status;
 
-    status = LMS_READ(dev, base + 9, &data);
-    if (status != 0) {
-        return status;
-    }
-
     data &= ~(0x3f);
     for (i = 0; i < 6; i++) {
         status = LMS_WRITE(dev, base + 9, vcocap | data);
@@ -1648,6 +1841,87 @@ static inline int tune_vcocap(struct bladerf *dev, uint8_t base, uint8_t data)
     return status;
 }
 
+/* Write the frequency configuration of a module's PLL, turning on the DSMs.
+ * The VCOCAP register is only written if `vcocap` is non-negative.
+ *
+ * On success, `dsm` is set to the DSM register value prior to this call, and
+ * must be used to turn the DSMs back off once the caller is done with the PLL.
+ * `vcocap_reg` is set to the current VCOCAP register value. */
+static int write_pll(struct bladerf *dev, bladerf_module mod,
+                     const struct lms_freq *f, bool low_band, int vcocap,
+                     uint8_t *dsm, uint8_t *vcocap_reg)
+{
+    const uint8_t base = (mod == BLADERF_MODULE_RX) ? 0x20 : 0x10;
+    struct backend_reg regs[10];
+    size_t n = 9;
+    int status;
+
+    /* Read back all of the registers we'll be modifying in one go:
+     * DSM control, PLL output buffer, charge pump currents, and VCOCAP */
+    regs[0].addr = 0x09;
+    regs[1].addr = base + 5;
+    regs[2].addr = base + 6;
+    regs[3].addr = base + 7;
+    regs[4].addr = base + 8;
+    regs[5].addr = base + 9;
+
+    status = LMS_READ_BATCH(dev, regs, 6);
+    if (status != 0) {
+        log_debug("Failed to read PLL configuration\n");
+        return status;
+    }
+
+    *dsm = regs[0].data;
+    *vcocap_reg = regs[5].data;
+
+    /* Turn on the DSMs */
+    regs[0].data = *dsm | 0x05;
+
+    /* Select the VCO and PLL output buffer */
+    status = update_pll_config(dev, low_band, f->freqsel, &regs[1].data);
+    if (status != 0) {
+        return status;
+    }
+
+    /* Set the PLL Ichp, Iup and Idn currents */
+    regs[6].addr = base + 6;
+    regs[6].data = (regs[2].data & ~0x1f) | 0x0c;
+
+    regs[7].addr = base + 7;
+    regs[7].data = regs[3].data & ~0x1f;
+
+    regs[8].addr = base + 8;
+    regs[8].data = regs[4].data & ~0x1f;
+
+    /* Integer and fractional portions of the frequency */
+    regs[2].addr = base + 0;
+    regs[2].data = f->nint >> 1;
+
+    regs[3].addr = base + 1;
+    regs[3].data = ((f->nint & 1) << 7) | ((f->nfrac >> 16) & 0x7f);
+
+    regs[4].addr = base + 2;
+    regs[4].data = ((f->nfrac >> 8) & 0xff);
+
+    regs[5].addr = base + 3;
+    regs[5].data = (f->nfrac & 0xff);
+
+    if (vcocap >= 0) {
+        *vcocap_reg = (*vcocap_reg & ~0x3f) | (vcocap & 0x3f);
+        regs[n].addr = base + 9;
+        regs[n].data = *vcocap_reg;
+        n++;
+    }
+
+    status = LMS_WRITE_BATCH(dev, regs, n);
+    if (status != 0) {
+        /* Turn off the DSMs */
+        LMS_WRITE(dev, 0x09, *dsm & ~0x05);
+    }
+
+    return status;
+}
+
 /* Set the frequency of a module */
 int lms_set_frequency(struct bladerf *dev, bladerf_module mod, uint32_t freq)
 {
@@ -1658,7 +1932,7 @@ int lms_set_frequency(struct bladerf *dev, bladerf_module mod, uint32_t freq)
     uint16_t nint;
     uint32_t nfrac;
     struct lms_freq f;
-    uint8_t data;
+    uint8_t dsm, vcocap;
     uint64_t vco_x;
     uint64_t temp;
     int status, dsm_status;
@@ -1704,96 +1978,82 @@ int lms_set_frequency(struct bladerf *dev, bladerf_module mod, uint32_t freq)
     f.reference = (uint32_t)ref_clock;
     lms_print_frequency(&f);
 
-    /* Turn on the DSMs */
-    status = LMS_READ(dev, 0x09, &data);
-    if (status == 0) {
-        data |= 0x05;
-        status = LMS_WRITE(dev, 0x09, data);
-    }
-
+    status = write_pll(dev, mod, &f, freq < BLADERF_BAND_HIGH, -1,
+                       &dsm, &vcocap);
     if (status != 0) {
-        log_debug("Failed to turn on DSMs\n");
         return status;
     }
 
-    status = write_pll_config(dev, mod, freq, freqsel);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+    /* Loop through the VCOCAP to figure out optimal values */
+    status = tune_vcocap(dev, base, vcocap);
 
-    data = nint >> 1;
-    status = LMS_WRITE(dev, base + 0, data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+    /* Turn off the DSMs */
+    dsm_status = LMS_WRITE(dev, 0x09, dsm & ~0x05);
 
-    data = ((nint & 1) << 7) | ((nfrac >> 16) & 0x7f);
-    status = LMS_WRITE(dev, base + 1, data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+    return (status == 0) ? dsm_status : status;
+}
 
-    data = ((nfrac >> 8) & 0xff);
-    status = LMS_WRITE(dev, base + 2, data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+int lms_get_quick_tune(struct bladerf *dev, bladerf_module mod,
+                       struct bladerf_quick_tune *quick_tune)
+{
+    const uint8_t base = (mod == BLADERF_MODULE_RX) ? 0x20 : 0x10;
+    struct lms_freq f;
+    uint8_t vcocap;
+    int status;
 
-    data = (nfrac & 0xff);
-    status = LMS_WRITE(dev, base + 3, data);
+    status = lms_get_frequency(dev, mod, &f);
     if (status != 0) {
-        goto lms_set_frequency_error;
+        return status;
     }
 
-    /* Set the PLL Ichp, Iup and Idn currents */
-    status = LMS_READ(dev, base + 6, &data);
+    status = LMS_READ(dev, base + 9, &vcocap);
     if (status != 0) {
-        goto lms_set_frequency_error;
+        return status;
     }
 
-    data &= ~(0x1f);
-    data |= 0x0c;
-
-    status = LMS_WRITE(dev, base + 6, data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+    quick_tune->frequency = lms_frequency_to_hz(&f);
+    quick_tune->module = mod;
+    quick_tune->freqsel = f.freqsel;
+    quick_tune->vcocap = vcocap & 0x3f;
+    quick_tune->nint = f.nint;
+    quick_tune->nfrac = f.nfrac;
 
-    status = LMS_READ(dev, base + 7, &data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+    return 0;
+}
 
-    data &= ~(0x1f);
-    // data |= 3;
+int lms_set_quick_tune(struct bladerf *dev,
+                       const struct bladerf_quick_tune *quick_tune)
+{
+    const bladerf_module mod = quick_tune->module;
+    const uint8_t base = (mod == BLADERF_MODULE_RX) ? 0x20 : 0x10;
+    const bool low_band =
+        (quick_tune->flags & BLADERF_QUICK_TUNE_FLAG_HIGH_BAND) == 0;
+    struct lms_freq f;
+    uint8_t dsm, vcocap, vtune;
+    int status, dsm_status;
 
-    status = LMS_WRITE(dev, base + 7, data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
-    }
+    f.freqsel = quick_tune->freqsel;
+    f.nint = quick_tune->nint;
+    f.nfrac = quick_tune->nfrac;
 
-    status = LMS_READ(dev, base + 8, &data);
+    status = write_pll(dev, mod, &f, low_band, quick_tune->vcocap,
+                       &dsm, &vcocap);
     if (status != 0) {
-        goto lms_set_frequency_error;
+        return status;
     }
 
-    data &= ~(0x1f);
-    // data |= 3;
-    status = LMS_WRITE(dev, base + 8, data);
-    if (status != 0) {
-        goto lms_set_frequency_error;
+    /* The VCOCAP value may no longer be ideal if the device's temperature
+     * has changed significantly since it was captured. Fall back to a
+     * search if the VCO is not locked. */
+    status = LMS_READ(dev, base + 10, &vtune);
+    if (status == 0 && (vtune >> 6) != VCO_NORM) {
+        log_debug("VTUNE not locked at quick tune VCOCAP=%u. Searching...\n",
+                  quick_tune->vcocap);
+        status = tune_vcocap(dev, base, vcocap);
     }
 
-    /* Loop through the VCOCAP to figure out optimal values */
-    status = tune_vcocap(dev, base, data);
-
-lms_set_frequency_error:
     /* Turn off the DSMs */
-    dsm_status = LMS_READ(dev, 0x09, &data);
-    if (dsm_status == 0) {
-        data &= ~(0x05);
-        dsm_status = LMS_WRITE(dev, 0x09, data);
-    }
+    dsm_status = LMS_WRITE(dev, 0x09, dsm & ~0x05);
 
     return (status == 0) ? dsm_status : status;
 }
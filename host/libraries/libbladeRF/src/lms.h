@@ -28,9 +28,83 @@
 #include <libbladeRF.h>
 #include "bladerf_priv.h"
 
-#define LMS_WRITE(dev, addr, value) dev->fn->lms_write(dev, addr, value)
-#define LMS_READ(dev, addr, value)  dev->fn->lms_read(dev, addr, value)
+/* Register accesses go through the host-side register shadow. See
+ * lms_read() and lms_write(). */
+#define LMS_WRITE(dev, addr, value) lms_write(dev, addr, value)
+#define LMS_READ(dev, addr, value)  lms_read(dev, addr, value)
 
+/* Perform a sequence of register writes or reads (of struct backend_reg),
+ * in as few transactions with the device as possible */
+#define LMS_WRITE_BATCH(dev, regs, n)   lms_write_batch(dev, regs, n)
+#define LMS_READ_BATCH(dev, regs, n)    lms_read_batch(dev, regs, n)
+
+
+/**
+ * Initialize the LMS6002D register shadow, invalidating its contents.
+ *
+ * The shadow is enabled by default. The BLADERF_LMS_SHADOW environment
+ * variable may be set to "off" to disable it, or to "verify" to read registers
+ * from the device regardless and log a warning if the cached value differs.
+ *
+ * @param   dev         Device handle
+ */
+void lms_shadow_init(struct bladerf *dev);
+
+/**
+ * Read all LMS6002D registers into the shadow, if it is enabled
+ *
+ * @param   dev         Device handle
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_shadow_load(struct bladerf *dev);
+
+/**
+ * Read an LMS6002D register. Registers whose values may only be changed by
+ * the host are served from the shadow, when possible.
+ *
+ * @param[in]   dev     Device handle
+ * @param[in]   addr    Register address
+ * @param[out]  data    Register value
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_read(struct bladerf *dev, uint8_t addr, uint8_t *data);
+
+/**
+ * Write an LMS6002D register, updating the shadow
+ *
+ * @param   dev         Device handle
+ * @param   addr        Register address
+ * @param   data        Register value
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_write(struct bladerf *dev, uint8_t addr, uint8_t data);
+
+/**
+ * Batched equivalent of lms_read(). The device is only accessed if one or
+ * more of the registers cannot be served from the shadow.
+ *
+ * @param       dev     Device handle
+ * @param[in]   regs    Register addresses. Values are filled in on success.
+ * @param       n       Number of entries in `regs`
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_read_batch(struct bladerf *dev, struct backend_reg *regs, size_t n);
+
+/**
+ * Batched equivalent of lms_write()
+ *
+ * @param   dev         Device handle
+ * @param   regs        Register addresses and values, written in order
+ * @param   n           Number of entries in `regs`
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_write_batch(struct bladerf *dev,
+                    const struct backend_reg *regs, size_t n);
 
 /**
  * Information about the frequency calculation for the LMS6002D PLL
@@ -514,6 +588,31 @@ int lms_get_frequency(struct bladerf *dev, bladerf_module mod,
 int lms_set_frequency(struct bladerf *dev,
                       bladerf_module mod, uint32_t freq);
 
+/**
+ * Read the PLL configuration of a module into the provided quick tune
+ * structure. The `flags` field is not modified.
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   mod         Module to query
+ * @param[out]  quick_tune  Quick tune parameters
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_get_quick_tune(struct bladerf *dev, bladerf_module mod,
+                       struct bladerf_quick_tune *quick_tune);
+
+/**
+ * Apply previously captured PLL configuration to the module specified in
+ * `quick_tune`, without a VCOCAP search (unless the VCO fails to lock).
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   quick_tune  Quick tune parameters
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int lms_set_quick_tune(struct bladerf *dev,
+                       const struct bladerf_quick_tune *quick_tune);
+
 /**
  * Read back every register from the LMS6002D device.
  *
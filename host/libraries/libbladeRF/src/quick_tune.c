@@ -0,0 +1,186 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Quick tune profiles are stored as plain text, one entry per line:
+ *
+ *   <module>,<frequency>,<freqsel>,<vcocap>,<nint>,<nfrac>,<flags>
+ *
+ * where <module> is "rx" or "tx" and the remaining fields are unsigned
+ * decimal values. Blank lines and lines beginning with '#' are ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libbladeRF.h"
+#include "host_config.h"
+#include "log.h"
+
+#define QUICK_TUNE_HEADER \
+    "# bladeRF quick tune profile\n" \
+    "# module,frequency,freqsel,vcocap,nint,nfrac,flags\n"
+
+#define LINE_MAX_LEN 128
+
+int bladerf_save_quick_tune_profile(const char *filename,
+                                    const struct bladerf_quick_tune *profile,
+                                    unsigned int count)
+{
+    FILE *f;
+    unsigned int i;
+    int status = 0;
+
+    f = fopen(filename, "w");
+    if (f == NULL) {
+        log_debug("Failed to open %s: %s\n", filename, strerror(errno));
+        return BLADERF_ERR_IO;
+    }
+
+    if (fputs(QUICK_TUNE_HEADER, f) < 0) {
+        status = BLADERF_ERR_IO;
+    }
+
+    for (i = 0; i < count && status == 0; i++) {
+        const struct bladerf_quick_tune *qt = &profile[i];
+
+        if (qt->module != BLADERF_MODULE_RX &&
+            qt->module != BLADERF_MODULE_TX) {
+            log_debug("Invalid module in quick tune entry %u\n", i);
+            status = BLADERF_ERR_INVAL;
+            break;
+        }
+
+        if (fprintf(f, "%s,%u,%u,%u,%u,%u,%u\n",
+                    qt->module == BLADERF_MODULE_RX ? "rx" : "tx",
+                    qt->frequency, qt->freqsel, qt->vcocap,
+                    qt->nint, qt->nfrac, qt->flags) < 0) {
+            status = BLADERF_ERR_IO;
+        }
+    }
+
+    if (fclose(f) != 0 && status == 0) {
+        status = BLADERF_ERR_IO;
+    }
+
+    return status;
+}
+
+static int parse_entry(const char *line, struct bladerf_quick_tune *qt)
+{
+    char module[3];
+    unsigned int frequency, freqsel, vcocap, nint, nfrac, flags;
+
+    if (sscanf(line, "%2[^,],%u,%u,%u,%u,%u,%u",
+               module, &frequency, &freqsel, &vcocap,
+               &nint, &nfrac, &flags) != 7) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (!strcasecmp(module, "rx")) {
+        qt->module = BLADERF_MODULE_RX;
+    } else if (!strcasecmp(module, "tx")) {
+        qt->module = BLADERF_MODULE_TX;
+    } else {
+        return BLADERF_ERR_INVAL;
+    }
+
+    if (freqsel > 0x3f || vcocap > 0x3f || nint > UINT16_MAX ||
+        nfrac >= (1 << 23) || flags > UINT8_MAX) {
+        return BLADERF_ERR_INVAL;
+    }
+
+    qt->frequency = frequency;
+    qt->freqsel = (uint8_t) freqsel;
+    qt->vcocap = (uint8_t) vcocap;
+    qt->nint = (uint16_t) nint;
+    qt->nfrac = nfrac;
+    qt->flags = (uint8_t) flags;
+
+    return 0;
+}
+
+int bladerf_load_quick_tune_profile(const char *filename,
+                                    struct bladerf_quick_tune **profile,
+                                    unsigned int *count)
+{
+    FILE *f;
+    char line[LINE_MAX_LEN];
+    unsigned int line_num = 0;
+    unsigned int n = 0, n_alloc = 0;
+    struct bladerf_quick_tune *entries = NULL, *tmp;
+    int status = 0;
+
+    f = fopen(filename, "r");
+    if (f == NULL) {
+        log_debug("Failed to open %s: %s\n", filename, strerror(errno));
+        return BLADERF_ERR_IO;
+    }
+
+    while (status == 0 && fgets(line, sizeof(line), f) != NULL) {
+        line_num++;
+
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        if (n == n_alloc) {
+            n_alloc = (n_alloc == 0) ? 16 : (2 * n_alloc);
+            tmp = realloc(entries, n_alloc * sizeof(entries[0]));
+            if (tmp == NULL) {
+                status = BLADERF_ERR_MEM;
+                break;
+            }
+
+            entries = tmp;
+        }
+
+        status = parse_entry(line, &entries[n]);
+        if (status != 0) {
+            log_debug("Invalid quick tune entry on line %u of %s\n",
+                      line_num, filename);
+        } else {
+            n++;
+        }
+    }
+
+    if (status == 0 && ferror(f)) {
+        status = BLADERF_ERR_IO;
+    }
+
+    fclose(f);
+
+    if (status == 0) {
+        *profile = entries;
+        *count = n;
+    } else {
+        free(entries);
+    }
+
+    return status;
+}
+
+void bladerf_free_quick_tune_profile(struct bladerf_quick_tune *profile)
+{
+    free(profile);
+}
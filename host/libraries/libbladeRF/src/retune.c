@@ -0,0 +1,206 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "libbladeRF.h"
+#include "bladerf_priv.h"
+#include "retune.h"
+#include "tuning.h"
+#include "si5338.h"
+#include "log.h"
+
+/* Wake up this long before a retune's timestamp is expected to arrive, and
+ * poll the sample counter from there on. This should comfortably exceed the
+ * host's scheduling latency and a timestamp query's USB round trip. */
+#define RETUNE_WAKE_EARLY_US    2000
+
+/* Upper bound on any single sleep, such that sample rate changes and stalled
+ * counters are noticed in a reasonable amount of time */
+#define RETUNE_MAX_SLEEP_US     100000
+
+static inline int read_counter(struct bladerf *dev, bladerf_module module,
+                               uint64_t *timestamp)
+{
+    int status;
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+    status = read_timestamp(dev, module, timestamp);
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    return status;
+}
+
+static inline uint64_t elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    int64_t ms;
+
+    if (clock_gettime(CLOCK_REALTIME, &now) != 0) {
+        return 0;
+    }
+
+    ms = ((int64_t) now.tv_sec - start->tv_sec) * 1000 +
+         ((int64_t) now.tv_nsec - start->tv_nsec) / 1000000;
+
+    return ms > 0 ? (uint64_t) ms : 0;
+}
+
+/* Block until the module's sample counter reaches `target` */
+static int wait_for_timestamp(struct bladerf *dev, bladerf_module module,
+                              uint64_t target, unsigned int sample_rate,
+                              unsigned int timeout_ms)
+{
+    int status;
+    uint64_t now, last = 0;
+    uint64_t remaining, sleep_us;
+    struct timespec last_progress;
+    bool first = true;
+
+    if (clock_gettime(CLOCK_REALTIME, &last_progress) != 0) {
+        return BLADERF_ERR_UNEXPECTED;
+    }
+
+    while (true) {
+        status = read_counter(dev, module, &now);
+        if (status != 0) {
+            return status;
+        }
+
+        if (now >= target) {
+            if (first) {
+                log_debug("Retune @ %" PRIu64 " is late by %" PRIu64
+                          " samples\n", target, now - target);
+            }
+            return 0;
+        }
+
+        if (first || now != last) {
+            clock_gettime(CLOCK_REALTIME, &last_progress);
+            last = now;
+            first = false;
+        } else if (elapsed_ms(&last_progress) >= timeout_ms) {
+            log_debug("Sample counter stalled at %" PRIu64 "\n", now);
+            return BLADERF_ERR_TIMEOUT;
+        }
+
+        if (sample_rate != 0) {
+            /* Sleeps are capped well below 1 s below, so limit the remaining
+             * sample count to 1 s worth to avoid overflowing the product */
+            remaining = target - now;
+            if (remaining > sample_rate) {
+                remaining = sample_rate;
+            }
+
+            sleep_us = remaining * 1000000 / sample_rate;
+        } else {
+            sleep_us = RETUNE_MAX_SLEEP_US;
+        }
+
+        if (sleep_us > RETUNE_WAKE_EARLY_US) {
+            sleep_us -= RETUNE_WAKE_EARLY_US;
+
+            if (sleep_us > RETUNE_MAX_SLEEP_US) {
+                sleep_us = RETUNE_MAX_SLEEP_US;
+            }
+
+            usleep((unsigned int) sleep_us);
+        }
+    }
+}
+
+static int apply_retune(struct bladerf *dev, bladerf_module module,
+                        struct bladerf_retune *retune)
+{
+    int status;
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+
+    if (retune->quick_tune != NULL) {
+        status = tuning_set_quick_tune(dev, retune->quick_tune);
+    } else {
+        status = tuning_set_freq(dev, module, retune->frequency);
+    }
+
+    if (status == 0) {
+        status = read_timestamp(dev, module, &retune->applied);
+    }
+
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    return status;
+}
+
+int retune_schedule(struct bladerf *dev, bladerf_module module,
+                    struct bladerf_retune *retunes, unsigned int count,
+                    unsigned int timeout_ms)
+{
+    int status;
+    unsigned int i;
+    unsigned int sample_rate;
+
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        log_debug("%s: Invalid module: %d\n", __FUNCTION__, module);
+        return BLADERF_ERR_INVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (retunes[i].quick_tune != NULL &&
+            retunes[i].quick_tune->module != module) {
+            log_debug("%s: Retune %u's quick tune is for the other module.\n",
+                      __FUNCTION__, i);
+            return BLADERF_ERR_INVAL;
+        }
+
+        if (i > 0 && retunes[i].timestamp < retunes[i - 1].timestamp) {
+            log_debug("%s: Retune timestamps must not decrease.\n",
+                      __FUNCTION__);
+            return BLADERF_ERR_INVAL;
+        }
+    }
+
+    MUTEX_LOCK(&dev->ctrl_lock);
+    status = si5338_get_sample_rate(dev, module, &sample_rate);
+    MUTEX_UNLOCK(&dev->ctrl_lock);
+
+    if (status != 0) {
+        return status;
+    }
+
+    for (i = 0; i < count; i++) {
+        status = wait_for_timestamp(dev, module, retunes[i].timestamp,
+                                    sample_rate, timeout_ms);
+        if (status != 0) {
+            return status;
+        }
+
+        status = apply_retune(dev, module, &retunes[i]);
+        if (status != 0) {
+            return status;
+        }
+
+        log_verbose("Retune @ %" PRIu64 " applied @ %" PRIu64 "\n",
+                    retunes[i].timestamp, retunes[i].applied);
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_RETUNE_H_
+#define BLADERF_RETUNE_H_
+
+#include <libbladeRF.h>
+
+/**
+ * Perform a sequence of retunes at the specified timestamps.
+ *
+ * Unlike most internal routines, this acquires and releases the device's
+ * control lock itself, as it may block for an extended period of time.
+ *
+ * See bladerf_schedule_retunes() for more information.
+ *
+ * @param       dev         Device handle
+ * @param       module      Module to retune
+ * @param       retunes     Retunes to perform
+ * @param       count       Number of retunes
+ * @param       timeout_ms  Sample counter stall timeout
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int retune_schedule(struct bladerf *dev, bladerf_module module,
+                    struct bladerf_retune *retunes, unsigned int count,
+                    unsigned int timeout_ms);
+
+#endif
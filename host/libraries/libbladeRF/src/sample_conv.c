@@ -0,0 +1,665 @@
+/*
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "host_config.h"
+#include "sample_conv.h"
+
+#ifdef TEST_SAMPLE_CONV
+#   include <stdio.h>
+#   define log_debug(...)
+#   define log_warning(...) fprintf(stderr, __VA_ARGS__)
+#else
+#   include "log.h"
+#endif
+
+#if !BLADERF_BIG_ENDIAN
+#   if defined(__x86_64__) || defined(__i386__) || \
+       defined(_M_X64) || defined(_M_IX86)
+
+        /* SSE2 is used if the library is being built for it */
+#       if defined(__SSE2__) || defined(_M_X64) || \
+           (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#           define SAMPLE_CONV_SSE2
+#       endif
+
+        /* AVX2 is used if the compiler supports per-function targets and
+         * the CPU supports it at runtime */
+#       if defined(_MSC_VER) || defined(__clang__) || \
+           (defined(__GNUC__) && __GNUC__ >= 5)
+#           define SAMPLE_CONV_AVX2
+#       endif
+
+#       if defined(_MSC_VER)
+#           include <intrin.h>
+#       endif
+#       include <immintrin.h>
+
+#   elif defined(__aarch64__) || defined(_M_ARM64)
+#       define SAMPLE_CONV_NEON
+#       include <arm_neon.h>
+#   endif
+#endif
+
+#if defined(SAMPLE_CONV_AVX2) && !defined(_MSC_VER)
+#   define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#   define TARGET_AVX2
+#endif
+
+/* SC16Q11 values in [-2048, 2048) map to [-1.0, 1.0) */
+#define SC16Q11_SCALE       2048.0f
+#define SC16Q11_MIN         -2048.0f
+#define SC16Q11_MAX         2047.0f
+
+struct kernels {
+    const char *name;
+    sample_conv_fn sc16q11_to_cf32;
+    sample_conv_fn cf32_to_sc16q11;
+};
+
+/*******************************************************************************
+ * Portable implementations
+ ******************************************************************************/
+
+static void sc16q11_copy(void *dest, const void *src, size_t n)
+{
+    /* Lent buffers are handed back in place, in which case there's
+     * nothing to copy */
+    if (dest != src) {
+        memcpy(dest, src, n * 2 * sizeof(int16_t));
+    }
+}
+
+#if BLADERF_BIG_ENDIAN
+static void sc16q11_le_to_host(void *dest, const void *src, size_t n)
+{
+    const uint16_t *in = (const uint16_t *) src;
+    uint16_t *out = (uint16_t *) dest;
+    size_t i;
+
+    for (i = 0; i < 2 * n; i++) {
+        out[i] = LE16_TO_HOST(in[i]);
+    }
+}
+
+static void sc16q11_host_to_le(void *dest, const void *src, size_t n)
+{
+    const uint16_t *in = (const uint16_t *) src;
+    uint16_t *out = (uint16_t *) dest;
+    size_t i;
+
+    for (i = 0; i < 2 * n; i++) {
+        out[i] = HOST_TO_LE16(in[i]);
+    }
+}
+#endif
+
+static void sc16q11_to_cf32_generic(void *dest, const void *src, size_t n)
+{
+    const uint16_t *in = (const uint16_t *) src;
+    float *out = (float *) dest;
+    size_t i;
+
+    for (i = 0; i < 2 * n; i++) {
+        out[i] = (int16_t) LE16_TO_HOST(in[i]) * (1.0f / SC16Q11_SCALE);
+    }
+}
+
+/* Out-of-range values (and NaN) are clamped, matching the SIMD kernels */
+static void cf32_to_sc16q11_generic(void *dest, const void *src, size_t n)
+{
+    const float *in = (const float *) src;
+    uint16_t *out = (uint16_t *) dest;
+    float v;
+    size_t i;
+
+    for (i = 0; i < 2 * n; i++) {
+        v = in[i] * SC16Q11_SCALE;
+
+        if (!(v <= SC16Q11_MAX)) {
+            v = SC16Q11_MAX;
+        } else if (v < SC16Q11_MIN) {
+            v = SC16Q11_MIN;
+        }
+
+        out[i] = HOST_TO_LE16((uint16_t) (int16_t) lrintf(v));
+    }
+}
+
+/*******************************************************************************
+ * SSE2 implementations
+ ******************************************************************************/
+
+#ifdef SAMPLE_CONV_SSE2
+static void sc16q11_to_cf32_sse2(void *dest, const void *src, size_t n)
+{
+    const int16_t *in = (const int16_t *) src;
+    float *out = (float *) dest;
+    const __m128 scale = _mm_set1_ps(1.0f / SC16Q11_SCALE);
+    size_t i;
+
+    for (i = 0; i + 16 <= 2 * n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) &in[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *) &in[i + 8]);
+
+        /* Sign-extend each int16 into the upper half of an int32 */
+        const __m128i a_lo = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+        const __m128i a_hi = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+        const __m128i b_lo = _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16);
+        const __m128i b_hi = _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16);
+
+        _mm_storeu_ps(&out[i],      _mm_mul_ps(_mm_cvtepi32_ps(a_lo), scale));
+        _mm_storeu_ps(&out[i + 4],  _mm_mul_ps(_mm_cvtepi32_ps(a_hi), scale));
+        _mm_storeu_ps(&out[i + 8],  _mm_mul_ps(_mm_cvtepi32_ps(b_lo), scale));
+        _mm_storeu_ps(&out[i + 12], _mm_mul_ps(_mm_cvtepi32_ps(b_hi), scale));
+    }
+
+    sc16q11_to_cf32_generic(&out[i], &in[i], n - i / 2);
+}
+
+static inline __m128i cf32_to_epi32_sse2(const float *in)
+{
+    const __m128 scale = _mm_set1_ps(SC16Q11_SCALE);
+    const __m128 min = _mm_set1_ps(SC16Q11_MIN);
+    const __m128 max = _mm_set1_ps(SC16Q11_MAX);
+    __m128 v = _mm_mul_ps(_mm_loadu_ps(in), scale);
+
+    /* _mm_min_ps() yields its second operand if the first is NaN */
+    v = _mm_max_ps(_mm_min_ps(v, max), min);
+    return _mm_cvtps_epi32(v);
+}
+
+static void cf32_to_sc16q11_sse2(void *dest, const void *src, size_t n)
+{
+    const float *in = (const float *) src;
+    int16_t *out = (int16_t *) dest;
+    size_t i;
+
+    for (i = 0; i + 8 <= 2 * n; i += 8) {
+        const __m128i lo = cf32_to_epi32_sse2(&in[i]);
+        const __m128i hi = cf32_to_epi32_sse2(&in[i + 4]);
+        _mm_storeu_si128((__m128i *) &out[i], _mm_packs_epi32(lo, hi));
+    }
+
+    cf32_to_sc16q11_generic(&out[i], &in[i], n - i / 2);
+}
+
+static const struct kernels kernels_sse2 = {
+    "sse2", sc16q11_to_cf32_sse2, cf32_to_sc16q11_sse2
+};
+#endif
+
+/*******************************************************************************
+ * AVX2 implementations
+ ******************************************************************************/
+
+#ifdef SAMPLE_CONV_AVX2
+TARGET_AVX2
+static void sc16q11_to_cf32_avx2(void *dest, const void *src, size_t n)
+{
+    const int16_t *in = (const int16_t *) src;
+    float *out = (float *) dest;
+    const __m256 scale = _mm256_set1_ps(1.0f / SC16Q11_SCALE);
+    size_t i;
+
+    for (i = 0; i + 16 <= 2 * n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) &in[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *) &in[i + 8]);
+        const __m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a));
+        const __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+
+        _mm256_storeu_ps(&out[i],     _mm256_mul_ps(fa, scale));
+        _mm256_storeu_ps(&out[i + 8], _mm256_mul_ps(fb, scale));
+    }
+
+    sc16q11_to_cf32_generic(&out[i], &in[i], n - i / 2);
+}
+
+TARGET_AVX2
+static inline __m256i cf32_to_epi32_avx2(const float *in)
+{
+    const __m256 scale = _mm256_set1_ps(SC16Q11_SCALE);
+    const __m256 min = _mm256_set1_ps(SC16Q11_MIN);
+    const __m256 max = _mm256_set1_ps(SC16Q11_MAX);
+    __m256 v = _mm256_mul_ps(_mm256_loadu_ps(in), scale);
+
+    v = _mm256_max_ps(_mm256_min_ps(v, max), min);
+    return _mm256_cvtps_epi32(v);
+}
+
+TARGET_AVX2
+static void cf32_to_sc16q11_avx2(void *dest, const void *src, size_t n)
+{
+    const float *in = (const float *) src;
+    int16_t *out = (int16_t *) dest;
+    size_t i;
+
+    for (i = 0; i + 16 <= 2 * n; i += 16) {
+        const __m256i lo = cf32_to_epi32_avx2(&in[i]);
+        const __m256i hi = cf32_to_epi32_avx2(&in[i + 8]);
+
+        /* Packing operates within 128-bit lanes, so the 64-bit quarters
+         * need to be put back in order afterwards */
+        const __m256i packed = _mm256_packs_epi32(lo, hi);
+        _mm256_storeu_si256((__m256i *) &out[i],
+                            _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+
+    cf32_to_sc16q11_generic(&out[i], &in[i], n - i / 2);
+}
+
+static const struct kernels kernels_avx2 = {
+    "avx2", sc16q11_to_cf32_avx2, cf32_to_sc16q11_avx2
+};
+
+static bool cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    /* Ensure the OS saves the YMM registers (OSXSAVE + XCR0[2:1]) */
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+/*******************************************************************************
+ * NEON implementations
+ ******************************************************************************/
+
+#ifdef SAMPLE_CONV_NEON
+static void sc16q11_to_cf32_neon(void *dest, const void *src, size_t n)
+{
+    const int16_t *in = (const int16_t *) src;
+    float *out = (float *) dest;
+    const float32x4_t scale = vdupq_n_f32(1.0f / SC16Q11_SCALE);
+    size_t i;
+
+    for (i = 0; i + 8 <= 2 * n; i += 8) {
+        const int16x8_t a = vld1q_s16(&in[i]);
+        const float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(a)));
+        const float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(a)));
+
+        vst1q_f32(&out[i],     vmulq_f32(lo, scale));
+        vst1q_f32(&out[i + 4], vmulq_f32(hi, scale));
+    }
+
+    sc16q11_to_cf32_generic(&out[i], &in[i], n - i / 2);
+}
+
+static inline int32x4_t cf32_to_s32_neon(const float *in)
+{
+    const float32x4_t scale = vdupq_n_f32(SC16Q11_SCALE);
+    const float32x4_t min = vdupq_n_f32(SC16Q11_MIN);
+    const float32x4_t max = vdupq_n_f32(SC16Q11_MAX);
+    float32x4_t v = vmulq_f32(vld1q_f32(in), scale);
+
+    /* The "minnm/maxnm" variants yield the numeric operand for NaN */
+    v = vmaxnmq_f32(vminnmq_f32(v, max), min);
+    return vcvtnq_s32_f32(v);
+}
+
+static void cf32_to_sc16q11_neon(void *dest, const void *src, size_t n)
+{
+    const float *in = (const float *) src;
+    int16_t *out = (int16_t *) dest;
+    size_t i;
+
+    for (i = 0; i + 8 <= 2 * n; i += 8) {
+        const int16x4_t lo = vmovn_s32(cf32_to_s32_neon(&in[i]));
+        const int16x4_t hi = vmovn_s32(cf32_to_s32_neon(&in[i + 4]));
+        vst1q_s16(&out[i], vcombine_s16(lo, hi));
+    }
+
+    cf32_to_sc16q11_generic(&out[i], &in[i], n - i / 2);
+}
+
+static const struct kernels kernels_neon = {
+    "neon", sc16q11_to_cf32_neon, cf32_to_sc16q11_neon
+};
+#endif
+
+/*******************************************************************************
+ * Runtime selection
+ ******************************************************************************/
+
+static const struct kernels kernels_generic = {
+    "generic", sc16q11_to_cf32_generic, cf32_to_sc16q11_generic
+};
+
+static const struct kernels *kernels = &kernels_generic;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+#define MAX_KERNELS 4
+
+/* Fill `candidates` with the implementations supported by this build and CPU,
+ * ordered by preference. The generic implementation is always last. */
+static size_t available_kernels(const struct kernels *candidates[MAX_KERNELS])
+{
+    size_t num_candidates = 0;
+
+#ifdef SAMPLE_CONV_AVX2
+    if (cpu_has_avx2()) {
+        candidates[num_candidates++] = &kernels_avx2;
+    }
+#endif
+
+#ifdef SAMPLE_CONV_SSE2
+    candidates[num_candidates++] = &kernels_sse2;
+#endif
+
+#ifdef SAMPLE_CONV_NEON
+    candidates[num_candidates++] = &kernels_neon;
+#endif
+
+    candidates[num_candidates++] = &kernels_generic;
+
+    return num_candidates;
+}
+
+static void select_kernels(void)
+{
+    const struct kernels *candidates[MAX_KERNELS];
+    const char *env = getenv("BLADERF_SAMPLE_CONV_IMPL");
+    const size_t num_candidates = available_kernels(candidates);
+    size_t i;
+
+    kernels = candidates[0];
+
+    /* Allow a specific implementation to be forced, for testing and
+     * benchmarking purposes */
+    if (env != NULL) {
+        for (i = 0; i < num_candidates; i++) {
+            if (!strcmp(env, candidates[i]->name)) {
+                kernels = candidates[i];
+                break;
+            }
+        }
+
+        if (i == num_candidates) {
+            log_warning("Sample conversion implementation \"%s\" is not "
+                        "available. Using \"%s\".\n", env, kernels->name);
+        }
+    }
+
+    log_debug("Using %s sample conversion routines.\n", kernels->name);
+}
+
+static inline const struct kernels *get_kernels(void)
+{
+    pthread_once(&kernels_once, select_kernels);
+    return kernels;
+}
+
+const char * sample_conv_impl_str(void)
+{
+    return get_kernels()->name;
+}
+
+bladerf_format sample_conv_wire_format(bladerf_format format)
+{
+    switch (format) {
+        case BLADERF_FORMAT_SC16_Q11:
+        case BLADERF_FORMAT_SC16_Q11_HOST:
+        case BLADERF_FORMAT_CF32:
+            return BLADERF_FORMAT_SC16_Q11;
+
+        case BLADERF_FORMAT_SC16_Q11_META:
+        case BLADERF_FORMAT_SC16_Q11_HOST_META:
+        case BLADERF_FORMAT_CF32_META:
+            return BLADERF_FORMAT_SC16_Q11_META;
+
+        default:
+            return (bladerf_format) -1;
+    }
+}
+
+int sample_conv_init(bladerf_format format, struct sample_conv *conv)
+{
+    const struct kernels *k;
+
+    switch (format) {
+        case BLADERF_FORMAT_SC16_Q11:
+        case BLADERF_FORMAT_SC16_Q11_META:
+            conv->to_host = sc16q11_copy;
+            conv->to_wire = sc16q11_copy;
+            conv->host_bytes_per_sample = 2 * sizeof(int16_t);
+            conv->identity = true;
+            break;
+
+        case BLADERF_FORMAT_SC16_Q11_HOST:
+        case BLADERF_FORMAT_SC16_Q11_HOST_META:
+#if BLADERF_BIG_ENDIAN
+            conv->to_host = sc16q11_le_to_host;
+            conv->to_wire = sc16q11_host_to_le;
+            conv->identity = false;
+#else
+            conv->to_host = sc16q11_copy;
+            conv->to_wire = sc16q11_copy;
+            conv->identity = true;
+#endif
+            conv->host_bytes_per_sample = 2 * sizeof(int16_t);
+            break;
+
+        case BLADERF_FORMAT_CF32:
+        case BLADERF_FORMAT_CF32_META:
+            k = get_kernels();
+            conv->to_host = k->sc16q11_to_cf32;
+            conv->to_wire = k->cf32_to_sc16q11;
+            conv->host_bytes_per_sample = 2 * sizeof(float);
+            conv->identity = false;
+            break;
+
+        default:
+            return BLADERF_ERR_INVAL;
+    }
+
+    return 0;
+}
+
+#ifdef TEST_SAMPLE_CONV
+
+/* Building this file alone with TEST_SAMPLE_CONV defined produces a program
+ * that checks each SIMD implementation available on the host against the
+ * generic one, returning the number of failures. */
+
+/* Lengths, in samples, to convert. Every length up to MAX_SHORT_LEN is used,
+ * which covers lengths shorter than a single vector and every possible tail
+ * after the last full vector of each implementation. */
+#define MAX_SHORT_LEN   40
+static const size_t long_lens[] = { 1000, 1023, 1024, 1025, 4096 + 7 };
+
+/* Buffers are offset by up to this many samples, so that they are not always
+ * vector-aligned */
+#define MAX_OFFSET      3
+
+/* Samples following the requested length must be left untouched */
+#define GUARD           16
+#define GUARD_BYTE      0xa5
+
+#define BUF_LEN         (4096 + 7 + MAX_OFFSET + GUARD)
+
+static uint32_t rand_state = 1;
+
+static uint32_t next_rand(void)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return rand_state;
+}
+
+/* Random floats of either sign, mostly within [-1.1, 1.1], with occasional
+ * out-of-range, non-finite, and rounding-boundary values */
+static float rand_cf32(void)
+{
+    const uint32_t r = next_rand();
+
+    switch (r % 16) {
+        case 0:
+            return ((int32_t) (r >> 8) % 8) * 0.5f;
+        case 1:
+            /* Exactly between two SC16Q11 values */
+            return (((int32_t) (r >> 8) % 4096) - 2048 + 0.5f) / SC16Q11_SCALE;
+        case 2:
+            return (r & 0x100) ? INFINITY : -INFINITY;
+        case 3:
+            return NAN;
+        default:
+            return ((int32_t) r / 2147483648.0f) * 1.1f;
+    }
+}
+
+static bool guard_intact(const void *buf, size_t len)
+{
+    const uint8_t *b = (const uint8_t *) buf;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (b[i] != GUARD_BYTE) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Compare an implementation against the generic one, converting `n` samples
+ * starting `off` samples into each buffer */
+static unsigned int test_len(const struct kernels *k, size_t n, size_t off)
+{
+    static int16_t sc16[2 * BUF_LEN];
+    static float cf32[2 * BUF_LEN];
+    static float cf32_expected[2 * BUF_LEN];
+    static float cf32_actual[2 * BUF_LEN];
+    static int16_t sc16_expected[2 * BUF_LEN];
+    static int16_t sc16_actual[2 * BUF_LEN];
+    const size_t start = 2 * off;
+    const size_t end = 2 * (off + n);
+    unsigned int failures = 0;
+    size_t i;
+
+    for (i = start; i < end; i++) {
+        sc16[i] = (int16_t) next_rand();
+        cf32[i] = rand_cf32();
+    }
+
+    memset(cf32_actual, GUARD_BYTE, sizeof(cf32_actual));
+    memset(sc16_actual, GUARD_BYTE, sizeof(sc16_actual));
+
+    sc16q11_to_cf32_generic(&cf32_expected[start], &sc16[start], n);
+    k->sc16q11_to_cf32(&cf32_actual[start], &sc16[start], n);
+
+    cf32_to_sc16q11_generic(&sc16_expected[start], &cf32[start], n);
+    k->cf32_to_sc16q11(&sc16_actual[start], &cf32[start], n);
+
+    for (i = start; i < end; i++) {
+        if (memcmp(&cf32_actual[i], &cf32_expected[i], sizeof(float)) != 0) {
+            fprintf(stderr, "%s sc16q11_to_cf32, n=%u, offset=%u: "
+                    "%d -> %f, expected %f\n", k->name, (unsigned int) n,
+                    (unsigned int) off, sc16[i], cf32_actual[i],
+                    cf32_expected[i]);
+            failures++;
+            break;
+        }
+    }
+
+    for (i = start; i < end; i++) {
+        if (sc16_actual[i] != sc16_expected[i]) {
+            fprintf(stderr, "%s cf32_to_sc16q11, n=%u, offset=%u: "
+                    "%f -> %d, expected %d\n", k->name, (unsigned int) n,
+                    (unsigned int) off, cf32[i], sc16_actual[i],
+                    sc16_expected[i]);
+            failures++;
+            break;
+        }
+    }
+
+    if (!guard_intact(cf32_actual, start * sizeof(float)) ||
+        !guard_intact(&cf32_actual[end], 2 * GUARD * sizeof(float))) {
+        fprintf(stderr, "%s sc16q11_to_cf32, n=%u, offset=%u: "
+                "Wrote outside of output\n", k->name, (unsigned int) n,
+                (unsigned int) off);
+        failures++;
+    }
+
+    if (!guard_intact(sc16_actual, start * sizeof(int16_t)) ||
+        !guard_intact(&sc16_actual[end], 2 * GUARD * sizeof(int16_t))) {
+        fprintf(stderr, "%s cf32_to_sc16q11, n=%u, offset=%u: "
+                "Wrote outside of output\n", k->name, (unsigned int) n,
+                (unsigned int) off);
+        failures++;
+    }
+
+    return failures;
+}
+
+int main(void)
+{
+    const struct kernels *candidates[MAX_KERNELS];
+    const size_t num_candidates = available_kernels(candidates);
+    unsigned int num_failures = 0;
+    unsigned int failures;
+    size_t i, n, off;
+
+    /* The generic implementation, listed last, is the reference */
+    for (i = 0; i + 1 < num_candidates; i++) {
+        failures = 0;
+
+        for (off = 0; off <= MAX_OFFSET; off++) {
+            for (n = 0; n <= MAX_SHORT_LEN; n++) {
+                failures += test_len(candidates[i], n, off);
+            }
+
+            for (n = 0; n < sizeof(long_lens) / sizeof(long_lens[0]); n++) {
+                failures += test_len(candidates[i], long_lens[n], off);
+            }
+        }
+
+        if (failures != 0) {
+            fprintf(stderr, "%s: failed.\n", candidates[i]->name);
+            num_failures += failures;
+        } else {
+            printf("%s: passed.\n", candidates[i]->name);
+        }
+    }
+
+    if (num_candidates == 1) {
+        printf("No SIMD implementations are available.\n");
+    }
+
+    return num_failures;
+}
+#endif
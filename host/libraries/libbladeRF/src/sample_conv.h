@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+#ifndef SAMPLE_CONV_H_
+#define SAMPLE_CONV_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <libbladeRF.h>
+
+/*
+ * Sample conversion kernels
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * The device always exchanges little-endian SC16Q11 samples with the host.
+ * The "host-side" formats (BLADERF_FORMAT_SC16_Q11_HOST*, BLADERF_FORMAT_CF32*)
+ * are converted to/from this "wire" format while samples are copied between
+ * the caller's buffer and the sync interface's stream buffers, so the
+ * conversion does not require an additional pass over the data.
+ *
+ * SIMD implementations (SSE2, AVX2, NEON) are selected at runtime, based upon
+ * the capabilities of the CPU. A portable implementation is used otherwise.
+ */
+
+/**
+ * Convert or copy `n` samples from `src` to `dest`
+ */
+typedef void (*sample_conv_fn)(void *dest, const void *src, size_t n);
+
+struct sample_conv {
+    sample_conv_fn to_host;     /**< Wire format -> host-side format */
+    sample_conv_fn to_wire;     /**< Host-side format -> wire format */
+
+    /** Size of a host-side sample, in bytes */
+    size_t host_bytes_per_sample;
+
+    /** Host-side and wire formats have the same memory representation */
+    bool identity;
+};
+
+/**
+ * Get the wire format corresponding to the provided format
+ *
+ * @return BLADERF_FORMAT_SC16_Q11 or BLADERF_FORMAT_SC16_Q11_META
+ *         on success, -1 on an invalid format
+ */
+bladerf_format sample_conv_wire_format(bladerf_format format);
+
+/**
+ * Look up the conversion routines for the provided host-side format
+ *
+ * @param[in]   format      Host-side format
+ * @param[out]  conv        Conversion routines
+ *
+ * @return 0 on success, BLADERF_ERR_INVAL on an invalid format
+ */
+int sample_conv_init(bladerf_format format, struct sample_conv *conv);
+
+/**
+ * @return Name of the implementation selected for this CPU
+ */
+const char * sample_conv_impl_str(void);
+
+#endif
@@ -462,6 +462,12 @@ int si5338_set_rational_sample_rate(struct bladerf *dev, bladerf_module module,
     /* Program it to the part */
     status = si5338_write_multisynth(dev, &ms);
 
+    /* The module's sample counter now runs at the new rate */
+    if (status == 0) {
+        time_model_set_rate(&dev->time_model[module],
+                            actual.integer + (double) actual.num / actual.den);
+    }
+
     /* Done */
     return status ;
 }
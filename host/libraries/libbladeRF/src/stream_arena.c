@@ -0,0 +1,208 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Required for MAP_HUGETLB and MADV_HUGEPAGE */
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS
+#   include <windows.h>
+#else
+#   include <unistd.h>
+#   include <sys/mman.h>
+#endif
+
+#include "async.h"
+#include "stream_arena.h"
+#include "thread_config.h"
+#include "log.h"
+
+/* Only attempt hugepage mappings for arenas at least this large */
+#define HUGEPAGE_SIZE   (2 * 1024 * 1024)
+
+static inline size_t round_up(size_t n, size_t align)
+{
+    return (n + align - 1) / align * align;
+}
+
+static size_t page_size(void)
+{
+#if BLADERF_OS_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t) size : 4096;
+#endif
+}
+
+static void *map_pages(size_t len, bool huge)
+{
+    void *mem;
+
+#if BLADERF_OS_WINDOWS
+    if (huge) {
+        /* Large pages require SeLockMemoryPrivilege; not worth pursuing */
+        return NULL;
+    }
+
+    mem = VirtualAlloc(NULL, len, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if (huge) {
+#   ifdef MAP_HUGETLB
+        flags |= MAP_HUGETLB;
+#   else
+        return NULL;
+#   endif
+    }
+
+    mem = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+
+#   ifdef MADV_HUGEPAGE
+    /* Let transparent hugepages back large regular mappings */
+    if (!huge && len >= HUGEPAGE_SIZE) {
+        madvise(mem, len, MADV_HUGEPAGE);
+    }
+#   endif
+#endif
+
+    return mem;
+}
+
+static void unmap_pages(void *mem, size_t len)
+{
+#if BLADERF_OS_WINDOWS
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, len);
+#endif
+}
+
+static const char *arena_type_str(stream_arena_type type)
+{
+    switch (type) {
+        case STREAM_ARENA_DEVICE:       return "device";
+        case STREAM_ARENA_HUGEPAGES:    return "hugepage";
+        case STREAM_ARENA_PAGES:        return "page-aligned";
+        case STREAM_ARENA_HEAP:         return "heap";
+        default:                        return "unknown";
+    }
+}
+
+int stream_arena_alloc(struct bladerf_stream *stream,
+                       struct stream_arena *arena,
+                       size_t len, bool lock)
+{
+    const struct backend_fns *fn = stream->dev->fn;
+    int status;
+
+    memset(arena, 0, sizeof(*arena));
+
+    if (fn->alloc_stream_mem != NULL) {
+        arena->mem = fn->alloc_stream_mem(stream, len);
+        if (arena->mem != NULL) {
+            arena->type = STREAM_ARENA_DEVICE;
+            arena->size = len;
+            memset(arena->mem, 0, len);
+        }
+    }
+
+    if (arena->mem == NULL && len >= HUGEPAGE_SIZE) {
+        arena->size = round_up(len, HUGEPAGE_SIZE);
+        arena->mem = map_pages(arena->size, true);
+        arena->type = STREAM_ARENA_HUGEPAGES;
+    }
+
+    if (arena->mem == NULL) {
+        arena->size = round_up(len, page_size());
+        arena->mem = map_pages(arena->size, false);
+        arena->type = STREAM_ARENA_PAGES;
+    }
+
+    if (arena->mem == NULL) {
+        arena->size = len;
+        arena->mem = calloc(1, len);
+        arena->type = STREAM_ARENA_HEAP;
+    }
+
+    if (arena->mem == NULL) {
+        arena->type = STREAM_ARENA_NONE;
+        return BLADERF_ERR_MEM;
+    }
+
+    log_verbose("Allocated %u-byte %s stream buffer arena.\n",
+                (unsigned int) arena->size, arena_type_str(arena->type));
+
+    /* Device memory is already pinned by the kernel */
+    if (lock && arena->type != STREAM_ARENA_DEVICE) {
+        status = thread_config_lock_memory(arena->mem, arena->size);
+        if (status != 0) {
+            log_debug("Failed to lock stream buffers into memory: %s\n",
+                      bladerf_strerror(status));
+            stream_arena_free(stream, arena);
+            return status;
+        }
+
+        arena->locked = true;
+    }
+
+    return 0;
+}
+
+void stream_arena_free(struct bladerf_stream *stream,
+                       struct stream_arena *arena)
+{
+    if (arena->locked) {
+        thread_config_unlock_memory(arena->mem, arena->size);
+    }
+
+    switch (arena->type) {
+        case STREAM_ARENA_DEVICE:
+            stream->dev->fn->free_stream_mem(stream, arena->mem, arena->size);
+            break;
+
+        case STREAM_ARENA_HUGEPAGES:
+        case STREAM_ARENA_PAGES:
+            unmap_pages(arena->mem, arena->size);
+            break;
+
+        case STREAM_ARENA_HEAP:
+            free(arena->mem);
+            break;
+
+        default:
+            break;
+    }
+
+    memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_STREAM_ARENA_H_
+#define BLADERF_STREAM_ARENA_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct bladerf_stream;
+
+/* Origin of a stream's buffer memory, in order of preference */
+typedef enum {
+    STREAM_ARENA_NONE,      /* Not allocated */
+    STREAM_ARENA_DEVICE,    /* Backend-provided (e.g., usbfs zero-copy) */
+    STREAM_ARENA_HUGEPAGES, /* Explicit hugepage mapping */
+    STREAM_ARENA_PAGES,     /* Page-aligned mapping */
+    STREAM_ARENA_HEAP       /* Heap allocation */
+} stream_arena_type;
+
+/* A single contiguous allocation from which all of a stream's buffers are
+ * carved out */
+struct stream_arena {
+    void *mem;
+    size_t size;            /* Size of the mapping, in bytes */
+    stream_arena_type type;
+    bool locked;            /* Memory has been locked via mlock() */
+};
+
+/**
+ * Allocate a zeroed arena of at least `len` bytes for the specified stream.
+ *
+ * The stream's backend is first given the opportunity to provide memory it
+ * can transfer to/from without an intermediate copy. Otherwise, a hugepage
+ * mapping is attempted for large arenas, followed by a page-aligned mapping,
+ * and finally a plain heap allocation.
+ *
+ * @param[in]   stream      Stream the arena is for. Only stream->dev is used.
+ * @param[out]  arena       Arena to initialize
+ * @param[in]   len         Required length, in bytes
+ * @param[in]   lock        Lock the arena into physical memory
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int stream_arena_alloc(struct bladerf_stream *stream,
+                       struct stream_arena *arena,
+                       size_t len, bool lock);
+
+/**
+ * Free an arena allocated via stream_arena_alloc()
+ *
+ * @param[in]   stream      Stream the arena was allocated for
+ * @param[in]   arena       Arena to free
+ */
+void stream_arena_free(struct bladerf_stream *stream,
+                       struct stream_arena *arena);
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <string.h>
+
+#include "stream_stats.h"
+
+void stream_stats_reset(struct stream_stats *stats)
+{
+    unsigned int i;
+
+    COUNTER_STORE(&stats->transfers_submitted, 0);
+    COUNTER_STORE(&stats->transfers_completed, 0);
+    COUNTER_STORE(&stats->short_transfers, 0);
+    COUNTER_STORE(&stats->overruns, 0);
+    COUNTER_STORE(&stats->underruns, 0);
+
+    ATOMIC_STORE(&stats->in_flight, 0);
+    ATOMIC_STORE(&stats->in_flight_max, 0);
+    ATOMIC_STORE(&stats->full_max, 0);
+    ATOMIC_STORE(&stats->empty_max, 0);
+
+    ATOMIC_STORE(&stats->latency_max_us, 0);
+
+    for (i = 0; i < STREAM_STATS_LATENCY_BUCKETS; i++) {
+        COUNTER_STORE(&stats->latency[i], 0);
+    }
+}
+
+/* Estimate a latency percentile from the histogram, reporting the upper bound
+ * of the bucket in which it falls */
+static unsigned int latency_percentile(const uint64_t *hist, uint64_t total,
+                                       unsigned int percent,
+                                       unsigned int max_us)
+{
+    uint64_t threshold, count = 0;
+    unsigned int i;
+    uint64_t bound_us;
+
+    if (total == 0) {
+        return 0;
+    }
+
+    /* Rank of the sample at this percentile, rounded up */
+    threshold = (total * percent + 99) / 100;
+
+    for (i = 0; i < STREAM_STATS_LATENCY_BUCKETS; i++) {
+        count += hist[i];
+        if (count >= threshold) {
+            break;
+        }
+    }
+
+    bound_us = ((uint64_t) 1 << i) - 1;
+    return (bound_us < max_us) ? (unsigned int) bound_us : max_us;
+}
+
+void stream_stats_get(struct stream_stats *stats,
+                      struct bladerf_stream_stats *out)
+{
+    uint64_t hist[STREAM_STATS_LATENCY_BUCKETS];
+    uint64_t total = 0;
+    unsigned int i;
+
+    out->transfers_submitted = COUNTER_LOAD(&stats->transfers_submitted);
+    out->transfers_completed = COUNTER_LOAD(&stats->transfers_completed);
+    out->short_transfers = COUNTER_LOAD(&stats->short_transfers);
+    out->overruns = COUNTER_LOAD(&stats->overruns);
+    out->underruns = COUNTER_LOAD(&stats->underruns);
+
+    out->in_flight = ATOMIC_LOAD(&stats->in_flight);
+    out->in_flight_max = ATOMIC_LOAD(&stats->in_flight_max);
+    out->full_max = ATOMIC_LOAD(&stats->full_max);
+    out->empty_max = ATOMIC_LOAD(&stats->empty_max);
+
+    /* The histogram may be updated while we're reading it, so the total is
+     * taken from the buckets we actually read */
+    for (i = 0; i < STREAM_STATS_LATENCY_BUCKETS; i++) {
+        hist[i] = COUNTER_LOAD(&stats->latency[i]);
+        total += hist[i];
+    }
+
+    out->latency_count = total;
+    out->latency_max_us = ATOMIC_LOAD(&stats->latency_max_us);
+    out->latency_p50_us = latency_percentile(hist, total, 50,
+                                             out->latency_max_us);
+    out->latency_p90_us = latency_percentile(hist, total, 90,
+                                             out->latency_max_us);
+    out->latency_p99_us = latency_percentile(hist, total, 99,
+                                             out->latency_max_us);
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_STREAM_STATS_H_
+#define BLADERF_STREAM_STATS_H_
+
+#include <stdint.h>
+#include "libbladeRF.h"
+#include "host_config.h"
+#include "thread.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
+
+/* Latency histogram bucket i counts latencies in [2^(i-1), 2^i) us, with
+ * bucket 0 holding those under 1 us. The last bucket also holds anything
+ * larger than it would otherwise. */
+#define STREAM_STATS_LATENCY_BUCKETS    24
+
+/* Per-module stream counters, stored in struct bladerf.
+ *
+ * The uint64_t counters are only accessed via the COUNTER_* accessors.
+ * The unsigned int values each have a single writer, and are accessed with
+ * ATOMIC_LOAD()/ATOMIC_STORE(). */
+struct stream_stats {
+    uint64_t transfers_submitted;
+    uint64_t transfers_completed;
+    uint64_t short_transfers;
+    uint64_t overruns;
+    uint64_t underruns;
+
+    unsigned int in_flight;
+    unsigned int in_flight_max;
+    unsigned int full_max;
+    unsigned int empty_max;
+
+    unsigned int latency_max_us;
+    uint64_t latency[STREAM_STATS_LATENCY_BUCKETS];
+};
+
+/* Current time, in microseconds, for latency measurements */
+static inline uint64_t stream_stats_now_us(void)
+{
+    struct timespec t;
+
+    if (clock_gettime(CLOCK_REALTIME, &t) != 0) {
+        return 0;
+    }
+
+    return (uint64_t) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+/* Record a new value for a high-water mark. Each mark must only be updated
+ * from a single thread. */
+static inline void stream_stats_update_max(unsigned int *max,
+                                           unsigned int value)
+{
+    if (value > ATOMIC_LOAD(max)) {
+        ATOMIC_STORE(max, value);
+    }
+}
+
+/* Record the latency between `start_us` and now. Measurements spanning a
+ * clock adjustment are discarded. */
+static inline void stream_stats_latency(struct stream_stats *stats,
+                                        uint64_t start_us)
+{
+    const uint64_t now_us = stream_stats_now_us();
+    uint64_t latency_us;
+    unsigned int bucket = 0;
+
+    if (start_us == 0 || now_us < start_us) {
+        return;
+    }
+
+    latency_us = now_us - start_us;
+    while (bucket < (STREAM_STATS_LATENCY_BUCKETS - 1) &&
+           (latency_us >> bucket) != 0) {
+        bucket++;
+    }
+
+    COUNTER_ADD(&stats->latency[bucket], 1);
+
+    if (latency_us > UINT32_MAX) {
+        latency_us = UINT32_MAX;
+    }
+
+    stream_stats_update_max(&stats->latency_max_us, (unsigned int) latency_us);
+}
+
+/**
+ * Zero a module's statistics. This is called when a stream is started.
+ *
+ * @param   stats       Statistics to reset
+ */
+void stream_stats_reset(struct stream_stats *stats);
+
+/**
+ * Take a snapshot of a module's statistics
+ *
+ * @param[in]   stats       Statistics to read
+ * @param[out]  out         Snapshot, with latency percentiles computed
+ */
+void stream_stats_get(struct stream_stats *stats,
+                      struct bladerf_stream_stats *out);
+
+#endif
@@ -38,6 +38,11 @@ static inline size_t samples2bytes(struct bladerf_sync *s, size_t n) {
     return s->stream_config.bytes_per_sample * n;
 }
 
+/* Size of samples in the caller's format */
+static inline size_t user_samples2bytes(struct bladerf_sync *s, size_t n) {
+    return s->stream_config.conv.host_bytes_per_sample * n;
+}
+
 static inline unsigned int msg_per_buf(struct bladerf *dev,
                                        size_t buf_size, size_t bytes_per_sample) {
 
@@ -65,12 +70,16 @@ int sync_init(struct bladerf *dev,
     struct bladerf_sync *sync;
     int status = 0;
     size_t i, bytes_per_sample;
+    struct sample_conv conv;
+    bladerf_format wire_format;
 
     if (num_transfers >= num_buffers) {
         return BLADERF_ERR_INVAL;
     }
 
-    switch (format) {
+    wire_format = sample_conv_wire_format(format);
+
+    switch (wire_format) {
         case BLADERF_FORMAT_SC16_Q11:
         case BLADERF_FORMAT_SC16_Q11_META:
             bytes_per_sample = 4;
@@ -81,6 +90,11 @@ int sync_init(struct bladerf *dev,
             return BLADERF_ERR_INVAL;
     }
 
+    status = sample_conv_init(format, &conv);
+    if (status != 0) {
+        return status;
+    }
+
     /* bladeRF GPIF DMA requirement */
     if ((bytes_per_sample * buffer_size) % 4096 != 0) {
         return BLADERF_ERR_INVAL;
@@ -115,7 +129,8 @@ int sync_init(struct bladerf *dev,
     sync->buf_mgmt.resubmit_count = 0;
 
     sync->stream_config.module = module;
-    sync->stream_config.format = format;
+    sync->stream_config.format = wire_format;
+    sync->stream_config.conv = conv;
     sync->stream_config.samples_per_buffer = buffer_size;
     sync->stream_config.num_xfers = num_transfers;
     sync->stream_config.timeout_ms = stream_timeout;
@@ -138,7 +153,10 @@ int sync_init(struct bladerf *dev,
     pthread_cond_init(&sync->buf_mgmt.buf_ready, NULL);
 
     sync->buf_mgmt.status = (sync_buffer_status*) malloc(num_buffers * sizeof(sync_buffer_status));
-    if (sync->buf_mgmt.status == NULL) {
+    sync->buf_mgmt.gaps = (struct sync_rx_gap *) calloc(num_buffers, sizeof(struct sync_rx_gap));
+    sync->buf_mgmt.handoff_us = (uint64_t *) calloc(num_buffers, sizeof(uint64_t));
+    if (sync->buf_mgmt.status == NULL || sync->buf_mgmt.gaps == NULL ||
+        sync->buf_mgmt.handoff_us == NULL) {
         status = BLADERF_ERR_MEM;
     } else {
         switch (module) {
@@ -191,38 +209,51 @@ int sync_init(struct bladerf *dev,
 void sync_deinit(struct bladerf_sync *sync)
 {
     if (sync != NULL) {
-
-        if (sync->stream_config.module == BLADERF_MODULE_TX) {
-            async_submit_stream_buffer(sync->worker->stream,
-                                       BLADERF_STREAM_SHUTDOWN, 0);
-        }
-
         sync_worker_deinit(sync->worker, &sync->buf_mgmt.lock,
                            &sync->buf_mgmt.buf_ready);
 
          /* De-allocate our buffer management resources */
         free(sync->buf_mgmt.status);
+        free(sync->buf_mgmt.gaps);
+        free(sync->buf_mgmt.handoff_us);
         free(sync);
     }
 }
 
-static int wait_for_buffer(struct buffer_mgmt *b, unsigned int timeout_ms,
-                           const char *dbg_name, unsigned int dbg_idx)
+/* Block until buffer `idx` may have reached the `desired` status, a stream
+ * error occurs, or the timeout expires. The caller must re-check the buffer
+ * status after this returns 0. */
+static int wait_for_buffer(struct buffer_mgmt *b, unsigned int idx,
+                           sync_buffer_status desired, unsigned int timeout_ms,
+                           const char *dbg_name)
 {
-    int status;
+    int status = 0;
     struct timespec timeout;
 
-    if (timeout_ms == 0) {
-        log_verbose("%s: Infinite wait for [%d] to fill.\n", dbg_name, dbg_idx);
-        status = pthread_cond_wait(&b->buf_ready, &b->lock);
-    } else {
-        log_verbose("%s: Timed wait for [%d] to fill.\n", dbg_name, dbg_idx);
-        status = populate_abs_timeout(&timeout, timeout_ms);
-        if (status == 0) {
-            status = pthread_cond_timedwait(&b->buf_ready, &b->lock, &timeout);
+    MUTEX_LOCK(&b->lock);
+
+    /* Callbacks only signal buf_ready when we've flagged that we're waiting.
+     * The buffer may have been handed off before they observed the flag, so
+     * re-check it before blocking. */
+    ATOMIC_STORE_SC(&b->waiting, 1);
+
+    if (ATOMIC_LOAD_SC(&b->status[idx]) != desired) {
+        if (timeout_ms == 0) {
+            log_verbose("%s: Infinite wait for [%u].\n", dbg_name, idx);
+            status = pthread_cond_wait(&b->buf_ready, &b->lock);
+        } else {
+            log_verbose("%s: Timed wait for [%u].\n", dbg_name, idx);
+            status = populate_abs_timeout(&timeout, timeout_ms);
+            if (status == 0) {
+                status = pthread_cond_timedwait(&b->buf_ready, &b->lock,
+                                                &timeout);
+            }
         }
     }
 
+    ATOMIC_STORE(&b->waiting, 0);
+    MUTEX_UNLOCK(&b->lock);
+
     if (status == ETIMEDOUT) {
         status = BLADERF_ERR_TIMEOUT;
     } else if (status != 0) {
@@ -249,7 +280,8 @@ static inline void advance_rx_buffer(struct buffer_mgmt *b)
 {
     log_verbose("%s: Marking buf[%u] empty.\n", __FUNCTION__, b->cons_i);
 
-    b->status[b->cons_i] = SYNC_BUFFER_EMPTY;
+    ATOMIC_STORE(&b->status[b->cons_i], SYNC_BUFFER_EMPTY);
+    COUNTER_ADD(&b->api_handoffs, 1);
     b->cons_i = (b->cons_i + 1) % b->num_buffers;
 }
 
@@ -260,41 +292,67 @@ static inline unsigned int timestamp_to_msg(struct bladerf_sync *s, uint64_t t)
     return (unsigned int) m;
 }
 
-int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
-            struct bladerf_metadata *user_meta, unsigned int timeout_ms)
+static inline void rx_read_header(struct bladerf_sync *s, struct buffer_mgmt *b)
 {
-    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_RX];
-    struct buffer_mgmt *b;
+    uint8_t *buf_src = (uint8_t*)b->buffers[b->cons_i];
 
-    int status = 0;
-    bool exit_early = false;
-    bool copied_data = false;
-    unsigned int samples_returned = 0;
-    uint8_t *samples_dest = (uint8_t*)samples;
-    uint8_t *buf_src = NULL;
-    unsigned int samples_to_copy = 0;
-    unsigned int samples_per_buffer = 0;
-    uint64_t target_timestamp = UINT64_MAX;
+    s->meta.curr_msg = buf_src + s->dev->msg_size * s->meta.msg_num;
+    s->meta.msg_timestamp = metadata_get_timestamp(s->meta.curr_msg);
+    s->meta.msg_flags = metadata_get_flags(s->meta.curr_msg);
+    s->meta.curr_msg_off = 0;
+}
 
-    if (s == NULL || samples == NULL) {
-        log_debug("NULL pointer passed to %s\n", __FUNCTION__);
-        return BLADERF_ERR_INVAL;
-    } else if (s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META) {
-        if (user_meta == NULL) {
-            log_debug("NULL metadata pointer passed to %s\n", __FUNCTION__);
-            return BLADERF_ERR_INVAL;
-        } else {
-            user_meta->status = 0;
-            target_timestamp = user_meta->timestamp;
+/* Account for any samples the RX callback discarded before the buffer that
+ * is about to be consumed */
+static inline void rx_account_gap(struct bladerf_sync *s)
+{
+    struct sync_rx_gap *gap = &s->buf_mgmt.gaps[s->buf_mgmt.cons_i];
+
+    if (gap->samples != 0) {
+        s->overruns.events++;
+        s->overruns.dropped_buffers += gap->buffers;
+        s->overruns.dropped_samples += gap->samples;
+        s->overruns.last_gap_index = gap->index;
+        s->unreported_drops += gap->samples;
+
+        log_debug("RX overrun: %u buffers (%llu samples) dropped @ %llu\n",
+                  gap->buffers, (unsigned long long) gap->samples,
+                  (unsigned long long) gap->index);
+
+        gap->samples = 0;
+    }
+}
+
+/* Report any dropped samples that the caller has not yet been told about.
+ * If the caller did not provide metadata, they can only learn about these via
+ * the cumulative overrun statistics. */
+static inline void rx_report_drops(struct bladerf_sync *s,
+                                   struct bladerf_metadata *user_meta)
+{
+    if (user_meta != NULL && s->unreported_drops != 0) {
+        user_meta->status |= BLADERF_META_STATUS_OVERRUN;
+
+        /* A discontinuity in metadata timestamps may already have provided
+         * a more complete count, which includes any loss in the FPGA */
+        if (user_meta->dropped == 0) {
+            user_meta->dropped = s->unreported_drops;
         }
     }
 
-    b = &s->buf_mgmt;
-    samples_per_buffer = s->stream_config.samples_per_buffer;
+    s->unreported_drops = 0;
+}
 
-    log_verbose("%s: Requests %u samples.\n", __FUNCTION__, num_samples);
+/* Run the RX state machine until a filled buffer is ready to be consumed,
+ * starting the worker if needed. Upon success, s->state will be one of the
+ * SYNC_STATE_USING_BUFFER* states. */
+static int rx_get_buffer(struct bladerf_sync *s, unsigned int timeout_ms)
+{
+    struct buffer_mgmt *b = &s->buf_mgmt;
+    int status = 0;
 
-    while (!exit_early && samples_returned < num_samples && status == 0) {
+    while (status == 0 &&
+           s->state != SYNC_STATE_USING_BUFFER &&
+           s->state != SYNC_STATE_USING_BUFFER_META) {
 
         switch (s->state) {
             case SYNC_STATE_CHECK_WORKER: {
@@ -354,20 +412,19 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
                 break;
 
             case SYNC_STATE_WAIT_FOR_BUFFER:
-                MUTEX_LOCK(&b->lock);
-
                 /* Check the buffer state, as the worker may have produced one
                  * since we last queried the status */
-                if (b->status[b->cons_i] == SYNC_BUFFER_FULL) {
+                if (ATOMIC_LOAD(&b->status[b->cons_i]) == SYNC_BUFFER_FULL) {
                     s->state = SYNC_STATE_BUFFER_READY;
                     log_verbose("%s: buffer %u is ready to consume\n",
                                 __FUNCTION__, b->cons_i);
                 } else {
-                    status = wait_for_buffer(b, timeout_ms,
-                                             __FUNCTION__, b->cons_i);
+                    status = wait_for_buffer(b, b->cons_i, SYNC_BUFFER_FULL,
+                                             timeout_ms, __FUNCTION__);
 
                     if (status == 0) {
-                        if (b->status[b->cons_i] != SYNC_BUFFER_FULL) {
+                        if (ATOMIC_LOAD(&b->status[b->cons_i]) !=
+                            SYNC_BUFFER_FULL) {
                             s->state = SYNC_STATE_CHECK_WORKER;
                         } else {
                             s->state = SYNC_STATE_BUFFER_READY;
@@ -376,15 +433,14 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
                         }
                     }
                 }
-
-                MUTEX_UNLOCK(&b->lock);
                 break;
 
             case SYNC_STATE_BUFFER_READY:
-                MUTEX_LOCK(&b->lock);
-                b->status[b->cons_i] = SYNC_BUFFER_PARTIAL;
+                ATOMIC_STORE(&b->status[b->cons_i], SYNC_BUFFER_PARTIAL);
                 b->partial_off = 0;
-                MUTEX_UNLOCK(&b->lock);
+
+                rx_account_gap(s);
+                stream_stats_latency(sync_stats(s), b->handoff_us[b->cons_i]);
 
                 switch (s->stream_config.format) {
                     case BLADERF_FORMAT_SC16_Q11:
@@ -403,17 +459,77 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
                 }
                 break;
 
-            case SYNC_STATE_USING_BUFFER: /* SC16Q11 buffers w/o metadata */
-                MUTEX_LOCK(&b->lock);
+            default:
+                assert(!"Invalid state");
+                status = BLADERF_ERR_UNEXPECTED;
+        }
+    }
+
+    return status;
+}
+
+int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
+            struct bladerf_metadata *user_meta, unsigned int timeout_ms)
+{
+    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_RX];
+    struct buffer_mgmt *b;
+
+    int status = 0;
+    bool exit_early = false;
+    bool copied_data = false;
+    unsigned int samples_returned = 0;
+    uint8_t *samples_dest = (uint8_t*)samples;
+    uint8_t *buf_src = NULL;
+    unsigned int samples_to_copy = 0;
+    unsigned int samples_per_buffer = 0;
+    uint64_t target_timestamp = UINT64_MAX;
+
+    if (s == NULL || samples == NULL) {
+        log_debug("NULL pointer passed to %s\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (s->lent != NULL && samples != s->lent) {
+        log_debug("%s: Lent samples must be released first\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META) {
+        if (user_meta == NULL) {
+            log_debug("NULL metadata pointer passed to %s\n", __FUNCTION__);
+            return BLADERF_ERR_INVAL;
+        } else {
+            target_timestamp = user_meta->timestamp;
+        }
+    }
+
+    if (user_meta != NULL) {
+        user_meta->status = 0;
+        user_meta->dropped = 0;
+    }
 
+    b = &s->buf_mgmt;
+    samples_per_buffer = s->stream_config.samples_per_buffer;
+
+    log_verbose("%s: Requests %u samples.\n", __FUNCTION__, num_samples);
+
+    while (!exit_early && samples_returned < num_samples && status == 0) {
+
+        switch (s->state) {
+            case SYNC_STATE_CHECK_WORKER:
+            case SYNC_STATE_RESET_BUF_MGMT:
+            case SYNC_STATE_START_WORKER:
+            case SYNC_STATE_WAIT_FOR_BUFFER:
+            case SYNC_STATE_BUFFER_READY:
+                status = rx_get_buffer(s, timeout_ms);
+                break;
+
+            case SYNC_STATE_USING_BUFFER: /* SC16Q11 buffers w/o metadata */
                 buf_src = (uint8_t*)b->buffers[b->cons_i];
 
                 samples_to_copy = uint_min(num_samples - samples_returned,
                                            samples_per_buffer - b->partial_off);
 
-                memcpy(samples_dest + samples2bytes(s, samples_returned),
-                       buf_src + samples2bytes(s, b->partial_off),
-                       samples2bytes(s, samples_to_copy));
+                s->stream_config.conv.to_host(
+                        samples_dest + user_samples2bytes(s, samples_returned),
+                        buf_src + samples2bytes(s, b->partial_off),
+                        samples_to_copy);
 
                 b->partial_off += samples_to_copy;
                 samples_returned += samples_to_copy;
@@ -431,31 +547,16 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
                     advance_rx_buffer(b);
                     s->state = SYNC_STATE_WAIT_FOR_BUFFER;
                 }
-
-                MUTEX_UNLOCK(&b->lock);
                 break;
 
 
             case SYNC_STATE_USING_BUFFER_META: /* SC16Q11 buffers w/ metadata */
-                MUTEX_LOCK(&b->lock);
-
                 switch (s->meta.state) {
                     case SYNC_META_STATE_HEADER:
 
                         assert(s->meta.msg_num < s->meta.msg_per_buf);
 
-                        buf_src = (uint8_t*)b->buffers[b->cons_i];
-
-                        s->meta.curr_msg =
-                            buf_src + dev->msg_size * s->meta.msg_num;
-
-                        s->meta.msg_timestamp =
-                            metadata_get_timestamp(s->meta.curr_msg);
-
-                        s->meta.msg_flags =
-                            metadata_get_flags(s->meta.curr_msg);
-
-                        s->meta.curr_msg_off = 0;
+                        rx_read_header(s, b);
 
                         /* We've encountered a discontinuity and need to return
                          * what we have so far, setting the status flags */
@@ -464,6 +565,12 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
 
                             user_meta->status |= BLADERF_META_STATUS_OVERRUN;
                             exit_early = true;
+
+                            if (s->meta.msg_timestamp > s->meta.curr_timestamp) {
+                                user_meta->dropped = s->meta.msg_timestamp -
+                                                     s->meta.curr_timestamp;
+                            }
+
                             log_debug("Sample discontinuity detected @ "
                                       "buffer %u, message %u: Expected t=%llu, "
                                       "got t=%llu\n",
@@ -504,11 +611,12 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
                                 uint_min(num_samples - samples_returned,
                                          left_in_msg(s));
 
-                            memcpy(samples_dest + samples2bytes(s, samples_returned),
-                                   s->meta.curr_msg +
-                                        METADATA_HEADER_SIZE +
-                                        samples2bytes(s, s->meta.curr_msg_off),
-                                   samples2bytes(s, samples_to_copy));
+                            s->stream_config.conv.to_host(
+                                samples_dest +
+                                    user_samples2bytes(s, samples_returned),
+                                s->meta.curr_msg + METADATA_HEADER_SIZE +
+                                    samples2bytes(s, s->meta.curr_msg_off),
+                                samples_to_copy);
 
                             samples_returned += samples_to_copy;
                             s->meta.curr_msg_off += samples_to_copy;
@@ -593,8 +701,6 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
                         assert(!"Invalid state");
                         status = BLADERF_ERR_UNEXPECTED;
                 }
-
-                MUTEX_UNLOCK(&b->lock);
                 break;
         }
     }
@@ -603,35 +709,38 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned num_samples,
         user_meta->actual_count = samples_returned;
     }
 
+    rx_report_drops(s, user_meta);
+
     return status;
 }
 
-/* Assumes buffer lock is held */
 static int advance_tx_buffer(struct bladerf_sync *s, struct buffer_mgmt *b)
 {
     int status;
 
     log_verbose("%s: Marking buf[%u] full\n", __FUNCTION__, b->prod_i);
-    b->status[b->prod_i] = SYNC_BUFFER_IN_FLIGHT;
+    ATOMIC_STORE(&b->status[b->prod_i], SYNC_BUFFER_IN_FLIGHT);
+    b->handoff_us[b->prod_i] = stream_stats_now_us();
 
-    /* This call may block and it results in a per-stream lock being held, so
-     * the buffer lock must be dropped.
+    /* Counted before submission, so that the callback never observes more
+     * completions than submissions */
+    COUNTER_ADD(&b->api_handoffs, 1);
+
+    /* This call may block and it results in a per-stream lock being held.
      *
      * A callback may occur in the meantime, but this will not touch the status
      * for this this buffer, or the producer index.
      */
-    MUTEX_UNLOCK(&b->lock);
     status = async_submit_stream_buffer(s->worker->stream,
                                         b->buffers[b->prod_i],
                                         s->stream_config.timeout_ms);
-    MUTEX_LOCK(&b->lock);
 
     if (status == 0) {
         b->prod_i = (b->prod_i + 1) % b->num_buffers;
 
         /* Go handle the next buffer, if we have one available.  Otherwise,
          * check up on the worker's state and restart it if needed. */
-        if (b->status[b->prod_i] == SYNC_BUFFER_EMPTY) {
+        if (ATOMIC_LOAD(&b->status[b->prod_i]) == SYNC_BUFFER_EMPTY) {
             s->state = SYNC_STATE_BUFFER_READY;
         } else {
             s->state = SYNC_STATE_CHECK_WORKER;
@@ -644,6 +753,99 @@ static int advance_tx_buffer(struct bladerf_sync *s, struct buffer_mgmt *b)
     return status;
 }
 
+/* Run the TX state machine until an empty buffer is ready to be filled,
+ * starting the worker if needed. Upon success, s->state will be one of the
+ * SYNC_STATE_USING_BUFFER* states. */
+static int tx_get_buffer(struct bladerf_sync *s, unsigned int timeout_ms)
+{
+    struct buffer_mgmt *b = &s->buf_mgmt;
+    int status = 0;
+
+    while (status == 0 &&
+           s->state != SYNC_STATE_USING_BUFFER &&
+           s->state != SYNC_STATE_USING_BUFFER_META) {
+
+        switch (s->state) {
+            case SYNC_STATE_CHECK_WORKER: {
+                int stream_error;
+                sync_worker_state worker_state =
+                    sync_worker_get_state(s->worker, &stream_error);
+
+                if (stream_error != 0) {
+                    status = stream_error;
+                } else {
+                    if (worker_state == SYNC_WORKER_STATE_IDLE) {
+                        /* No need to reset any buffer managment for TX since
+                         * the TX stream does not submit an initial set of
+                         * buffers.  Therefore the RESET_BUF_MGMT state is
+                         * skipped here. */
+                        s->state = SYNC_STATE_START_WORKER;
+                    } else if (worker_state == SYNC_WORKER_STATE_RUNNING) {
+                        s->state = SYNC_STATE_WAIT_FOR_BUFFER;
+                    }
+                }
+                break;
+            }
+
+            case SYNC_STATE_RESET_BUF_MGMT:
+                assert(!"Bug");
+                break;
+
+            case SYNC_STATE_START_WORKER:
+                sync_worker_submit_request(s->worker, SYNC_WORKER_START);
+
+                status = sync_worker_wait_for_state(
+                        s->worker,
+                        SYNC_WORKER_STATE_RUNNING,
+                        SYNC_WORKER_START_TIMEOUT_MS);
+
+                if (status == 0) {
+                    s->state = SYNC_STATE_WAIT_FOR_BUFFER;
+                    log_debug("%s: Worker is now running.\n", __FUNCTION__);
+                }
+                break;
+
+            case SYNC_STATE_WAIT_FOR_BUFFER:
+                /* Check the buffer state, as the worker may have consumed one
+                 * since we last queried the status */
+                if (ATOMIC_LOAD(&b->status[b->prod_i]) == SYNC_BUFFER_EMPTY) {
+                    s->state = SYNC_STATE_BUFFER_READY;
+                } else {
+                    status = wait_for_buffer(b, b->prod_i, SYNC_BUFFER_EMPTY,
+                                             timeout_ms, __FUNCTION__);
+                }
+                break;
+
+            case SYNC_STATE_BUFFER_READY:
+                ATOMIC_STORE(&b->status[b->prod_i], SYNC_BUFFER_PARTIAL);
+                b->partial_off = 0;
+
+                switch (s->stream_config.format) {
+                    case BLADERF_FORMAT_SC16_Q11:
+                        s->state = SYNC_STATE_USING_BUFFER;
+                        break;
+
+                    case BLADERF_FORMAT_SC16_Q11_META:
+                        s->state = SYNC_STATE_USING_BUFFER_META;
+                        s->meta.curr_msg_off = 0;
+                        s->meta.msg_num = 0;
+                        break;
+
+                    default:
+                        assert(!"Invalid stream format");
+                        status = BLADERF_ERR_UNEXPECTED;
+                }
+                break;
+
+            default:
+                assert(!"Invalid state");
+                status = BLADERF_ERR_UNEXPECTED;
+        }
+    }
+
+    return status;
+}
+
 int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
              struct bladerf_metadata *user_meta, unsigned int timeout_ms)
 {
@@ -660,6 +862,9 @@ int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
 
     if (s == NULL || samples == NULL) {
         return BLADERF_ERR_INVAL;
+    } else if (s->lent != NULL && samples != s->lent) {
+        log_debug("%s: Lent samples must be released first\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
     }
 
     if (s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META) {
@@ -721,92 +926,23 @@ int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
     while (status == 0 && ((samples_written < num_samples) || flush) ) {
 
         switch (s->state) {
-            case SYNC_STATE_CHECK_WORKER: {
-                int stream_error;
-                sync_worker_state worker_state =
-                    sync_worker_get_state(s->worker, &stream_error);
-
-                if (stream_error != 0) {
-                    status = stream_error;
-                } else {
-                    if (worker_state == SYNC_WORKER_STATE_IDLE) {
-                        /* No need to reset any buffer managment for TX since
-                         * the TX stream does not submit an initial set of
-                         * buffers.  Therefore the RESET_BUF_MGMT state is
-                         * skipped here. */
-                        s->state = SYNC_STATE_START_WORKER;
-                    }
-                }
-                break;
-            }
-
+            case SYNC_STATE_CHECK_WORKER:
             case SYNC_STATE_RESET_BUF_MGMT:
-                assert(!"Bug");
-                break;
-
             case SYNC_STATE_START_WORKER:
-                sync_worker_submit_request(s->worker, SYNC_WORKER_START);
-
-                status = sync_worker_wait_for_state(
-                        s->worker,
-                        SYNC_WORKER_STATE_RUNNING,
-                        SYNC_WORKER_START_TIMEOUT_MS);
-
-                if (status == 0) {
-                    s->state = SYNC_STATE_WAIT_FOR_BUFFER;
-                    log_debug("%s: Worker is now running.\n", __FUNCTION__);
-                }
-                break;
-
             case SYNC_STATE_WAIT_FOR_BUFFER:
-                MUTEX_LOCK(&b->lock);
-
-                /* Check the buffer state, as the worker may have consumed one
-                 * since we last queried the status */
-                if (b->status[b->prod_i] == SYNC_BUFFER_EMPTY) {
-                    s->state = SYNC_STATE_BUFFER_READY;
-                } else {
-                    status = wait_for_buffer(b, timeout_ms,
-                                             __FUNCTION__, b->prod_i);
-                }
-
-                MUTEX_UNLOCK(&b->lock);
-                break;
-
             case SYNC_STATE_BUFFER_READY:
-                MUTEX_LOCK(&b->lock);
-                b->status[b->prod_i] = SYNC_BUFFER_PARTIAL;
-                b->partial_off = 0;
-                MUTEX_UNLOCK(&b->lock);
-
-                switch (s->stream_config.format) {
-                    case BLADERF_FORMAT_SC16_Q11:
-                        s->state = SYNC_STATE_USING_BUFFER;
-                        break;
-
-                    case BLADERF_FORMAT_SC16_Q11_META:
-                        s->state = SYNC_STATE_USING_BUFFER_META;
-                        s->meta.curr_msg_off = 0;
-                        s->meta.msg_num = 0;
-                        break;
-
-                    default:
-                        assert(!"Invalid stream format");
-                        status = BLADERF_ERR_UNEXPECTED;
-                }
+                status = tx_get_buffer(s, timeout_ms);
                 break;
 
-
             case SYNC_STATE_USING_BUFFER:
-                MUTEX_LOCK(&b->lock);
-
                 buf_dest = (uint8_t*)b->buffers[b->prod_i];
                 samples_to_copy = uint_min(num_samples - samples_written,
                                            samples_per_buffer - b->partial_off);
 
-                memcpy(buf_dest + samples2bytes(s, b->partial_off),
-                        samples_src + samples2bytes(s, samples_written),
-                        samples2bytes(s, samples_to_copy));
+                s->stream_config.conv.to_wire(
+                        buf_dest + samples2bytes(s, b->partial_off),
+                        samples_src + user_samples2bytes(s, samples_written),
+                        samples_to_copy);
 
                 b->partial_off += samples_to_copy;
                 samples_written += samples_to_copy;
@@ -821,13 +957,9 @@ int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
                     /* Submit buffer and advance to the next one */
                     status = advance_tx_buffer(s, b);
                 }
-
-                MUTEX_UNLOCK(&b->lock);
                 break;
 
             case SYNC_STATE_USING_BUFFER_META: /* SC16Q11 buffers w/ metadata */
-                MUTEX_LOCK(&b->lock);
-
                 switch (s->meta.state) {
 
                     case SYNC_META_STATE_HEADER:
@@ -863,10 +995,12 @@ int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
                         if (samples_to_copy != 0) {
                             /* We have user data to copy into the current
                              * message within the buffer */
-                            memcpy(s->meta.curr_msg + METADATA_HEADER_SIZE +
-                                        samples2bytes(s, s->meta.curr_msg_off),
-                                   samples_src + samples2bytes(s, samples_written),
-                                   samples2bytes(s, samples_to_copy));
+                            s->stream_config.conv.to_wire(
+                                s->meta.curr_msg + METADATA_HEADER_SIZE +
+                                    samples2bytes(s, s->meta.curr_msg_off),
+                                samples_src +
+                                    user_samples2bytes(s, samples_written),
+                                samples_to_copy);
 
                             s->meta.curr_msg_off += samples_to_copy;
                             s->meta.curr_timestamp += samples_to_copy;
@@ -934,8 +1068,6 @@ int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
                         assert(!"Invalid state");
                         status = BLADERF_ERR_UNEXPECTED;
                 }
-
-                MUTEX_UNLOCK(&b->lock);
                 break;
         }
     }
@@ -949,14 +1081,267 @@ int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
     return status;
 }
 
-unsigned int sync_buf2idx(struct buffer_mgmt *b, void *addr)
+int sync_rx_acquire(struct bladerf *dev, void **samples,
+                    unsigned int *num_samples,
+                    struct bladerf_metadata *user_meta,
+                    unsigned int timeout_ms)
 {
+    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_RX];
+    struct buffer_mgmt *b;
+    uint8_t *buf_src;
+    int status;
+
+    if (s == NULL || samples == NULL || num_samples == NULL) {
+        log_debug("NULL pointer passed to %s\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (s->lent != NULL) {
+        log_debug("%s: Lent samples must be released first\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (!s->stream_config.conv.identity) {
+        log_debug("%s: Samples cannot be lent in a format that requires "
+                  "conversion\n", __FUNCTION__);
+        return BLADERF_ERR_UNSUPPORTED;
+    } else if (s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META &&
+               user_meta == NULL) {
+        log_debug("NULL metadata pointer passed to %s\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    }
+
+    b = &s->buf_mgmt;
+
+    status = rx_get_buffer(s, timeout_ms);
+    if (status != 0) {
+        return status;
+    }
+
+    if (s->state == SYNC_STATE_USING_BUFFER) {
+        buf_src = (uint8_t*)b->buffers[b->cons_i];
+
+        s->lent = buf_src + samples2bytes(s, b->partial_off);
+        s->lent_count = s->stream_config.samples_per_buffer - b->partial_off;
+    } else {
+        /* Messages are lent one at a time, as their headers sit between
+         * each run of samples */
+        if (s->meta.state == SYNC_META_STATE_HEADER) {
+            rx_read_header(s, b);
+            s->meta.curr_timestamp = s->meta.msg_timestamp;
+            s->meta.state = SYNC_META_STATE_SAMPLES;
+        }
+
+        s->lent = s->meta.curr_msg + METADATA_HEADER_SIZE +
+                    samples2bytes(s, s->meta.curr_msg_off);
+
+        s->lent_count = left_in_msg(s);
+
+        user_meta->timestamp = s->meta.curr_timestamp;
+        user_meta->actual_count = s->lent_count;
+    }
+
+    if (user_meta != NULL) {
+        user_meta->status = 0;
+        user_meta->dropped = 0;
+    }
+
+    rx_report_drops(s, user_meta);
+
+    log_verbose("%s: Lent %u samples to caller\n",
+                __FUNCTION__, s->lent_count);
+
+    *samples = s->lent;
+    *num_samples = s->lent_count;
+
+    return 0;
+}
+
+int sync_rx_release(struct bladerf *dev, void *samples,
+                    unsigned int num_samples)
+{
+    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_RX];
+    struct bladerf_metadata meta;
+    int status;
+
+    if (s == NULL || samples == NULL || samples != s->lent) {
+        log_debug("%s: Samples were not lent via sync_rx_acquire()\n",
+                  __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (num_samples > s->lent_count) {
+        log_debug("%s: Releasing %u samples, but only %u were lent\n",
+                  __FUNCTION__, num_samples, s->lent_count);
+        return BLADERF_ERR_INVAL;
+    }
+
+    /* The samples are consumed in place, so this won't copy or block.
+     * RX_NOW ensures no timestamp seeking occurs in metadata mode. */
+    memset(&meta, 0, sizeof(meta));
+    meta.flags = BLADERF_META_FLAG_RX_NOW;
+
+    status = sync_rx(dev, samples, num_samples, &meta, 0);
+
+    s->lent = NULL;
+    s->lent_count = 0;
+
+    return status;
+}
+
+int sync_get_rx_overrun_stats(struct bladerf *dev,
+                              struct bladerf_rx_overrun_stats *stats)
+{
+    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_RX];
+
+    if (s == NULL) {
+        log_debug("%s: RX sync interface is not configured\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    }
+
+    *stats = s->overruns;
+    return 0;
+}
+
+int sync_pause(struct bladerf *dev, bladerf_module module)
+{
+    struct bladerf_sync *s = dev->sync[module];
+    struct buffer_mgmt *b;
     unsigned int i;
+    int status;
+
+    if (s == NULL) {
+        log_debug("%s: %s sync interface is not configured\n",
+                  __FUNCTION__, module2str(module));
+        return BLADERF_ERR_INVAL;
+    } else if (s->lent != NULL) {
+        log_debug("%s: Lent samples must be released first\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    }
 
+    status = sync_worker_pause(s->worker, s->stream_config.timeout_ms);
+    if (status != 0) {
+        return status;
+    }
+
+    /* Discard any samples that have not yet been consumed or transmitted.
+     * The worker is idle, so buffer statuses may be updated freely. The
+     * worker sets up the RX in-flight buffers when it is restarted. */
+    b = &s->buf_mgmt;
+
+    MUTEX_LOCK(&b->lock);
     for (i = 0; i < b->num_buffers; i++) {
-        if (b->buffers[i] == addr) {
-            return i;
-        }
+        ATOMIC_STORE(&b->status[i], SYNC_BUFFER_EMPTY);
+    }
+
+    b->prod_i = 0;
+    b->cons_i = 0;
+    b->partial_off = 0;
+    MUTEX_UNLOCK(&b->lock);
+
+    s->meta.state = SYNC_META_STATE_HEADER;
+    if (module == BLADERF_MODULE_RX) {
+        s->meta.msg_timestamp = 0;
+        s->meta.msg_flags = 0;
+        s->unreported_drops = 0;
+    } else {
+        s->meta.in_burst = false;
+        s->meta.now = false;
+    }
+
+    /* The stream will be restarted by the next sync_rx() or sync_tx() call */
+    s->state = SYNC_STATE_CHECK_WORKER;
+
+    return 0;
+}
+
+int sync_tx_acquire(struct bladerf *dev, void **samples,
+                    unsigned int *num_samples, unsigned int timeout_ms)
+{
+    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_TX];
+    struct buffer_mgmt *b;
+    uint8_t *buf_dest;
+    int status;
+
+    if (s == NULL || samples == NULL || num_samples == NULL) {
+        log_debug("NULL pointer passed to %s\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (s->lent != NULL) {
+        log_debug("%s: Lent samples must be released first\n", __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (!s->stream_config.conv.identity) {
+        log_debug("%s: Samples cannot be lent in a format that requires "
+                  "conversion\n", __FUNCTION__);
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+
+    b = &s->buf_mgmt;
+
+    status = tx_get_buffer(s, timeout_ms);
+    if (status != 0) {
+        return status;
+    }
+
+    buf_dest = (uint8_t*)b->buffers[b->prod_i];
+
+    if (s->state == SYNC_STATE_USING_BUFFER) {
+        s->lent = buf_dest + samples2bytes(s, b->partial_off);
+        s->lent_count = s->stream_config.samples_per_buffer - b->partial_off;
+    } else if (s->meta.state == SYNC_META_STATE_HEADER) {
+        /* The header isn't written until sync_tx_release(), as that's when
+         * we find out about the burst flags and timestamp */
+        s->lent = buf_dest + dev->msg_size * s->meta.msg_num +
+                    METADATA_HEADER_SIZE;
+
+        s->lent_count = s->meta.samples_per_msg;
+    } else {
+        s->lent = s->meta.curr_msg + METADATA_HEADER_SIZE +
+                    samples2bytes(s, s->meta.curr_msg_off);
+
+        s->lent_count = left_in_msg(s);
+    }
+
+    log_verbose("%s: Lent %u samples to caller\n",
+                __FUNCTION__, s->lent_count);
+
+    *samples = s->lent;
+    *num_samples = s->lent_count;
+
+    return 0;
+}
+
+int sync_tx_release(struct bladerf *dev, void *samples,
+                    unsigned int num_samples,
+                    struct bladerf_metadata *user_meta,
+                    unsigned int timeout_ms)
+{
+    struct bladerf_sync *s = dev->sync[BLADERF_MODULE_TX];
+    int status;
+
+    if (s == NULL || samples == NULL || samples != s->lent) {
+        log_debug("%s: Samples were not lent via sync_tx_acquire()\n",
+                  __FUNCTION__);
+        return BLADERF_ERR_INVAL;
+    } else if (num_samples > s->lent_count) {
+        log_debug("%s: Releasing %u samples, but only %u were lent\n",
+                  __FUNCTION__, num_samples, s->lent_count);
+        return BLADERF_ERR_INVAL;
+    }
+
+    /* The samples are already in place, so sync_tx() only needs to
+     * fill in headers, flush, and submit buffers as needed. */
+    status = sync_tx(dev, samples, num_samples, user_meta, timeout_ms);
+
+    s->lent = NULL;
+    s->lent_count = 0;
+
+    return status;
+}
+
+unsigned int sync_buf2idx(struct buffer_mgmt *b, void *addr)
+{
+    /* Stream buffers are carved out of a single contiguous arena */
+    const uintptr_t base = (uintptr_t) b->buffers[0];
+    const uintptr_t offset = (uintptr_t) addr - base;
+    const size_t i = offset / b->buffer_bytes;
+
+    if ((uintptr_t) addr >= base && offset % b->buffer_bytes == 0 &&
+        i < b->num_buffers) {
+        return (unsigned int) i;
     }
 
     assert(!"Bug: Buffer not found.");
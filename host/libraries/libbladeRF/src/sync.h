@@ -25,12 +25,15 @@
 #include <pthread.h>
 #include <libbladeRF.h>
 
+#include "sample_conv.h"
+
 #define MODULE_STR(s) module2str(s->stream_config.module)
 
 /* These parameters are only written during sync_init */
 struct stream_config
 {
-    bladerf_format format;
+    bladerf_format format;      /* Format of the samples exchanged with the
+                                 * device. See sample_conv_wire_format(). */
     bladerf_module module;
 
     unsigned int samples_per_buffer;
@@ -38,6 +41,9 @@ struct stream_config
     unsigned int timeout_ms;
 
     size_t bytes_per_sample;
+
+    /* Converts samples between the caller's format and the above format */
+    struct sample_conv conv;
 };
 
 typedef enum {
@@ -52,11 +58,25 @@ typedef enum {
     SYNC_META_STATE_SAMPLES,      /**< Process samples */
 } sync_meta_state;
 
+/* Samples discarded by the RX callback to recover from an overrun */
+struct sync_rx_gap {
+    uint64_t index;             /**< Stream sample index of the first sample
+                                 *   discarded */
+    uint64_t samples;           /**< # of samples discarded. 0 = no gap */
+    unsigned int buffers;       /**< # of buffers discarded */
+};
+
+/* The buffers form a single-producer/single-consumer ring between the
+ * stream callbacks and the API-side functions. Status entries are only
+ * accessed via ATOMIC_LOAD()/ATOMIC_STORE(); the side that currently owns a
+ * buffer (as indicated by its status) may access it without locking. */
 struct buffer_mgmt {
     sync_buffer_status *status;
 
     void **buffers;
     unsigned int num_buffers;
+    size_t buffer_bytes;        /**< Size of (and distance between) the
+                                 *   contiguously allocated buffers */
 
     unsigned int prod_i;        /**< Producer index - next buffer to fill */
     unsigned int cons_i;        /**< Consumer index - next buffer to empty */
@@ -67,8 +87,42 @@ struct buffer_mgmt {
      * resubmission */
     unsigned int resubmit_count;
 
+    /* RX overrun accounting. gaps[i] describes any samples discarded
+     * immediately before the contents of buffer i, and is written by the RX
+     * callback before the buffer is handed off. The remaining items are only
+     * accessed from the RX callback while the stream is running. */
+    struct sync_rx_gap *gaps;
+    struct sync_rx_gap pending_gap; /**< Gap preceding the next handoff */
+    uint64_t rx_samples;            /**< # samples received (including
+                                     *   those discarded) since the stream
+                                     *   was started */
+
+    /* Running totals of buffers handed between the two sides, from which the
+     * callbacks derive buffer occupancy without scanning the status array.
+     * worker_handoffs is only accessed from the callbacks while the stream is
+     * running. api_handoffs is written by the API side, and is accessed via
+     * the COUNTER_* accessors. Both are re-baselined by the worker when the
+     * stream is (re)started.
+     *
+     * RX: worker_handoffs counts buffers marked full by the callback, and
+     *     api_handoffs counts buffers emptied by sync_rx().
+     * TX: api_handoffs counts buffers submitted by sync_tx(), and
+     *     worker_handoffs counts their completions. */
+    uint64_t worker_handoffs;
+    uint64_t api_handoffs;
+
+    /* Time (stream_stats_now_us()) at which each buffer was last handed to
+     * the other side, for latency statistics. RX: when the callback marked
+     * it full. TX: when it was submitted. */
+    uint64_t *handoff_us;
+
+    /* Non-zero while the API side is blocked (or about to block) on
+     * buf_ready. Callbacks only acquire the lock and signal buf_ready when
+     * this is set. */
+    int waiting;
 
-    MUTEX lock;
+    MUTEX lock;                 /**< Only required to wait on or signal
+                                 *   buf_ready, or while the stream is idle */
     pthread_cond_t  buf_ready;  /**< Buffer produced by RX callback, or
                                  *   buffer emptied by TX callback */
 };
@@ -121,6 +175,16 @@ struct bladerf_sync {
     struct stream_config stream_config;
     struct sync_worker *worker;
     struct sync_meta meta;
+
+    /* Samples currently lent to the API user via sync_rx_acquire() or
+     * sync_tx_acquire(). NULL when nothing is lent out. */
+    void *lent;
+    unsigned int lent_count;
+
+    /* RX overruns encountered by the API side so far, and the number of
+     * dropped samples not yet reported to the caller via metadata */
+    struct bladerf_rx_overrun_stats overruns;
+    uint64_t unreported_drops;
 };
 
 /**
@@ -155,6 +219,110 @@ int sync_rx(struct bladerf *dev, void *samples, unsigned int num_samples,
 int sync_tx(struct bladerf *dev, void *samples, unsigned int num_samples,
              struct bladerf_metadata *metadata, unsigned int timeout_ms);
 
+/**
+ * @return Number of samples held by each buffer, excluding metadata headers
+ */
+static inline unsigned int sync_payload_per_buffer(const struct bladerf_sync *s)
+{
+    if (s->stream_config.format == BLADERF_FORMAT_SC16_Q11_META) {
+        return s->meta.msg_per_buf * s->meta.samples_per_msg;
+    } else {
+        return s->stream_config.samples_per_buffer;
+    }
+}
+
+/**
+ * @return Statistics for the module a sync handle is associated with
+ */
+static inline struct stream_stats * sync_stats(const struct bladerf_sync *s)
+{
+    return &s->dev->stream_stats[s->stream_config.module];
+}
+
+/**
+ * @return Number of buffers whose status is currently `status`
+ */
+static inline unsigned int sync_count_buffers(struct buffer_mgmt *b,
+                                              sync_buffer_status status)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < b->num_buffers; i++) {
+        if (ATOMIC_LOAD(&b->status[i]) == status) {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Fetch cumulative RX overrun statistics
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_get_rx_overrun_stats(struct bladerf *dev,
+                              struct bladerf_rx_overrun_stats *stats);
+
+/**
+ * Stop the module's stream while retaining its worker, buffers, and
+ * transfers. Samples not yet consumed (RX) or transmitted (TX) are discarded.
+ * The stream is restarted by the next sync_rx() or sync_tx() call.
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_pause(struct bladerf *dev, bladerf_module module);
+
+/**
+ * Lend the caller a pointer directly into the next filled RX buffer, avoiding
+ * the copy performed by sync_rx(). The samples must be handed back via
+ * sync_rx_release() before any other sync_rx*() call is made.
+ *
+ * In ::BLADERF_FORMAT_SC16_Q11_META mode, at most one message's worth of
+ * samples is lent at a time, and the metadata timestamp is updated to reflect
+ * the first lent sample.
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_rx_acquire(struct bladerf *dev, void **samples,
+                    unsigned int *num_samples,
+                    struct bladerf_metadata *metadata,
+                    unsigned int timeout_ms);
+
+/**
+ * Return samples lent by sync_rx_acquire(), marking the first `num_samples`
+ * of them as consumed.
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_rx_release(struct bladerf *dev, void *samples,
+                    unsigned int num_samples);
+
+/**
+ * Lend the caller a pointer directly into the current TX buffer, avoiding the
+ * copy performed by sync_tx(). The samples must be handed back via
+ * sync_tx_release() before any other sync_tx*() call is made.
+ *
+ * In ::BLADERF_FORMAT_SC16_Q11_META mode, at most one message's worth of
+ * samples is lent at a time.
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_tx_acquire(struct bladerf *dev, void **samples,
+                    unsigned int *num_samples, unsigned int timeout_ms);
+
+/**
+ * Return samples lent by sync_tx_acquire(), committing the first
+ * `num_samples` of them for transmission. The metadata is handled exactly
+ * as it is by sync_tx().
+ *
+ * @return 0 or BLADERF_ERR_* value on failure
+ */
+int sync_tx_release(struct bladerf *dev, void *samples,
+                    unsigned int num_samples,
+                    struct bladerf_metadata *metadata,
+                    unsigned int timeout_ms);
+
 unsigned int sync_buf2idx(struct buffer_mgmt *b, void *addr);
 
 void * sync_idx2buf(struct buffer_mgmt *b, unsigned int idx);
@@ -35,9 +35,24 @@
 #include "sync.h"
 #include "sync_worker.h"
 #include "conversions.h"
+#include "thread_config.h"
 
 void *sync_worker_task(void *arg);
 
+/* Hand a buffer off to the API side by updating its status. The buffer lock
+ * is only acquired to wake the API side if it is blocked on buf_ready. */
+static inline void handoff_buffer(struct buffer_mgmt *b, unsigned int idx,
+                                  sync_buffer_status status)
+{
+    ATOMIC_STORE_SC(&b->status[idx], status);
+
+    if (ATOMIC_LOAD_SC(&b->waiting)) {
+        MUTEX_LOCK(&b->lock);
+        pthread_cond_signal(&b->buf_ready);
+        MUTEX_UNLOCK(&b->lock);
+    }
+}
+
 static void *rx_callback(struct bladerf *dev,
                          struct bladerf_stream *stream,
                          struct bladerf_metadata *meta,
@@ -53,35 +68,47 @@ static void *rx_callback(struct bladerf *dev,
     struct bladerf_sync *s = (struct bladerf_sync *)user_data;
     struct sync_worker  *w = s->worker;
     struct buffer_mgmt  *b = &s->buf_mgmt;
+    const unsigned int payload = sync_payload_per_buffer(s);
 
-    /* Check if the caller has requested us to shut down. We'll keep the
-     * SHUTDOWN bit set through our transition into the IDLE state so we
-     * can act on it there. */
-    MUTEX_LOCK(&w->request_lock);
-    requests = w->requests;
-    MUTEX_UNLOCK(&w->request_lock);
+    /* Check if the caller has requested us to stop or pause. We'll keep the
+     * request bits set through our transition into the IDLE state so we
+     * can act on them there. */
+    requests = ATOMIC_LOAD(&w->requests);
 
-    if (requests & SYNC_WORKER_STOP) {
-        log_verbose("%s worker: Got STOP request upon entering callback. "
-                    "Ending stream.\n", MODULE_STR(s));
-        return NULL;
+    if (requests & (SYNC_WORKER_STOP | SYNC_WORKER_PAUSE)) {
+        log_verbose("%s worker: Got STOP/PAUSE request upon entering "
+                    "callback. Ending stream.\n", MODULE_STR(s));
+        return BLADERF_STREAM_SHUTDOWN;
     }
 
-    MUTEX_LOCK(&b->lock);
-
     /* Get the index of the buffer that was just filled */
     samples_idx = sync_buf2idx(b, samples);
 
+    /* The producer index, resubmit count, and overrun accounting items are
+     * only accessed from this callback while the stream is running, so no
+     * locking is required */
     if (b->resubmit_count == 0) {
-        if (b->status[b->prod_i] == SYNC_BUFFER_EMPTY) {
+        if (ATOMIC_LOAD(&b->status[b->prod_i]) == SYNC_BUFFER_EMPTY) {
+
+            /* Note any samples discarded since the previous handoff. The
+             * consumer reads this after observing the FULL status. */
+            b->gaps[samples_idx] = b->pending_gap;
+            b->pending_gap.samples = 0;
+            b->pending_gap.buffers = 0;
 
             /* This buffer is now ready for the consumer */
-            b->status[samples_idx] = SYNC_BUFFER_FULL;
-            pthread_cond_signal(&b->buf_ready);
+            b->handoff_us[samples_idx] = stream_stats_now_us();
+            b->worker_handoffs++;
+            handoff_buffer(b, samples_idx, SYNC_BUFFER_FULL);
+
+            /* Buffers handed to the consumer and not yet emptied */
+            stream_stats_update_max(&sync_stats(s)->full_max,
+                (unsigned int) (b->worker_handoffs -
+                                COUNTER_LOAD(&b->api_handoffs)));
 
             /* Update the state of the buffer being submitted next */
             next_idx = b->prod_i;
-            b->status[next_idx] = SYNC_BUFFER_IN_FLIGHT;
+            ATOMIC_STORE(&b->status[next_idx], SYNC_BUFFER_IN_FLIGHT);
             next_buf = b->buffers[next_idx];
 
             /* Advance to the next buffer for the next callback */
@@ -91,23 +118,36 @@ static void *rx_callback(struct bladerf *dev,
                         MODULE_STR(s), samples_idx, next_idx);
 
         } else {
-            /* TODO propgate back the RX Overrun to the sync_rx() caller */
             log_debug("RX overrun @ buffer %u\r\n", samples_idx);
 
+            /* The contents of this buffer, and of those still in flight,
+             * are discarded. They're accounted for as a single gap that is
+             * reported along with the next buffer handed to the consumer. */
+            if (b->pending_gap.samples == 0) {
+                b->pending_gap.index = b->rx_samples;
+                COUNTER_ADD(&sync_stats(s)->overruns, 1);
+            }
+
+            b->pending_gap.samples += payload;
+            b->pending_gap.buffers++;
+
             next_buf = samples;
             b->resubmit_count = s->stream_config.num_xfers - 1;
         }
     } else {
         /* We're still recovering from an overrun at this point. Just
          * turn around and resubmit this buffer */
+        b->pending_gap.samples += payload;
+        b->pending_gap.buffers++;
+
         next_buf = samples;
         b->resubmit_count--;
         log_verbose("Resubmitting buffer %u (%u resubmissions left)\r\n",
                     samples_idx, b->resubmit_count);
     }
 
+    b->rx_samples += payload;
 
-    MUTEX_UNLOCK(&b->lock);
     return next_buf;
 }
 
@@ -120,37 +160,43 @@ static void *tx_callback(struct bladerf *dev,
 {
     unsigned int requests;      /* Pending requests */
     unsigned int completed_idx; /* Index of completed buffer */
+    unsigned int in_flight;     /* Buffers submitted but not yet completed */
 
     struct bladerf_sync *s = (struct bladerf_sync *)user_data;
     struct sync_worker  *w = s->worker;
     struct buffer_mgmt  *b = &s->buf_mgmt;
 
-    /* Check if the caller has requested us to shut down. We'll keep the
-     * SHUTDOWN bit set through our transition into the IDLE state so we
-     * can act on it there. */
-    MUTEX_LOCK(&w->request_lock);
-    requests = w->requests;
-    MUTEX_UNLOCK(&w->request_lock);
+    /* Check if the caller has requested us to stop or pause. We'll keep the
+     * request bits set through our transition into the IDLE state so we
+     * can act on them there. */
+    requests = ATOMIC_LOAD(&w->requests);
 
-    if (requests & SYNC_WORKER_STOP) {
-        log_verbose("%s worker: Got STOP request upon entering callback. "
-                    "Ending stream.\r\n", MODULE_STR(s));
-        return NULL;
+    if (requests & (SYNC_WORKER_STOP | SYNC_WORKER_PAUSE)) {
+        log_verbose("%s worker: Got STOP/PAUSE request upon entering "
+                    "callback. Ending stream.\r\n", MODULE_STR(s));
+        return BLADERF_STREAM_SHUTDOWN;
     }
 
 
     /* Mark the last transfer as being completed. Note that the first
      * callbacks we get have samples=NULL */
     if (samples != NULL) {
-
-        MUTEX_LOCK(&b->lock);
-
         completed_idx = sync_buf2idx(b, samples);
-        assert(b->status[completed_idx] == SYNC_BUFFER_IN_FLIGHT);
-        b->status[completed_idx] = SYNC_BUFFER_EMPTY;
-
-        pthread_cond_signal(&b->buf_ready);
-        MUTEX_UNLOCK(&b->lock);
+        assert(ATOMIC_LOAD(&b->status[completed_idx]) ==
+               SYNC_BUFFER_IN_FLIGHT);
+
+        stream_stats_latency(sync_stats(s), b->handoff_us[completed_idx]);
+        b->worker_handoffs++;
+        handoff_buffer(b, completed_idx, SYNC_BUFFER_EMPTY);
+
+        /* Buffers not submitted are awaiting samples. Once the stream has
+         * drained, every buffer is trivially empty. */
+        in_flight = (unsigned int) (COUNTER_LOAD(&b->api_handoffs) -
+                                    b->worker_handoffs);
+        if (in_flight != 0) {
+            stream_stats_update_max(&sync_stats(s)->empty_max,
+                                    b->num_buffers - in_flight);
+        }
 
         log_verbose("%s worker: Buffer %u emptied.\r\n",
                     MODULE_STR(s), completed_idx);
@@ -162,6 +208,7 @@ static void *tx_callback(struct bladerf *dev,
 int sync_worker_init(struct bladerf_sync *s)
 {
     int status = 0;
+    unsigned int i;
     s->worker = (struct sync_worker*) calloc(1, sizeof(*s->worker));
 
     if (s->worker == NULL) {
@@ -191,6 +238,20 @@ int sync_worker_init(struct bladerf_sync *s)
         goto worker_init_out;
     }
 
+    s->buf_mgmt.buffer_bytes = async_stream_buf_bytes(s->worker->stream);
+
+    /* sync_buf2idx() derives a buffer's index from its offset into the
+     * stream's arena, so verify that this holds for every buffer before the
+     * callbacks rely upon it */
+    for (i = 0; i < s->buf_mgmt.num_buffers; i++) {
+        if (sync_buf2idx(&s->buf_mgmt, s->buf_mgmt.buffers[i]) != i) {
+            log_error("%s worker: Buffer %u is not at its expected offset\n",
+                      MODULE_STR(s), i);
+            async_deinit_stream(s->worker->stream);
+            status = BLADERF_ERR_UNEXPECTED;
+            goto worker_init_out;
+        }
+    }
 
     MUTEX_INIT(&s->worker->state_lock);
     MUTEX_INIT(&s->worker->request_lock);
@@ -243,6 +304,11 @@ void sync_worker_deinit(struct sync_worker *w,
 
     sync_worker_submit_request(w, SYNC_WORKER_STOP);
 
+    /* Callbacks will observe the request and end the stream, but a TX
+     * stream with nothing in flight won't be calling back. Shut the stream
+     * down directly in case that's the situation. */
+    async_submit_stream_buffer(w->stream, BLADERF_STREAM_SHUTDOWN, 0);
+
     if (lock != NULL && cond != NULL) {
         MUTEX_LOCK(lock);
         pthread_cond_signal(cond);
@@ -264,10 +330,38 @@ void sync_worker_deinit(struct sync_worker *w,
     free(w);
 }
 
+int sync_worker_pause(struct sync_worker *w, unsigned int timeout_ms)
+{
+    int status;
+    int stream_error;
+
+    log_verbose("%s: Requesting worker %p to pause...\n", __FUNCTION__, w);
+
+    /* As with stopping, shut the stream down directly in case it is not
+     * expecting any further callbacks */
+    sync_worker_submit_request(w, SYNC_WORKER_PAUSE);
+    async_submit_stream_buffer(w->stream, BLADERF_STREAM_SHUTDOWN, 0);
+
+    status = sync_worker_wait_for_state(w, SYNC_WORKER_STATE_IDLE, timeout_ms);
+    if (status != 0) {
+        log_debug("%s: Failed to pause worker: %s\n", __FUNCTION__,
+                  bladerf_strerror(status));
+        return status;
+    }
+
+    /* The stream was ended intentionally, so any error it reported while
+     * shutting down is of no interest */
+    sync_worker_get_state(w, &stream_error);
+
+    return 0;
+}
+
 void sync_worker_submit_request(struct sync_worker *w, unsigned int request)
 {
     MUTEX_LOCK(&w->request_lock);
-    w->requests |= request;
+
+    /* Stream callbacks poll this without acquiring the request lock */
+    ATOMIC_STORE(&w->requests, w->requests | request);
     pthread_cond_signal(&w->requests_pending);
     MUTEX_UNLOCK(&w->request_lock);
 }
@@ -369,7 +463,7 @@ static sync_worker_state exec_idle_state(struct bladerf_sync *s)
     }
 
     requests = s->worker->requests;
-    s->worker->requests = 0;
+    ATOMIC_STORE(&s->worker->requests, 0);
     MUTEX_UNLOCK(&s->worker->request_lock);
 
     if (requests & SYNC_WORKER_STOP) {
@@ -388,27 +482,49 @@ static sync_worker_state exec_idle_state(struct bladerf_sync *s)
             * stale buffers marked "in-flight" that have since been cancelled. */
             for (i = 0; i < s->buf_mgmt.num_buffers; i++) {
                 if (s->buf_mgmt.status[i] == SYNC_BUFFER_IN_FLIGHT) {
-                    s->buf_mgmt.status[i] = SYNC_BUFFER_EMPTY;
+                    ATOMIC_STORE(&s->buf_mgmt.status[i], SYNC_BUFFER_EMPTY);
                 }
             }
 
+            /* Nothing is in flight */
+            s->buf_mgmt.worker_handoffs = 0;
+            COUNTER_STORE(&s->buf_mgmt.api_handoffs, 0);
+
             pthread_cond_signal(&s->buf_mgmt.buf_ready);
         } else {
             assert(s->stream_config.module == BLADERF_MODULE_RX);
             s->buf_mgmt.prod_i = s->stream_config.num_xfers;
+            s->buf_mgmt.resubmit_count = 0;
+
+            /* Sample indices are relative to the start of the stream */
+            s->buf_mgmt.rx_samples = 0;
+            memset(&s->buf_mgmt.pending_gap, 0,
+                   sizeof(s->buf_mgmt.pending_gap));
+            memset(s->buf_mgmt.gaps, 0,
+                   s->buf_mgmt.num_buffers * sizeof(s->buf_mgmt.gaps[0]));
 
             for (i = 0; i < s->buf_mgmt.num_buffers; i++) {
                 if (i < s->stream_config.num_xfers) {
-                    s->buf_mgmt.status[i] = SYNC_BUFFER_IN_FLIGHT;
+                    ATOMIC_STORE(&s->buf_mgmt.status[i],
+                                 SYNC_BUFFER_IN_FLIGHT);
                 } else if (s->buf_mgmt.status[i] == SYNC_BUFFER_IN_FLIGHT) {
-                    s->buf_mgmt.status[i] = SYNC_BUFFER_EMPTY;
+                    ATOMIC_STORE(&s->buf_mgmt.status[i], SYNC_BUFFER_EMPTY);
                 }
             }
+
+            /* Account for any buffers the consumer has yet to empty */
+            s->buf_mgmt.worker_handoffs =
+                sync_count_buffers(&s->buf_mgmt, SYNC_BUFFER_FULL) +
+                sync_count_buffers(&s->buf_mgmt, SYNC_BUFFER_PARTIAL);
+            COUNTER_STORE(&s->buf_mgmt.api_handoffs, 0);
         }
 
         MUTEX_UNLOCK(&s->buf_mgmt.lock);
 
         next_state = SYNC_WORKER_STATE_RUNNING;
+    } else if (requests & SYNC_WORKER_PAUSE) {
+        /* The stream has already ended by the time we get here */
+        log_verbose("%s worker: Paused\n", MODULE_STR(s));
     } else {
         log_warning("Invalid request value encountered: 0x%08X\n",
                     s->worker->requests);
@@ -447,6 +563,9 @@ void *sync_worker_task(void *arg)
     struct bladerf_sync *s = (struct bladerf_sync *)arg;
 
     log_verbose("%s worker: task started\n", MODULE_STR(s));
+    thread_config_apply(&s->worker->stream->thread_config,
+                        s->stream_config.module == BLADERF_MODULE_RX ?
+                            "RX worker" : "TX worker");
     set_state(s->worker, state);
     log_verbose("%s worker: task state set\n", MODULE_STR(s));
 
@@ -33,11 +33,15 @@
  *
  * STARTUP --+--> IDLE --> RUNNING --+--> SHUTTING_DOWN --> STOPPED
  *           ^----------------------/
+ *
+ * A PAUSE request ends a running stream, returning the worker to IDLE with
+ * its stream, buffers, and transfers intact.
  */
 
 /* Request flags */
 #define SYNC_WORKER_START    (1 << 0)
 #define SYNC_WORKER_STOP     (1 << 1)
+#define SYNC_WORKER_PAUSE    (1 << 2)
 
 typedef enum {
     SYNC_WORKER_STATE_STARTUP,
@@ -91,6 +95,18 @@ int sync_worker_init(struct bladerf_sync *s);
 void sync_worker_deinit(struct sync_worker *w,
                         pthread_mutex_t *lock, pthread_cond_t *cond);
 
+/**
+ * End the worker's stream, if it is running, and wait for the worker to
+ * return to the IDLE state. A subsequent SYNC_WORKER_START request restarts
+ * the stream.
+ *
+ * @param   w               Worker to pause
+ * @param   timeout_ms      Timeout in ms. 0 implies "wait forever"
+ *
+ * @return 0 on success, BLADERF_ERR_* on failure
+ */
+int sync_worker_pause(struct sync_worker *w, unsigned int timeout_ms);
+
 /**
  * Wait for state change with optional timeout
  *
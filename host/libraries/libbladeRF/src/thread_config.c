@@ -0,0 +1,189 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Required for CPU affinity functions */
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS
+#   include <windows.h>
+#else
+#   include <sched.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#endif
+
+#include "libbladeRF.h"
+#include "thread_config.h"
+#include "log.h"
+
+#if BLADERF_OS_LINUX
+/* The process's CPU affinity, which threads are restored to when no
+ * cpu_mask is configured */
+static cpu_set_t default_cpus;
+static bool default_cpus_valid = false;
+static pthread_once_t default_cpus_once = PTHREAD_ONCE_INIT;
+
+static void init_default_cpus(void)
+{
+    /* The main thread's ID is the process ID. Querying it, rather than the
+     * calling thread, ensures a mask previously applied to a library thread
+     * isn't mistaken for the process's. */
+    if (sched_getaffinity(getpid(), sizeof(default_cpus), &default_cpus) == 0) {
+        default_cpus_valid = true;
+    } else {
+        log_debug("Failed to read process CPU affinity: %s\n",
+                  strerror(errno));
+    }
+}
+#endif
+
+void thread_config_init(void)
+{
+#if BLADERF_OS_LINUX
+    pthread_once(&default_cpus_once, init_default_cpus);
+#endif
+}
+
+int thread_config_check(const struct bladerf_thread_config *config)
+{
+    if (config->priority < 0) {
+        return BLADERF_ERR_INVAL;
+    }
+
+#if BLADERF_OS_WINDOWS
+    if (config->priority != 0) {
+        log_debug("Real-time priorities are not supported on Windows.\n");
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+#else
+    if (config->priority != 0 &&
+        (config->priority < sched_get_priority_min(SCHED_FIFO) ||
+         config->priority > sched_get_priority_max(SCHED_FIFO))) {
+        log_debug("Invalid SCHED_FIFO priority: %d\n", config->priority);
+        return BLADERF_ERR_RANGE;
+    }
+#endif
+
+#if !BLADERF_OS_LINUX
+    if (config->cpu_mask != 0) {
+        log_debug("CPU affinity is only supported on Linux.\n");
+        return BLADERF_ERR_UNSUPPORTED;
+    }
+#endif
+
+    return 0;
+}
+
+void thread_config_apply(const struct bladerf_thread_config *config,
+                         const char *name)
+{
+#if !BLADERF_OS_WINDOWS
+    int status;
+    int policy = SCHED_OTHER;
+    struct sched_param param;
+
+    memset(&param, 0, sizeof(param));
+
+    if (config->priority != 0) {
+        policy = SCHED_FIFO;
+        param.sched_priority = config->priority;
+    }
+
+    status = pthread_setschedparam(pthread_self(), policy, &param);
+    if (status != 0) {
+        log_warning("Failed to set %s thread priority to %d: %s\n",
+                    name, config->priority, strerror(status));
+    }
+#endif
+
+#if BLADERF_OS_LINUX
+    {
+        cpu_set_t cpus;
+        unsigned int i;
+
+        CPU_ZERO(&cpus);
+
+        if (config->cpu_mask != 0) {
+            for (i = 0; i < 64; i++) {
+                if (config->cpu_mask & ((uint64_t) 1 << i)) {
+                    CPU_SET(i, &cpus);
+                }
+            }
+        } else {
+            thread_config_init();
+
+            if (!default_cpus_valid) {
+                /* Unable to determine the process's affinity - leave the
+                 * thread's affinity as-is */
+                return;
+            }
+
+            cpus = default_cpus;
+        }
+
+        status = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (status != 0) {
+            log_warning("Failed to set %s thread CPU affinity to 0x%llx: %s\n",
+                        name, (unsigned long long) config->cpu_mask,
+                        strerror(status));
+        }
+    }
+#endif
+
+    log_verbose("%s thread: priority=%d, cpu_mask=0x%llx\n", name,
+                config->priority, (unsigned long long) config->cpu_mask);
+}
+
+int thread_config_lock_memory(void *addr, size_t len)
+{
+#if BLADERF_OS_WINDOWS
+    if (!VirtualLock(addr, len)) {
+        log_debug("VirtualLock() failed: %lu\n", GetLastError());
+        return BLADERF_ERR_MEM;
+    }
+#else
+    if (mlock(addr, len) != 0) {
+        log_debug("mlock() failed: %s\n", strerror(errno));
+        return (errno == ENOMEM || errno == EAGAIN) ?
+                    BLADERF_ERR_MEM : BLADERF_ERR_UNEXPECTED;
+    }
+#endif
+
+    return 0;
+}
+
+void thread_config_unlock_memory(void *addr, size_t len)
+{
+#if BLADERF_OS_WINDOWS
+    VirtualUnlock(addr, len);
+#else
+    munlock(addr, len);
+#endif
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_THREAD_CONFIG_H_
+#define BLADERF_THREAD_CONFIG_H_
+
+#include <stddef.h>
+#include "libbladeRF.h"
+
+/**
+ * Record the process's CPU affinity, which thread_config_apply() restores
+ * threads to by default. Only the first call has any effect.
+ *
+ * This is called when a device is opened, such that the affinity is captured
+ * before any library threads are configured.
+ */
+void thread_config_init(void);
+
+/**
+ * Check whether a thread configuration is valid and supported
+ *
+ * @param[in]   config      Configuration to check
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int thread_config_check(const struct bladerf_thread_config *config);
+
+/**
+ * Apply a thread configuration's priority and CPU affinity to the calling
+ * thread. Default values restore the default policy and the process's CPU
+ * affinity. Failures are logged as warnings.
+ *
+ * @param[in]   config      Configuration to apply
+ * @param[in]   name        Thread name, for log messages
+ */
+void thread_config_apply(const struct bladerf_thread_config *config,
+                         const char *name);
+
+/**
+ * Lock a region of memory into physical memory
+ *
+ * @param   addr        Start of region
+ * @param   len         Length of region, in bytes
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int thread_config_lock_memory(void *addr, size_t len);
+
+/**
+ * Unlock a region locked via thread_config_lock_memory()
+ *
+ * @param   addr        Start of region
+ * @param   len         Length of region, in bytes
+ */
+void thread_config_unlock_memory(void *addr, size_t len);
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <string.h>
+
+#include "libbladeRF.h"
+#include "time_model.h"
+#include "metadata.h"
+
+void time_model_init(struct time_model *m)
+{
+    memset(m, 0, sizeof(*m));
+    MUTEX_INIT(&m->lock);
+}
+
+/* Assumes m->lock is held */
+static void clear(struct time_model *m)
+{
+    m->count = 0;
+    m->next = 0;
+    m->rate = m->nominal_rate;
+    m->offset = 0;
+}
+
+void time_model_reset(struct time_model *m)
+{
+    MUTEX_LOCK(&m->lock);
+    clear(m);
+    MUTEX_UNLOCK(&m->lock);
+}
+
+void time_model_set_rate(struct time_model *m, double samples_per_sec)
+{
+    const double rate = samples_per_sec / 1e9;
+
+    MUTEX_LOCK(&m->lock);
+    if (rate != m->nominal_rate) {
+        m->nominal_rate = rate;
+        clear(m);
+    }
+    MUTEX_UNLOCK(&m->lock);
+}
+
+bool time_model_needs_refresh(struct time_model *m, uint64_t now_ns)
+{
+    bool ret;
+
+    MUTEX_LOCK(&m->lock);
+    ret = m->count == 0 || m->rate <= 0 ||
+          (now_ns > m->host_ref && now_ns - m->host_ref > TIME_MODEL_REFRESH_NS);
+    MUTEX_UNLOCK(&m->lock);
+
+    return ret;
+}
+
+/* Refit the model to the retained observations, relative to the newest one.
+ * Assumes m->lock is held, and that m->count != 0. */
+static void fit(struct time_model *m)
+{
+    const size_t newest = (m->next + TIME_MODEL_POINTS - 1) % TIME_MODEL_POINTS;
+    const size_t oldest = m->count < TIME_MODEL_POINTS ? 0 : m->next;
+    double mean_x = 0, mean_y = 0, sxx = 0, sxy = 0;
+    double x, y, offset;
+    size_t i;
+
+    m->host_ref = m->points[newest].host_ns;
+    m->ts_ref = m->points[newest].timestamp;
+
+    if (m->count >= 2 &&
+        m->host_ref - m->points[oldest].host_ns >= TIME_MODEL_MIN_FIT_SPAN_NS) {
+
+        for (i = 0; i < m->count; i++) {
+            mean_x += (double) (int64_t) (m->points[i].host_ns - m->host_ref);
+            mean_y += (double) (int64_t) (m->points[i].timestamp - m->ts_ref);
+        }
+
+        mean_x /= m->count;
+        mean_y /= m->count;
+
+        for (i = 0; i < m->count; i++) {
+            x = (double) (int64_t) (m->points[i].host_ns - m->host_ref) - mean_x;
+            y = (double) (int64_t) (m->points[i].timestamp - m->ts_ref) - mean_y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+
+        m->rate = sxy / sxx;
+    } else {
+        m->rate = m->nominal_rate;
+    }
+
+    /* Pass through the observation with the least latency */
+    m->offset = 0;
+    for (i = 0; i < m->count; i++) {
+        x = (double) (int64_t) (m->points[i].host_ns - m->host_ref);
+        y = (double) (int64_t) (m->points[i].timestamp - m->ts_ref);
+        offset = y - m->rate * x;
+
+        if (offset > m->offset) {
+            m->offset = offset;
+        }
+    }
+}
+
+void time_model_add(struct time_model *m, uint64_t host_ns,
+                    uint64_t timestamp)
+{
+    MUTEX_LOCK(&m->lock);
+
+    /* A readback may lag a concurrently received RX buffer slightly, but a
+     * counter that has gone further backwards has been reset */
+    if (m->count != 0 && timestamp < m->ts_ref &&
+        (m->rate <= 0 ||
+         (double) (m->ts_ref - timestamp) > m->rate * TIME_MODEL_MAX_LAG_NS)) {
+        clear(m);
+    }
+
+    /* Keep the observations ordered by host time */
+    if (m->count == 0 || host_ns >= m->host_ref) {
+        m->points[m->next].host_ns = host_ns;
+        m->points[m->next].timestamp = timestamp;
+        m->next = (m->next + 1) % TIME_MODEL_POINTS;
+
+        if (m->count < TIME_MODEL_POINTS) {
+            m->count++;
+        }
+
+        fit(m);
+    }
+
+    MUTEX_UNLOCK(&m->lock);
+}
+
+void time_model_add_rx_buffer(struct time_model *m, uint64_t host_ns,
+                              const uint8_t *buf, size_t len,
+                              size_t msg_size)
+{
+    const uint8_t *last_msg;
+    uint64_t timestamp;
+
+    if (len < msg_size || msg_size <= METADATA_HEADER_SIZE) {
+        return;
+    }
+
+    /* The buffer arrived after its final sample was received */
+    last_msg = buf + (len / msg_size - 1) * msg_size;
+    timestamp = metadata_get_timestamp(last_msg) +
+                (msg_size - METADATA_HEADER_SIZE) / (2 * sizeof(int16_t));
+
+    time_model_add(m, host_ns, timestamp);
+}
+
+int time_model_timestamp(struct time_model *m, uint64_t host_ns,
+                         uint64_t *timestamp)
+{
+    int status = BLADERF_ERR_UNEXPECTED;
+    double delta;
+
+    MUTEX_LOCK(&m->lock);
+
+    if (m->count != 0 && m->rate > 0) {
+        delta = m->offset +
+                m->rate * (double) (int64_t) (host_ns - m->host_ref);
+
+        if (delta < 0 && (uint64_t) -delta > m->ts_ref) {
+            *timestamp = 0;
+        } else {
+            *timestamp = m->ts_ref + (int64_t) delta;
+        }
+
+        status = 0;
+    }
+
+    MUTEX_UNLOCK(&m->lock);
+    return status;
+}
+
+int time_model_host_time(struct time_model *m, uint64_t timestamp,
+                         uint64_t *host_ns)
+{
+    int status = BLADERF_ERR_UNEXPECTED;
+    double delta;
+
+    MUTEX_LOCK(&m->lock);
+
+    if (m->count != 0 && m->rate > 0) {
+        delta = ((double) (int64_t) (timestamp - m->ts_ref) - m->offset) /
+                m->rate;
+
+        if (delta < 0 && (uint64_t) -delta > m->host_ref) {
+            *host_ns = 0;
+        } else {
+            *host_ns = m->host_ref + (int64_t) delta;
+        }
+
+        status = 0;
+    }
+
+    MUTEX_UNLOCK(&m->lock);
+    return status;
+}
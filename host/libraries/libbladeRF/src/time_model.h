@@ -0,0 +1,159 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#ifndef BLADERF_TIME_MODEL_H_
+#define BLADERF_TIME_MODEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "host_config.h"
+#include "thread.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
+
+/* Number of (host time, timestamp) observations retained per module */
+#define TIME_MODEL_POINTS           32
+
+/* The counter's rate is only estimated from observations once they span at
+ * least this much host time. Until then, the nominal sample rate is used. */
+#define TIME_MODEL_MIN_FIT_SPAN_NS  (10 * 1000000ull)
+
+/* Age beyond which a model is refreshed with a timestamp readback */
+#define TIME_MODEL_REFRESH_NS       (1000 * 1000000ull)
+
+/* Observations lagging the newest one by more than this much time indicate
+ * that the counter has been reset */
+#define TIME_MODEL_MAX_LAG_NS       (100 * 1000000ull)
+
+/* Host clock that timestamps are correlated with */
+#if BLADERF_OS_LINUX
+#   define TIME_MODEL_CLOCK CLOCK_MONOTONIC
+#else
+#   define TIME_MODEL_CLOCK CLOCK_REALTIME
+#endif
+
+/* Linear model of a module's sample counter as a function of host time,
+ * stored in struct bladerf.
+ *
+ * Each observation is a lower bound on the counter at a host time: an RX
+ * buffer's final timestamp when the buffer arrived, or a readback's value
+ * upon its completion. The rate is a least-squares fit over the retained
+ * observations, and the offset is chosen such that the model passes through
+ * the observation with the least latency. This rejects the (one-sided) jitter
+ * in buffer arrival and readback times. */
+struct time_model {
+    MUTEX lock;
+
+    struct {
+        uint64_t host_ns;
+        uint64_t timestamp;
+    } points[TIME_MODEL_POINTS];
+
+    size_t count;               /* Number of valid observations */
+    size_t next;                /* Index of the next observation to replace */
+
+    double nominal_rate;        /* Configured sample rate, in samples/ns, or
+                                 * 0 if unknown */
+
+    /* Current model: timestamp(t) = ts_ref + offset + rate * (t - host_ref) */
+    uint64_t host_ref;
+    uint64_t ts_ref;
+    double offset;
+    double rate;
+};
+
+/* Current host time, in nanoseconds */
+static inline uint64_t time_model_now_ns(void)
+{
+    struct timespec t;
+
+    if (clock_gettime(TIME_MODEL_CLOCK, &t) != 0) {
+        return 0;
+    }
+
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+void time_model_init(struct time_model *m);
+
+/**
+ * Discard all observations. This is called when a stream is started, as
+ * the counter may have been reset.
+ */
+void time_model_reset(struct time_model *m);
+
+/**
+ * Set the nominal rate of the counter, discarding all observations if it
+ * has changed.
+ *
+ * @param   m               Model to update
+ * @param   samples_per_sec Sample rate, or 0 if unknown
+ */
+void time_model_set_rate(struct time_model *m, double samples_per_sec);
+
+/**
+ * Get whether a model needs a timestamp readback to provide an estimate:
+ * it has no rate, or no observation newer than TIME_MODEL_REFRESH_NS.
+ */
+bool time_model_needs_refresh(struct time_model *m, uint64_t now_ns);
+
+/**
+ * Record that the counter was at least `timestamp` at `host_ns`
+ */
+void time_model_add(struct time_model *m, uint64_t host_ns,
+                    uint64_t timestamp);
+
+/**
+ * Record the arrival of an RX buffer containing metadata
+ *
+ * @param   m           Model to update
+ * @param   host_ns     Host time at which the buffer arrived
+ * @param   buf         Buffer, consisting of `msg_size`-byte messages
+ * @param   len         Buffer length, in bytes
+ * @param   msg_size    Message size, in bytes
+ */
+void time_model_add_rx_buffer(struct time_model *m, uint64_t host_ns,
+                              const uint8_t *buf, size_t len,
+                              size_t msg_size);
+
+/**
+ * Estimate the counter's value at a host time
+ *
+ * @return 0 on success, BLADERF_ERR_UNEXPECTED if the model lacks the
+ *         observations or rate needed to provide an estimate
+ */
+int time_model_timestamp(struct time_model *m, uint64_t host_ns,
+                         uint64_t *timestamp);
+
+/**
+ * Estimate the host time at which the counter reaches `timestamp`
+ *
+ * @return 0 on success, BLADERF_ERR_UNEXPECTED if the model lacks the
+ *         observations or rate needed to provide an estimate
+ */
+int time_model_host_time(struct time_model *m, uint64_t timestamp,
+                         uint64_t *host_ns);
+
+#endif
@@ -25,6 +25,15 @@
 #include "log.h"
 
 
+/* Band selection values in the config GPIO register */
+#define GPIO_BAND_HIGH  1
+#define GPIO_BAND_LOW   2
+
+static inline unsigned int gpio_band_shift(bladerf_module module)
+{
+    return (module == BLADERF_MODULE_TX) ? 3 : 5;
+}
+
 int tuning_select_band(struct bladerf *dev, bladerf_module module,
                        unsigned int frequency)
 {
@@ -40,7 +49,7 @@ int tuning_select_band(struct bladerf *dev, bladerf_module module,
         log_info("Clamping frequency to %uHz\n", frequency);
     }
 
-    band = (frequency >= BLADERF_BAND_HIGH) ? 1 : 2;
+    band = (frequency >= BLADERF_BAND_HIGH) ? GPIO_BAND_HIGH : GPIO_BAND_LOW;
 
     status = lms_select_band(dev, module, frequency);
     if (status != 0) {
@@ -52,8 +61,8 @@ int tuning_select_band(struct bladerf *dev, bladerf_module module,
         return status;
     }
 
-    gpio &= ~(module == BLADERF_MODULE_TX ? (3 << 3) : (3 << 5));
-    gpio |= (module == BLADERF_MODULE_TX ? (band << 3) : (band << 5));
+    gpio &= ~(3 << gpio_band_shift(module));
+    gpio |= (band << gpio_band_shift(module));
 
     return CONFIG_GPIO_WRITE(dev, gpio);
 }
@@ -167,5 +176,50 @@ int tuning_get_freq(struct bladerf *dev, bladerf_module module,
     return rv;
 }
 
+int tuning_get_quick_tune(struct bladerf *dev, bladerf_module module,
+                          struct bladerf_quick_tune *quick_tune)
+{
+    int status;
+    uint32_t gpio;
+
+    status = lms_get_quick_tune(dev, module, quick_tune);
+    if (status != 0) {
+        return status;
+    }
+
+    status = CONFIG_GPIO_READ(dev, &gpio);
+    if (status != 0) {
+        return status;
+    }
+
+    quick_tune->flags = 0;
+    if (((gpio >> gpio_band_shift(module)) & 3) == GPIO_BAND_HIGH) {
+        quick_tune->flags |= BLADERF_QUICK_TUNE_FLAG_HIGH_BAND;
+    }
+
+    return 0;
+}
+
+int tuning_set_quick_tune(struct bladerf *dev,
+                          const struct bladerf_quick_tune *quick_tune)
+{
+    int status;
+    const bladerf_module module = quick_tune->module;
 
+    /* Any frequency in the desired band suffices for its selection */
+    const unsigned int band_freq =
+        (quick_tune->flags & BLADERF_QUICK_TUNE_FLAG_HIGH_BAND) ?
+            BLADERF_BAND_HIGH : BLADERF_FREQUENCY_MIN;
 
+    if (module != BLADERF_MODULE_RX && module != BLADERF_MODULE_TX) {
+        log_debug("Invalid quick tune module: %d\n", module);
+        return BLADERF_ERR_INVAL;
+    }
+
+    status = lms_set_quick_tune(dev, quick_tune);
+    if (status != 0) {
+        return status;
+    }
+
+    return tuning_select_band(dev, module, band_freq);
+}
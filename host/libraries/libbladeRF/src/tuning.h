@@ -61,5 +61,28 @@ int tuning_set_freq(struct bladerf *dev, bladerf_module module,
 int tuning_get_freq(struct bladerf *dev, bladerf_module module,
                     unsigned int *frequency);
 
+/**
+ * Capture the quick tune parameters for the module's current frequency
+ *
+ * @param[in]   dev         Device handle
+ * @param[in]   module      Module to query
+ * @param[out]  quick_tune  Quick tune parameters
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int tuning_get_quick_tune(struct bladerf *dev, bladerf_module module,
+                          struct bladerf_quick_tune *quick_tune);
+
+/**
+ * Apply quick tune parameters
+ *
+ * @param   dev         Device handle
+ * @param   quick_tune  Quick tune parameters
+ *
+ * @return 0 on success, BLADERF_ERR_* value on failure
+ */
+int tuning_set_quick_tune(struct bladerf *dev,
+                          const struct bladerf_quick_tune *quick_tune);
+
 
 #endif
@@ -38,6 +38,12 @@
 #include "test_ctrl.h"
 #include "conversions.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 static const struct test_case *tests[] = {
     &test_case_sampling,
     &test_case_lpf_mode,
@@ -50,6 +56,15 @@ static const struct test_case *tests[] = {
     &test_case_gain,
     &test_case_frequency,
     &test_case_threads,
+    &test_case_rx_zero_copy,
+    &test_case_quick_tune,
+    &test_case_time_model,
+    &test_case_fpga_cache,
+    &test_case_flash_progress,
+    &test_case_flash_update,
+    &test_case_sync_pause,
+    &test_case_rx_overrun,
+    &test_case_stream_stats,
 };
 
 #define OPTARG  "d:t:s:v:hL"
@@ -86,6 +101,73 @@ void usage(const char *argv0)
     printf("  -v, --verbosity <level>       Set libbladeRF verbosity level.\n");
 }
 
+static int set_env(const char *name, const char *value)
+{
+#ifdef _WIN32
+    return _putenv_s(name, value == NULL ? "" : value);
+#else
+    if (value == NULL) {
+        return unsetenv(name);
+    } else {
+        return setenv(name, value, 1);
+    }
+#endif
+}
+
+static int open_paced_dummy(struct bladerf **dev, unsigned int sample_rate)
+{
+    int status;
+    const char *env;
+    char *prev_rate = NULL;
+    char rate_str[16];
+
+    env = getenv("BLADERF_DUMMY_SAMPLE_RATE");
+    if (env != NULL) {
+        prev_rate = strdup(env);
+        if (prev_rate == NULL) {
+            return BLADERF_ERR_MEM;
+        }
+    }
+
+    snprintf(rate_str, sizeof(rate_str), "%u", sample_rate);
+
+    set_env("BLADERF_DUMMY_SAMPLE_RATE", rate_str);
+    status = bladerf_open(dev, "dummy");
+    set_env("BLADERF_DUMMY_SAMPLE_RATE", prev_rate);
+
+    free(prev_rate);
+    return status;
+}
+
+int open_dummy(struct bladerf **dev, unsigned int sample_rate,
+               const char *test_name, bool quiet)
+{
+    int status;
+
+    if (sample_rate != 0) {
+        status = open_paced_dummy(dev, sample_rate);
+    } else {
+        status = bladerf_open(dev, "dummy");
+    }
+
+    if (status == BLADERF_ERR_NODEV) {
+        PRINT("%s: Dummy backend is not available. Skipping.\n", test_name);
+    } else if (status != 0) {
+        PR_ERROR("Failed to open dummy device: %s\n", bladerf_strerror(status));
+    }
+
+    return status;
+}
+
+void sleep_ms(unsigned int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
 void list_tests()
 {
     size_t i;
@@ -68,14 +68,45 @@ struct test_case {
     unsigned int (*fn)(struct bladerf *dev, struct app_params *p, bool quiet);
 };
 
+/**
+ * Open a dummy device, for tests that must not run against hardware. A
+ * message is printed if the dummy backend is not available, in which case
+ * the test should be skipped.
+ *
+ * @param   dev         Device handle to update
+ * @param   sample_rate Rate at which streams are paced, for tests that require
+ *                      samples to arrive in real time. 0 disables pacing.
+ * @param   test_name   Name of the test, used in messages
+ * @param   quiet       Suppress the message printed when skipping
+ *
+ * @return 0 on success, BLADERF_ERR_NODEV if the dummy backend is not
+ *         available, or another BLADERF_ERR_* value on failure
+ */
+int open_dummy(struct bladerf **dev, unsigned int sample_rate,
+               const char *test_name, bool quiet);
+
+/**
+ * Sleep for the specified number of milliseconds
+ */
+void sleep_ms(unsigned int ms);
+
 DECLARE_TEST(bandwidth);
 DECLARE_TEST(correction);
 DECLARE_TEST(enable_module);
+DECLARE_TEST(flash_progress);
+DECLARE_TEST(flash_update);
+DECLARE_TEST(fpga_cache);
 DECLARE_TEST(gain);
 DECLARE_TEST(frequency);
 DECLARE_TEST(loopback);
 DECLARE_TEST(lpf_mode);
+DECLARE_TEST(quick_tune);
+DECLARE_TEST(rx_overrun);
+DECLARE_TEST(rx_zero_copy);
 DECLARE_TEST(samplerate);
 DECLARE_TEST(sampling);
+DECLARE_TEST(stream_stats);
+DECLARE_TEST(sync_pause);
 DECLARE_TEST(threads);
+DECLARE_TEST(time_model);
 DECLARE_TEST(xb200);
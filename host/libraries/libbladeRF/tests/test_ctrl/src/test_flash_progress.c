@@ -0,0 +1,228 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Checks that erase, read and write operations report their progress through
+ * the callback set with bladerf_set_flash_progress_cb(), one erase block or
+ * page at a time, and that rejected operations report nothing.
+ *
+ * A dummy device is always used, so that this test never modifies the flash
+ * of actual hardware. */
+#include <stdlib.h>
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(flash_progress);
+
+/* Erase blocks at the start of the FPGA region */
+#define ERASE_BLOCK     BLADERF_FLASH_EB_FPGA
+#define NUM_BLOCKS      2
+
+#define PAGES_PER_EB    BLADERF_FLASH_TO_PAGES(BLADERF_FLASH_EB_SIZE)
+#define FIRST_PAGE      (ERASE_BLOCK * PAGES_PER_EB)
+#define NUM_PAGES       (NUM_BLOCKS * PAGES_PER_EB)
+
+struct progress {
+    unsigned int reports;
+    bladerf_flash_op op;
+    uint32_t done;
+    uint32_t total;
+    bool out_of_order;
+};
+
+static void record_progress(struct bladerf *dev, bladerf_flash_op op,
+                            uint32_t done, uint32_t total, void *user_data)
+{
+    struct progress *p = (struct progress *) user_data;
+
+    if (p->reports != 0 && (op != p->op || total != p->total)) {
+        p->out_of_order = true;
+    }
+
+    if (done != p->done + 1) {
+        p->out_of_order = true;
+    }
+
+    p->reports++;
+    p->op = op;
+    p->done = done;
+    p->total = total;
+}
+
+static const char *op_str(bladerf_flash_op op)
+{
+    switch (op) {
+        case BLADERF_FLASH_OP_ERASE:
+            return "erase";
+        case BLADERF_FLASH_OP_READ:
+            return "read";
+        case BLADERF_FLASH_OP_WRITE:
+            return "write";
+        default:
+            return "unknown";
+    }
+}
+
+/* Check that an operation of `count` units reported each unit in turn, or
+ * that nothing was reported if count is 0 */
+static unsigned int check_progress(const struct progress *p,
+                                   bladerf_flash_op op, uint32_t count)
+{
+    if (count == 0) {
+        if (p->reports != 0) {
+            PR_ERROR("Rejected %s reported progress %u times\n",
+                     op_str(op), p->reports);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (p->reports != count || p->out_of_order) {
+        PR_ERROR("%s reported progress %u times%s, expected %u\n",
+                 op_str(op), p->reports,
+                 p->out_of_order ? " out of order" : "", count);
+        return 1;
+    }
+
+    if (p->op != op || p->done != count || p->total != count) {
+        PR_ERROR("Last %s report was %s %u/%u, expected %u/%u\n",
+                 op_str(op), op_str(p->op), p->done, p->total, count, count);
+        return 1;
+    }
+
+    return 0;
+}
+
+static unsigned int run(struct bladerf *dev, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    struct progress p;
+    uint8_t *buf;
+    size_t i;
+    const size_t len = NUM_PAGES * BLADERF_FLASH_PAGE_SIZE;
+
+    buf = malloc(len);
+    if (buf == NULL) {
+        PR_ERROR("Failed to allocate buffer\n");
+        return 1;
+    }
+
+    status = bladerf_set_flash_progress_cb(dev, record_progress, &p);
+    if (status != 0) {
+        PR_ERROR("Failed to set progress callback: %s\n",
+                 bladerf_strerror(status));
+        free(buf);
+        return 1;
+    }
+
+    PRINT("%s: Erasing %u blocks...\n", __FUNCTION__, NUM_BLOCKS);
+    memset(&p, 0, sizeof(p));
+    status = bladerf_erase_flash(dev, ERASE_BLOCK, NUM_BLOCKS);
+    if (status != 0) {
+        PR_ERROR("Failed to erase flash: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+    failures += check_progress(&p, BLADERF_FLASH_OP_ERASE, NUM_BLOCKS);
+
+    for (i = 0; i < len; i++) {
+        buf[i] = (uint8_t) i;
+    }
+
+    PRINT("%s: Writing %u pages...\n", __FUNCTION__, NUM_PAGES);
+    memset(&p, 0, sizeof(p));
+    status = bladerf_write_flash(dev, buf, FIRST_PAGE, NUM_PAGES);
+    if (status != 0) {
+        PR_ERROR("Failed to write flash: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+    failures += check_progress(&p, BLADERF_FLASH_OP_WRITE, NUM_PAGES);
+
+    PRINT("%s: Reading %u pages...\n", __FUNCTION__, NUM_PAGES);
+    memset(buf, 0, len);
+    memset(&p, 0, sizeof(p));
+    status = bladerf_read_flash(dev, buf, FIRST_PAGE, NUM_PAGES);
+    if (status != 0) {
+        PR_ERROR("Failed to read flash: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+    failures += check_progress(&p, BLADERF_FLASH_OP_READ, NUM_PAGES);
+
+    for (i = 0; i < len; i++) {
+        if (buf[i] != (uint8_t) i) {
+            PR_ERROR("Read 0x%02x at byte %u, expected 0x%02x\n",
+                     buf[i], (unsigned int) i, (uint8_t) i);
+            failures++;
+            break;
+        }
+    }
+
+    PRINT("%s: Checking rejected operations...\n", __FUNCTION__);
+    memset(&p, 0, sizeof(p));
+    status = bladerf_erase_flash(dev, BLADERF_FLASH_NUM_EBS, 1);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Erase past end of flash returned %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    }
+    failures += check_progress(&p, BLADERF_FLASH_OP_ERASE, 0);
+
+    memset(&p, 0, sizeof(p));
+    status = bladerf_read_flash(dev, buf, BLADERF_FLASH_NUM_PAGES, 1);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Read past end of flash returned %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    }
+    failures += check_progress(&p, BLADERF_FLASH_OP_READ, 0);
+
+out:
+    bladerf_set_flash_progress_cb(dev, NULL, NULL);
+    free(buf);
+    return failures;
+}
+
+unsigned int test_flash_progress(struct bladerf *dev_main,
+                                 struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures;
+    struct bladerf *dev;
+
+    PRINT("%s: Checking flash progress reports...\n", __FUNCTION__);
+
+    status = open_dummy(&dev, 0, __FUNCTION__, quiet);
+    if (status != 0) {
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    failures = run(dev, quiet);
+
+    bladerf_close(dev);
+    return failures;
+}
@@ -0,0 +1,247 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Writes an FPGA image to a dummy device's flash, and checks that rewriting
+ * it after changing a single byte only erases and rewrites the erase block
+ * containing that byte.
+ *
+ * A dummy device is always used, so that this test never modifies the flash
+ * of actual hardware. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(flash_update);
+
+#define IMAGE_FILE      "test_ctrl_flash_update.rbf"
+
+/* Smallest bitstream accepted by the library */
+#define IMAGE_LEN       (1024 * 1024)
+
+/* The bitstream is preceded by a metadata page in the FPGA region of flash */
+#define IMAGE_OFFSET    BLADERF_FLASH_PAGE_SIZE
+
+/* Offset into the image of the byte to change, which lies within the sixth
+ * erase block of the FPGA region */
+#define CHANGED_BYTE    (5 * BLADERF_FLASH_EB_SIZE + 1000)
+
+struct flash_ops {
+    uint32_t erased_blocks;
+    uint32_t written_pages;
+};
+
+static void count_ops(struct bladerf *dev, bladerf_flash_op op,
+                      uint32_t done, uint32_t total, void *user_data)
+{
+    struct flash_ops *ops = (struct flash_ops *) user_data;
+
+    if (done != total) {
+        return;
+    }
+
+    switch (op) {
+        case BLADERF_FLASH_OP_ERASE:
+            ops->erased_blocks += total;
+            break;
+
+        case BLADERF_FLASH_OP_WRITE:
+            ops->written_pages += total;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int write_image(const uint8_t *image)
+{
+    FILE *f = fopen(IMAGE_FILE, "wb");
+    int status = 0;
+
+    if (f == NULL) {
+        PR_ERROR("Failed to open %s\n", IMAGE_FILE);
+        return -1;
+    }
+
+    if (fwrite(image, 1, IMAGE_LEN, f) != IMAGE_LEN) {
+        PR_ERROR("Failed to write %s\n", IMAGE_FILE);
+        status = -1;
+    }
+
+    fclose(f);
+    return status;
+}
+
+/* Flash the image and check the number of erase blocks and pages that were
+ * erased and written */
+static unsigned int flash_image(struct bladerf *dev, const uint8_t *image,
+                                uint32_t exp_blocks, uint32_t exp_pages,
+                                const char *desc, bool quiet)
+{
+    int status;
+    struct flash_ops ops;
+
+    PRINT("%s: %s...\n", __FUNCTION__, desc);
+
+    if (write_image(image) != 0) {
+        return 1;
+    }
+
+    memset(&ops, 0, sizeof(ops));
+
+    status = bladerf_set_flash_progress_cb(dev, count_ops, &ops);
+    if (status == 0) {
+        status = bladerf_flash_fpga(dev, IMAGE_FILE);
+        bladerf_set_flash_progress_cb(dev, NULL, NULL);
+    }
+
+    if (status != 0) {
+        PR_ERROR("Failed to flash image: %s\n", bladerf_strerror(status));
+        return 1;
+    }
+
+    if (ops.erased_blocks != exp_blocks || ops.written_pages != exp_pages) {
+        PR_ERROR("Erased %u blocks and wrote %u pages, "
+                 "expected %u blocks and %u pages\n",
+                 ops.erased_blocks, ops.written_pages, exp_blocks, exp_pages);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Check that the FPGA region contains the image, followed by erased flash */
+static unsigned int check_contents(struct bladerf *dev, const uint8_t *image,
+                                   bool quiet)
+{
+    int status;
+    size_t i;
+    unsigned int failures = 0;
+    uint8_t *readback;
+    const size_t len = BLADERF_FLASH_BYTE_LEN_FPGA - IMAGE_OFFSET;
+
+    PRINT("%s: Checking flash contents...\n", __FUNCTION__);
+
+    readback = malloc(len);
+    if (readback == NULL) {
+        PR_ERROR("Failed to allocate readback buffer\n");
+        return 1;
+    }
+
+    status = bladerf_read_flash(dev, readback,
+                                BLADERF_FLASH_PAGE_FPGA + 1,
+                                BLADERF_FLASH_TO_PAGES(len));
+    if (status != 0) {
+        PR_ERROR("Failed to read flash: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    for (i = 0; i < len; i++) {
+        const uint8_t expected = i < IMAGE_LEN ? image[i] : 0xff;
+
+        if (readback[i] != expected) {
+            PR_ERROR("Image byte %u is 0x%02x, expected 0x%02x\n",
+                     (unsigned int) i, readback[i], expected);
+            failures++;
+            break;
+        }
+    }
+
+out:
+    free(readback);
+    return failures;
+}
+
+static unsigned int run(struct bladerf *dev, bool quiet)
+{
+    unsigned int failures = 0;
+    uint8_t *image;
+    uint32_t i, x = 1;
+    const uint32_t pages_per_eb = BLADERF_FLASH_TO_PAGES(BLADERF_FLASH_EB_SIZE);
+    const uint32_t region_blocks =
+        (IMAGE_OFFSET + IMAGE_LEN + BLADERF_FLASH_EB_SIZE - 1) /
+        BLADERF_FLASH_EB_SIZE;
+
+    image = malloc(IMAGE_LEN);
+    if (image == NULL) {
+        PR_ERROR("Failed to allocate image\n");
+        return 1;
+    }
+
+    /* Pseudo-random contents, such that no page of the image is blank */
+    for (i = 0; i < IMAGE_LEN; i++) {
+        x = x * 1103515245 + 12345;
+        image[i] = (uint8_t) (x >> 16);
+    }
+
+    /* Start from a known state, in which the entire region must be written */
+    if (bladerf_erase_stored_fpga(dev) != 0) {
+        PR_ERROR("Failed to erase FPGA region\n");
+        failures++;
+        goto out;
+    }
+
+    /* The metadata page and the image are written */
+    failures += flash_image(dev, image, region_blocks,
+                            1 + BLADERF_FLASH_TO_PAGES(IMAGE_LEN),
+                            "Writing image", quiet);
+
+    failures += flash_image(dev, image, 0, 0,
+                            "Rewriting unchanged image", quiet);
+
+    image[CHANGED_BYTE] ^= 0x5a;
+
+    failures += flash_image(dev, image, 1, pages_per_eb,
+                            "Rewriting image with one byte changed", quiet);
+
+    failures += check_contents(dev, image, quiet);
+
+out:
+    remove(IMAGE_FILE);
+    free(image);
+    return failures;
+}
+
+unsigned int test_flash_update(struct bladerf *dev_main,
+                               struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures;
+    struct bladerf *dev;
+
+    PRINT("%s: Updating FPGA image in flash...\n", __FUNCTION__);
+
+    status = open_dummy(&dev, 0, __FUNCTION__, quiet);
+    if (status != 0) {
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    failures = run(dev, quiet);
+
+    bladerf_close(dev);
+    return failures;
+}
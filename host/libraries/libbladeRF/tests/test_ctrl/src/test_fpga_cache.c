@@ -0,0 +1,235 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Loads a bitstream into a dummy device and checks that subsequent loads of
+ * the same bitstream are skipped, unless forced or the record of the previous
+ * load is malformed.
+ *
+ * BLADERF_FPGA_CACHE_DIR is pointed at a temporary directory for the duration
+ * of the test, so that the user's own records are left untouched. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(fpga_cache);
+
+#ifndef _WIN32
+#include <unistd.h>
+
+#define CACHE_DIR_ENV   "BLADERF_FPGA_CACHE_DIR"
+#define DIR_TEMPLATE    "/tmp/test_ctrl_fpga_cache_XXXXXX"
+#define BITSTREAM_FILE  "/bitstream.rbf"
+
+/* Smallest bitstream accepted by the library */
+#define BITSTREAM_LEN   (1024 * 1024)
+
+#define PATH_LEN        256
+
+static void count_load(struct bladerf *dev, size_t done, size_t total,
+                       void *user_data)
+{
+    unsigned int *num_loads = (unsigned int *) user_data;
+
+    if (done == total) {
+        (*num_loads)++;
+    }
+}
+
+static int write_file(const char *path, const void *data, size_t len)
+{
+    FILE *f = fopen(path, "wb");
+    int status = 0;
+
+    if (f == NULL) {
+        PR_ERROR("Failed to open %s\n", path);
+        return -1;
+    }
+
+    if (fwrite(data, 1, len, f) != len) {
+        PR_ERROR("Failed to write %s\n", path);
+        status = -1;
+    }
+
+    fclose(f);
+    return status;
+}
+
+/* Load the bitstream and check whether the FPGA was actually loaded */
+static unsigned int check_load(struct bladerf *dev, const char *bitstream,
+                               bool force, unsigned int *num_loads,
+                               bool expect_load, const char *desc, bool quiet)
+{
+    int status;
+    const unsigned int prev_loads = *num_loads;
+
+    PRINT("%s: %s...\n", __FUNCTION__, desc);
+
+    if (force) {
+        status = bladerf_load_fpga_force(dev, bitstream);
+    } else {
+        status = bladerf_load_fpga(dev, bitstream);
+    }
+
+    if (status != 0) {
+        PR_ERROR("Failed to load FPGA: %s\n", bladerf_strerror(status));
+        return 1;
+    }
+
+    if ((*num_loads != prev_loads) != expect_load) {
+        PR_ERROR("FPGA was %s, expected it to be %s\n",
+                 *num_loads != prev_loads ? "loaded" : "not loaded",
+                 expect_load ? "loaded" : "skipped");
+        return 1;
+    }
+
+    return 0;
+}
+
+static unsigned int run(struct bladerf *dev, const char *dir, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int num_loads = 0;
+    char serial[BLADERF_SERIAL_LENGTH];
+    char bitstream[PATH_LEN];
+    char cache[PATH_LEN];
+    uint8_t *buf;
+
+    status = bladerf_get_serial(dev, serial);
+    if (status != 0) {
+        PR_ERROR("Failed to get serial: %s\n", bladerf_strerror(status));
+        return 1;
+    }
+
+    snprintf(bitstream, sizeof(bitstream), "%s" BITSTREAM_FILE, dir);
+    snprintf(cache, sizeof(cache), "%s/%s_fpga.cache", dir, serial);
+
+    buf = malloc(BITSTREAM_LEN);
+    if (buf == NULL) {
+        PR_ERROR("Failed to allocate bitstream\n");
+        return 1;
+    }
+
+    memset(buf, 0xa5, BITSTREAM_LEN);
+    status = write_file(bitstream, buf, BITSTREAM_LEN);
+    free(buf);
+
+    if (status != 0) {
+        return 1;
+    }
+
+    status = bladerf_set_fpga_load_progress_cb(dev, count_load, &num_loads);
+    if (status != 0) {
+        PR_ERROR("Failed to set progress callback: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    failures += check_load(dev, bitstream, false, &num_loads, true,
+                           "Initial load", quiet);
+
+    failures += check_load(dev, bitstream, false, &num_loads, false,
+                           "Reloading same bitstream", quiet);
+
+    failures += check_load(dev, bitstream, true, &num_loads, true,
+                           "Forcing load of same bitstream", quiet);
+
+    if (write_file(cache, "malformed\n", strlen("malformed\n")) != 0) {
+        failures++;
+    } else {
+        failures += check_load(dev, bitstream, false, &num_loads, true,
+                               "Loading with malformed record", quiet);
+
+        /* ...after which the record should have been rewritten */
+        failures += check_load(dev, bitstream, false, &num_loads, false,
+                               "Reloading after malformed record", quiet);
+    }
+
+    bladerf_set_fpga_load_progress_cb(dev, NULL, NULL);
+
+out:
+    remove(cache);
+    remove(bitstream);
+    return failures;
+}
+
+unsigned int test_fpga_cache(struct bladerf *dev_main,
+                             struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures;
+    struct bladerf *dev;
+    char dir[] = DIR_TEMPLATE;
+    char *prev_dir = NULL;
+    const char *env;
+
+    PRINT("%s: Loading FPGA with cached load records...\n", __FUNCTION__);
+
+    if (mkdtemp(dir) == NULL) {
+        PR_ERROR("Failed to create temporary directory\n");
+        return 1;
+    }
+
+    env = getenv(CACHE_DIR_ENV);
+    if (env != NULL) {
+        prev_dir = strdup(env);
+        if (prev_dir == NULL) {
+            rmdir(dir);
+            return 1;
+        }
+    }
+
+    setenv(CACHE_DIR_ENV, dir, 1);
+
+    status = open_dummy(&dev, 0, __FUNCTION__, quiet);
+    if (status != 0) {
+        failures = status == BLADERF_ERR_NODEV ? 0 : 1;
+    } else {
+        failures = run(dev, dir, quiet);
+        bladerf_close(dev);
+    }
+
+    if (prev_dir != NULL) {
+        setenv(CACHE_DIR_ENV, prev_dir, 1);
+        free(prev_dir);
+    } else {
+        unsetenv(CACHE_DIR_ENV);
+    }
+
+    rmdir(dir);
+    return failures;
+}
+
+#else
+unsigned int test_fpga_cache(struct bladerf *dev,
+                             struct app_params *p, bool quiet)
+{
+    /* mkdtemp() is not available on Windows */
+    PRINT("%s: Not supported on this platform. Skipping.\n", __FUNCTION__);
+    return 0;
+}
+#endif
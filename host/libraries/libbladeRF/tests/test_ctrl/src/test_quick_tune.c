@@ -0,0 +1,220 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(quick_tune);
+
+#define PROFILE_FILE    "test_ctrl_quick_tune.txt"
+
+static const unsigned int frequencies[] = {
+    300000000, 915000000, 1575420000, 2400000000u, 3800000000u
+};
+
+#define NUM_FREQUENCIES (sizeof(frequencies) / sizeof(frequencies[0]))
+
+/* Entries that bladerf_load_quick_tune_profile() must reject */
+static const char *malformed[] = {
+    "xx,915000000,44,32,130,5592405,0\n",       /* Invalid module */
+    "rx,915000000,44,32,130\n",                 /* Missing fields */
+    "rx,915000000,64,32,130,5592405,0\n",       /* freqsel out of range */
+    "rx,915000000,44,64,130,5592405,0\n",       /* vcocap out of range */
+    "rx,915000000,44,32,65536,5592405,0\n",     /* nint out of range */
+    "rx,915000000,44,32,130,8388608,0\n",       /* nfrac out of range */
+    "rx,915000000,44,32,130,5592405,256\n",     /* flags out of range */
+    "rx;915000000;44;32;130;5592405;0\n",       /* Wrong delimiter */
+};
+
+#define NUM_MALFORMED (sizeof(malformed) / sizeof(malformed[0]))
+
+static bool entry_match(const struct bladerf_quick_tune *a,
+                        const struct bladerf_quick_tune *b)
+{
+    return a->frequency == b->frequency && a->module == b->module &&
+           a->freqsel == b->freqsel && a->vcocap == b->vcocap &&
+           a->nint == b->nint && a->nfrac == b->nfrac &&
+           a->flags == b->flags;
+}
+
+static unsigned int test_round_trip(struct bladerf *dev, bladerf_module m,
+                                    bool quiet)
+{
+    int status;
+    unsigned int i, count, orig, readback;
+    unsigned int failures = 0;
+    struct bladerf_quick_tune profile[NUM_FREQUENCIES];
+    struct bladerf_quick_tune *loaded = NULL;
+
+    PRINT("%s: Building, saving and loading %s profile...\n", __FUNCTION__,
+          m == BLADERF_MODULE_RX ? "RX" : "TX");
+
+    status = bladerf_get_frequency(dev, m, &orig);
+    if (status != 0) {
+        PR_ERROR("Failed to get frequency: %s\n", bladerf_strerror(status));
+        return 1;
+    }
+
+    status = bladerf_build_quick_tune_profile(dev, m, frequencies, profile,
+                                              NUM_FREQUENCIES);
+    if (status != 0) {
+        PR_ERROR("Failed to build profile: %s\n", bladerf_strerror(status));
+        return 1;
+    }
+
+    /* The module should have been returned to its original frequency */
+    status = bladerf_get_frequency(dev, m, &readback);
+    if (status != 0) {
+        PR_ERROR("Failed to get frequency: %s\n", bladerf_strerror(status));
+        failures++;
+    } else if (readback != orig) {
+        PR_ERROR("Frequency not restored: %u != %u\n", readback, orig);
+        failures++;
+    }
+
+    status = bladerf_save_quick_tune_profile(PROFILE_FILE, profile,
+                                             NUM_FREQUENCIES);
+    if (status != 0) {
+        PR_ERROR("Failed to save profile: %s\n", bladerf_strerror(status));
+        return failures + 1;
+    }
+
+    status = bladerf_load_quick_tune_profile(PROFILE_FILE, &loaded, &count);
+    remove(PROFILE_FILE);
+
+    if (status != 0) {
+        PR_ERROR("Failed to load profile: %s\n", bladerf_strerror(status));
+        return failures + 1;
+    }
+
+    if (count != NUM_FREQUENCIES) {
+        PR_ERROR("Loaded %u entries, expected %u\n",
+                 count, (unsigned int) NUM_FREQUENCIES);
+        failures++;
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!entry_match(&loaded[i], &profile[i])) {
+            PR_ERROR("Entry %u (%u Hz) does not match after loading\n",
+                     i, profile[i].frequency);
+            failures++;
+            continue;
+        }
+
+        /* ...and applying the loaded entry should yield its frequency */
+        status = bladerf_set_quick_tune(dev, &loaded[i]);
+        if (status != 0) {
+            PR_ERROR("Failed to apply entry %u: %s\n",
+                     i, bladerf_strerror(status));
+            failures++;
+            continue;
+        }
+
+        status = bladerf_get_frequency(dev, m, &readback);
+        if (status != 0 || readback != loaded[i].frequency) {
+            PR_ERROR("Entry %u yielded %u Hz, expected %u Hz\n",
+                     i, readback, loaded[i].frequency);
+            failures++;
+        }
+    }
+
+out:
+    bladerf_free_quick_tune_profile(loaded);
+    bladerf_set_frequency(dev, m, orig);
+    return failures;
+}
+
+static int write_file(const char *contents)
+{
+    FILE *f = fopen(PROFILE_FILE, "w");
+    int status = 0;
+
+    if (f == NULL) {
+        PR_ERROR("Failed to open %s\n", PROFILE_FILE);
+        return -1;
+    }
+
+    if (fputs(contents, f) < 0) {
+        PR_ERROR("Failed to write %s\n", PROFILE_FILE);
+        status = -1;
+    }
+
+    fclose(f);
+    return status;
+}
+
+static unsigned int test_malformed(bool quiet)
+{
+    int status;
+    unsigned int i, count;
+    unsigned int failures = 0;
+    struct bladerf_quick_tune *loaded;
+    char contents[256];
+
+    PRINT("%s: Loading malformed profiles...\n", __FUNCTION__);
+
+    for (i = 0; i < NUM_MALFORMED; i++) {
+        /* Precede the malformed entry with a valid one, to ensure that the
+         * entire load fails, rather than just the bad line being skipped */
+        snprintf(contents, sizeof(contents),
+                 "# Malformed profile\n"
+                 "tx,915000000,44,32,130,5592405,0\n"
+                 "%s", malformed[i]);
+
+        if (write_file(contents) != 0) {
+            failures++;
+            continue;
+        }
+
+        loaded = NULL;
+        status = bladerf_load_quick_tune_profile(PROFILE_FILE,
+                                                 &loaded, &count);
+        if (status != BLADERF_ERR_INVAL) {
+            PR_ERROR("Malformed entry %u was not rejected (%s): %s",
+                     i, bladerf_strerror(status), malformed[i]);
+            failures++;
+
+            if (status == 0) {
+                bladerf_free_quick_tune_profile(loaded);
+            }
+        }
+    }
+
+    remove(PROFILE_FILE);
+    return failures;
+}
+
+unsigned int test_quick_tune(struct bladerf *dev,
+                             struct app_params *p, bool quiet)
+{
+    unsigned int failures = 0;
+
+    failures += test_round_trip(dev, BLADERF_MODULE_RX, quiet);
+    failures += test_round_trip(dev, BLADERF_MODULE_TX, quiet);
+    failures += test_malformed(quiet);
+
+    return failures;
+}
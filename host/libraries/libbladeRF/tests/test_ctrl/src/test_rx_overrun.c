@@ -0,0 +1,208 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Streams RX samples with metadata from a dummy device paced in real time,
+ * periodically stalling for long enough that the stream overruns. The samples
+ * reported as dropped via metadata and via bladerf_get_rx_overrun_stats()
+ * must both account for the gaps in the received timestamps. */
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(rx_overrun);
+
+#define SAMPLE_RATE         1000000
+#define BUF_LEN             4096
+#define NUM_BUFFERS         8
+#define NUM_XFERS           4
+#define TIMEOUT_MS          1000
+
+#define READ_LEN            2048
+#define NUM_STALLS          4
+
+/* Enough reads between stalls to drain the buffers that filled up during the
+ * previous stall, and to reach the gap that follows them */
+#define READS_PER_STALL     (4 * NUM_BUFFERS * BUF_LEN / READ_LEN)
+
+/* Longer than it takes the stream to fill all of its buffers */
+#define STALL_MS            (2 * NUM_BUFFERS * BUF_LEN / (SAMPLE_RATE / 1000))
+
+struct totals {
+    uint64_t next;              /* Timestamp expected for the next sample */
+    uint64_t timestamp_gaps;    /* Samples missing from received timestamps */
+    uint64_t meta_dropped;      /* Samples reported dropped via metadata */
+    unsigned int overruns;      /* Reads flagged with an overrun */
+};
+
+static unsigned int check_read(const struct bladerf_metadata *meta,
+                               unsigned int i, struct totals *t)
+{
+    const bool overrun = (meta->status & BLADERF_META_STATUS_OVERRUN) != 0;
+
+    if (overrun != (meta->dropped != 0)) {
+        PR_ERROR("Read %u: Status 0x%08x with %llu dropped\n", i,
+                 meta->status, (unsigned long long) meta->dropped);
+        return 1;
+    }
+
+    if (!overrun && meta->actual_count != READ_LEN) {
+        PR_ERROR("Read %u: Got %u samples without an overrun\n",
+                 i, meta->actual_count);
+        return 1;
+    }
+
+    if (i != 0) {
+        if (meta->timestamp < t->next) {
+            PR_ERROR("Read %u: Timestamp went backwards from t=%llu to "
+                     "t=%llu\n", i, (unsigned long long) t->next,
+                     (unsigned long long) meta->timestamp);
+            return 1;
+        }
+
+        t->timestamp_gaps += meta->timestamp - t->next;
+    }
+
+    t->next = meta->timestamp + meta->actual_count;
+    t->meta_dropped += meta->dropped;
+
+    if (overrun) {
+        t->overruns++;
+    }
+
+    return 0;
+}
+
+static unsigned int run(struct bladerf *dev, int16_t *samples, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int i;
+    struct bladerf_metadata meta;
+    struct bladerf_rx_overrun_stats stats;
+    struct totals t;
+
+    memset(&t, 0, sizeof(t));
+
+    for (i = 0; i < NUM_STALLS * READS_PER_STALL; i++) {
+        if (i % READS_PER_STALL == READS_PER_STALL / 2) {
+            sleep_ms(STALL_MS);
+        }
+
+        memset(&meta, 0, sizeof(meta));
+        meta.flags = BLADERF_META_FLAG_RX_NOW;
+
+        status = bladerf_sync_rx(dev, samples, READ_LEN, &meta, TIMEOUT_MS);
+        if (status != 0) {
+            PR_ERROR("Read %u failed: %s\n", i, bladerf_strerror(status));
+            return 1;
+        }
+
+        failures += check_read(&meta, i, &t);
+        if (failures != 0) {
+            return failures;
+        }
+    }
+
+    status = bladerf_get_rx_overrun_stats(dev, &stats);
+    if (status != 0) {
+        PR_ERROR("Failed to get overrun stats: %s\n",
+                 bladerf_strerror(status));
+        return 1;
+    }
+
+    PRINT("%s: %u overruns, %llu samples missing from timestamps\n",
+          __FUNCTION__, t.overruns, (unsigned long long) t.timestamp_gaps);
+
+    if (t.overruns == 0 || t.timestamp_gaps == 0) {
+        PR_ERROR("Stalling did not cause an overrun\n");
+        failures++;
+    }
+
+    if (t.meta_dropped != t.timestamp_gaps) {
+        PR_ERROR("Metadata reported %llu samples dropped, expected %llu\n",
+                 (unsigned long long) t.meta_dropped,
+                 (unsigned long long) t.timestamp_gaps);
+        failures++;
+    }
+
+    if (stats.events != t.overruns ||
+        stats.dropped_samples != t.timestamp_gaps) {
+        PR_ERROR("Overrun stats reported %llu events (%llu samples), "
+                 "expected %u (%llu samples)\n",
+                 (unsigned long long) stats.events,
+                 (unsigned long long) stats.dropped_samples,
+                 t.overruns, (unsigned long long) t.timestamp_gaps);
+        failures++;
+    }
+
+    return failures;
+}
+
+unsigned int test_rx_overrun(struct bladerf *dev_main,
+                             struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    int16_t *samples;
+    struct bladerf *dev;
+
+    PRINT("%s: Receiving with a slow consumer...\n", __FUNCTION__);
+
+    samples = malloc(2 * READ_LEN * sizeof(samples[0]));
+    if (samples == NULL) {
+        PR_ERROR("Failed to allocate sample buffer\n");
+        return 1;
+    }
+
+    status = open_dummy(&dev, SAMPLE_RATE, __FUNCTION__, quiet);
+    if (status != 0) {
+        free(samples);
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    status = bladerf_sync_config(dev, BLADERF_MODULE_RX,
+                                 BLADERF_FORMAT_SC16_Q11_META,
+                                 NUM_BUFFERS, BUF_LEN, NUM_XFERS, TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to configure RX sync i/f: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_enable_module(dev, BLADERF_MODULE_RX, true);
+    if (status != 0) {
+        PR_ERROR("Failed to enable RX module: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    failures += run(dev, samples, quiet);
+
+out:
+    bladerf_enable_module(dev, BLADERF_MODULE_RX, false);
+    bladerf_close(dev);
+    free(samples);
+    return failures;
+}
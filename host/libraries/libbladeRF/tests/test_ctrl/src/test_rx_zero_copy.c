@@ -0,0 +1,341 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(rx_zero_copy);
+
+#define NUM_ITERATIONS      64
+
+/* Rate at which the paced dummy device used by the timeout check streams.
+ * Its first buffer is available almost immediately, but the next one is not
+ * available for DEFAULT_BUF_LEN / TIMEOUT_SAMPLERATE seconds. */
+#define TIMEOUT_SAMPLERATE  1000
+#define SHORT_TIMEOUT_MS    50
+
+static inline const char *format_str(bladerf_format f)
+{
+    switch (f) {
+        case BLADERF_FORMAT_SC16_Q11:
+            return "SC16 Q11";
+        case BLADERF_FORMAT_SC16_Q11_META:
+            return "SC16 Q11 + metadata";
+        default:
+            return "unknown";
+    }
+}
+
+static int configure_rx(struct bladerf *dev, bladerf_format format)
+{
+    int status;
+
+    status = bladerf_sync_config(dev, BLADERF_MODULE_RX, format,
+                                 DEFAULT_NUM_BUFFERS, DEFAULT_BUF_LEN,
+                                 DEFAULT_NUM_XFERS, DEFAULT_TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to configure RX sync i/f: %s\n",
+                 bladerf_strerror(status));
+        return status;
+    }
+
+    status = bladerf_enable_module(dev, BLADERF_MODULE_RX, true);
+    if (status != 0) {
+        PR_ERROR("Failed to enable RX module: %s\n", bladerf_strerror(status));
+    }
+
+    return status;
+}
+
+/* Acquire some samples, and verify that the calls that are not permitted
+ * while they are lent out are rejected. */
+static unsigned int test_lend(struct bladerf *dev, bladerf_format format,
+                              bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int i, count, half, prev_count;
+    void *samples;
+    int16_t *first;
+    int16_t buf[2 * 16];
+    struct bladerf_metadata meta, *meta_ptr;
+    uint64_t prev_ts;
+
+    PRINT("%s: Lending samples in %s format...\n", __FUNCTION__,
+          format_str(format));
+
+    memset(&meta, 0, sizeof(meta));
+    meta_ptr = (format == BLADERF_FORMAT_SC16_Q11_META) ? &meta : NULL;
+
+    status = configure_rx(dev, format);
+    if (status != 0) {
+        return 1;
+    }
+
+    if (meta_ptr != NULL) {
+        status = bladerf_sync_rx_acquire(dev, &samples, &count, NULL,
+                                         DEFAULT_TIMEOUT_MS);
+        if (status != BLADERF_ERR_INVAL) {
+            PR_ERROR("Acquire without metadata returned: %s\n",
+                     bladerf_strerror(status));
+            failures++;
+        }
+    }
+
+    status = bladerf_sync_rx_acquire(dev, &samples, &count, meta_ptr,
+                                     DEFAULT_TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to acquire samples: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    } else if (count == 0 || count > DEFAULT_BUF_LEN) {
+        PR_ERROR("Unexpected number of samples lent: %u\n", count);
+        failures++;
+        goto out;
+    }
+
+    first = (int16_t *) samples;
+
+    /* Only a single lend may be outstanding */
+    status = bladerf_sync_rx_acquire(dev, &samples, &i, meta_ptr,
+                                     DEFAULT_TIMEOUT_MS);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Second acquire returned: %s\n", bladerf_strerror(status));
+        failures++;
+    }
+
+    status = bladerf_sync_rx(dev, buf, 16, meta_ptr, DEFAULT_TIMEOUT_MS);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("RX during lend returned: %s\n", bladerf_strerror(status));
+        failures++;
+    }
+
+    status = bladerf_sync_rx_release(dev, first, count + 1);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Over-release returned: %s\n", bladerf_strerror(status));
+        failures++;
+    }
+
+    status = bladerf_sync_rx_release(dev, first + 2, count - 1);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Release of unlent pointer returned: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    }
+
+    /* Release half of the samples. The remainder should be lent next. */
+    half = count / 2;
+    prev_ts = meta.timestamp;
+
+    status = bladerf_sync_rx_release(dev, first, half);
+    if (status != 0) {
+        PR_ERROR("Failed to release samples: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_sync_rx_acquire(dev, &samples, &i, meta_ptr,
+                                     DEFAULT_TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to re-acquire samples: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    if ((int16_t *) samples != first + 2 * half || i != count - half) {
+        PR_ERROR("Remainder mismatch: got %p (%u), expected %p (%u)\n",
+                 samples, i, (void *) (first + 2 * half), count - half);
+        failures++;
+    }
+
+    if (meta_ptr != NULL && meta.timestamp != prev_ts + half) {
+        PR_ERROR("Remainder timestamp mismatch: got 0x%llx, expected 0x%llx\n",
+                 (unsigned long long) meta.timestamp,
+                 (unsigned long long) (prev_ts + half));
+        failures++;
+    }
+
+    status = bladerf_sync_rx_release(dev, samples, i);
+    if (status != 0) {
+        PR_ERROR("Failed to release samples: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    /* Cycle through buffers, ensuring timestamps are contiguous unless the
+     * worker had to drop data while we weren't keeping up. */
+    prev_ts = meta.timestamp;
+    prev_count = i;
+
+    for (i = 0; i < NUM_ITERATIONS; i++) {
+        status = bladerf_sync_rx_acquire(dev, &samples, &count, meta_ptr,
+                                         DEFAULT_TIMEOUT_MS);
+        if (status != 0) {
+            PR_ERROR("Failed to acquire samples in iteration %u: %s\n",
+                     i, bladerf_strerror(status));
+            failures++;
+            goto out;
+        }
+
+        if (meta_ptr != NULL &&
+            (meta.status & BLADERF_META_STATUS_OVERRUN) == 0 &&
+            meta.timestamp != prev_ts + prev_count) {
+            PR_ERROR("Timestamp discontinuity in iteration %u: "
+                     "got 0x%llx, expected 0x%llx\n", i,
+                     (unsigned long long) meta.timestamp,
+                     (unsigned long long) (prev_ts + prev_count));
+            failures++;
+        }
+
+        prev_ts = meta.timestamp;
+        prev_count = count;
+
+        status = bladerf_sync_rx_release(dev, samples, count);
+        if (status != 0) {
+            PR_ERROR("Failed to release samples in iteration %u: %s\n",
+                     i, bladerf_strerror(status));
+            failures++;
+            goto out;
+        }
+    }
+
+    /* Nothing is lent, so a release should be rejected */
+    status = bladerf_sync_rx_release(dev, samples, count);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Release with nothing lent returned: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    }
+
+    /* ...and normal reads should work again */
+    meta.flags = BLADERF_META_FLAG_RX_NOW;
+    status = bladerf_sync_rx(dev, buf, 16, meta_ptr, DEFAULT_TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("RX after lend failed: %s\n", bladerf_strerror(status));
+        failures++;
+    }
+
+out:
+    bladerf_enable_module(dev, BLADERF_MODULE_RX, false);
+    return failures;
+}
+
+/* Uses a paced dummy device to verify that an acquire times out when no
+ * samples become available, and that nothing is lent in this case. */
+static unsigned int test_timeout(bladerf_format format, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int count;
+    void *samples;
+    struct bladerf *dev;
+    struct bladerf_metadata meta, *meta_ptr;
+
+    PRINT("%s: Checking acquire timeout in %s format...\n", __FUNCTION__,
+          format_str(format));
+
+    memset(&meta, 0, sizeof(meta));
+    meta_ptr = (format == BLADERF_FORMAT_SC16_Q11_META) ? &meta : NULL;
+
+    status = open_dummy(&dev, TIMEOUT_SAMPLERATE, __FUNCTION__, quiet);
+    if (status != 0) {
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    status = configure_rx(dev, format);
+    if (status != 0) {
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_sync_rx_acquire(dev, &samples, &count, meta_ptr,
+                                     DEFAULT_TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to acquire samples: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_sync_rx_release(dev, samples, count);
+    if (status != 0) {
+        PR_ERROR("Failed to release samples: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    /* In metadata mode, the remaining messages of the first buffer are
+     * available before the stream stalls */
+    while (meta_ptr != NULL) {
+        status = bladerf_sync_rx_acquire(dev, &samples, &count, meta_ptr,
+                                         SHORT_TIMEOUT_MS);
+        if (status != 0) {
+            break;
+        }
+
+        status = bladerf_sync_rx_release(dev, samples, count);
+        if (status != 0) {
+            PR_ERROR("Failed to release samples: %s\n",
+                     bladerf_strerror(status));
+            failures++;
+            goto out;
+        }
+    }
+
+    if (meta_ptr == NULL) {
+        status = bladerf_sync_rx_acquire(dev, &samples, &count, meta_ptr,
+                                         SHORT_TIMEOUT_MS);
+    }
+
+    if (status != BLADERF_ERR_TIMEOUT) {
+        PR_ERROR("Expected acquire to time out, got: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    }
+
+    status = bladerf_sync_rx_release(dev, samples, count);
+    if (status != BLADERF_ERR_INVAL) {
+        PR_ERROR("Release after timeout returned: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    }
+
+out:
+    bladerf_enable_module(dev, BLADERF_MODULE_RX, false);
+    bladerf_close(dev);
+    return failures;
+}
+
+unsigned int test_rx_zero_copy(struct bladerf *dev,
+                               struct app_params *p, bool quiet)
+{
+    unsigned int failures = 0;
+
+    failures += test_lend(dev, BLADERF_FORMAT_SC16_Q11, quiet);
+    failures += test_lend(dev, BLADERF_FORMAT_SC16_Q11_META, quiet);
+    failures += test_timeout(BLADERF_FORMAT_SC16_Q11, quiet);
+    failures += test_timeout(BLADERF_FORMAT_SC16_Q11_META, quiet);
+
+    return failures;
+}
@@ -0,0 +1,189 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Streams RX samples from a dummy device paced in real time, and checks that
+ * the counters reported by bladerf_get_stream_stats() advance in step with
+ * the buffers consumed via bladerf_sync_rx(). */
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(stream_stats);
+
+#define SAMPLE_RATE         1000000
+#define BUF_LEN             4096
+#define NUM_BUFFERS         8
+#define NUM_XFERS           4
+#define TIMEOUT_MS          1000
+
+/* Buffers consumed between snapshots of the stream's statistics */
+#define BUFFERS_PER_STEP    32
+#define NUM_STEPS           4
+
+static unsigned int check_stats(const struct bladerf_stream_stats *prev,
+                                const struct bladerf_stream_stats *curr,
+                                unsigned int step, bool quiet)
+{
+    unsigned int failures = 0;
+    const uint64_t consumed = (uint64_t) (step + 1) * BUFFERS_PER_STEP;
+
+    PRINT("%s: %llu buffers consumed, %llu transfers submitted, "
+          "%llu completed, full_max %u\n", __FUNCTION__,
+          (unsigned long long) curr->latency_count,
+          (unsigned long long) curr->transfers_submitted,
+          (unsigned long long) curr->transfers_completed, curr->full_max);
+
+    /* Each buffer handed to bladerf_sync_rx() is measured once */
+    if (curr->latency_count != consumed) {
+        PR_ERROR("Step %u: %llu buffers measured, expected %llu\n", step,
+                 (unsigned long long) curr->latency_count,
+                 (unsigned long long) consumed);
+        failures++;
+    }
+
+    /* Every consumed buffer arrived via a completed transfer */
+    if (curr->transfers_completed < consumed ||
+        curr->transfers_completed <= prev->transfers_completed ||
+        curr->transfers_submitted <= prev->transfers_submitted ||
+        curr->transfers_submitted < curr->transfers_completed) {
+        PR_ERROR("Step %u: Transfer counts did not advance: "
+                 "%llu -> %llu submitted, %llu -> %llu completed\n", step,
+                 (unsigned long long) prev->transfers_submitted,
+                 (unsigned long long) curr->transfers_submitted,
+                 (unsigned long long) prev->transfers_completed,
+                 (unsigned long long) curr->transfers_completed);
+        failures++;
+    }
+
+    if (curr->full_max < 1 || curr->full_max > NUM_BUFFERS ||
+        curr->full_max < prev->full_max) {
+        PR_ERROR("Step %u: full_max of %u (previously %u)\n",
+                 step, curr->full_max, prev->full_max);
+        failures++;
+    }
+
+    if (curr->in_flight > NUM_XFERS || curr->in_flight_max > NUM_XFERS) {
+        PR_ERROR("Step %u: %u transfers in flight (max %u), expected at "
+                 "most %u\n", step, curr->in_flight, curr->in_flight_max,
+                 NUM_XFERS);
+        failures++;
+    }
+
+    if (curr->short_transfers != 0 || curr->overruns != 0 ||
+        curr->underruns != 0) {
+        PR_ERROR("Step %u: %llu short transfers, %llu overruns, "
+                 "%llu underruns\n", step,
+                 (unsigned long long) curr->short_transfers,
+                 (unsigned long long) curr->overruns,
+                 (unsigned long long) curr->underruns);
+        failures++;
+    }
+
+    return failures;
+}
+
+static unsigned int run(struct bladerf *dev, int16_t *samples, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int step, i;
+    struct bladerf_stream_stats prev, curr;
+
+    status = bladerf_get_stream_stats(dev, BLADERF_MODULE_RX, &prev);
+    if (status != 0) {
+        PR_ERROR("Failed to get stream stats: %s\n", bladerf_strerror(status));
+        return 1;
+    }
+
+    for (step = 0; step < NUM_STEPS; step++) {
+        for (i = 0; i < BUFFERS_PER_STEP; i++) {
+            status = bladerf_sync_rx(dev, samples, BUF_LEN, NULL, TIMEOUT_MS);
+            if (status != 0) {
+                PR_ERROR("Failed to receive samples: %s\n",
+                         bladerf_strerror(status));
+                return failures + 1;
+            }
+        }
+
+        status = bladerf_get_stream_stats(dev, BLADERF_MODULE_RX, &curr);
+        if (status != 0) {
+            PR_ERROR("Failed to get stream stats: %s\n",
+                     bladerf_strerror(status));
+            return failures + 1;
+        }
+
+        failures += check_stats(&prev, &curr, step, quiet);
+        prev = curr;
+    }
+
+    return failures;
+}
+
+unsigned int test_stream_stats(struct bladerf *dev_main,
+                               struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    int16_t *samples;
+    struct bladerf *dev;
+
+    PRINT("%s: Checking stream statistics during RX...\n", __FUNCTION__);
+
+    samples = malloc(2 * BUF_LEN * sizeof(samples[0]));
+    if (samples == NULL) {
+        PR_ERROR("Failed to allocate sample buffer\n");
+        return 1;
+    }
+
+    status = open_dummy(&dev, SAMPLE_RATE, __FUNCTION__, quiet);
+    if (status != 0) {
+        free(samples);
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    status = bladerf_sync_config(dev, BLADERF_MODULE_RX,
+                                 BLADERF_FORMAT_SC16_Q11,
+                                 NUM_BUFFERS, BUF_LEN, NUM_XFERS, TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to configure RX sync i/f: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_enable_module(dev, BLADERF_MODULE_RX, true);
+    if (status != 0) {
+        PR_ERROR("Failed to enable RX module: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    failures += run(dev, samples, quiet);
+
+out:
+    bladerf_enable_module(dev, BLADERF_MODULE_RX, false);
+    bladerf_close(dev);
+    free(samples);
+    return failures;
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Streams RX samples with metadata from a dummy device paced in real time,
+ * pausing and resuming the stream via bladerf_sync_pause() and
+ * bladerf_sync_resume() between runs of reads. Within each run, timestamps
+ * must be contiguous. Across a pause, they must increase, and the samples
+ * discarded by the pause must not be reported as an overrun. */
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(sync_pause);
+
+#define SAMPLE_RATE         1000000
+#define BUF_LEN             4096
+#define NUM_BUFFERS         8
+#define NUM_XFERS           4
+#define TIMEOUT_MS          1000
+
+#define READ_LEN            2048
+#define READS_PER_RUN       64
+#define NUM_RUNS            4
+
+/* Longer than it takes the stream to fill all of its buffers, such that the
+ * stream would overrun were it not paused */
+#define PAUSE_MS            (2 * NUM_BUFFERS * BUF_LEN / (SAMPLE_RATE / 1000))
+
+/* Perform a run of reads. `next` is the timestamp expected to follow the
+ * previous run, or 0 before the first run. Upon return, it is the timestamp
+ * following the final sample read. */
+static unsigned int read_run(struct bladerf *dev, int16_t *samples,
+                             unsigned int run, uint64_t *next, bool quiet)
+{
+    int status;
+    unsigned int i;
+    struct bladerf_metadata meta;
+
+    for (i = 0; i < READS_PER_RUN; i++) {
+        memset(&meta, 0, sizeof(meta));
+        meta.flags = BLADERF_META_FLAG_RX_NOW;
+
+        status = bladerf_sync_rx(dev, samples, READ_LEN, &meta, TIMEOUT_MS);
+        if (status != 0) {
+            PR_ERROR("Run %u, read %u failed: %s\n",
+                     run, i, bladerf_strerror(status));
+            return 1;
+        }
+
+        if (meta.actual_count != READ_LEN ||
+            (meta.status & BLADERF_META_STATUS_OVERRUN) || meta.dropped != 0) {
+            PR_ERROR("Run %u, read %u: %u samples, status 0x%08x, "
+                     "%llu dropped\n", run, i, meta.actual_count, meta.status,
+                     (unsigned long long) meta.dropped);
+            return 1;
+        }
+
+        if (i == 0 && meta.timestamp < *next) {
+            PR_ERROR("Run %u started at t=%llu, before previous run's "
+                     "end at t=%llu\n", run,
+                     (unsigned long long) meta.timestamp,
+                     (unsigned long long) *next);
+            return 1;
+        } else if (i != 0 && meta.timestamp != *next) {
+            PR_ERROR("Run %u, read %u: Expected t=%llu, got t=%llu\n", run, i,
+                     (unsigned long long) *next,
+                     (unsigned long long) meta.timestamp);
+            return 1;
+        }
+
+        *next = meta.timestamp + meta.actual_count;
+    }
+
+    return 0;
+}
+
+unsigned int test_sync_pause(struct bladerf *dev_main,
+                             struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int run;
+    uint64_t next = 0;
+    int16_t *samples;
+    struct bladerf *dev;
+    struct bladerf_rx_overrun_stats overruns;
+
+    PRINT("%s: Pausing and resuming RX stream...\n", __FUNCTION__);
+
+    samples = malloc(2 * READ_LEN * sizeof(samples[0]));
+    if (samples == NULL) {
+        PR_ERROR("Failed to allocate sample buffer\n");
+        return 1;
+    }
+
+    status = open_dummy(&dev, SAMPLE_RATE, __FUNCTION__, quiet);
+    if (status != 0) {
+        free(samples);
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    status = bladerf_sync_config(dev, BLADERF_MODULE_RX,
+                                 BLADERF_FORMAT_SC16_Q11_META,
+                                 NUM_BUFFERS, BUF_LEN, NUM_XFERS, TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to configure RX sync i/f: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_enable_module(dev, BLADERF_MODULE_RX, true);
+    if (status != 0) {
+        PR_ERROR("Failed to enable RX module: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    for (run = 0; run < NUM_RUNS; run++) {
+        if (run != 0) {
+            status = bladerf_sync_pause(dev, BLADERF_MODULE_RX);
+            if (status != 0) {
+                PR_ERROR("Failed to pause RX: %s\n", bladerf_strerror(status));
+                failures++;
+                goto out;
+            }
+
+            sleep_ms(PAUSE_MS);
+
+            status = bladerf_sync_resume(dev, BLADERF_MODULE_RX);
+            if (status != 0) {
+                PR_ERROR("Failed to resume RX: %s\n",
+                         bladerf_strerror(status));
+                failures++;
+                goto out;
+            }
+        }
+
+        failures += read_run(dev, samples, run, &next, quiet);
+        if (failures != 0) {
+            goto out;
+        }
+    }
+
+    status = bladerf_get_rx_overrun_stats(dev, &overruns);
+    if (status != 0) {
+        PR_ERROR("Failed to get overrun stats: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+    } else if (overruns.events != 0) {
+        PR_ERROR("%llu overruns reported (%llu samples)\n",
+                 (unsigned long long) overruns.events,
+                 (unsigned long long) overruns.dropped_samples);
+        failures++;
+    }
+
+out:
+    /* Closing the device after a pause tears down the stream, which must
+     * not wait on a stream that has already stopped */
+    bladerf_enable_module(dev, BLADERF_MODULE_RX, false);
+    bladerf_close(dev);
+    free(samples);
+    return failures;
+}
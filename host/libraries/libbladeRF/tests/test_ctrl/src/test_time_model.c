@@ -0,0 +1,202 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Streams RX samples with metadata from a dummy device paced in real time,
+ * and compares the time at which each buffer is received against the library's
+ * estimate of when its final sample was taken. */
+#include <string.h>
+#include "test_ctrl.h"
+
+DECLARE_TEST_CASE(time_model);
+
+#define SAMPLE_RATE         1000000
+#define BUF_LEN             1024
+#define NUM_BUFFERS         16
+#define NUM_XFERS           8
+#define TIMEOUT_MS          1000
+
+/* Buffers received before measurements begin, so that the model has
+ * observations spanning enough time to fit the counter's rate */
+#define WARMUP_BUFFERS      200
+#define MEASURED_BUFFERS    500
+
+/* The median error is typically tens of microseconds when this is run by
+ * hand, and is dominated by the latency of the buffer handoff to the caller.
+ * This leaves headroom for loaded test machines. */
+#define TOLERANCE_NS        500000
+
+/* A buffer cannot be received before its final sample is taken, so no
+ * estimate of that time may follow the buffer's receipt by more than this */
+#define MAX_LATE_NS         50000
+
+/* Size of the header preceding each message's samples */
+#define MSG_HEADER_BYTES    16
+
+static int cmp_i64(const void *a, const void *b)
+{
+    const int64_t x = *(const int64_t *) a;
+    const int64_t y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Receive one message's worth of samples. Upon return, `end` is the
+ * timestamp following the message's final sample. */
+static int receive_msg(struct bladerf *dev, uint64_t *end, unsigned int *count)
+{
+    int status;
+    void *samples;
+    struct bladerf_metadata meta;
+
+    memset(&meta, 0, sizeof(meta));
+
+    status = bladerf_sync_rx_acquire(dev, &samples, count, &meta, TIMEOUT_MS);
+    if (status == 0) {
+        *end = meta.timestamp + *count;
+        status = bladerf_sync_rx_release(dev, samples, *count);
+    }
+
+    return status;
+}
+
+unsigned int test_time_model(struct bladerf *dev,
+                             struct app_params *p, bool quiet)
+{
+    int status;
+    unsigned int failures = 0;
+    unsigned int i, n, count, msg_len, msgs_per_buf;
+    uint64_t start, end, received, estimate;
+    int64_t err[MEASURED_BUFFERS];
+    struct bladerf *paced;
+
+    PRINT("%s: Comparing buffer arrival times with estimates...\n",
+          __FUNCTION__);
+
+    status = open_dummy(&paced, SAMPLE_RATE, __FUNCTION__, quiet);
+    if (status != 0) {
+        return status == BLADERF_ERR_NODEV ? 0 : 1;
+    }
+
+    /* The model uses the configured rate until it has enough observations */
+    status = bladerf_set_sample_rate(paced, BLADERF_MODULE_RX, SAMPLE_RATE, NULL);
+    if (status != 0) {
+        PR_ERROR("Failed to set sample rate: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_sync_config(paced, BLADERF_MODULE_RX,
+                                 BLADERF_FORMAT_SC16_Q11_META,
+                                 NUM_BUFFERS, BUF_LEN, NUM_XFERS, TIMEOUT_MS);
+    if (status != 0) {
+        PR_ERROR("Failed to configure RX sync i/f: %s\n",
+                 bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    status = bladerf_enable_module(paced, BLADERF_MODULE_RX, true);
+    if (status != 0) {
+        PR_ERROR("Failed to enable RX module: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    /* Messages are lent one at a time. The first is lent in its entirety,
+     * which yields the number of messages per buffer. */
+    status = receive_msg(paced, &end, &msg_len);
+    if (status != 0) {
+        PR_ERROR("Failed to receive samples: %s\n", bladerf_strerror(status));
+        failures++;
+        goto out;
+    }
+
+    start = end - msg_len;
+    msgs_per_buf = (BUF_LEN * 4) / (msg_len * 4 + MSG_HEADER_BYTES);
+
+    if (msgs_per_buf == 0 ||
+        (BUF_LEN * 4) % (msg_len * 4 + MSG_HEADER_BYTES) != 0) {
+        PR_ERROR("Unexpected message length: %u samples\n", msg_len);
+        failures++;
+        goto out;
+    }
+
+    for (i = 0, n = 0; n < MEASURED_BUFFERS; ) {
+        status = receive_msg(paced, &end, &count);
+        if (status != 0) {
+            PR_ERROR("Failed to receive samples: %s\n",
+                     bladerf_strerror(status));
+            failures++;
+            goto out;
+        }
+
+        received = bladerf_get_host_time();
+
+        /* Only a buffer's final message is received as soon as the buffer
+         * arrives. */
+        if (((end - start) / msg_len) % msgs_per_buf != 0) {
+            continue;
+        }
+
+        if (i < WARMUP_BUFFERS) {
+            i++;
+            continue;
+        }
+
+        status = bladerf_get_host_time_estimate(paced, BLADERF_MODULE_RX,
+                                                end, &estimate);
+        if (status != 0) {
+            PR_ERROR("Failed to get estimate: %s\n", bladerf_strerror(status));
+            failures++;
+            goto out;
+        }
+
+        err[n++] = (int64_t) (received - estimate);
+    }
+
+    qsort(err, MEASURED_BUFFERS, sizeof(err[0]), cmp_i64);
+
+    PRINT("%s: Error (us): min %.1f, median %.1f, p99 %.1f, max %.1f\n",
+          __FUNCTION__, err[0] / 1e3, err[MEASURED_BUFFERS / 2] / 1e3,
+          err[MEASURED_BUFFERS * 99 / 100] / 1e3,
+          err[MEASURED_BUFFERS - 1] / 1e3);
+
+    if (err[MEASURED_BUFFERS / 2] > TOLERANCE_NS ||
+        err[MEASURED_BUFFERS / 2] < -TOLERANCE_NS) {
+        PR_ERROR("Median error of %.1f us exceeds %.1f us\n",
+                 err[MEASURED_BUFFERS / 2] / 1e3, TOLERANCE_NS / 1e3);
+        failures++;
+    }
+
+    if (err[0] < -MAX_LATE_NS) {
+        PR_ERROR("Estimate followed a buffer's receipt by %.1f us\n",
+                 -err[0] / 1e3);
+        failures++;
+    }
+
+out:
+    bladerf_enable_module(paced, BLADERF_MODULE_RX, false);
+    bladerf_close(paced);
+    return failures;
+}
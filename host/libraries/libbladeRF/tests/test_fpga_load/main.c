@@ -0,0 +1,138 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* This program measures the time taken to load an FPGA bitstream, from the
+ * call to bladerf_load_fpga_force() to its return. This includes sending the
+ * bitstream to the device, waiting for the FPGA to report that it has been
+ * configured, and reinitializing the device.
+ *
+ * Only API functions that predate the chunked bitstream upload are used, such
+ * that load times may be compared by running this against libbladeRF builds
+ * from before and after that change.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <libbladeRF.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
+
+#define DEFAULT_ITERATIONS  5
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int i;
+    unsigned int iterations = DEFAULT_ITERATIONS;
+    const char *device = NULL;
+    const char *bitstream;
+    struct bladerf *dev;
+    uint64_t *load_ns;
+    uint64_t t, total = 0;
+    int status;
+
+    if (argc < 2 || argc > 4 || !strcmp(argv[1], "-h")) {
+        printf("Usage: %s <bitstream> [iterations] [device]\n", argv[0]);
+        printf("Defaults: %u iterations, first available device\n",
+               DEFAULT_ITERATIONS);
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    bitstream = argv[1];
+
+    if (argc > 2) {
+        iterations = (unsigned int) strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3) {
+        device = argv[3];
+    }
+
+    if (iterations == 0) {
+        fprintf(stderr, "Iteration count must be non-zero.\n");
+        return EXIT_FAILURE;
+    }
+
+    load_ns = calloc(iterations, sizeof(load_ns[0]));
+    if (load_ns == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        return EXIT_FAILURE;
+    }
+
+    status = bladerf_open(&dev, device);
+    if (status != 0) {
+        fprintf(stderr, "Failed to open device: %s\n",
+                bladerf_strerror(status));
+        free(load_ns);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < iterations; i++) {
+        t = now_ns();
+        status = bladerf_load_fpga_force(dev, bitstream);
+        load_ns[i] = now_ns() - t;
+
+        if (status != 0) {
+            fprintf(stderr, "Load %u failed: %s\n",
+                    i, bladerf_strerror(status));
+            goto out;
+        }
+
+        total += load_ns[i];
+        printf("Load %u: %.1f ms\n", i, load_ns[i] / 1e6);
+    }
+
+    qsort(load_ns, iterations, sizeof(load_ns[0]), cmp_u64);
+
+    printf("\n%u loads: min %.1f ms, median %.1f ms, mean %.1f ms, "
+           "max %.1f ms\n", iterations, load_ns[0] / 1e6,
+           load_ns[iterations / 2] / 1e6, total / 1e6 / iterations,
+           load_ns[iterations - 1] / 1e6);
+
+out:
+    bladerf_close(dev);
+    free(load_ns);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,495 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <libbladeRF.h>
+
+#include "host_config.h"
+#include "rel_assert.h"
+#include "conversions.h"
+#include "log.h"
+#include "bench.h"
+
+#if BLADERF_OS_WINDOWS
+#   include <windows.h>
+#   include "clock_gettime.h"
+#else
+#   include <sys/time.h>
+#   include <sys/resource.h>
+#   if BLADERF_OS_OSX
+#       include "clock_gettime.h"
+#   else
+#       include <time.h>
+#   endif
+#endif
+
+struct bench_result {
+    int status;
+
+    uint64_t samples;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+
+    /* RX discontinuities reported via BLADERF_META_STATUS_OVERRUN,
+     * and the number of samples lost to them */
+    uint64_t overruns;
+    uint64_t dropped;
+
+    /* Per-call latencies, in ns */
+    uint64_t *latency;
+    size_t num_calls;
+    size_t max_calls;
+};
+
+static inline uint64_t wall_time_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/* Process-wide CPU time, which includes libbladeRF's stream threads */
+static uint64_t cpu_time_ns(void)
+{
+#if BLADERF_OS_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    ULARGE_INTEGER k, u;
+
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit,
+                         &kernel, &user)) {
+        return 0;
+    }
+
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    /* FILETIME values are in units of 100 ns */
+    return (k.QuadPart + u.QuadPart) * 100;
+#else
+    struct rusage r;
+
+    if (getrusage(RUSAGE_SELF, &r) != 0) {
+        return 0;
+    }
+
+    return ((uint64_t) r.ru_utime.tv_sec + r.ru_stime.tv_sec) * 1000000000 +
+           ((uint64_t) r.ru_utime.tv_usec + r.ru_stime.tv_usec) * 1000;
+#endif
+}
+
+int sweep_parse(const char *str, unsigned int min, struct sweep *s)
+{
+    char *list, *tok, *saveptr;
+    bool ok = true;
+
+    list = strdup(str);
+    if (list == NULL) {
+        return -1;
+    }
+
+    s->count = 0;
+
+    for (tok = strtok_r(list, ",", &saveptr);
+         tok != NULL && ok;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+
+        if (s->count >= MAX_SWEEP_VALUES) {
+            log_error("Too many values in list (max: %u): %s\n",
+                      MAX_SWEEP_VALUES, str);
+            ok = false;
+        } else {
+            s->values[s->count++] = str2uint(tok, min, UINT_MAX, &ok);
+        }
+    }
+
+    free(list);
+
+    if (!ok || s->count == 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void bench_init_params(struct bench_params *p)
+{
+    int status;
+
+    memset(p, 0, sizeof(*p));
+
+    p->rx = true;
+    p->tx = true;
+
+    p->samples = DEFAULT_SAMPLES;
+    p->block_size = DEFAULT_BLOCK_SIZE;
+    p->timeout_ms = DEFAULT_STREAM_TIMEOUT;
+
+    status  = sweep_parse(DEFAULT_STREAM_XFERS, 1, &p->num_xfers);
+    status |= sweep_parse(DEFAULT_STREAM_BUFFERS, 1, &p->buffer_count);
+    status |= sweep_parse(DEFAULT_STREAM_SAMPLES, 1, &p->buffer_size);
+    assert(status == 0);
+
+    p->out = stdout;
+}
+
+static int stream_samples(struct bladerf *dev, bladerf_module module,
+                          int16_t *samples, const struct bench_params *p,
+                          struct bench_result *r)
+{
+    int status = 0;
+    struct bladerf_metadata meta;
+    uint64_t remaining = p->samples;
+    uint64_t expected_ts = 0;
+    uint64_t t_start, t_end;
+    unsigned int to_xfer;
+    bool first = true;
+
+    while (remaining != 0 && status == 0) {
+        to_xfer = remaining < p->block_size ?
+                    (unsigned int) remaining : p->block_size;
+
+        memset(&meta, 0, sizeof(meta));
+
+        if (module == BLADERF_MODULE_RX) {
+            meta.flags = BLADERF_META_FLAG_RX_NOW;
+
+            t_start = wall_time_ns();
+            status = bladerf_sync_rx(dev, samples, to_xfer, &meta,
+                                     SYNC_TIMEOUT_MS);
+            t_end = wall_time_ns();
+
+            if (status == 0) {
+                /* A call that returns early with BLADERF_META_STATUS_OVERRUN
+                 * is followed by one that starts after the discontinuity */
+                if (!first && meta.timestamp != expected_ts) {
+                    r->overruns++;
+                    if (meta.timestamp > expected_ts) {
+                        r->dropped += meta.timestamp - expected_ts;
+                    }
+                }
+
+                to_xfer = meta.actual_count;
+                expected_ts = meta.timestamp + meta.actual_count;
+            }
+        } else {
+            if (first) {
+                meta.flags = BLADERF_META_FLAG_TX_BURST_START |
+                             BLADERF_META_FLAG_TX_NOW;
+            }
+
+            if (remaining == to_xfer) {
+                meta.flags |= BLADERF_META_FLAG_TX_BURST_END;
+            }
+
+            t_start = wall_time_ns();
+            status = bladerf_sync_tx(dev, samples, to_xfer, &meta,
+                                     SYNC_TIMEOUT_MS);
+            t_end = wall_time_ns();
+        }
+
+        if (status != 0) {
+            log_error("%s failed: %s\n",
+                      module == BLADERF_MODULE_RX ? "RX" : "TX",
+                      bladerf_strerror(status));
+        } else {
+            if (r->num_calls == r->max_calls) {
+                uint64_t *tmp = realloc(r->latency, 2 * r->max_calls *
+                                                    sizeof(r->latency[0]));
+                if (tmp == NULL) {
+                    return BLADERF_ERR_MEM;
+                }
+
+                r->latency = tmp;
+                r->max_calls *= 2;
+            }
+
+            r->latency[r->num_calls++] = t_end - t_start;
+            r->samples += to_xfer;
+            remaining -= to_xfer;
+            first = false;
+        }
+    }
+
+    return status;
+}
+
+static void run_config(struct bladerf *dev, bladerf_module module,
+                       const struct bench_params *p,
+                       unsigned int num_buffers, unsigned int buffer_size,
+                       unsigned int num_xfers, struct bench_result *r)
+{
+    int status;
+    int16_t *samples = NULL;
+    uint64_t wall_start, cpu_start;
+
+    memset(r, 0, sizeof(*r));
+
+    /* RX calls may return early upon discontinuities, in which case this
+     * will be grown as needed */
+    r->max_calls = (size_t) ((p->samples + p->block_size - 1) / p->block_size);
+    r->latency = calloc(r->max_calls, sizeof(r->latency[0]));
+    samples = calloc(p->block_size, 2 * sizeof(samples[0]));
+
+    if (r->latency == NULL || samples == NULL) {
+        status = BLADERF_ERR_MEM;
+        goto out;
+    }
+
+    /* Provide a recognizable TX pattern, should the samples be looped back */
+    if (module == BLADERF_MODULE_TX) {
+        unsigned int i;
+        for (i = 0; i < p->block_size; i++) {
+            samples[2 * i] = (int16_t) (i & 0x7ff);
+            samples[2 * i + 1] = (int16_t) -(i & 0x7ff);
+        }
+    }
+
+    status = bladerf_sync_config(dev, module, BLADERF_FORMAT_SC16_Q11_META,
+                                 num_buffers, buffer_size, num_xfers,
+                                 p->timeout_ms);
+    if (status != 0) {
+        log_debug("Skipping buffers=%u, size=%u, xfers=%u: %s\n",
+                  num_buffers, buffer_size, num_xfers,
+                  bladerf_strerror(status));
+        goto out;
+    }
+
+    status = bladerf_enable_module(dev, module, true);
+    if (status != 0) {
+        log_error("Failed to enable module: %s\n", bladerf_strerror(status));
+        goto out;
+    }
+
+    wall_start = wall_time_ns();
+    cpu_start = cpu_time_ns();
+
+    status = stream_samples(dev, module, samples, p, r);
+
+    r->wall_ns = wall_time_ns() - wall_start;
+    r->cpu_ns = cpu_time_ns() - cpu_start;
+
+    bladerf_enable_module(dev, module, false);
+
+out:
+    r->status = status;
+    free(samples);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static inline double percentile_us(const struct bench_result *r, unsigned p)
+{
+    size_t idx = (size_t) ((uint64_t) (r->num_calls - 1) * p / 100);
+    return r->latency[idx] / 1e3;
+}
+
+static void print_result(FILE *out, bladerf_module module,
+                         unsigned int num_buffers, unsigned int buffer_size,
+                         unsigned int num_xfers,
+                         const struct bench_result *r)
+{
+    uint64_t hist[LATENCY_HIST_BUCKETS];
+    uint64_t total_ns = 0;
+    double elapsed, msamples;
+    size_t i;
+    unsigned int b;
+
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"direction\": \"%s\",\n",
+            module == BLADERF_MODULE_RX ? "rx" : "tx");
+    fprintf(out, "      \"num_buffers\": %u,\n", num_buffers);
+    fprintf(out, "      \"buffer_size\": %u,\n", buffer_size);
+    fprintf(out, "      \"num_transfers\": %u,\n", num_xfers);
+
+    if (r->status != 0 || r->num_calls == 0) {
+        fprintf(out, "      \"status\": \"%s\"\n",
+                r->status != 0 ? bladerf_strerror(r->status) : "No samples");
+        fprintf(out, "    }");
+        return;
+    }
+
+    fprintf(out, "      \"status\": \"ok\",\n");
+
+    memset(hist, 0, sizeof(hist));
+    for (i = 0; i < r->num_calls; i++) {
+        uint64_t us = r->latency[i] / 1000;
+
+        total_ns += r->latency[i];
+
+        for (b = 0; b < LATENCY_HIST_BUCKETS - 1 && us >= (1ull << b); b++);
+        hist[b]++;
+    }
+
+    qsort(r->latency, r->num_calls, sizeof(r->latency[0]), cmp_u64);
+
+    elapsed = r->wall_ns / 1e9;
+    msamples = r->samples / 1e6;
+
+    fprintf(out, "      \"samples\": %llu,\n", (unsigned long long) r->samples);
+    fprintf(out, "      \"elapsed_s\": %.6f,\n", elapsed);
+    fprintf(out, "      \"samples_per_sec\": %.1f,\n",
+            elapsed > 0 ? r->samples / elapsed : 0.0);
+    fprintf(out, "      \"cpu_s\": %.6f,\n", r->cpu_ns / 1e9);
+    fprintf(out, "      \"cpu_s_per_msample\": %.6f,\n",
+            msamples > 0 ? (r->cpu_ns / 1e9) / msamples : 0.0);
+    fprintf(out, "      \"overruns\": %llu,\n",
+            (unsigned long long) r->overruns);
+    fprintf(out, "      \"dropped_samples\": %llu,\n",
+            (unsigned long long) r->dropped);
+
+    fprintf(out, "      \"latency_us\": {\n");
+    fprintf(out, "        \"calls\": %llu,\n",
+            (unsigned long long) r->num_calls);
+    fprintf(out, "        \"min\": %.3f,\n", r->latency[0] / 1e3);
+    fprintf(out, "        \"mean\": %.3f,\n", total_ns / 1e3 / r->num_calls);
+    fprintf(out, "        \"p50\": %.3f,\n", percentile_us(r, 50));
+    fprintf(out, "        \"p90\": %.3f,\n", percentile_us(r, 90));
+    fprintf(out, "        \"p99\": %.3f,\n", percentile_us(r, 99));
+    fprintf(out, "        \"max\": %.3f,\n",
+            r->latency[r->num_calls - 1] / 1e3);
+
+    fprintf(out, "        \"histogram\": [");
+    for (b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+        fprintf(out, "%s%llu", b == 0 ? "" : ", ",
+                (unsigned long long) hist[b]);
+    }
+    fprintf(out, "]\n");
+
+    fprintf(out, "      }\n");
+    fprintf(out, "    }");
+}
+
+static void print_header(FILE *out, struct bladerf *dev,
+                         const struct bench_params *p)
+{
+    struct bladerf_devinfo info;
+    unsigned int b;
+
+    fprintf(out, "{\n");
+
+    if (bladerf_get_devinfo(dev, &info) == 0) {
+        fprintf(out, "  \"backend\": \"%s\",\n",
+                bladerf_backend_str(info.backend));
+    }
+
+    fprintf(out, "  \"samplerate\": %u,\n", p->samplerate);
+    fprintf(out, "  \"samples\": %llu,\n", (unsigned long long) p->samples);
+    fprintf(out, "  \"block_size\": %u,\n", p->block_size);
+    fprintf(out, "  \"timeout_ms\": %u,\n", p->timeout_ms);
+
+    /* Upper bound of each latency histogram bucket, in microseconds. The
+     * final bucket holds all latencies above the last listed bound. */
+    fprintf(out, "  \"histogram_bounds_us\": [");
+    for (b = 0; b < LATENCY_HIST_BUCKETS - 1; b++) {
+        fprintf(out, "%s%llu", b == 0 ? "" : ", ", 1ull << b);
+    }
+    fprintf(out, "],\n");
+
+    fprintf(out, "  \"results\": [\n");
+}
+
+int bench_run(struct bench_params *p)
+{
+    int status;
+    int ret = 0;
+    struct bladerf *dev;
+    struct bench_result r;
+    unsigned int i, j, k, m;
+    bool first = true;
+    const bladerf_module modules[] = { BLADERF_MODULE_RX, BLADERF_MODULE_TX };
+
+    status = bladerf_open(&dev, p->device_str);
+    if (status != 0) {
+        log_error("Failed to open device: %s\n", bladerf_strerror(status));
+        return -1;
+    }
+
+    if (p->samplerate != 0) {
+        for (m = 0; m < 2 && status == 0; m++) {
+            status = bladerf_set_sample_rate(dev, modules[m], p->samplerate,
+                                             NULL);
+        }
+
+        if (status != 0) {
+            log_error("Failed to set samplerate: %s\n",
+                      bladerf_strerror(status));
+            bladerf_close(dev);
+            return -1;
+        }
+    }
+
+    print_header(p->out, dev, p);
+
+    for (m = 0; m < 2; m++) {
+        if ((modules[m] == BLADERF_MODULE_RX && !p->rx) ||
+            (modules[m] == BLADERF_MODULE_TX && !p->tx)) {
+            continue;
+        }
+
+        for (i = 0; i < p->buffer_count.count; i++) {
+            for (j = 0; j < p->buffer_size.count; j++) {
+                for (k = 0; k < p->num_xfers.count; k++) {
+                    const unsigned int num_buffers = p->buffer_count.values[i];
+                    const unsigned int buffer_size = p->buffer_size.values[j];
+                    const unsigned int num_xfers = p->num_xfers.values[k];
+
+                    run_config(dev, modules[m], p, num_buffers, buffer_size,
+                               num_xfers, &r);
+
+                    /* Invalid combinations (e.g., num_xfers >= num_buffers)
+                     * are reported, but do not fail the benchmark */
+                    if (r.status != 0 && r.status != BLADERF_ERR_INVAL) {
+                        ret = -1;
+                    }
+
+                    if (!first) {
+                        fprintf(p->out, ",\n");
+                    }
+
+                    print_result(p->out, modules[m], num_buffers, buffer_size,
+                                 num_xfers, &r);
+                    fflush(p->out);
+
+                    free(r.latency);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    fprintf(p->out, "\n  ]\n}\n");
+
+    bladerf_close(dev);
+    return ret;
+}
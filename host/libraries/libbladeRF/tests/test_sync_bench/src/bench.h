@@ -0,0 +1,95 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <libbladeRF.h>
+
+/* Device config defaults */
+#define DEFAULT_DEVICE          "dummy"
+
+/* Benchmark defaults */
+#define DEFAULT_SAMPLES         (16 * 1024 * 1024)
+#define DEFAULT_BLOCK_SIZE      4096
+
+/* Stream defaults. Each of these may be swept over a list of values. */
+#define DEFAULT_STREAM_XFERS    "8,16"
+#define DEFAULT_STREAM_BUFFERS  "16,32"
+#define DEFAULT_STREAM_SAMPLES  "4096,16384"
+#define DEFAULT_STREAM_TIMEOUT  1000
+
+#define SYNC_TIMEOUT_MS         1000
+
+/* Maximum number of values in each swept parameter list */
+#define MAX_SWEEP_VALUES        16
+
+/* Latency histogram buckets are powers of two, in microseconds. The last
+ * bucket accumulates everything beyond the second-to-last bound. */
+#define LATENCY_HIST_BUCKETS    22
+
+struct sweep {
+    unsigned int values[MAX_SWEEP_VALUES];
+    unsigned int count;
+};
+
+struct bench_params {
+    const char *device_str;
+    unsigned int samplerate;        /* 0 => Leave at device default */
+
+    bool rx;
+    bool tx;
+
+    uint64_t samples;               /* Samples to stream per configuration */
+    unsigned int block_size;        /* Samples per sync call */
+
+    struct sweep num_xfers;
+    struct sweep buffer_count;
+    struct sweep buffer_size;
+    unsigned int timeout_ms;
+
+    FILE *out;
+};
+
+/**
+ * Parse a comma-separated list of values into a sweep
+ *
+ * @return 0 on success, -1 on an invalid list
+ */
+int sweep_parse(const char *str, unsigned int min, struct sweep *s);
+
+void bench_init_params(struct bench_params *p);
+
+/**
+ * Run the benchmark for each combination of swept parameters, writing
+ * results to p->out as a JSON object.
+ *
+ * @return 0 if all configurations ran successfully, non-zero otherwise
+ */
+int bench_run(struct bench_params *p);
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <libbladeRF.h>
+#include <getopt.h>
+
+#include "host_config.h"
+#include "conversions.h"
+#include "log.h"
+#include "bench.h"
+
+/* FIXME these should be provided in libbladeRF.h */
+#define SAMPLERATE_MIN          160000u
+#define SAMPLERATE_MAX          40000000u
+
+#define OPTSTR "hd:s:m:n:b:X:B:C:T:o:"
+const struct option long_options[] = {
+    { "help",           no_argument,        0,  'h' },
+
+    /* Device configuration */
+    { "device",         required_argument,  0,  'd' },
+    { "samplerate",     required_argument,  0,  's' },
+
+    /* Benchmark configuration */
+    { "mode",           required_argument,  0,  'm' },
+    { "samples",        required_argument,  0,  'n' },
+    { "block-size",     required_argument,  0,  'b' },
+    { "output",         required_argument,  0,  'o' },
+
+    /* Stream configuration */
+    { "num-xfers",      required_argument,  0,  'X' },
+    { "buffer-size",    required_argument,  0,  'B' },
+    { "buffer-count",   required_argument,  0,  'C' },
+    { "timeout",        required_argument,  0,  'T' },
+
+    /* Verbosity options */
+    { "verbosity",      required_argument,  0,  1,  },
+    { "lib-verbosity",  required_argument,  0,  2,  },
+    { 0,                0,                  0,  0   },
+};
+
+const struct numeric_suffix freq_suffixes[] = {
+    { "K",   1000 },
+    { "kHz", 1000 },
+    { "M",   1000000 },
+    { "MHz", 1000000 },
+};
+
+const unsigned int num_freq_suffixes = sizeof(freq_suffixes) / sizeof(freq_suffixes[0]);
+
+const struct numeric_suffix size_suffixes[] = {
+    { "K",  1024 },
+    { "M",  1024 * 1024 },
+};
+
+const unsigned int num_size_suffixes = sizeof(size_suffixes) / sizeof(size_suffixes[0]);
+
+const struct numeric_suffix count_suffixes[] = {
+    { "K", 1000 },
+    { "M", 1000000 },
+    { "G", 1000000000 },
+};
+
+const unsigned int num_count_suffixes = sizeof(count_suffixes) / sizeof(count_suffixes[0]);
+
+static void print_usage(const char *argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("libbladeRF_test_sync_bench: Benchmark the sync interface over a sweep\n");
+    printf("of stream configurations, writing results as JSON.\n");
+    printf("\n");
+
+    printf("Device configuration options:\n");
+    printf("    -d, --device <device>       Use the specified device. Default = \"%s\".\n", DEFAULT_DEVICE);
+    printf("    -s, --samplerate <value>    Set the specified sample rate on both modules.\n");
+    printf("                                By default, the device's rate is left as-is.\n");
+    printf("\n");
+
+    printf("Benchmark configuration options:\n");
+    printf("    -m, --mode <mode>           Stream direction(s): rx, tx, or both.\n");
+    printf("                                Default = both.\n");
+    printf("    -n, --samples <n>           # samples to stream per configuration.\n");
+    printf("                                Default = %u.\n", DEFAULT_SAMPLES);
+    printf("    -b, --block-size <n>        # samples to RX/TX per sync call. Default = %u.\n", DEFAULT_BLOCK_SIZE);
+    printf("    -o, --output <file>         Write JSON results to <file>. Default = stdout.\n");
+    printf("\n");
+
+    printf("Stream configuration options. Each accepts a comma-separated list of values:\n");
+    printf("    -X, --num-xfers <list>      # in-flight transfers. Default = %s.\n", DEFAULT_STREAM_XFERS);
+    printf("    -B, --buffer-size <list>    # samples per stream buffer. Default = %s.\n", DEFAULT_STREAM_SAMPLES);
+    printf("    -C, --buffer-count <list>   # of stream buffers. Default = %s.\n", DEFAULT_STREAM_BUFFERS);
+    printf("    -T, --timeout <n>           Stream timeout, in ms. Default = %u.\n", DEFAULT_STREAM_TIMEOUT);
+    printf("\n");
+
+    printf("Misc options:\n");
+    printf("    -h, --help                  Show this help text\n");
+    printf("    --verbosity <level>         Set test verbosity (Default: warning)\n");
+    printf("    --lib-verbosity <level>     Set libbladeRF verbosity (Default: warning)\n");
+    printf("\n");
+
+    printf("Notes:\n");
+    printf("    Every combination of the stream configuration lists is run. Invalid\n");
+    printf("    combinations (e.g., num-xfers >= buffer-count) are reported as such.\n");
+    printf("\n");
+    printf("    RX overruns are detected via discontinuities in metadata timestamps.\n");
+    printf("\n");
+    printf("    When using the dummy backend, the BLADERF_DUMMY_SAMPLE_RATE environment\n");
+    printf("    variable may be used to pace the simulated device. Otherwise, it runs as\n");
+    printf("    fast as possible.\n");
+    printf("\n");
+}
+
+static int handle_cmdline(int argc, char *argv[], struct bench_params *p)
+{
+    int c;
+    int idx;
+    bool ok;
+    bladerf_log_level level;
+
+    bench_init_params(p);
+
+    while ((c = getopt_long(argc, argv, OPTSTR, long_options, &idx)) >= 0) {
+        switch (c) {
+
+            case 1:
+                level = str2loglevel(optarg, &ok);
+                if (!ok) {
+                    log_error("Invalid log level provided: %s\n", optarg);
+                    return -1;
+                } else {
+                    log_set_verbosity(level);
+                }
+                break;
+
+            case 2:
+                level = str2loglevel(optarg, &ok);
+                if (!ok) {
+                    log_error("Invalid log level provided: %s\n", optarg);
+                    return -1;
+                } else {
+                    bladerf_log_set_verbosity(level);
+                }
+                break;
+
+            case 'h':
+                return 1;
+
+            case 'd':
+                if (p->device_str != NULL) {
+                    log_error("Device was already specified.\n");
+                    return -1;
+                }
+
+                p->device_str = strdup(optarg);
+                if (p->device_str == NULL) {
+                    perror("strdup");
+                    return -1;
+                }
+                break;
+
+            case 's':
+                p->samplerate = str2uint_suffix(optarg,
+                                                SAMPLERATE_MIN, SAMPLERATE_MAX,
+                                                freq_suffixes,
+                                                num_freq_suffixes,
+                                                &ok);
+                if (!ok) {
+                    log_error("Invalid sample rate: %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'm':
+                if (!strcasecmp(optarg, "rx")) {
+                    p->rx = true;
+                    p->tx = false;
+                } else if (!strcasecmp(optarg, "tx")) {
+                    p->rx = false;
+                    p->tx = true;
+                } else if (!strcasecmp(optarg, "both")) {
+                    p->rx = true;
+                    p->tx = true;
+                } else {
+                    log_error("Invalid mode: %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'n':
+                p->samples = str2uint_suffix(optarg, 1, UINT_MAX,
+                                             count_suffixes,
+                                             num_count_suffixes,
+                                             &ok);
+                if (!ok) {
+                    log_error("Invalid sample count: %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'b':
+                p->block_size = str2uint_suffix(optarg, 1, UINT_MAX,
+                                                size_suffixes,
+                                                num_size_suffixes,
+                                                &ok);
+
+                if (!ok) {
+                    log_error("Invalid block size: %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'o':
+                if (p->out != stdout) {
+                    log_error("Output file already provided.\n");
+                    return -1;
+                }
+
+                p->out = fopen(optarg, "w");
+                if (p->out == NULL) {
+                    log_error("Failed to open output file - %s\n",
+                            strerror(errno));
+                    p->out = stdout;
+                    return -1;
+                }
+                break;
+
+            case 'X':
+                if (sweep_parse(optarg, 1, &p->num_xfers) != 0) {
+                    log_error("Invalid stream transfer count(s): %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'B':
+                if (sweep_parse(optarg, 1, &p->buffer_size) != 0) {
+                    log_error("Invalid stream buffer size(s): %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'C':
+                if (sweep_parse(optarg, 1, &p->buffer_count) != 0) {
+                    log_error("Invalid stream buffer count(s): %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'T':
+                p->timeout_ms = str2uint(optarg, 0, UINT_MAX, &ok);
+                if (!ok) {
+                    log_error("Invalid stream timeout: %s\n", optarg);
+                    return -1;
+                }
+                break;
+
+            default:
+                return -1;
+        }
+    }
+
+    if (p->device_str == NULL) {
+        p->device_str = strdup(DEFAULT_DEVICE);
+        if (p->device_str == NULL) {
+            perror("strdup");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int status;
+    struct bench_params p;
+
+    status = handle_cmdline(argc, argv, &p);
+
+    if (status == 0) {
+        status = bench_run(&p);
+    } else if (status > 0) {
+        print_usage(argv[0]);
+        status = 0;
+    }
+
+    if (p.out != stdout) {
+        fclose(p.out);
+    }
+
+    free((void *) p.device_str);
+
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+/*
+ * This file is part of the bladeRF project:
+ *   http://www.github.com/nuand/bladeRF
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* This program benchmarks the buffer handoff between the sync interface's
+ * stream worker (producer on RX, consumer on TX) and its API side.
+ *
+ * Each RX handoff is a bladerf_sync_rx_acquire() and
+ * bladerf_sync_rx_release() of one full buffer, so no samples are copied and
+ * the time spent in the calls is dominated by the handoff itself. Each TX
+ * handoff is a bladerf_sync_tx() of one full buffer.
+ *
+ * This is intended to be run against the dummy backend (the default device),
+ * with BLADERF_DUMMY_SAMPLE_RATE unset so that the stream is free-running and
+ * the handoff is the bottleneck. For each direction, the number of handoffs
+ * per second and the distribution of the time spent per handoff are reported.
+ *
+ * To measure a change to the handoff, run this program against libbladeRF
+ * builds from before and after the change (e.g., via LD_LIBRARY_PATH). Only
+ * API functions that predate the lock-free handoff are used, so it may also
+ * be run against the mutex-based implementation as a baseline. Results are
+ * only meaningful on a host with at least two cores, as the stream worker and
+ * the caller otherwise take turns on a single core.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <libbladeRF.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
+
+#define DEFAULT_ITERATIONS  100000
+#define DEFAULT_NUM_BUFFERS 16
+#define DEFAULT_DEVICE      "dummy"
+
+#define BUFFER_LEN          4096
+#define NUM_XFERS           8
+#define TIMEOUT_MS          2500
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static int handoff(struct bladerf *dev, bladerf_module module, int16_t *buf)
+{
+    int status;
+    void *samples;
+    unsigned int count;
+
+    if (module == BLADERF_MODULE_RX) {
+        status = bladerf_sync_rx_acquire(dev, &samples, &count, NULL,
+                                         TIMEOUT_MS);
+        if (status == 0) {
+            status = bladerf_sync_rx_release(dev, samples, count);
+        }
+    } else {
+        status = bladerf_sync_tx(dev, buf, BUFFER_LEN, NULL, TIMEOUT_MS);
+    }
+
+    return status;
+}
+
+static int run(struct bladerf *dev, bladerf_module module,
+               unsigned int iterations, unsigned int num_buffers)
+{
+    int status;
+    unsigned int i;
+    uint64_t start, elapsed, t;
+    uint64_t *latency_ns;
+    int16_t *buf;
+
+    latency_ns = calloc(iterations, sizeof(latency_ns[0]));
+    buf = calloc(2 * BUFFER_LEN, sizeof(buf[0]));
+
+    if (latency_ns == NULL || buf == NULL) {
+        fprintf(stderr, "Failed to allocate memory.\n");
+        status = -1;
+        goto out;
+    }
+
+    status = bladerf_sync_config(dev, module, BLADERF_FORMAT_SC16_Q11,
+                                 num_buffers, BUFFER_LEN, NUM_XFERS,
+                                 TIMEOUT_MS);
+    if (status != 0) {
+        fprintf(stderr, "Failed to configure sync interface: %s\n",
+                bladerf_strerror(status));
+        goto out;
+    }
+
+    status = bladerf_enable_module(dev, module, true);
+    if (status != 0) {
+        fprintf(stderr, "Failed to enable module: %s\n",
+                bladerf_strerror(status));
+        goto out;
+    }
+
+    /* Start the stream, so its startup isn't included in the results */
+    status = handoff(dev, module, buf);
+    if (status != 0) {
+        fprintf(stderr, "Failed to start stream: %s\n",
+                bladerf_strerror(status));
+        goto disable;
+    }
+
+    start = now_ns();
+
+    for (i = 0; i < iterations; i++) {
+        t = now_ns();
+        status = handoff(dev, module, buf);
+        latency_ns[i] = now_ns() - t;
+
+        if (status != 0) {
+            fprintf(stderr, "Handoff %u failed: %s\n",
+                    i, bladerf_strerror(status));
+            goto disable;
+        }
+    }
+
+    elapsed = now_ns() - start;
+
+    qsort(latency_ns, iterations, sizeof(latency_ns[0]), cmp_u64);
+
+    printf("%-4s  %12.0f  %10.3f  %10.3f  %10.3f\n",
+           module == BLADERF_MODULE_RX ? "RX" : "TX",
+           iterations / (elapsed / 1e9),
+           latency_ns[iterations / 2] / 1e3,
+           latency_ns[(uint64_t) iterations * 99 / 100] / 1e3,
+           latency_ns[iterations - 1] / 1e3);
+
+disable:
+    bladerf_enable_module(dev, module, false);
+
+out:
+    free(latency_ns);
+    free(buf);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = DEFAULT_ITERATIONS;
+    unsigned int num_buffers = DEFAULT_NUM_BUFFERS;
+    const char *device = DEFAULT_DEVICE;
+    struct bladerf *dev;
+    int status;
+
+    if (argc > 4 || (argc > 1 && !strcmp(argv[1], "-h"))) {
+        printf("Usage: %s [iterations] [num buffers] [device]\n", argv[0]);
+        printf("Defaults: %u iterations, %u buffers, device \"%s\"\n",
+               DEFAULT_ITERATIONS, DEFAULT_NUM_BUFFERS, DEFAULT_DEVICE);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1) {
+        iterations = (unsigned int) strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2) {
+        num_buffers = (unsigned int) strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3) {
+        device = argv[3];
+    }
+
+    if (iterations == 0 || num_buffers == 0) {
+        fprintf(stderr, "Iterations and buffer count must be non-zero.\n");
+        return EXIT_FAILURE;
+    }
+
+    status = bladerf_open(&dev, device);
+    if (status != 0) {
+        fprintf(stderr, "Failed to open device \"%s\": %s\n",
+                device, bladerf_strerror(status));
+        return EXIT_FAILURE;
+    }
+
+    printf("%u handoffs, %u buffers of %u samples\n\n",
+           iterations, num_buffers, BUFFER_LEN);
+    printf("%-4s  %12s  %10s  %10s  %10s\n",
+           "dir", "handoffs/s", "p50 (us)", "p99 (us)", "max (us)");
+
+    status = run(dev, BLADERF_MODULE_RX, iterations, num_buffers);
+    if (status == 0) {
+        status = run(dev, BLADERF_MODULE_TX, iterations, num_buffers);
+    }
+
+    bladerf_close(dev);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
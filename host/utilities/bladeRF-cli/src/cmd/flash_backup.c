@@ -30,6 +30,7 @@
 #include "minmax.h"
 #include "conversions.h"
 #include "rel_assert.h"
+#include "flash_common.h"
 
 #define lib_error(status, ...) do { \
     state->last_lib_error = (status); \
@@ -113,7 +114,10 @@ int cmd_flash_backup(struct cli_state *state, int argc, char **argv)
     count = BLADERF_FLASH_TO_PAGES(length);
 
 
+    bladerf_set_flash_progress_cb(state->dev, flash_progress_print, NULL);
     status = bladerf_read_flash(state->dev, image->data, page, count);
+    bladerf_set_flash_progress_cb(state->dev, NULL, NULL);
+
     if (status < 0) {
         lib_error(status, "Failed to read flash region");
         goto out;
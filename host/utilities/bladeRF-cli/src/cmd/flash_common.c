@@ -0,0 +1,59 @@
+/*
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <stdio.h>
+
+#include "flash_common.h"
+
+static const char *op_str(bladerf_flash_op op)
+{
+    switch (op) {
+        case BLADERF_FLASH_OP_ERASE:
+            return "Erasing";
+
+        case BLADERF_FLASH_OP_READ:
+            return "Reading";
+
+        case BLADERF_FLASH_OP_WRITE:
+            return "Writing";
+
+        default:
+            return "Unknown operation";
+    }
+}
+
+void flash_progress_print(struct bladerf *dev, bladerf_flash_op op,
+                          uint32_t done, uint32_t total, void *user_data)
+{
+    unsigned int percent, prev_percent;
+
+    if (total == 0) {
+        return;
+    }
+
+    percent = (unsigned int) (100 * (uint64_t) done / total);
+    prev_percent = (unsigned int) (100 * (uint64_t) (done - 1) / total);
+
+    /* Only update the line when the percentage changes */
+    if (done == 1 || done == total || percent != prev_percent) {
+        printf("  %s flash: %3u%%%c", op_str(op), percent,
+               done == total ? '\n' : '\r');
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * @file flash_common.h
+ *
+ * @brief Items common to the flash commands
+ *
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef FLASH_COMMON_H__
+#define FLASH_COMMON_H__
+
+#include <libbladeRF.h>
+
+/**
+ * Flash progress callback that prints the percentage of each flash operation
+ * completed. Install it with bladerf_set_flash_progress_cb() for the duration
+ * of a command, and remove it before returning.
+ */
+void flash_progress_print(struct bladerf *dev, bladerf_flash_op op,
+                          uint32_t done, uint32_t total, void *user_data);
+
+#endif
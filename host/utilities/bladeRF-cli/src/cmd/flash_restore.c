@@ -30,6 +30,7 @@
 #include "input.h"
 #include "minmax.h"
 #include "conversions.h"
+#include "flash_common.h"
 
 struct options {
     char *file;
@@ -149,6 +150,8 @@ int cmd_flash_restore(struct cli_state *state, int argc, char **argv)
         len = image->length;
     }
 
+    bladerf_set_flash_progress_cb(state->dev, flash_progress_print, NULL);
+
     rv = erase_region(state->dev, image, addr, len);
     if (rv < 0) {
         state->last_lib_error = rv;
@@ -174,6 +177,7 @@ int cmd_flash_restore(struct cli_state *state, int argc, char **argv)
     rv = CLI_RET_OK;
 
 cmd_flash_restore_out:
+    bladerf_set_flash_progress_cb(state->dev, NULL, NULL);
     free(opt.file);
     bladerf_free_image(image);
     return rv;
@@ -19,19 +19,45 @@
  */
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include "cmd.h"
 #include "input.h"
 
+static void fpga_load_progress_print(struct bladerf *dev,
+                                     size_t done, size_t total,
+                                     void *user_data)
+{
+    unsigned int *prev_percent = (unsigned int *) user_data;
+    const unsigned int percent =
+        total == 0 ? 100 : (unsigned int) (100 * (uint64_t) done / total);
+
+    if (percent != *prev_percent) {
+        *prev_percent = percent;
+        printf("  Loading FPGA: %3u%%%c", percent, done == total ? '\n' : '\r');
+        fflush(stdout);
+    }
+}
+
 int cmd_load(struct cli_state *state, int argc, char **argv)
 {
     /* Valid commands:
-        load fpga <filename>
+        load fpga <filename> [force]
         load fx3 <filename>
         load cal[ibration] <filename>
     */
     int rv = CLI_RET_OK;
+    bool force = false;
+
+    if (argc == 4) {
+        if (!strcasecmp(argv[1], "fpga") && !strcasecmp(argv[3], "force")) {
+            force = true;
+        } else {
+            cli_err(state, argv[0], "Invalid argument: %s\n", argv[3]);
+            return CLI_RET_INVPARAM;
+        }
+    }
 
-    if ( argc == 3 ) {
+    if (argc == 3 || argc == 4) {
         int lib_status = 0;
         struct bladerf *dev = state->dev;
         char *expanded_path = input_expand_path(argv[2]);
@@ -43,9 +69,20 @@ int cmd_load(struct cli_state *state, int argc, char **argv)
         }
 
         if (!strcasecmp(argv[1], "fpga")) {
+            unsigned int prev_percent = UINT_MAX;
 
             printf("\n  Loading fpga from %s...\n", expanded_path);
-            lib_status = bladerf_load_fpga(dev, expanded_path);
+            bladerf_set_fpga_load_progress_cb(dev, fpga_load_progress_print,
+                                              &prev_percent);
+
+            if (force) {
+                lib_status = bladerf_load_fpga_force(dev, expanded_path);
+            } else {
+                lib_status = bladerf_load_fpga(dev, expanded_path);
+            }
+
+            bladerf_set_fpga_load_progress_cb(dev, NULL, NULL);
+
             if (lib_status == 0) {
                 printf("  Done.\n\n");
             }
@@ -37,39 +37,6 @@
 #   define EOL "\n"
 #endif
 
-/**
- * Peform adjustments on received samples before writing them out:
- *  (1) Mask off FPGA markers
- *  (2) Convert little-endian samples to host endianness, if needed.
- *
- *  @param  buff    Sample buffer
- *  @param  n       Number of samples
- */
-static inline void sc16q11_sample_fixup(int16_t *buf, size_t n)
-{
-    size_t i;
-
-    for (i = 0; i < n; i++) {
-        /* I - Mask off the marker and sign extend */
-//        *buf &= (*buf) & 0x0fff;
-//        if (*buf & 0x800) {
-//            *buf |= 0xf000;
-//        }
-
-        *buf = LE16_TO_HOST(*buf);
-        buf++;
-
-        /* Q - Mask off the marker and sign extend */
-//        *buf = HOST_TO_LE16(*buf) & 0x0fff;
-//        if (*buf & 0x800) {
-//            *buf |= 0xf000;
-//        }
-
-        *buf = LE16_TO_HOST(*buf);
-        buf++;
-    }
-}
-
 /*
  * @pre data_mgmt lock is held
  *
@@ -121,12 +88,22 @@ static int rx_write_csv_sc16q11(struct rxtx_data *rx,
 static int rx_task_exec_running(struct rxtx_data *rx, struct cli_state *s)
 {
     int status = 0;
-    int samples_per_buffer;
+    int writer_status;
+    unsigned int samples_per_buffer;
     void *samples;
+    void *scratch = NULL;
     size_t num_samples;
-    size_t samples_read = 0;
-    int (*write_samples)(struct rxtx_data *rx, int16_t *samples, size_t n);
+    size_t samples_written = 0;
     unsigned int timeout_ms;
+    struct rx_params *rx_params = rx->params;
+    struct rx_writer *writer = NULL;
+    struct rx_writer_config writer_config;
+    struct rx_writer_stats stats;
+    struct bladerf_metadata meta;
+    size_t n_read;
+    uint32_t flags, pending_flags = 0;
+    bool prealloc;
+    char *path = NULL;
 
     /* Read the parameters that will be used for the sync transfers */
     MUTEX_LOCK(&rx->data_mgmt.lock);
@@ -135,22 +112,64 @@ static int rx_task_exec_running(struct rxtx_data *rx, struct cli_state *s)
     MUTEX_UNLOCK(&rx->data_mgmt.lock);
 
     MUTEX_LOCK(&rx->param_lock);
-    num_samples = ((struct rx_params*)rx->params)->n_samples;
-    write_samples = ((struct rx_params*)rx->params)->write_samples;
+    num_samples = rx_params->n_samples;
+    writer_config.num_buffers = rx_params->writer_buffers;
+    writer_config.direct = rx_params->direct;
+    writer_config.segment_samples = rx_params->segment_samples;
+    prealloc = rx_params->prealloc;
+    memset(&rx_params->stats, 0, sizeof(rx_params->stats));
     MUTEX_UNLOCK(&rx->param_lock);
 
-    /* Allocate a buffer for the block of samples */
-    samples = malloc(samples_per_buffer * sizeof(uint16_t) * 2);
-    if (samples == NULL) {
-        status = errno;
-        set_last_error(&rx->last_error, ETYPE_ERRNO, status);
+    writer_config.samples_per_buffer = samples_per_buffer;
+
+    /* Segments are preallocated individually */
+    if (!prealloc) {
+        writer_config.prealloc_bytes = 0;
+    } else if (writer_config.segment_samples != 0) {
+        writer_config.prealloc_bytes =
+            writer_config.segment_samples * 2 * sizeof(int16_t);
+    } else {
+        writer_config.prealloc_bytes = (uint64_t) num_samples * 2 *
+                                       sizeof(int16_t);
+    }
+
+    MUTEX_LOCK(&rx->file_mgmt.file_meta_lock);
+    if (rx->file_mgmt.path != NULL) {
+        path = strdup(rx->file_mgmt.path);
+    }
+    MUTEX_UNLOCK(&rx->file_mgmt.file_meta_lock);
+
+    writer_config.path = path;
+
+    /* The sample rate is only used to flag late writes, so failing to
+     * fetch it is not fatal */
+    MUTEX_LOCK(&s->dev_lock);
+    if (bladerf_get_sample_rate(s->dev, rx->module,
+                                &writer_config.sample_rate) != 0) {
+        writer_config.sample_rate = 0;
+    }
+    MUTEX_UNLOCK(&s->dev_lock);
+
+    /* Samples are read into this buffer, and discarded, when the writer
+     * has fallen too far behind to accept them. This keeps the device's
+     * stream serviced while the writer catches up. */
+    scratch = malloc(samples_per_buffer * sizeof(uint16_t) * 2);
+    if (scratch == NULL || path == NULL) {
+        status = CLI_RET_MEM;
+        set_last_error(&rx->last_error, ETYPE_CLI, status);
+    } else {
+        status = rx_writer_start(&writer, rx, &writer_config);
+        if (status != 0) {
+            set_last_error(&rx->last_error, ETYPE_CLI, status);
+        }
     }
 
     /*
      * Keep reading samples until a failure or until all requested samples
-     * have been read
+     * have been handed to the writer. Buffers dropped because the writer fell
+     * behind don't count towards this; they're reported in the final stats.
      */
-    while (status == 0 && (num_samples == 0 || samples_read < num_samples)) {
+    while (status == 0 && (num_samples == 0 || samples_written < num_samples)) {
         /*
          * Stop stream on STOP or SHUTDOWN, but only clear STOP. This will keep
          * the SHUTDOWN request around so we can read it when determining our
@@ -161,33 +180,74 @@ static int rx_task_exec_running(struct rxtx_data *rx, struct cli_state *s)
             break;
         }
 
-        /* Read the samples into the sample buffer */
-        status = bladerf_sync_rx(s->dev, samples, samples_per_buffer, NULL,
+        samples = rx_writer_acquire(writer);
+
+        /* Read the samples into the sample buffer. Segmented recordings are
+         * indexed by the samples' timestamps. */
+        memset(&meta, 0, sizeof(meta));
+        meta.flags = BLADERF_META_FLAG_RX_NOW;
+
+        status = bladerf_sync_rx(s->dev,
+                                 samples != NULL ? samples : scratch,
+                                 samples_per_buffer,
+                                 writer_config.segment_samples != 0 ?
+                                    &meta : NULL,
                                  timeout_ms);
 
+        if (writer_config.segment_samples != 0) {
+            n_read = meta.actual_count;
+        } else {
+            n_read = samples_per_buffer;
+        }
+
+        /* An overrun's discontinuity follows the samples of a short read,
+         * and otherwise precedes them */
+        flags = pending_flags;
+        pending_flags = 0;
+
+        if (meta.status & BLADERF_META_STATUS_OVERRUN) {
+            if (n_read < samples_per_buffer) {
+                pending_flags |= RX_INDEX_FLAG_OVERRUN;
+            } else {
+                flags |= RX_INDEX_FLAG_OVERRUN;
+            }
+        }
+
         if (status != 0) {
             set_last_error(&rx->last_error, ETYPE_BLADERF, status);
+        } else if (samples == NULL) {
+            rx_writer_drop(writer);
+            pending_flags |= flags;
         } else {
-            size_t to_write = min_sz(samples_per_buffer,
-                                     (num_samples - samples_read));
+            size_t to_write = num_samples == 0 ? n_read :
+                              min_sz(n_read, (num_samples - samples_written));
 
-            /* Write the samples to the output file */
-            sc16q11_sample_fixup(samples, to_write);
-            status = write_samples(rx, samples, to_write);
+            /* Hand the samples off to the writer thread */
+            status = rx_writer_submit(writer, to_write, meta.timestamp, flags);
 
             if (status != 0) {
                 set_last_error(&rx->last_error, ETYPE_CLI, status);
             }
-        }
 
-        samples_read += samples_per_buffer;
+            samples_written += to_write;
+        }
     }
 
-    /* Free the sample buffer */
-    if (samples != NULL) {
-        free(samples);
+    if (writer != NULL) {
+        writer_status = rx_writer_stop(writer, &stats);
+        if (status == 0 && writer_status != 0) {
+            status = writer_status;
+            set_last_error(&rx->last_error, ETYPE_CLI, status);
+        }
+
+        MUTEX_LOCK(&rx->param_lock);
+        rx_params->stats = stats;
+        MUTEX_UNLOCK(&rx->param_lock);
     }
 
+    free(scratch);
+    free(path);
+
     return status;
 }
 
@@ -201,6 +261,7 @@ void *rx_task(void *cli_state_arg)
     struct rxtx_data *rx = cli_state->rx;
     struct rx_params *rx_params = rx->params;
     MUTEX *dev_lock = &cli_state->dev_lock;
+    bladerf_format format;
 
     task_state = rxtx_get_state(rx);
     assert(task_state == RXTX_STATE_INIT);
@@ -252,13 +313,22 @@ void *rx_task(void *cli_state_arg)
 
                 MUTEX_UNLOCK(&rx->file_mgmt.file_meta_lock);
 
+                /* Segmented recordings require sample timestamps */
+                MUTEX_LOCK(&rx->param_lock);
+                if (rx_params->segment_samples != 0) {
+                    format = BLADERF_FORMAT_SC16_Q11_HOST_META;
+                } else {
+                    format = BLADERF_FORMAT_SC16_Q11_HOST;
+                }
+                MUTEX_UNLOCK(&rx->param_lock);
+
                 /* Set up the reception stream and buffer information */
                 if (status == 0) {
                     MUTEX_LOCK(&rx->data_mgmt.lock);
 
                     status = bladerf_sync_config(cli_state->dev,
                                                  BLADERF_MODULE_RX,
-                                                 BLADERF_FORMAT_SC16_Q11,
+                                                 format,
                                                  rx->data_mgmt.num_buffers,
                                                  rx->data_mgmt.samples_per_buffer,
                                                  rx->data_mgmt.num_transfers,
@@ -326,6 +396,10 @@ void *rx_task(void *cli_state_arg)
 static int rx_cmd_start(struct cli_state *s)
 {
     int status;
+    bool direct;
+    unsigned int segment_samples;
+    enum rxtx_fmt format;
+    char *segment_path = NULL;
 
     /* Check that we can start up in our current state */
     status = rxtx_cmd_start_check(s, s->rx, "rx");
@@ -333,9 +407,44 @@ static int rx_cmd_start(struct cli_state *s)
         return status;
     }
 
+    /* Direct writes bypass the CSV formatting routines */
+    MUTEX_LOCK(&s->rx->param_lock);
+    direct = ((struct rx_params *) s->rx->params)->direct;
+    segment_samples = ((struct rx_params *) s->rx->params)->segment_samples;
+    MUTEX_UNLOCK(&s->rx->param_lock);
+
+    MUTEX_LOCK(&s->rx->file_mgmt.file_meta_lock);
+    format = s->rx->file_mgmt.format;
+    MUTEX_UNLOCK(&s->rx->file_mgmt.file_meta_lock);
+
+    if (direct && format != RXTX_FMT_BIN_SC16Q11) {
+        cli_err(s, "rx", "Direct writes require the bin file format.\n");
+        return CLI_RET_INVPARAM;
+    }
+
+    if (segment_samples != 0 && format != RXTX_FMT_BIN_SC16Q11) {
+        cli_err(s, "rx", "Segmented recording requires the bin file format.\n");
+        return CLI_RET_INVPARAM;
+    }
+
+    /* Segmented recordings begin with the first segment's file */
+    if (segment_samples != 0) {
+        MUTEX_LOCK(&s->rx->file_mgmt.file_meta_lock);
+        segment_path = rx_writer_segment_path(s->rx->file_mgmt.path, 0);
+        MUTEX_UNLOCK(&s->rx->file_mgmt.file_meta_lock);
+
+        if (segment_path == NULL) {
+            return CLI_RET_MEM;
+        }
+    }
+
     /* Set up output file */
     MUTEX_LOCK(&s->rx->file_mgmt.file_lock);
-    if(s->rx->file_mgmt.format == RXTX_FMT_CSV_SC16Q11) {
+    if (segment_path != NULL) {
+        status = expand_and_open(segment_path, "wb", &s->rx->file_mgmt.file);
+        free(segment_path);
+
+    } else if(s->rx->file_mgmt.format == RXTX_FMT_CSV_SC16Q11) {
         status = expand_and_open(s->rx->file_mgmt.path, "w",
                                  &s->rx->file_mgmt.file);
 
@@ -367,10 +476,18 @@ static int rx_cmd_start(struct cli_state *s)
 static void rx_print_config(struct rxtx_data *rx)
 {
     size_t n_samples;
+    unsigned int writer_buffers, segment_samples;
+    bool direct, prealloc;
+    struct rx_writer_stats stats;
     struct rx_params *rx_params = rx->params;
 
     MUTEX_LOCK(&rx->param_lock);
     n_samples = rx_params->n_samples;
+    writer_buffers = rx_params->writer_buffers;
+    direct = rx_params->direct;
+    prealloc = rx_params->prealloc;
+    segment_samples = rx_params->segment_samples;
+    stats = rx_params->stats;
     MUTEX_UNLOCK(&rx->param_lock);
 
     rxtx_print_state(rx, "\n  State: ", "\n");
@@ -385,9 +502,43 @@ static void rx_print_config(struct rxtx_data *rx)
     }
     rxtx_print_stream_info(rx, "  ", "\n");
 
+    printf("  # Writer buffers: %u\n", writer_buffers);
+    printf("  Direct writes: %s\n", direct ? "on" : "off");
+    printf("  Preallocate file: %s\n", prealloc ? "on" : "off");
+
+    if (segment_samples) {
+        printf("  Segment size: %u samples\n", segment_samples);
+    } else {
+        printf("  Segment size: off\n");
+    }
+
+    printf("  Last capture: %" PRIu64 " buffers written, %" PRIu64
+           " dropped, %" PRIu64 " late, %u max queued",
+           stats.written, stats.dropped, stats.late, stats.max_queued);
+
+    if (stats.segments != 0) {
+        printf(", %u segments", stats.segments);
+    }
+
+    printf("\n");
+
     printf("\n");
 }
 
+/* Parse an on/off config value */
+static int rx_str2onoff(const char *str, bool *val)
+{
+    if (!strcasecmp(str, "on")) {
+        *val = true;
+    } else if (!strcasecmp(str, "off")) {
+        *val = false;
+    } else {
+        return CLI_RET_INVPARAM;
+    }
+
+    return 0;
+}
+
 static int rx_cmd_config(struct cli_state *s, int argc, char **argv)
 {
     int i;
@@ -425,6 +576,72 @@ static int rx_cmd_config(struct cli_state *s, int argc, char **argv)
                     return CLI_RET_INVPARAM;
                 }
 
+            } else if (!strcasecmp("writer_buffers", argv[i])) {
+                /* Configure the depth of the file writer's buffer ring */
+                unsigned int n;
+                bool ok;
+
+                n = str2uint_suffix(val, RX_WRITER_BUFFERS_MIN, UINT_MAX,
+                                    rxtx_kmg_suffixes,
+                                    (int)rxtx_kmg_suffixes_len, &ok);
+
+                if (ok) {
+                    MUTEX_LOCK(&s->rx->param_lock);
+                    rx_params->writer_buffers = n;
+                    MUTEX_UNLOCK(&s->rx->param_lock);
+                } else {
+                    cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
+                    return CLI_RET_INVPARAM;
+                }
+
+            } else if (!strcasecmp("segment", argv[i])) {
+                /* Configure the size of each file in a segmented recording.
+                 * Segments are a multiple of the page size, such that they
+                 * may be mmap'd in their entirety. */
+                unsigned int n;
+                bool ok;
+
+                n = str2uint_suffix(val, 0, UINT_MAX, rxtx_kmg_suffixes,
+                                    (int)rxtx_kmg_suffixes_len, &ok);
+
+                if (!ok || (n % LIBBLADERF_SAMPLE_BLOCK_SIZE) != 0) {
+                    cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
+                    return CLI_RET_INVPARAM;
+                }
+
+                MUTEX_LOCK(&s->rx->param_lock);
+                rx_params->segment_samples = n;
+                MUTEX_UNLOCK(&s->rx->param_lock);
+
+            } else if (!strcasecmp("direct", argv[i]) ||
+                       !strcasecmp("prealloc", argv[i])) {
+                bool enable;
+                const bool is_direct = !strcasecmp("direct", argv[i]);
+
+                if (rx_str2onoff(val, &enable) != 0) {
+                    cli_err(s, argv[0], RXTX_ERRMSG_VALUE(argv[i], val));
+                    return CLI_RET_INVPARAM;
+                }
+
+                if (enable && is_direct && !rx_writer_direct_supported()) {
+                    cli_err(s, argv[0],
+                            "Direct writes are not supported on this platform.\n");
+                    return CLI_RET_INVPARAM;
+                } else if (enable && !is_direct &&
+                           !rx_writer_prealloc_supported()) {
+                    cli_err(s, argv[0],
+                            "Preallocation is not supported on this platform.\n");
+                    return CLI_RET_INVPARAM;
+                }
+
+                MUTEX_LOCK(&s->rx->param_lock);
+                if (is_direct) {
+                    rx_params->direct = enable;
+                } else {
+                    rx_params->prealloc = enable;
+                }
+                MUTEX_UNLOCK(&s->rx->param_lock);
+
             } else {
                 cli_err(s, argv[0],
                         "Unrecognized config parameter: %s\n", argv[i]);
@@ -0,0 +1,657 @@
+/*
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* O_DIRECT and fallocate() are GNU extensions on Linux */
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "host_config.h"
+
+#if BLADERF_OS_WINDOWS || BLADERF_OS_OSX
+#include "clock_gettime.h"
+#else
+#include <time.h>
+#endif
+
+#if BLADERF_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "rel_assert.h"
+#include "rxtx_impl.h"
+#include "rx_writer.h"
+#include "thread.h"
+
+/* Buffers are aligned to, and O_DIRECT writes are performed in multiples of,
+ * this many bytes. This satisfies the logical block size requirements of
+ * typical storage devices. */
+#define RX_WRITER_ALIGNMENT 4096
+
+/* Bytes per SC16Q11 sample: an int16_t for I, and another for Q */
+#define BYTES_PER_SAMPLE    (2 * sizeof(int16_t))
+
+struct rx_writer_buf {
+    int16_t *samples;
+    size_t n_samples;
+    uint64_t timestamp;
+    uint32_t flags;
+};
+
+struct rx_writer {
+    struct rxtx_data *rx;
+    int (*write_samples)(struct rxtx_data *rx, int16_t *samples, size_t n);
+
+    pthread_t thread;
+    bool thread_started;
+
+    void *pool;                     /* Backing allocation for all buffers */
+    struct rx_writer_buf *bufs;
+    unsigned int num_buffers;
+
+    /* Nanoseconds of samples held in a full buffer. 0 = unknown */
+    uint64_t buffer_ns;
+
+    bool direct;                    /* O_DIRECT is currently set on 'fd' */
+    int fd;
+
+    /* Segmented recording state, only accessed by the writer thread once
+     * it has been started */
+    struct rx_writer_config config; /* With a private copy of 'path' */
+    FILE *index;
+    unsigned int segment;           /* Current segment number */
+    uint64_t segment_offset;        /* Samples written to current segment */
+    uint64_t next_timestamp;        /* Timestamp expected of next sample */
+    bool have_timestamp;            /* next_timestamp is valid */
+
+    MUTEX lock;                     /* Protects the following items */
+    pthread_cond_t buf_queued;      /* Signalled on submit and shutdown */
+    unsigned int prod_idx;          /* Next buffer to be filled */
+    unsigned int cons_idx;          /* Next buffer to be written */
+    unsigned int num_queued;        /* Submitted and not yet written */
+    bool shutdown;
+    int status;                     /* First error encountered by the writer */
+    uint32_t pending_flags;         /* Flags for the next submitted buffer */
+    struct rx_writer_stats stats;
+};
+
+bool rx_writer_direct_supported(void)
+{
+#if BLADERF_OS_LINUX && defined(O_DIRECT)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool rx_writer_prealloc_supported(void)
+{
+#if BLADERF_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+static inline uint64_t elapsed_ns(const struct timespec *start,
+                                  const struct timespec *end)
+{
+    int64_t ns = ((int64_t) end->tv_sec - start->tv_sec) * 1000000000 +
+                 ((int64_t) end->tv_nsec - start->tv_nsec);
+
+    return ns > 0 ? (uint64_t) ns : 0;
+}
+
+#if BLADERF_OS_LINUX
+static int set_direct(struct rx_writer *w, bool enable)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(w->fd, F_GETFL);
+
+    if (flags >= 0) {
+        if (enable) {
+            flags |= O_DIRECT;
+        } else {
+            flags &= ~O_DIRECT;
+        }
+
+        flags = fcntl(w->fd, F_SETFL, flags);
+    }
+
+    if (flags < 0) {
+        set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+        return CLI_RET_FILEOP;
+    }
+
+    w->direct = enable;
+    return 0;
+#else
+    return enable ? CLI_RET_INVPARAM : 0;
+#endif
+}
+
+/* Write a buffer straight to the file descriptor, bypassing stdio. O_DIRECT
+ * is cleared before the first write that is not a multiple of the alignment
+ * (i.e., the final, partial buffer of a capture). */
+static int write_direct(struct rx_writer *w, int16_t *samples, size_t n)
+{
+    int status;
+    const uint8_t *data = (const uint8_t *) samples;
+    size_t to_write = n * BYTES_PER_SAMPLE;
+    ssize_t written;
+
+    if (w->direct && (to_write % RX_WRITER_ALIGNMENT) != 0) {
+        status = set_direct(w, false);
+        if (status != 0) {
+            return status;
+        }
+    }
+
+    while (to_write > 0) {
+        written = write(w->fd, data, to_write);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+            return CLI_RET_FILEOP;
+        }
+
+        data += written;
+        to_write -= written;
+    }
+
+    return 0;
+}
+#endif
+
+static int write_samples(struct rx_writer *w, int16_t *samples, size_t n)
+{
+#if BLADERF_OS_LINUX
+    if (w->fd >= 0) {
+        return write_direct(w, samples, n);
+    }
+#endif
+
+    return w->write_samples(w->rx, samples, n);
+}
+
+char *rx_writer_segment_path(const char *path, unsigned int segment)
+{
+    const size_t len = strlen(path) + 16;
+    char *ret = malloc(len);
+
+    if (ret != NULL) {
+        snprintf(ret, len, "%s.%06u", path, segment);
+    }
+
+    return ret;
+}
+
+static int write_index_entry(struct rx_writer *w, uint64_t timestamp,
+                             uint32_t flags)
+{
+    struct rx_index_entry entry;
+
+    entry.segment = HOST_TO_LE32(w->segment);
+    entry.flags = HOST_TO_LE32(flags);
+    entry.offset = HOST_TO_LE64(w->segment_offset * BYTES_PER_SAMPLE);
+    entry.timestamp = HOST_TO_LE64(timestamp);
+
+    if (fwrite(&entry, sizeof(entry), 1, w->index) != 1) {
+        set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+        return CLI_RET_FILEOP;
+    }
+
+    return 0;
+}
+
+static int setup_file(struct rx_writer *w);
+
+/* Close the current segment's file, and continue with the next one */
+static int next_segment(struct rx_writer *w)
+{
+    int status;
+    char *name;
+    FILE *file;
+
+    /* Ensure the index is complete for all finished segments */
+    if (fflush(w->index) != 0) {
+        set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+        return CLI_RET_FILEOP;
+    }
+
+    name = rx_writer_segment_path(w->config.path, w->segment + 1);
+    if (name == NULL) {
+        return CLI_RET_MEM;
+    }
+
+    status = expand_and_open(name, "wb", &file);
+    free(name);
+
+    if (status != 0) {
+        return status;
+    }
+
+    MUTEX_LOCK(&w->rx->file_mgmt.file_lock);
+    fclose(w->rx->file_mgmt.file);
+    w->rx->file_mgmt.file = file;
+    MUTEX_UNLOCK(&w->rx->file_mgmt.file_lock);
+
+    w->fd = -1;
+    w->direct = false;
+    w->segment++;
+    w->segment_offset = 0;
+
+    MUTEX_LOCK(&w->lock);
+    w->stats.segments++;
+    MUTEX_UNLOCK(&w->lock);
+
+    return setup_file(w);
+}
+
+/* Write a buffer to the current segment, continuing into the next segment
+ * when the current one fills up */
+static int write_segmented(struct rx_writer *w, struct rx_writer_buf *buf)
+{
+    int status = 0;
+    int16_t *samples = buf->samples;
+    size_t n = buf->n_samples;
+    size_t to_write;
+    uint64_t timestamp = buf->timestamp;
+    uint32_t flags = buf->flags;
+    bool add_entry = !w->have_timestamp || flags != 0 ||
+                     timestamp != w->next_timestamp;
+
+    while (n > 0 && status == 0) {
+        if (w->segment_offset == w->config.segment_samples) {
+            status = next_segment(w);
+            add_entry = true;
+        }
+
+        if (status == 0 && (add_entry || w->segment_offset == 0)) {
+            status = write_index_entry(w, timestamp, flags);
+            add_entry = false;
+            flags = 0;
+        }
+
+        if (status == 0) {
+            to_write = n;
+            if (to_write > w->config.segment_samples - w->segment_offset) {
+                to_write = (size_t)
+                           (w->config.segment_samples - w->segment_offset);
+            }
+
+            status = write_samples(w, samples, to_write);
+
+            samples += 2 * to_write;
+            n -= to_write;
+            timestamp += to_write;
+            w->segment_offset += to_write;
+        }
+    }
+
+    w->next_timestamp = timestamp;
+    w->have_timestamp = true;
+
+    return status;
+}
+
+static int write_buf(struct rx_writer *w, struct rx_writer_buf *buf)
+{
+    if (w->config.segment_samples != 0) {
+        return write_segmented(w, buf);
+    } else {
+        return write_samples(w, buf->samples, buf->n_samples);
+    }
+}
+
+static void *writer_thread(void *arg)
+{
+    struct rx_writer *w = (struct rx_writer *) arg;
+    struct rx_writer_buf *buf;
+    struct timespec start, end;
+    bool late;
+    int status = 0;
+
+    MUTEX_LOCK(&w->lock);
+
+    while (status == 0) {
+        while (w->num_queued == 0 && !w->shutdown) {
+            pthread_cond_wait(&w->buf_queued, &w->lock);
+        }
+
+        if (w->num_queued == 0) {
+            /* Shutting down, and everything has been written out */
+            break;
+        }
+
+        buf = &w->bufs[w->cons_idx];
+        MUTEX_UNLOCK(&w->lock);
+
+        clock_gettime(CLOCK_REALTIME, &start);
+        status = write_buf(w, buf);
+        clock_gettime(CLOCK_REALTIME, &end);
+
+        late = w->buffer_ns != 0 && elapsed_ns(&start, &end) > w->buffer_ns;
+
+        MUTEX_LOCK(&w->lock);
+
+        w->cons_idx = (w->cons_idx + 1) % w->num_buffers;
+        w->num_queued--;
+
+        if (status == 0) {
+            w->stats.written++;
+            if (late) {
+                w->stats.late++;
+            }
+        } else {
+            w->status = status;
+        }
+    }
+
+    MUTEX_UNLOCK(&w->lock);
+    return NULL;
+}
+
+#if BLADERF_OS_LINUX
+static int prealloc_file(struct rx_writer *w, int fd, uint64_t bytes)
+{
+    int status = 0;
+
+    /* Keep the file size as-is, such that a capture that is cut short does
+     * not leave a tail of zeros in the file */
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t) bytes) != 0) {
+        /* Not all filesystems support this. It's just an optimization, so
+         * there's no need to fail the capture over it. */
+        if (errno != EOPNOTSUPP && errno != ENOSYS) {
+            set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+            status = CLI_RET_FILEOP;
+        }
+    }
+
+    return status;
+}
+#endif
+
+/* Apply the configured file options to the RX task's current file */
+static int setup_file(struct rx_writer *w)
+{
+    int status = 0;
+    const struct rx_writer_config *c = &w->config;
+
+#if BLADERF_OS_LINUX
+    int fd;
+
+    MUTEX_LOCK(&w->rx->file_mgmt.file_lock);
+
+    fd = fileno(w->rx->file_mgmt.file);
+    if (fd < 0) {
+        status = CLI_RET_FILEOP;
+    }
+
+    if (status == 0 && c->prealloc_bytes != 0) {
+        status = prealloc_file(w, fd, c->prealloc_bytes);
+    }
+
+    MUTEX_UNLOCK(&w->rx->file_mgmt.file_lock);
+
+    if (status == 0 && c->direct) {
+        w->fd = fd;
+        status = set_direct(w, true);
+        if (status != 0) {
+            w->fd = -1;
+        }
+    }
+#else
+    if (c->direct || c->prealloc_bytes != 0) {
+        status = CLI_RET_INVPARAM;
+    }
+#endif
+
+    return status;
+}
+
+/* Create the index file of a segmented recording, and write its header */
+static int open_index(struct rx_writer *w)
+{
+    int status;
+    char *name;
+    struct rx_index_header header;
+    const size_t len = strlen(w->config.path) + sizeof(".idx");
+
+    name = malloc(len);
+    if (name == NULL) {
+        return CLI_RET_MEM;
+    }
+
+    snprintf(name, len, "%s.idx", w->config.path);
+    status = expand_and_open(name, "wb", &w->index);
+    free(name);
+
+    if (status != 0) {
+        return status;
+    }
+
+    memcpy(header.magic, RX_INDEX_MAGIC, sizeof(header.magic));
+    header.version = HOST_TO_LE32(RX_INDEX_VERSION);
+    header.entry_size = HOST_TO_LE32(sizeof(struct rx_index_entry));
+    header.segment_samples = HOST_TO_LE64(w->config.segment_samples);
+
+    if (fwrite(&header, sizeof(header), 1, w->index) != 1) {
+        set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+        return CLI_RET_FILEOP;
+    }
+
+    w->stats.segments = 1;
+    return 0;
+}
+
+/* Returns the first error encountered in closing the index, if any */
+static int free_writer(struct rx_writer *w)
+{
+    int status = 0;
+
+    if (w->index != NULL && fclose(w->index) != 0) {
+        set_last_error(&w->rx->last_error, ETYPE_ERRNO, errno);
+        status = CLI_RET_FILEOP;
+    }
+
+    pthread_cond_destroy(&w->buf_queued);
+    pthread_mutex_destroy(&w->lock);
+    free((char *) w->config.path);
+    free(w->bufs);
+    free(w->pool);
+    free(w);
+
+    return status;
+}
+
+int rx_writer_start(struct rx_writer **writer, struct rxtx_data *rx,
+                    const struct rx_writer_config *config)
+{
+    int status;
+    unsigned int i;
+    uintptr_t base;
+    struct rx_writer *w;
+    const size_t buf_bytes = config->samples_per_buffer * BYTES_PER_SAMPLE;
+
+    assert(config->num_buffers >= RX_WRITER_BUFFERS_MIN);
+
+    *writer = NULL;
+
+    w = calloc(1, sizeof(*w));
+    if (w == NULL) {
+        return CLI_RET_MEM;
+    }
+
+    w->rx = rx;
+    w->fd = -1;
+    w->num_buffers = config->num_buffers;
+    w->config = *config;
+    w->config.path = NULL;
+
+    MUTEX_LOCK(&rx->param_lock);
+    w->write_samples = ((struct rx_params *) rx->params)->write_samples;
+    MUTEX_UNLOCK(&rx->param_lock);
+
+    if (config->sample_rate != 0) {
+        w->buffer_ns = (uint64_t) config->samples_per_buffer * 1000000000 /
+                       config->sample_rate;
+    }
+
+    MUTEX_INIT(&w->lock);
+    pthread_cond_init(&w->buf_queued, NULL);
+
+    /* Buffers are carved out of a single allocation, each starting on an
+     * alignment boundary. samples_per_buffer is a multiple of 1024, so each
+     * buffer is a multiple of the alignment in size. */
+    w->bufs = calloc(w->num_buffers, sizeof(w->bufs[0]));
+    w->pool = malloc(w->num_buffers * buf_bytes + RX_WRITER_ALIGNMENT);
+    if (config->segment_samples != 0) {
+        assert(config->path != NULL);
+        w->config.path = strdup(config->path);
+    }
+
+    if (w->bufs == NULL || w->pool == NULL ||
+        (config->segment_samples != 0 && w->config.path == NULL)) {
+        free_writer(w);
+        return CLI_RET_MEM;
+    }
+
+    base = ((uintptr_t) w->pool + RX_WRITER_ALIGNMENT - 1) &
+           ~((uintptr_t) RX_WRITER_ALIGNMENT - 1);
+
+    for (i = 0; i < w->num_buffers; i++) {
+        w->bufs[i].samples = (int16_t *) (base + i * buf_bytes);
+    }
+
+    status = setup_file(w);
+
+    if (status == 0 && config->segment_samples != 0) {
+        status = open_index(w);
+    }
+
+    if (status != 0) {
+        free_writer(w);
+        return status;
+    }
+
+    status = pthread_create(&w->thread, NULL, writer_thread, w);
+    if (status != 0) {
+        set_last_error(&rx->last_error, ETYPE_ERRNO, status);
+        free_writer(w);
+        return CLI_RET_UNKNOWN;
+    }
+
+    w->thread_started = true;
+    *writer = w;
+    return 0;
+}
+
+void *rx_writer_acquire(struct rx_writer *w)
+{
+    void *ret = NULL;
+
+    MUTEX_LOCK(&w->lock);
+    if (w->num_queued < w->num_buffers) {
+        ret = w->bufs[w->prod_idx].samples;
+    }
+    MUTEX_UNLOCK(&w->lock);
+
+    return ret;
+}
+
+int rx_writer_submit(struct rx_writer *w, size_t n_samples,
+                     uint64_t timestamp, uint32_t flags)
+{
+    int status;
+
+    MUTEX_LOCK(&w->lock);
+
+    status = w->status;
+    if (status == 0) {
+        assert(w->num_queued < w->num_buffers);
+
+        w->bufs[w->prod_idx].n_samples = n_samples;
+        w->bufs[w->prod_idx].timestamp = timestamp;
+        w->bufs[w->prod_idx].flags = flags | w->pending_flags;
+        w->pending_flags = 0;
+        w->prod_idx = (w->prod_idx + 1) % w->num_buffers;
+        w->num_queued++;
+
+        if (w->num_queued > w->stats.max_queued) {
+            w->stats.max_queued = w->num_queued;
+        }
+
+        pthread_cond_signal(&w->buf_queued);
+    }
+
+    MUTEX_UNLOCK(&w->lock);
+
+    return status;
+}
+
+void rx_writer_drop(struct rx_writer *w)
+{
+    MUTEX_LOCK(&w->lock);
+    w->stats.dropped++;
+    w->pending_flags |= RX_INDEX_FLAG_DROPPED;
+    MUTEX_UNLOCK(&w->lock);
+}
+
+int rx_writer_stop(struct rx_writer *w, struct rx_writer_stats *stats)
+{
+    int status, free_status;
+
+    MUTEX_LOCK(&w->lock);
+    w->shutdown = true;
+    pthread_cond_signal(&w->buf_queued);
+    MUTEX_UNLOCK(&w->lock);
+
+    if (w->thread_started) {
+        pthread_join(w->thread, NULL);
+    }
+
+#if BLADERF_OS_LINUX
+    /* Leave the file in a state suitable for any subsequent stdio usage */
+    if (w->direct) {
+        set_direct(w, false);
+    }
+#endif
+
+    status = w->status;
+
+    if (stats != NULL) {
+        *stats = w->stats;
+    }
+
+    free_status = free_writer(w);
+    return status != 0 ? status : free_status;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file rx_writer.h
+ *
+ * @brief Dedicated file writer thread for the rx command
+ *
+ * Received sample buffers are handed off to a writer thread through a ring
+ * of pre-allocated buffers, such that file I/O stalls do not hold up the
+ * thread reading samples from the device.
+ *
+ * This file is part of the bladeRF project
+ *
+ * Copyright (C) 2014 Nuand LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef RX_WRITER_H__
+#define RX_WRITER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Default and minimum number of buffers in the writer's ring */
+#define RX_WRITER_BUFFERS_DEFAULT   32
+#define RX_WRITER_BUFFERS_MIN       2
+
+/*
+ * Segmented recordings are split into files named "<file>.NNNNNN", each
+ * holding segment_samples samples (the last of which may hold fewer), and an
+ * index file named "<file>.idx". All index fields are little-endian.
+ *
+ * The index consists of a struct rx_index_header, followed by a
+ * struct rx_index_entry for the first sample of each segment, and for each
+ * sample whose timestamp does not follow that of the sample before it.
+ * Between entries, timestamps increase by one per sample. Therefore, the
+ * sample with timestamp t, if it was recorded, is located by finding the
+ * last entry with a timestamp <= t (e.g., via a binary search). The sample
+ * is (t - timestamp) * 4 bytes beyond the entry's offset in its segment,
+ * provided that this precedes the next entry.
+ */
+#define RX_INDEX_MAGIC          "BRFRXIDX"
+#define RX_INDEX_VERSION        1
+
+/* Samples preceding the entry's sample were lost to a stream overrun */
+#define RX_INDEX_FLAG_OVERRUN   (1 << 0)
+
+/* Samples preceding the entry's sample were dropped by the file writer */
+#define RX_INDEX_FLAG_DROPPED   (1 << 1)
+
+struct rx_index_header {
+    char magic[8];              /* RX_INDEX_MAGIC, without a '\0' */
+    uint32_t version;           /* RX_INDEX_VERSION */
+    uint32_t entry_size;        /* sizeof(struct rx_index_entry) */
+    uint64_t segment_samples;   /* Samples per (full) segment */
+};
+
+struct rx_index_entry {
+    uint32_t segment;           /* Segment number */
+    uint32_t flags;             /* RX_INDEX_FLAG_* bits */
+    uint64_t offset;            /* Byte offset of the sample in the segment */
+    uint64_t timestamp;         /* Timestamp of the sample */
+};
+
+struct rxtx_data;
+struct rx_writer;
+
+struct rx_writer_config {
+    unsigned int num_buffers;           /* # of buffers in the ring */
+    unsigned int samples_per_buffer;    /* Size of each buffer (in samples) */
+    unsigned int sample_rate;           /* Used to determine late writes.
+                                         *   0 disables this check. */
+    bool direct;                        /* Use O_DIRECT writes (bin only) */
+    uint64_t prealloc_bytes;            /* Preallocate this much of the
+                                         *   output file. 0 = disabled */
+    uint64_t segment_samples;           /* Samples per segment file. 0 =
+                                         *   record to a single file */
+    const char *path;                   /* Output path, from which segment
+                                         *   and index file names are formed
+                                         *   when segment_samples != 0 */
+};
+
+struct rx_writer_stats {
+    uint64_t written;   /* # of buffers written to the file */
+    uint64_t dropped;   /* # of buffers dropped because the ring was full */
+    uint64_t late;      /* # of buffers that took longer to write than the
+                         *   time they span at the current sample rate */
+    unsigned int max_queued;    /* Most buffers ever awaiting a write */
+    unsigned int segments;      /* # of segment files written to */
+};
+
+/**
+ * @return true if direct (O_DIRECT) writes are supported on this platform
+ */
+bool rx_writer_direct_supported(void);
+
+/**
+ * @return true if file preallocation is supported on this platform
+ */
+bool rx_writer_prealloc_supported(void);
+
+/**
+ * Form the name of a segment file
+ *
+ * @param   path        Output path
+ * @param   segment     Segment number
+ *
+ * @return Heap-allocated file name, or NULL on allocation failure
+ */
+char *rx_writer_segment_path(const char *path, unsigned int segment);
+
+/**
+ * Allocate the writer's buffers and start its thread
+ *
+ * The RX task's output file (the first segment's file, for segmented
+ * recordings) must already be open, and its write_samples callback must
+ * be set.
+ *
+ * @param[out]  writer  Writer handle
+ * @param[in]   rx      RX data handle
+ * @param[in]   config  Writer configuration
+ *
+ * @return 0 on success, CLI_RET_* on failure
+ */
+int rx_writer_start(struct rx_writer **writer, struct rxtx_data *rx,
+                    const struct rx_writer_config *config);
+
+/**
+ * Get the next free buffer. This does not block.
+ *
+ * @param   writer  Writer handle
+ *
+ * @return A buffer large enough for samples_per_buffer samples, or NULL if
+ *         all of the buffers are awaiting a write. In the latter case, the
+ *         caller should call rx_writer_drop() for the samples it was not
+ *         able to queue.
+ */
+void *rx_writer_acquire(struct rx_writer *writer);
+
+/**
+ * Queue the buffer most recently returned by rx_writer_acquire() for writing
+ *
+ * @param   writer      Writer handle
+ * @param   n_samples   Number of samples in the buffer to write
+ * @param   timestamp   Timestamp of the first sample. Only used for
+ *                      segmented recordings.
+ * @param   flags       RX_INDEX_FLAG_* conditions preceding the first sample.
+ *                      Only used for segmented recordings.
+ *
+ * @return 0 on success, or the CLI_RET_* error that stopped the writer
+ */
+int rx_writer_submit(struct rx_writer *writer, size_t n_samples,
+                     uint64_t timestamp, uint32_t flags);
+
+/**
+ * Account for a block of samples that could not be queued
+ *
+ * @param   writer      Writer handle
+ */
+void rx_writer_drop(struct rx_writer *writer);
+
+/**
+ * Write any queued buffers, stop the writer thread and free the writer
+ *
+ * @param[in]   writer      Writer handle
+ * @param[out]  stats       Writer statistics. May be NULL.
+ *
+ * @return 0 on success, or the CLI_RET_* error that stopped the writer
+ */
+int rx_writer_stop(struct rx_writer *writer, struct rx_writer_stats *stats);
+
+#endif
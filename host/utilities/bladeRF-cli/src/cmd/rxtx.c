@@ -283,6 +283,11 @@ struct rxtx_data *rxtx_data_alloc(bladerf_module module)
             return NULL;
         } else {
             rx_params->n_samples = 100000;
+            rx_params->writer_buffers = RX_WRITER_BUFFERS_DEFAULT;
+            rx_params->direct = false;
+            rx_params->prealloc = false;
+            rx_params->segment_samples = 0;
+            memset(&rx_params->stats, 0, sizeof(rx_params->stats));
             ret->params = rx_params;
         }
     } else {
@@ -618,15 +623,19 @@ int rxtx_cmd_stop(struct cli_state *s, struct rxtx_data *rxtx)
 
 void rxtx_task_exec_idle(struct rxtx_data *rxtx, unsigned char *requests)
 {
-    /* Wait until we're asked to start or shutdown */
-    while (!(*requests & (RXTX_TASK_REQ_START | RXTX_TASK_REQ_SHUTDOWN))) {
-
-        MUTEX_LOCK(&rxtx->task_mgmt.lock);
+    /* Wait until we're asked to start or shutdown. The pending requests are
+     * checked under the lock before waiting, such that a request submitted
+     * while we were on our way back to IDLE is not missed. */
+    MUTEX_LOCK(&rxtx->task_mgmt.lock);
+    while (!(rxtx->task_mgmt.req &
+             (RXTX_TASK_REQ_START | RXTX_TASK_REQ_SHUTDOWN))) {
         pthread_cond_wait(&rxtx->task_mgmt.signal_req, &rxtx->task_mgmt.lock);
-        *requests = rxtx->task_mgmt.req;
-        MUTEX_UNLOCK(&rxtx->task_mgmt.lock);
     }
 
+    *requests = rxtx->task_mgmt.req;
+    rxtx->task_mgmt.req &= ~RXTX_TASK_REQ_START;
+    MUTEX_UNLOCK(&rxtx->task_mgmt.lock);
+
     if (*requests & RXTX_TASK_REQ_SHUTDOWN) {
         rxtx_set_state(rxtx, RXTX_STATE_SHUTDOWN);
     } else if (*requests & RXTX_TASK_REQ_START) {
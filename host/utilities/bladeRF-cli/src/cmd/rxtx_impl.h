@@ -31,6 +31,7 @@
 #include "cmd.h"
 #include "conversions.h"
 #include "thread.h"
+#include "rx_writer.h"
 
 #define RXTX_ERRMSG_VALUE(param, value) \
     "Invalid value for \"%s\" (%s)\n", param, value
@@ -142,6 +143,13 @@ struct rx_params
 {
     size_t n_samples;           /* Number of samples to receive */
     int (*write_samples)(struct rxtx_data *rx, int16_t *samples, size_t n);
+
+    unsigned int writer_buffers;    /* # of buffers in the writer's ring */
+    bool direct;                    /* Use O_DIRECT writes */
+    bool prealloc;                  /* Preallocate the output file */
+    unsigned int segment_samples;   /* Samples per segment file, or 0 to
+                                     *   record to a single file */
+    struct rx_writer_stats stats;   /* Writer stats from the last capture */
 };
 
 /* Multipliers in units of 1024 */